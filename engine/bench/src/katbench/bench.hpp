@@ -0,0 +1,55 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Benchmarks register with KAT_BENCH and report through report(). Each runs its workload several times and
+// keeps the best time, like texcook --bench.
+namespace kat::bench {
+
+    struct Settings {
+        size_t count = 0;        // workload size, 0 for the benchmark's default
+        uint32_t iterations = 5; // repetitions, the best one is reported
+    };
+
+    using FNBENCH = void(const Settings &settings);
+
+    struct Benchmark {
+        const char *name;
+        const char *description;
+        FNBENCH *fn;
+    };
+
+    std::vector<Benchmark> &benchmarks();
+
+    struct Registrar {
+        Registrar(_In_ const char *name, _In_ const char *description, _In_ FNBENCH *fn) {
+            benchmarks().push_back(Benchmark{name, description, fn});
+        }
+    };
+
+    // best wall time of fn over the iterations, in seconds
+    template<typename F>
+    double best(_In_ uint32_t iterations, F &&fn) {
+        double best = 1e30;
+        for (uint32_t i = 0; i < iterations; i++) {
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return best;
+    }
+
+    // "<label>: <ms> ms, <items/s> M<unit>/s (best of n)"
+    void report(_In_ const char *label, _In_ double seconds, _In_ size_t items, _In_ const char *unit, _In_ uint32_t iterations);
+}// namespace kat::bench
+
+#define KAT_BENCH(name, description)                                                                                       \
+    static void name##Bench(const ::kat::bench::Settings &settings);                                                       \
+    static ::kat::bench::Registrar name##Registrar(#name, description, name##Bench);                                       \
+    static void name##Bench(const ::kat::bench::Settings &settings)
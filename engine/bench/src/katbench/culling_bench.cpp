@@ -0,0 +1,69 @@
+#include "kat/culling.hpp"
+#include "kat/transform.hpp"
+
+#include "bench.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <string>
+
+namespace {
+    using namespace kat;
+
+    const char *pathName(_In_ CullPath path) {
+        switch (path) {
+            case CullPath::SCALAR:
+                return "scalar";
+            case CullPath::SSE:
+                return "sse";
+            case CullPath::AVX2:
+                return "avx2";
+            default:
+                return "auto";
+        }
+    }
+}// namespace
+
+KAT_BENCH(culling, "frustum culling of spheres and boxes, per path, 1 and 4 views (default 100k entities)") {
+    const size_t count = settings.count > 0 ? settings.count : 100'000;
+
+    // a grid with about a third of it in view
+    entt::registry registry;
+    const auto side = static_cast<size_t>(std::cbrt(static_cast<double>(count))) + 1;
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 position(static_cast<float>(i % side), static_cast<float>(i / side % side), -static_cast<float>(i / (side * side)));
+        position = position * 4.0f - glm::vec3(side * 2.0f, side * 2.0f, 0.0f);
+
+        entt::entity entity = registry.create();
+        registry.emplace<WorldTransform>(entity, glm::translate(glm::mat4(1.0f), position));
+        if (i % 2 == 0) {
+            registry.emplace<BoundingSphere>(entity, glm::vec3(0.0f), 1.0f);
+        } else {
+            registry.emplace<BoundingBox>(entity, glm::vec3(-1.0f), glm::vec3(1.0f));
+        }
+    }
+
+    CullingSystem culling;
+    double gather = bench::best(settings.iterations, [&] { culling.gather(registry); });
+    bench::report("gather", gather, count, "entities", settings.iterations);
+
+    const glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(70.0f), 16.0f / 9.0f, 0.1f, static_cast<float>(side) * 4.0f);
+    std::vector<Frustum> views;
+    for (int v = 0; v < 4; v++) {
+        views.push_back(Frustum::fromMatrix(projection * glm::lookAtRH(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(v * 10.0f - 15.0f, 0.0f, -100.0f), glm::vec3(0.0f, 1.0f, 0.0f))));
+    }
+
+    for (CullPath path : {CullPath::SCALAR, CullPath::SSE, CullPath::AVX2}) {
+        if (path == CullPath::AVX2 && CullingSystem::bestPath() != CullPath::AVX2) continue;
+
+        for (size_t viewCount : {size_t{1}, size_t{4}}) {
+            std::vector<std::vector<entt::entity>> visible(viewCount);
+            double seconds = bench::best(settings.iterations, [&] { culling.cull({views.data(), viewCount}, visible, path); });
+
+            std::string label = std::string(pathName(path)) + ", " + std::to_string(viewCount) + (viewCount == 1 ? " view" : " views") + ", " +
+                                std::to_string(visible[0].size()) + " visible in the first";
+            bench::report(label.c_str(), seconds, count * viewCount, "tests", settings.iterations);
+        }
+    }
+}
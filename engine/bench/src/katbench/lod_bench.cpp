@@ -0,0 +1,61 @@
+#include "kat/lod.hpp"
+#include "kat/render_world.hpp"
+#include "kat/transform.hpp"
+
+#include "bench.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <random>
+#include <string>
+
+KAT_BENCH(lod, "LodSystem::update with a still and a moving camera, 1 and 4 views (default 100k entities)") {
+    using namespace kat;
+
+    const size_t count = settings.count > 0 ? settings.count : 100'000;
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> coordinate(-500.0f, 500.0f);
+
+    // five levels, each twice as coarse as the one before, spread over a square kilometre
+    entt::registry registry;
+    for (size_t i = 0; i < count; i++) {
+        entt::entity entity = registry.create();
+        registry.emplace<WorldTransform>(entity, glm::translate(glm::mat4(1.0f), glm::vec3(coordinate(random), 0.0f, coordinate(random))));
+
+        Lod lod;
+        lod.count = 5;
+        for (uint32_t level = 0; level < lod.count; level++) {
+            lod.meshes[level] = level;
+            lod.errors[level] = level == 0 ? 0.0f : 0.01f * static_cast<float>(1u << level);
+        }
+        registry.emplace<Lod>(entity, lod);
+        registry.emplace<Renderable>(entity);
+    }
+
+    const glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 2000.0f);
+    LodSystem lods;
+
+    for (size_t viewCount : {size_t{1}, size_t{4}}) {
+        std::vector<LodView> views;
+        for (size_t v = 0; v < viewCount; v++) {
+            views.push_back(LodView::perspective(glm::vec3(static_cast<float>(v) * 50.0f, 10.0f, 0.0f), projection, 1080.0f));
+        }
+
+        // after the first update nothing changes, this is the cost of only checking
+        lods.update(registry, views);
+        double still = bench::best(settings.iterations, [&] { lods.update(registry, views); });
+        std::string label = std::to_string(viewCount) + (viewCount == 1 ? " view" : " views") + ", still";
+        bench::report(label.c_str(), still, count * viewCount, "selections", settings.iterations);
+
+        // a camera moving 5 units per update, so levels change every time and the primary view's get patched
+        size_t changed = 0;
+        double moving = bench::best(settings.iterations, [&] {
+            for (LodView &view : views) view.position.x += 5.0f;
+            lods.update(registry, views);
+            changed = lods.changed();
+        });
+        label = std::to_string(viewCount) + (viewCount == 1 ? " view" : " views") + ", moving, " + std::to_string(changed) + " changed";
+        bench::report(label.c_str(), moving, count * viewCount, "selections", settings.iterations);
+    }
+}
@@ -0,0 +1,103 @@
+#include "kat/core.hpp"
+#include "kat/jobs.hpp"
+
+#include "bench.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+namespace kat::bench {
+
+    std::vector<Benchmark> &benchmarks() {
+        static std::vector<Benchmark> registered;
+        return registered;
+    }
+
+    void report(_In_ const char *label, _In_ double seconds, _In_ size_t items, _In_ const char *unit, _In_ uint32_t iterations) {
+        std::printf("%s: %.2f ms, %.1f M%s/s (best of %u)\n", label, seconds * 1000.0, static_cast<double>(items) / seconds / 1e6, unit, iterations);
+    }
+}// namespace kat::bench
+
+namespace {
+    using namespace kat;
+
+    void usage() {
+        std::puts("usage: katbench [options] [benchmark...]\n"
+                  "\n"
+                  "Runs the named benchmarks, every one without any.\n"
+                  "\n"
+                  "options:\n"
+                  "  --count <n>          workload size (default depends on the benchmark)\n"
+                  "  --iterations <n>     repetitions, the best is reported (default 5)\n"
+                  "  --list               list the benchmarks\n"
+                  "\n"
+                  "benchmarks:");
+        for (const bench::Benchmark &b : bench::benchmarks()) {
+            std::printf("  %-20s %s\n", b.name, b.description);
+        }
+    }
+}// namespace
+
+int main(int argc, char **argv) {
+    bench::Settings settings{};
+    std::vector<std::string_view> selected;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        auto value = [&]() -> std::string_view {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "missing value for %s\n", argv[i]);
+                std::exit(EXIT_FAILURE);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help" || arg == "--list") {
+            usage();
+            return EXIT_SUCCESS;
+        } else if (arg == "--count") {
+            settings.count = std::stoull(std::string(value()));
+        } else if (arg == "--iterations") {
+            settings.iterations = std::max(1u, static_cast<uint32_t>(std::stoul(std::string(value()))));
+        } else {
+            selected.push_back(arg);
+        }
+    }
+
+    spdlog::set_level(spdlog::level::warn);
+
+    // only what cpu side code reaches through the global accessors
+    globalState = new GlobalState();
+    globalState->jobSystem = std::make_unique<JobSystem>();
+    std::printf("%u job workers\n", jobSystem().workerCount());
+
+    int result = EXIT_SUCCESS;
+    try {
+        for (const std::string_view name : selected) {
+            auto it = std::find_if(bench::benchmarks().begin(), bench::benchmarks().end(), [&](const bench::Benchmark &b) { return name == b.name; });
+            if (it == bench::benchmarks().end()) {
+                std::fprintf(stderr, "unknown benchmark '%.*s'\n", static_cast<int>(name.size()), name.data());
+                result = EXIT_FAILURE;
+            }
+        }
+
+        for (const bench::Benchmark &b : bench::benchmarks()) {
+            if (!selected.empty() && std::find(selected.begin(), selected.end(), b.name) == selected.end()) continue;
+            std::printf("%s\n", b.name);
+            b.fn(settings);
+        }
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        result = EXIT_FAILURE;
+    }
+
+    globalState->jobSystem.reset();
+    delete globalState;
+    globalState = nullptr;
+    return result;
+}
@@ -0,0 +1,62 @@
+#include "kat/culling.hpp"
+#include "kat/prefab.hpp"
+#include "kat/spatial_index.hpp"
+#include "kat/transform.hpp"
+
+#include "bench.hpp"
+
+#include <memory>
+#include <string>
+
+namespace {
+    using namespace kat;
+
+    // a registry, optionally with the systems listening to construction of the prefab's components
+    struct World {
+        entt::registry registry;
+        std::unique_ptr<TransformHierarchy> transforms;
+        std::unique_ptr<SpatialIndex> spatial;
+
+        explicit World(_In_ bool listeners) {
+            if (!listeners) return;
+            transforms = std::make_unique<TransformHierarchy>(registry);
+            spatial = std::make_unique<SpatialIndex>(registry);
+        }
+    };
+
+    // fn runs once per iteration on a fresh world, set up and torn down outside the timing
+    template<typename F>
+    double timeFresh(_In_ uint32_t iterations, _In_ bool listeners, F &&fn) {
+        std::vector<std::unique_ptr<World>> worlds;
+        for (uint32_t i = 0; i < iterations; i++) worlds.push_back(std::make_unique<World>(listeners));
+
+        uint32_t run = 0;
+        return bench::best(iterations, [&] { fn(worlds[run++]->registry); });
+    }
+}// namespace
+
+KAT_BENCH(prefab, "Prefab::instantiate against one entity at a time, without and with listeners (default 100k entities)") {
+    const size_t count = settings.count > 0 ? settings.count : 100'000;
+    const Transform transform{};
+    const BoundingBox box{glm::vec3(-1.0f), glm::vec3(1.0f)};
+
+    Prefab prefab;
+    prefab.set(transform).set(WorldTransform{}).set(box);
+
+    for (bool listeners : {false, true}) {
+        const std::string suffix = listeners ? ", transform hierarchy and spatial index listening" : ", no listeners";
+
+        double bulk = timeFresh(settings.iterations, listeners, [&](entt::registry &registry) { (void) prefab.instantiate(registry, count); });
+        bench::report(("prefab" + suffix).c_str(), bulk, count, "entities", settings.iterations);
+
+        double single = timeFresh(settings.iterations, listeners, [&](entt::registry &registry) {
+            for (size_t i = 0; i < count; i++) {
+                entt::entity entity = registry.create();
+                registry.emplace<Transform>(entity, transform);
+                registry.emplace<WorldTransform>(entity);
+                registry.emplace<BoundingBox>(entity, box);
+            }
+        });
+        bench::report(("one at a time" + suffix).c_str(), single, count, "entities", settings.iterations);
+    }
+}
@@ -0,0 +1,58 @@
+#include "kat/radix_sort.hpp"
+
+#include "bench.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+KAT_BENCH(radixSort, "RadixSorter against std::sort and std::stable_sort on key/value pairs (default 1M keys)") {
+    using namespace kat;
+
+    const size_t count = settings.count > 0 ? settings.count : 1'000'000;
+    std::mt19937_64 random(1);
+
+    // full width keys take all eight passes, draw sort style keys (a few bits of state over a depth) fewer
+    std::vector<uint64_t> fullKeys(count), drawKeys(count);
+    for (size_t i = 0; i < count; i++) {
+        fullKeys[i] = random();
+        drawKeys[i] = (random() & 0xFF) << 32 | (random() & 0xFFFFFF);
+    }
+
+    RadixSorter sorter;
+    std::vector<uint64_t> keys(count);
+    std::vector<uint32_t> values(count);
+    std::vector<std::pair<uint64_t, uint32_t>> pairs(count);
+
+    // every run sorts a fresh copy, the copy is part of each timing
+    for (const auto &[name, input] : {std::pair{"full keys", &fullKeys}, std::pair{"draw keys", &drawKeys}}) {
+        double radix = bench::best(settings.iterations, [&] {
+            keys = *input;
+            std::iota(values.begin(), values.end(), 0u);
+            sorter.sort(keys, values);
+        });
+        bench::report((std::string(name) + ", radix").c_str(), radix, count, "keys", settings.iterations);
+
+        auto fill = [&] {
+            for (size_t i = 0; i < count; i++) pairs[i] = {(*input)[i], static_cast<uint32_t>(i)};
+        };
+        auto byKey = [](const auto &a, const auto &b) { return a.first < b.first; };
+
+        double sort = bench::best(settings.iterations, [&] {
+            fill();
+            std::sort(pairs.begin(), pairs.end(), byKey);
+        });
+        bench::report((std::string(name) + ", std::sort").c_str(), sort, count, "keys", settings.iterations);
+
+        double stable = bench::best(settings.iterations, [&] {
+            fill();
+            std::stable_sort(pairs.begin(), pairs.end(), byKey);
+        });
+        bench::report((std::string(name) + ", std::stable_sort").c_str(), stable, count, "keys", settings.iterations);
+
+        if (!std::is_sorted(keys.begin(), keys.end())) throw std::runtime_error("RadixSorter left the keys unsorted");
+    }
+}
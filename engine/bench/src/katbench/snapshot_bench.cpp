@@ -0,0 +1,44 @@
+#include "kat/snapshot.hpp"
+#include "kat/transform.hpp"
+
+#include "bench.hpp"
+
+#include <memory>
+#include <random>
+#include <string>
+
+KAT_BENCH(snapshot, "Snapshot save (capture + encode) and load (decode + merge) of a Transform/Parent scene, no disk (default 50k entities)") {
+    using namespace kat;
+
+    const size_t count = settings.count > 0 ? settings.count : 50'000;
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> coordinate(-500.0f, 500.0f);
+
+    // a level's worth of objects, most of them attached to another one
+    entt::registry registry;
+    std::vector<entt::entity> entities;
+    entities.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        entt::entity entity = registry.create();
+        registry.emplace<Transform>(entity, Transform{.position = {coordinate(random), 0.0f, coordinate(random)}});
+        if (i % 4 != 0) {
+            registry.emplace<Parent>(entity, Parent{entities[std::uniform_int_distribution<size_t>(0, entities.size() - 1)(random)]});
+        }
+        entities.push_back(entity);
+    }
+
+    const SnapshotTypes types = engineSnapshotTypes();
+
+    std::vector<std::byte> file;
+    double save = bench::best(settings.iterations, [&] { file = Snapshot::capture(registry, types).encode(); });
+    std::string label = "save, " + std::to_string(file.size() / 1024) + " KiB file";
+    bench::report(label.c_str(), save, count, "entities", settings.iterations);
+
+    // each load merges into a fresh registry, set up and torn down outside the timing
+    std::vector<std::unique_ptr<entt::registry>> targets;
+    for (uint32_t i = 0; i < settings.iterations; i++) targets.push_back(std::make_unique<entt::registry>());
+
+    uint32_t run = 0;
+    double load = bench::best(settings.iterations, [&] { (void) Snapshot::decode(file, types).merge(*targets[run++]); });
+    bench::report("load", load, count, "entities", settings.iterations);
+}
@@ -0,0 +1,127 @@
+// Culls every instance against its mesh's bounding sphere and appends one indexed draw per survivor.
+// Layouts mirror GpuInstance, GpuMesh, CullPush and vk::DrawIndexedIndirectCommand in kat/gpu_scene.*, the first
+// three are checked against the compiled shader when GpuScene is created.
+//
+// Included by cull.comp (frustum only) and cull_occlusion.comp (frustum and hi-z, defines OCCLUSION).
+
+layout(local_size_x = 64) in;
+
+struct Instance {
+    mat4 model;
+    uint mesh;
+    uint padding[3];
+};
+
+struct Mesh {
+    vec4 sphere; // local space center and radius
+    uint indexCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint padding;
+};
+
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Instances { Instance instances[]; };
+layout(std430, set = 0, binding = 1) readonly buffer Meshes { Mesh meshes[]; };
+layout(std430, set = 0, binding = 2) writeonly buffer Draws { DrawCommand draws[]; };
+layout(std430, set = 0, binding = 3) buffer DrawCount { uint drawCount; };
+layout(std430, set = 0, binding = 4) buffer Visibility { uint visibility[]; }; // last result per instance
+
+// CullPhase
+const uint PHASE_ALL = 0;
+const uint PHASE_EARLY = 1; // only what was visible last time, no occlusion
+const uint PHASE_LATE = 2;  // everything, draws only what the early phase skipped
+
+layout(push_constant) uniform Push {
+    mat4 viewProjection;
+    uint instanceCount;
+    uint phase;
+    vec2 pyramidSize;
+    uint pyramidLevels;
+};
+
+#ifdef OCCLUSION
+layout(set = 1, binding = 0) uniform sampler2D pyramid;
+
+// projects the sphere's bounding box and compares its nearest depth with the farthest depth stored in the
+// pyramid over the covered area, at the level where that area is at most 2x2 texels
+bool occluded(vec3 center, float radius) {
+    vec2 uvMin = vec2(1.0), uvMax = vec2(0.0);
+    float nearest = 1.0;
+
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = viewProjection * vec4(corner, 1.0);
+        if (clip.w <= 0.0) return false; // reaches behind the camera
+
+        vec3 ndc = clip.xyz / clip.w;
+        vec2 uv = ndc.xy * 0.5 + 0.5;
+        uvMin = min(uvMin, uv);
+        uvMax = max(uvMax, uv);
+        nearest = min(nearest, ndc.z);
+    }
+
+    uvMin = clamp(uvMin, 0.0, 1.0);
+    uvMax = clamp(uvMax, 0.0, 1.0);
+
+    vec2 extent = (uvMax - uvMin) * pyramidSize;
+    int level = min(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), int(pyramidLevels) - 1);
+
+    ivec2 levelSize = max(ivec2(pyramidSize) >> level, ivec2(1));
+    ivec2 a = clamp(ivec2(uvMin * vec2(levelSize)), ivec2(0), levelSize - 1);
+    ivec2 b = clamp(ivec2(uvMax * vec2(levelSize)), ivec2(0), levelSize - 1);
+
+    float farthest = 0.0;
+    for (int y = a.y; y <= b.y; y++) {
+        for (int x = a.x; x <= b.x; x++) {
+            farthest = max(farthest, texelFetch(pyramid, ivec2(x, y), level).r);
+        }
+    }
+
+    return nearest > farthest;
+}
+#endif
+
+bool insideFrustum(vec3 center, float radius) {
+    mat4 m = transpose(viewProjection);
+    vec4 planes[6] = vec4[](m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[2], m[3] - m[2]);
+
+    for (int i = 0; i < 6; i++) {
+        vec4 plane = planes[i] / length(planes[i].xyz);
+        if (dot(plane.xyz, center) + plane.w < -radius) return false;
+    }
+    return true;
+}
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= instanceCount) return;
+
+    bool wasVisible = visibility[index] != 0;
+    if (phase == PHASE_EARLY && !wasVisible) return;
+
+    Instance instance = instances[index];
+    Mesh mesh = meshes[instance.mesh];
+
+    vec3 center = (instance.model * vec4(mesh.sphere.xyz, 1.0)).xyz;
+    vec3 axisX = instance.model[0].xyz, axisY = instance.model[1].xyz, axisZ = instance.model[2].xyz;
+    float radius = mesh.sphere.w * sqrt(max(dot(axisX, axisX), max(dot(axisY, axisY), dot(axisZ, axisZ))));
+
+    bool visible = insideFrustum(center, radius);
+#ifdef OCCLUSION
+    if (visible && phase == PHASE_LATE) visible = !occluded(center, radius);
+#endif
+
+    if (phase != PHASE_EARLY) visibility[index] = visible ? 1 : 0;
+    if (!visible || (phase == PHASE_LATE && wasVisible)) return;
+
+    uint slot = atomicAdd(drawCount, 1);
+    draws[slot] = DrawCommand(mesh.indexCount, 1, mesh.firstIndex, mesh.vertexOffset, index);
+}
@@ -0,0 +1,19 @@
+#version 460
+
+// One line per instance, see DebugDraw::LineInstance. Drawn as a line list with two vertices.
+
+layout(location = 0) in vec3 from;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec3 to;
+
+layout(push_constant) uniform Push {
+    mat4 viewProjection;
+    vec2 viewportSize;
+};
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    gl_Position = viewProjection * vec4(gl_VertexIndex == 0 ? from : to, 1.0);
+    outColor = color;
+}
@@ -0,0 +1,13 @@
+#version 460
+
+layout(location = 0) in vec4 color;
+layout(location = 1) in vec2 pixel;
+layout(location = 2) flat in uint bits;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    uvec2 p = min(uvec2(pixel), uvec2(2, 4));
+    if (((bits >> (p.y * 3 + p.x)) & 1u) == 0u) discard;
+    outColor = color;
+}
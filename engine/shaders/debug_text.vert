@@ -0,0 +1,39 @@
+#version 460
+
+// One character per instance, see DebugDraw::GlyphInstance. A 3x5 pixel glyph cell placed in screen space next
+// to the projected anchor, drawn as a 4 vertex triangle strip.
+
+layout(location = 0) in vec3 anchor;
+layout(location = 1) in vec4 color;
+layout(location = 2) in uint bits;
+layout(location = 3) in ivec2 cell;
+layout(location = 4) in float scale;
+
+layout(push_constant) uniform Push {
+    mat4 viewProjection;
+    vec2 viewportSize;
+};
+
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec2 outPixel;
+layout(location = 2) flat out uint outBits;
+
+const vec2 GLYPH = vec2(3.0, 5.0);
+const vec2 ADVANCE = vec2(4.0, 6.0);
+
+void main() {
+    vec4 clip = viewProjection * vec4(anchor, 1.0);
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+
+    // behind the camera: emit a degenerate quad outside the clip volume
+    if (clip.w <= 0.0) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+    } else {
+        vec2 pixels = (vec2(cell) * ADVANCE + corner * GLYPH) * scale;
+        gl_Position = clip + vec4(pixels * 2.0 / viewportSize * clip.w, 0.0, 0.0);
+    }
+
+    outColor = color;
+    outPixel = corner * GLYPH;
+    outBits = bits;
+}
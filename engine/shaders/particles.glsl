@@ -0,0 +1,66 @@
+// Shared by the particle passes. Layouts mirror GpuParticle, GpuParticleEmitter, GpuParticleState and
+// ParticlePush in kat/particles.*, they are checked against the compiled shaders when ParticleSystem is created.
+//
+// The particle buffer has two halves of capacity particles each. source is the half holding last frame's
+// particles, survivors and new spawns are appended to the other one.
+
+struct Particle {
+    vec3 position;
+    float age;
+    vec3 velocity;
+    float lifetime;
+    vec4 color;
+};
+
+struct Emitter {
+    vec3 position;
+    uint first; // of this frame's spawns
+    vec3 velocity;
+    float spread;
+    vec4 color;
+    float lifetime;
+    uint count;
+    uint padding[2];
+};
+
+layout(std430, set = 0, binding = 0) buffer State {
+    uint count[2];
+    uint dropped;
+    uint statePadding;
+    uvec4 simulateArgs; // vk::DispatchIndirectCommand
+    uvec4 drawArgs;     // vk::DrawIndirectCommand
+};
+
+layout(std430, set = 0, binding = 1) buffer Particles { Particle particles[]; };
+layout(std430, set = 0, binding = 2) readonly buffer Emitters { Emitter emitters[]; };
+
+layout(push_constant) uniform Push {
+    vec3 gravity;
+    float deltaTime;
+    uint source;
+    uint capacity;
+    uint spawnCount;
+    uint firstEmitter; // this frame's slot in emitters
+    uint emitterCount;
+    uint seed;
+    float drag;
+};
+
+uint target() {
+    return 1u - source;
+}
+
+// lowbias32, a good enough integer hash for spawn jitter
+uint hash(uint x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+float random(inout uint state) {
+    state = hash(state);
+    return float(state) / 4294967295.0;
+}
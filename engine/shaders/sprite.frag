@@ -0,0 +1,12 @@
+#version 460
+
+layout(set = 0, binding = 0) uniform sampler2DArray image;
+
+layout(location = 0) in vec4 color;
+layout(location = 1) in vec3 uv;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = texture(image, uv) * color;
+}
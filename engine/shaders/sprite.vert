@@ -0,0 +1,27 @@
+#version 460
+
+// One sprite per instance, see kat::SpriteInstance. Drawn as a 4 vertex triangle strip.
+
+layout(location = 0) in vec2 axisX;
+layout(location = 1) in vec2 axisY;
+layout(location = 2) in vec2 origin;
+layout(location = 3) in float z;
+layout(location = 4) in vec4 color;
+layout(location = 5) in vec4 uv;
+layout(location = 6) in uint arrayLayer;
+
+layout(push_constant) uniform Push {
+    mat4 viewProjection;
+};
+
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec3 outUv;
+
+void main() {
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+    vec2 position = origin + corner.x * axisX + corner.y * axisY;
+    gl_Position = viewProjection * vec4(position, z, 1.0);
+
+    outColor = color;
+    outUv = vec3(mix(uv.xy, uv.zw, corner), float(arrayLayer));
+}
@@ -0,0 +1,271 @@
+#include "bindless.hpp"
+#include "kat/gpu_sync.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+namespace kat {
+
+    namespace {
+        constexpr vk::DescriptorType TYPES[] = {
+                vk::DescriptorType::eSampledImage,
+                vk::DescriptorType::eStorageBuffer,
+                vk::DescriptorType::eSampler,
+        };
+    }// namespace
+
+    BindlessHeap::BindlessHeap(_In_ const BindlessSettings &settings) : m_Indexing(globalState->descriptorIndexing) {
+        vk::Device device = globalState->device;
+
+        auto properties = globalState->physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+        const auto &limits = properties.get<vk::PhysicalDeviceProperties2>().properties.limits;
+        const auto &limits12 = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+
+        if (m_Indexing) {
+            m_Tables[TEXTURE].capacity = std::min({settings.maxTextures, limits12.maxPerStageDescriptorUpdateAfterBindSampledImages, limits12.maxDescriptorSetUpdateAfterBindSampledImages});
+            m_Tables[STORAGE_BUFFER].capacity = std::min({settings.maxStorageBuffers, limits12.maxPerStageDescriptorUpdateAfterBindStorageBuffers, limits12.maxDescriptorSetUpdateAfterBindStorageBuffers});
+            m_Tables[SAMPLER].capacity = std::min({settings.maxSamplers, limits12.maxPerStageDescriptorUpdateAfterBindSamplers, limits12.maxDescriptorSetUpdateAfterBindSamplers});
+        } else {
+            // leave a little room for whatever else a pipeline binds next to the heap
+            auto headroom = [](uint32_t limit) { return limit > 8 ? limit - 4 : limit; };
+            m_Tables[TEXTURE].capacity = std::min(settings.maxTextures, headroom(limits.maxPerStageDescriptorSampledImages));
+            m_Tables[STORAGE_BUFFER].capacity = std::min(settings.maxStorageBuffers, headroom(limits.maxPerStageDescriptorStorageBuffers));
+            m_Tables[SAMPLER].capacity = std::min(settings.maxSamplers, headroom(limits.maxPerStageDescriptorSamplers));
+            spdlog::warn("Descriptor indexing unavailable, bindless heap limited to {} textures, {} storage buffers and {} samplers",
+                         m_Tables[TEXTURE].capacity, m_Tables[STORAGE_BUFFER].capacity, m_Tables[SAMPLER].capacity);
+        }
+
+        std::array<vk::DescriptorSetLayoutBinding, KIND_COUNT> bindings;
+        std::array<vk::DescriptorBindingFlags, KIND_COUNT> bindingFlags;
+        std::array<vk::DescriptorPoolSize, KIND_COUNT> poolSizes;
+        const uint32_t setCount = m_Indexing ? 1 : FRAMES_IN_FLIGHT;
+        for (uint32_t kind = 0; kind < KIND_COUNT; kind++) {
+            bindings[kind] = vk::DescriptorSetLayoutBinding{kind, TYPES[kind], m_Tables[kind].capacity, vk::ShaderStageFlagBits::eAll};
+            bindingFlags[kind] = m_Indexing ? vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending | vk::DescriptorBindingFlagBits::ePartiallyBound
+                                            : vk::DescriptorBindingFlags{};
+            poolSizes[kind] = vk::DescriptorPoolSize{TYPES[kind], m_Tables[kind].capacity * setCount};
+        }
+
+        vk::DescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{bindingFlags};
+        vk::DescriptorSetLayoutCreateInfo dslci{{}, bindings};
+        vk::DescriptorPoolCreateInfo dpci{{}, setCount, poolSizes};
+        if (m_Indexing) {
+            dslci.flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool;
+            dslci.pNext = &flagsInfo;
+            dpci.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind;
+        }
+        m_SetLayout = device.createDescriptorSetLayout(dslci);
+        m_Pool = device.createDescriptorPool(dpci);
+
+        std::vector<vk::DescriptorSetLayout> layouts(setCount, m_SetLayout);
+        m_Sets = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo{m_Pool, layouts});
+
+        if (!m_Indexing) {
+            createDefaults();
+
+            // every slot has to hold something valid before a set is first bound
+            std::vector<Write> fill;
+            for (uint32_t kind = 0; kind < KIND_COUNT; kind++) {
+                for (uint32_t i = 0; i < m_Tables[kind].capacity; i++) {
+                    fill.push_back(defaultWrite(static_cast<Kind>(kind), i));
+                }
+            }
+            for (vk::DescriptorSet set : m_Sets) {
+                apply(set, fill);
+            }
+        }
+    }
+
+    BindlessHeap::~BindlessHeap() {
+        // frames in flight may still be bound to the sets and sample the default texture
+        DeletionQueue &deletions = deletionQueue();
+        deletions.destroy(m_Pool);
+        deletions.destroy(m_SetLayout);
+        deletions.destroy(m_DefaultSampler);
+        deletions.destroy(m_DefaultView);
+        deletions.defer([image = m_DefaultImage, memory = m_DefaultImageMemory] {
+            if (image) globalState->device.destroyImage(image);
+            if (memory) globalState->device.freeMemory(memory);
+        });
+    }
+
+    TextureHandle BindlessHeap::addTexture(_In_ vk::ImageView view, _In_ vk::ImageLayout layout) {
+        std::scoped_lock lock(m_Mutex);
+        uint32_t index = allocate(TEXTURE);
+        write({TEXTURE, index, vk::DescriptorImageInfo{nullptr, view, layout}, {}});
+        return {index};
+    }
+
+    StorageBufferHandle BindlessHeap::addStorageBuffer(_In_ vk::Buffer buffer, _In_ vk::DeviceSize offset, _In_ vk::DeviceSize range) {
+        std::scoped_lock lock(m_Mutex);
+        uint32_t index = allocate(STORAGE_BUFFER);
+        write({STORAGE_BUFFER, index, {}, vk::DescriptorBufferInfo{buffer, offset, range}});
+        return {index};
+    }
+
+    SamplerHandle BindlessHeap::addSampler(_In_ vk::Sampler sampler) {
+        std::scoped_lock lock(m_Mutex);
+        uint32_t index = allocate(SAMPLER);
+        write({SAMPLER, index, vk::DescriptorImageInfo{sampler}, {}});
+        return {index};
+    }
+
+    void BindlessHeap::free(_In_ TextureHandle handle) {
+        if (handle.valid()) release(TEXTURE, handle.index);
+    }
+
+    void BindlessHeap::free(_In_ StorageBufferHandle handle) {
+        if (handle.valid()) release(STORAGE_BUFFER, handle.index);
+    }
+
+    void BindlessHeap::free(_In_ SamplerHandle handle) {
+        if (handle.valid()) release(SAMPLER, handle.index);
+    }
+
+    void BindlessHeap::nextFrame(_In_ uint64_t frameIndex) {
+        std::scoped_lock lock(m_Mutex);
+        const auto frame = static_cast<uint32_t>(frameIndex % FRAMES_IN_FLIGHT);
+
+        // retired during this slot's previous frame, which the caller just waited for
+        for (Table &table : m_Tables) {
+            table.free.insert(table.free.end(), table.retired[frame].begin(), table.retired[frame].end());
+            table.retired[frame].clear();
+        }
+        m_Retire = frame;
+
+        if (!m_Indexing) {
+            m_Current = frame;
+            apply(m_Sets[frame], m_Pending[frame]);
+            m_Pending[frame].clear();
+        }
+    }
+
+    void BindlessHeap::bind(_In_ vk::CommandBuffer cmd, _In_ vk::PipelineBindPoint bindPoint, _In_ vk::PipelineLayout layout, _In_ uint32_t set) const {
+        std::scoped_lock lock(m_Mutex);
+        cmd.bindDescriptorSets(bindPoint, layout, set, m_Sets[m_Current], {});
+    }
+
+    vk::DescriptorSetLayout BindlessHeap::setLayout() const noexcept {
+        return m_SetLayout;
+    }
+
+    bool BindlessHeap::indexing() const noexcept {
+        return m_Indexing;
+    }
+
+    uint32_t BindlessHeap::textureCapacity() const noexcept {
+        return m_Tables[TEXTURE].capacity;
+    }
+
+    uint32_t BindlessHeap::storageBufferCapacity() const noexcept {
+        return m_Tables[STORAGE_BUFFER].capacity;
+    }
+
+    uint32_t BindlessHeap::samplerCapacity() const noexcept {
+        return m_Tables[SAMPLER].capacity;
+    }
+
+    uint32_t BindlessHeap::allocate(_In_ Kind kind) {
+        Table &table = m_Tables[kind];
+        if (!table.free.empty()) {
+            uint32_t index = table.free.back();
+            table.free.pop_back();
+            return index;
+        }
+        if (table.used >= table.capacity) {
+            throw std::runtime_error("Bindless heap is full");
+        }
+        return table.used++;
+    }
+
+    void BindlessHeap::release(_In_ Kind kind, _In_ uint32_t index) {
+        std::scoped_lock lock(m_Mutex);
+        m_Tables[kind].retired[m_Retire].push_back(index);
+
+        // without partially bound descriptors the slot must not keep pointing at something about to be destroyed
+        if (!m_Indexing) write(defaultWrite(kind, index));
+    }
+
+    void BindlessHeap::write(_In_ const Write &write) {
+        if (m_Indexing) {
+            apply(m_Sets[0], {&write, 1});
+            return;
+        }
+        for (auto &pending : m_Pending) {
+            pending.push_back(write);
+        }
+    }
+
+    void BindlessHeap::apply(_In_ vk::DescriptorSet set, _In_ std::span<const Write> writes) const {
+        if (writes.empty()) return;
+
+        std::vector<vk::WriteDescriptorSet> updates;
+        updates.reserve(writes.size());
+        for (const Write &w : writes) {
+            vk::WriteDescriptorSet update{set, static_cast<uint32_t>(w.kind), w.index, 1, TYPES[w.kind]};
+            if (w.kind == STORAGE_BUFFER) {
+                update.pBufferInfo = &w.buffer;
+            } else {
+                update.pImageInfo = &w.image;
+            }
+            updates.push_back(update);
+        }
+        globalState->device.updateDescriptorSets(updates, {});
+    }
+
+    BindlessHeap::Write BindlessHeap::defaultWrite(_In_ Kind kind, _In_ uint32_t index) const {
+        switch (kind) {
+            case TEXTURE:
+                return {kind, index, vk::DescriptorImageInfo{nullptr, m_DefaultView, vk::ImageLayout::eShaderReadOnlyOptimal}, {}};
+            case STORAGE_BUFFER:
+                return {kind, index, {}, vk::DescriptorBufferInfo{m_DefaultBuffer.handle(), 0, VK_WHOLE_SIZE}};
+            default:
+                return {kind, index, vk::DescriptorImageInfo{m_DefaultSampler}, {}};
+        }
+    }
+
+    void BindlessHeap::createDefaults() {
+        vk::Device device = globalState->device;
+
+        vk::ImageCreateInfo ici{};
+        ici.imageType = vk::ImageType::e2D;
+        ici.format = vk::Format::eR8G8B8A8Unorm;
+        ici.extent = vk::Extent3D{1, 1, 1};
+        ici.mipLevels = 1;
+        ici.arrayLayers = 1;
+        ici.samples = vk::SampleCountFlagBits::e1;
+        ici.tiling = vk::ImageTiling::eOptimal;
+        ici.usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
+        m_DefaultImage = device.createImage(ici);
+
+        vk::MemoryRequirements requirements = device.getImageMemoryRequirements(m_DefaultImage);
+        m_DefaultImageMemory = device.allocateMemory(vk::MemoryAllocateInfo{requirements.size, findMemoryType(requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal)});
+        device.bindImageMemory(m_DefaultImage, m_DefaultImageMemory, 0);
+
+        vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+        m_DefaultView = device.createImageView(vk::ImageViewCreateInfo{{}, m_DefaultImage, vk::ImageViewType::e2D, ici.format, {}, range});
+
+        m_DefaultBuffer = Buffer(256, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal);
+        m_DefaultSampler = device.createSampler(vk::SamplerCreateInfo{});
+
+        // magenta, so a missing texture is obvious
+        submitImmediate([&](vk::CommandBuffer cmd) {
+            vk::ImageMemoryBarrier toTransfer{{}, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+                                              VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, m_DefaultImage, range};
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, toTransfer);
+
+            cmd.clearColorImage(m_DefaultImage, vk::ImageLayout::eTransferDstOptimal, vk::ClearColorValue{std::array<float, 4>{1.0f, 0.0f, 1.0f, 1.0f}}, range);
+            cmd.fillBuffer(m_DefaultBuffer.handle(), 0, VK_WHOLE_SIZE, 0);
+
+            vk::ImageMemoryBarrier toShader{vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                                            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, m_DefaultImage, range};
+            vk::MemoryBarrier bufferWritten{vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead};
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, {}, bufferWritten, {}, toShader);
+        });
+    }
+
+    BindlessHeap &bindless() {
+        return *globalState->bindless;
+    }
+}// namespace kat
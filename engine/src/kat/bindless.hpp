@@ -0,0 +1,132 @@
+#pragma once
+
+#include "kat/core.hpp"
+#include "kat/gpu.hpp"
+
+#include <array>
+#include <mutex>
+#include <vector>
+
+namespace kat {
+
+    template<typename Tag>
+    struct BindlessHandle {
+        static constexpr uint32_t INVALID = ~0u;
+
+        uint32_t index = INVALID;
+
+        [[nodiscard]] bool valid() const noexcept { return index != INVALID; }
+        bool operator==(const BindlessHandle &) const = default;
+    };
+
+    using TextureHandle = BindlessHandle<struct BindlessTextureTag>;
+    using StorageBufferHandle = BindlessHandle<struct BindlessStorageBufferTag>;
+    using SamplerHandle = BindlessHandle<struct BindlessSamplerTag>;
+
+    struct BindlessSettings {
+        uint32_t maxTextures = 16384;
+        uint32_t maxStorageBuffers = 8192;
+        uint32_t maxSamplers = 256;
+    };
+
+    // One global descriptor set holding every texture, storage buffer and sampler in large arrays. Resources are
+    // addressed by the handle's index, so materials become plain integers in push constants or buffers and the
+    // set is bound once per pipeline layout rather than per draw. In glsl:
+    //
+    //   layout(set = N, binding = 0) uniform texture2D textures[];
+    //   layout(set = N, binding = 1) buffer Buffers { uint data[]; } buffers[];
+    //   layout(set = N, binding = 2) uniform sampler samplers[];
+    //
+    // With descriptor indexing the set is update-after-bind and partially bound: writes land immediately and
+    // empty slots are fine. Without it there is one set per frame in flight, writes are replayed into each as
+    // it comes up in nextFrame() (so they are visible from the next frame), every empty slot points at a
+    // default resource, the arrays shrink to the device's per-stage limits and indices must be dynamically
+    // uniform. The *Capacity() accessors say how big the arrays really are.
+    //
+    // Freed handles are recycled FRAMES_IN_FLIGHT frames later, once no frame that could use them is in flight.
+    // The resource itself has to stay alive at least that long as well.
+    class BindlessHeap {
+      public:
+        KAT_TRACKED_CLASS(MemoryTag::CORE);
+
+        explicit BindlessHeap(_In_ const BindlessSettings &settings = {});
+        ~BindlessHeap();
+
+        BindlessHeap(const BindlessHeap &) = delete;
+        BindlessHeap &operator=(const BindlessHeap &) = delete;
+
+        // thread safe
+        [[nodiscard]] TextureHandle addTexture(_In_ vk::ImageView view, _In_ vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+        [[nodiscard]] StorageBufferHandle addStorageBuffer(_In_ vk::Buffer buffer, _In_ vk::DeviceSize offset = 0, _In_ vk::DeviceSize range = VK_WHOLE_SIZE);
+        [[nodiscard]] SamplerHandle addSampler(_In_ vk::Sampler sampler);
+
+        // thread safe. invalid handles are ignored.
+        void free(_In_ TextureHandle handle);
+        void free(_In_ StorageBufferHandle handle);
+        void free(_In_ SamplerHandle handle);
+
+        // call once per frame, after waiting for the frame that last used frameIndex % FRAMES_IN_FLIGHT
+        void nextFrame(_In_ uint64_t frameIndex);
+
+        void bind(_In_ vk::CommandBuffer cmd, _In_ vk::PipelineBindPoint bindPoint, _In_ vk::PipelineLayout layout, _In_ uint32_t set) const;
+
+        [[nodiscard]] vk::DescriptorSetLayout setLayout() const noexcept;
+        [[nodiscard]] bool indexing() const noexcept;
+
+        // array sizes, after clamping to device limits
+        [[nodiscard]] uint32_t textureCapacity() const noexcept;
+        [[nodiscard]] uint32_t storageBufferCapacity() const noexcept;
+        [[nodiscard]] uint32_t samplerCapacity() const noexcept;
+
+      private:
+        enum Kind : uint32_t {
+            TEXTURE,
+            STORAGE_BUFFER,
+            SAMPLER,
+            KIND_COUNT,
+        };
+
+        struct Table {
+            uint32_t capacity = 0;
+            uint32_t used = 0; // high water mark, slots below it are either live or on a list
+            std::vector<uint32_t> free;
+            std::array<std::vector<uint32_t>, FRAMES_IN_FLIGHT> retired;
+        };
+
+        struct Write {
+            Kind kind;
+            uint32_t index;
+            vk::DescriptorImageInfo image;
+            vk::DescriptorBufferInfo buffer;
+        };
+
+        bool m_Indexing;
+        std::array<Table, KIND_COUNT> m_Tables;
+
+        vk::DescriptorSetLayout m_SetLayout;
+        vk::DescriptorPool m_Pool;
+        std::vector<vk::DescriptorSet> m_Sets; // one with indexing, FRAMES_IN_FLIGHT without
+        uint32_t m_Current = 0; // the set bind() uses, always 0 with indexing
+        uint32_t m_Retire = 0;  // frame slot releases retire into, in both modes
+
+        // only without indexing: writes not yet applied to each frame's set, and what empty slots point at
+        std::array<std::vector<Write>, FRAMES_IN_FLIGHT> m_Pending;
+        vk::Image m_DefaultImage;
+        vk::DeviceMemory m_DefaultImageMemory;
+        vk::ImageView m_DefaultView;
+        Buffer m_DefaultBuffer;
+        vk::Sampler m_DefaultSampler;
+
+        mutable std::mutex m_Mutex;
+
+        uint32_t allocate(_In_ Kind kind);
+        void release(_In_ Kind kind, _In_ uint32_t index);
+        void write(_In_ const Write &write);
+        void apply(_In_ vk::DescriptorSet set, _In_ std::span<const Write> writes) const;
+        [[nodiscard]] Write defaultWrite(_In_ Kind kind, _In_ uint32_t index) const;
+
+        void createDefaults();
+    };
+
+    [[nodiscard]] BindlessHeap &bindless();
+}// namespace kat
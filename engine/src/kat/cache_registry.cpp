@@ -0,0 +1,162 @@
+#include "cache_registry.hpp"
+
+#include "kat/window.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+namespace kat {
+
+    CacheRegistry::CacheRegistry() {
+        OnNewWindow.connect<&CacheRegistry::onNewWindow>(*this);
+        for (const auto &[id, window] : globalState->windows) {
+            onNewWindow(id, window);
+        }
+    }
+
+    CacheRegistry::~CacheRegistry() {
+        OnNewWindow.disconnect(this);
+        for (const auto &[id, window] : globalState->windows) {
+            if (window) window->OnLowMemory.disconnect(this);
+        }
+    }
+
+    CacheId CacheRegistry::add(_In_ CacheInfo &&info) {
+        CacheId id = m_NextId++;
+        m_Caches.push_back(Cache{id, std::move(info)});
+        return id;
+    }
+
+    void CacheRegistry::remove(_In_ CacheId id) {
+        std::erase_if(m_Caches, [id](const Cache &cache) { return cache.id == id; });
+    }
+
+    void CacheRegistry::update() {
+        m_Frame++;
+
+        for (CacheMemory memory : {CacheMemory::HOST, CacheMemory::DEVICE}) {
+            const size_t held = size(memory);
+            const size_t budget = m_Budget[static_cast<size_t>(memory)];
+            if (held > budget) {
+                size_t &debt = m_Debt[static_cast<size_t>(memory)];
+                debt = std::max(debt, held - budget);
+            }
+        }
+        if (globalState->memoryBudget && m_Frame % HEAP_POLL_INTERVAL == 0) {
+            pollDeviceHeaps();
+        }
+
+        using Clock = std::chrono::steady_clock;
+        const auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(m_TimeSlice));
+        for (CacheMemory memory : {CacheMemory::HOST, CacheMemory::DEVICE}) {
+            if (m_Debt[static_cast<size_t>(memory)] > 0) evict(memory, deadline);
+        }
+    }
+
+    void CacheRegistry::setBudget(_In_ CacheMemory memory, _In_ size_t bytes) noexcept {
+        m_Budget[static_cast<size_t>(memory)] = bytes;
+    }
+
+    void CacheRegistry::setLowMemoryTrim(_In_ float fraction) noexcept {
+        m_LowMemoryTrim = std::clamp(fraction, 0.0f, 1.0f);
+    }
+
+    void CacheRegistry::setDeviceHeapTarget(_In_ float fraction) noexcept {
+        m_DeviceHeapTarget = std::clamp(fraction, 0.0f, 1.0f);
+    }
+
+    void CacheRegistry::setTimeSlice(_In_ float seconds) noexcept {
+        m_TimeSlice = seconds;
+    }
+
+    void CacheRegistry::trim(_In_ CacheMemory memory, _In_ size_t bytes) noexcept {
+        size_t &debt = m_Debt[static_cast<size_t>(memory)];
+        debt = std::max(debt, bytes);
+    }
+
+    uint64_t CacheRegistry::frame() const noexcept {
+        return m_Frame;
+    }
+
+    size_t CacheRegistry::size(_In_ CacheMemory memory) const {
+        size_t total = 0;
+        for (const Cache &cache : m_Caches) {
+            if (cache.info.memory == memory) total += cache.info.size();
+        }
+        return total;
+    }
+
+    std::vector<CacheStats> CacheRegistry::stats() const {
+        std::vector<CacheStats> stats;
+        stats.reserve(m_Caches.size());
+        for (const Cache &cache : m_Caches) {
+            stats.push_back(CacheStats{cache.info.name, cache.info.memory, cache.info.size()});
+        }
+        return stats;
+    }
+
+    // caches can only give back device memory, so the trim is what's over the target of the fullest heap. other
+    // processes and non-cache allocations count toward usage too, which is the point: it's the driver's view.
+    void CacheRegistry::pollDeviceHeaps() {
+        auto properties = globalState->physicalDevice.getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2, vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        const vk::PhysicalDeviceMemoryProperties &memory = properties.get<vk::PhysicalDeviceMemoryProperties2>().memoryProperties;
+        const auto &budget = properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+
+        size_t over = 0;
+        for (uint32_t heap = 0; heap < memory.memoryHeapCount; heap++) {
+            if (!(memory.memoryHeaps[heap].flags & vk::MemoryHeapFlagBits::eDeviceLocal)) continue;
+
+            auto target = static_cast<vk::DeviceSize>(static_cast<double>(budget.heapBudget[heap]) * m_DeviceHeapTarget);
+            if (budget.heapUsage[heap] > target) {
+                over = std::max(over, static_cast<size_t>(budget.heapUsage[heap] - target));
+            }
+        }
+        if (over > 0 && m_Debt[static_cast<size_t>(CacheMemory::DEVICE)] == 0) {
+            spdlog::debug("Device heap over {}% of its budget, trimming {} bytes of caches", static_cast<int>(m_DeviceHeapTarget * 100.0f), over);
+        }
+        trim(CacheMemory::DEVICE, over);
+    }
+
+    void CacheRegistry::evict(_In_ CacheMemory memory, _In_ std::chrono::steady_clock::time_point deadline) {
+        size_t &debt = m_Debt[static_cast<size_t>(memory)];
+
+        for (bool first = true; debt > 0 && (first || std::chrono::steady_clock::now() < deadline); first = false) {
+            // lowest priority, then least recently used
+            Cache *victim = nullptr;
+            uint64_t victimOldest = CACHE_EMPTY;
+            for (Cache &cache : m_Caches) {
+                if (cache.info.memory != memory) continue;
+
+                uint64_t oldest = cache.info.oldest();
+                if (oldest == CACHE_EMPTY) continue;
+                if (!victim || cache.info.priority < victim->info.priority || (cache.info.priority == victim->info.priority && oldest < victimOldest)) {
+                    victim = &cache;
+                    victimOldest = oldest;
+                }
+            }
+
+            size_t freed = victim ? victim->info.evict(std::min(debt, EVICT_STEP)) : 0;
+            if (freed == 0) {
+                debt = 0; // nothing left that can go
+                return;
+            }
+            debt -= std::min(debt, freed);
+        }
+    }
+
+    void CacheRegistry::onNewWindow(_In_ size_t, _In_ const std::unique_ptr<Window> &window) {
+        window->OnLowMemory.connect<&CacheRegistry::onLowMemory>(*this);
+    }
+
+    // WM_COMPACTING: the system spends a noticeable share of its time paging
+    void CacheRegistry::onLowMemory() {
+        size_t bytes = static_cast<size_t>(static_cast<double>(size(CacheMemory::HOST)) * m_LowMemoryTrim);
+        spdlog::info("Low system memory, trimming {} bytes of caches", bytes);
+        trim(CacheMemory::HOST, bytes);
+    }
+
+    CacheRegistry &caches() {
+        return *globalState->caches;
+    }
+}// namespace kat
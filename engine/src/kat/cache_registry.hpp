@@ -0,0 +1,200 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace kat {
+
+    enum class CacheMemory : uint8_t {
+        HOST,   // system memory, trimmed on WM_COMPACTING and past the host budget
+        DEVICE, // gpu memory, trimmed past the device budget and when a heap nears its VK_EXT_memory_budget budget
+    };
+
+    inline constexpr uint64_t CACHE_EMPTY = std::numeric_limits<uint64_t>::max();
+
+    struct CacheInfo {
+        std::string name;
+        CacheMemory memory = CacheMemory::HOST;
+        int32_t priority = 0; // lower is evicted first
+
+        // bytes held
+        std::function<size_t()> size;
+        // CacheRegistry::frame() of the least recently used entry, CACHE_EMPTY if there is none
+        std::function<uint64_t()> oldest;
+        // drops least recently used entries until about bytes are freed, returns how many were. called with small
+        // amounts, so it never has to take long.
+        std::function<size_t(size_t bytes)> evict;
+    };
+
+    using CacheId = uint32_t;
+
+    struct CacheStats {
+        std::string name;
+        CacheMemory memory;
+        size_t size;
+    };
+
+    // Every cache of the engine registers here with its size and a way to evict from it. Once a budget is
+    // exceeded, or the os or driver report pressure, update() evicts across caches: lowest priority first, least
+    // recently used first within a priority, a bounded amount of time per frame until enough is freed.
+    //
+    // Main thread only.
+    class CacheRegistry {
+      public:
+        KAT_TRACKED_CLASS(MemoryTag::CORE);
+
+        CacheRegistry();
+        ~CacheRegistry();
+
+        CacheRegistry(const CacheRegistry &) = delete;
+        CacheRegistry &operator=(const CacheRegistry &) = delete;
+
+        CacheId add(_In_ CacheInfo &&info);
+        void remove(_In_ CacheId id);
+
+        // called by kat::pollMessages once per frame
+        void update();
+
+        // bytes the caches of a kind may hold together. host defaults to 1 GiB, device to no limit beyond what
+        // VK_EXT_memory_budget reports.
+        void setBudget(_In_ CacheMemory memory, _In_ size_t bytes) noexcept;
+        // fraction of host cache bytes freed when the os reports low memory (default 0.5)
+        void setLowMemoryTrim(_In_ float fraction) noexcept;
+        // start evicting device caches once a device local heap uses more than this fraction of its budget (default 0.9)
+        void setDeviceHeapTarget(_In_ float fraction) noexcept;
+        // seconds of eviction per update, at least one step always runs (default 1 ms)
+        void setTimeSlice(_In_ float seconds) noexcept;
+
+        // asks for bytes to be freed from caches of a kind, over the next updates
+        void trim(_In_ CacheMemory memory, _In_ size_t bytes) noexcept;
+
+        // incremented by every update, caches stamp their entries with it
+        [[nodiscard]] uint64_t frame() const noexcept;
+        [[nodiscard]] size_t size(_In_ CacheMemory memory) const;
+        [[nodiscard]] std::vector<CacheStats> stats() const;
+
+      private:
+        static constexpr size_t EVICT_STEP = 4 * 1024 * 1024; // bytes asked of a cache at once
+        static constexpr uint32_t HEAP_POLL_INTERVAL = 30; // frames between VK_EXT_memory_budget queries
+
+        struct Cache {
+            CacheId id;
+            CacheInfo info;
+        };
+
+        std::vector<Cache> m_Caches;
+        CacheId m_NextId = 1;
+        uint64_t m_Frame = 0;
+
+        size_t m_Budget[2] = {1024ull * 1024 * 1024, std::numeric_limits<size_t>::max()};
+        size_t m_Debt[2] = {0, 0}; // bytes still to be freed, by CacheMemory
+        float m_LowMemoryTrim = 0.5f;
+        float m_DeviceHeapTarget = 0.9f;
+        float m_TimeSlice = 0.001f;
+
+        void pollDeviceHeaps();
+        void evict(_In_ CacheMemory memory, _In_ std::chrono::steady_clock::time_point deadline);
+
+        void onNewWindow(_In_ size_t id, _In_ const std::unique_ptr<Window> &window);
+        void onLowMemory();
+    };
+
+    [[nodiscard]] CacheRegistry &caches();
+
+    // A least recently used map that registers itself with caches(). Evicted values are destroyed right away, so
+    // values holding gpu resources the gpu may still be using should hand them to deletionQueue() when destroyed.
+    // Main thread only.
+    template<typename Key, typename Value, typename Hash = std::hash<Key>>
+    class LruCache {
+      public:
+        LruCache(_In_ std::string name, _In_ CacheMemory memory, _In_ int32_t priority = 0) {
+            m_Id = caches().add(CacheInfo{std::move(name), memory, priority, [this] { return m_Size; },
+                                          [this] { return m_Entries.empty() ? CACHE_EMPTY : m_Entries.back().used; },
+                                          [this](size_t bytes) { return evict(bytes); }});
+        }
+
+        ~LruCache() {
+            if (globalState && globalState->caches) caches().remove(m_Id);
+        }
+
+        LruCache(const LruCache &) = delete;
+        LruCache &operator=(const LruCache &) = delete;
+
+        // nullptr if absent. marks the entry used.
+        [[nodiscard]] Value *find(_In_ const Key &key) {
+            auto it = m_Index.find(key);
+            if (it == m_Index.end()) return nullptr;
+
+            it->second->used = caches().frame();
+            m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+            return &it->second->value;
+        }
+
+        // replaces an existing entry. bytes is what the value keeps alive, in the cache's kind of memory.
+        Value &insert(_In_ const Key &key, _In_ Value &&value, _In_ size_t bytes) {
+            erase(key);
+            m_Entries.push_front(Entry{key, std::move(value), bytes, caches().frame()});
+            m_Index.emplace(key, m_Entries.begin());
+            m_Size += bytes;
+            return m_Entries.front().value;
+        }
+
+        bool erase(_In_ const Key &key) {
+            auto it = m_Index.find(key);
+            if (it == m_Index.end()) return false;
+
+            m_Size -= it->second->bytes;
+            m_Entries.erase(it->second);
+            m_Index.erase(it);
+            return true;
+        }
+
+        void clear() {
+            m_Index.clear();
+            m_Entries.clear();
+            m_Size = 0;
+        }
+
+        // least recently used first
+        size_t evict(_In_ size_t bytes) {
+            size_t freed = 0;
+            while (freed < bytes && !m_Entries.empty()) {
+                Entry &entry = m_Entries.back();
+                freed += entry.bytes;
+                m_Size -= entry.bytes;
+                m_Index.erase(entry.key);
+                m_Entries.pop_back();
+            }
+            return freed;
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return m_Size;
+        }
+
+        [[nodiscard]] size_t count() const noexcept {
+            return m_Entries.size();
+        }
+
+      private:
+        struct Entry {
+            Key key;
+            Value value;
+            size_t bytes;
+            uint64_t used;
+        };
+
+        CacheId m_Id;
+        std::list<Entry> m_Entries; // most recently used first
+        std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> m_Index;
+        size_t m_Size = 0;
+    };
+}// namespace kat
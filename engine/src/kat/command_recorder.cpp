@@ -0,0 +1,87 @@
+#include "command_recorder.hpp"
+
+#include "kat/jobs.hpp"
+
+#include <algorithm>
+
+namespace kat {
+
+    CommandRecorder::CommandRecorder(_In_ uint32_t queueFamily) : m_ThreadCount(jobSystem().threadSlotCount()) {
+        vk::Device device = globalState->device;
+
+        for (auto &pools : m_Pools) {
+            pools = std::make_unique<ThreadPool[]>(m_ThreadCount);
+            for (uint32_t i = 0; i < m_ThreadCount; i++) {
+                pools[i].pool = device.createCommandPool(vk::CommandPoolCreateInfo{vk::CommandPoolCreateFlagBits::eTransient, queueFamily});
+            }
+        }
+    }
+
+    CommandRecorder::~CommandRecorder() {
+        vk::Device device = globalState->device;
+
+        for (auto &pools : m_Pools) {
+            for (uint32_t i = 0; i < m_ThreadCount; i++) {
+                if (pools[i].pool) device.destroyCommandPool(pools[i].pool); // frees its buffers
+            }
+        }
+    }
+
+    void CommandRecorder::beginFrame(_In_ uint64_t frame) {
+        m_Frame = static_cast<uint32_t>(frame % FRAMES_IN_FLIGHT);
+
+        vk::Device device = globalState->device;
+        for (uint32_t i = 0; i < m_ThreadCount; i++) {
+            ThreadPool &pool = m_Pools[m_Frame][i];
+            device.resetCommandPool(pool.pool);
+            pool.usedPrimaries = 0;
+            pool.usedSecondaries = 0;
+        }
+    }
+
+    vk::CommandBuffer CommandRecorder::primary() {
+        return next(vk::CommandBufferLevel::ePrimary);
+    }
+
+    vk::CommandBuffer CommandRecorder::secondary() {
+        return next(vk::CommandBufferLevel::eSecondary);
+    }
+
+    void CommandRecorder::recordParallel(_In_ vk::CommandBuffer primary, _In_ const vk::CommandBufferInheritanceInfo &inheritance,
+                                         _In_ size_t count, _In_ size_t grain, _In_ const std::function<FNRECORDRANGE> &record) {
+        if (count == 0) return;
+
+        grain = std::max<size_t>(grain, 1);
+        std::vector<vk::CommandBuffer> chunks((count + grain - 1) / grain);
+
+        vk::CommandBufferBeginInfo begin{vk::CommandBufferUsageFlagBits::eOneTimeSubmit, &inheritance};
+        if (inheritance.renderPass) {
+            begin.flags |= vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+        }
+
+        // parallelFor hands out chunks of exactly grain items, so first / grain is the chunk's place in the order
+        jobSystem().parallelFor(count, grain, [&](size_t first, size_t last) {
+            vk::CommandBuffer cmd = secondary();
+            cmd.begin(begin);
+            record(cmd, first, last);
+            cmd.end();
+            chunks[first / grain] = cmd;
+        });
+
+        primary.executeCommands(chunks);
+    }
+
+    vk::CommandBuffer CommandRecorder::next(_In_ vk::CommandBufferLevel level) {
+        uint32_t thread = JobSystem::currentWorkerIndex();
+        ThreadPool &pool = m_Pools[m_Frame][thread];
+
+        bool isPrimary = level == vk::CommandBufferLevel::ePrimary;
+        auto &buffers = isPrimary ? pool.primaries : pool.secondaries;
+        size_t &used = isPrimary ? pool.usedPrimaries : pool.usedSecondaries;
+
+        if (used == buffers.size()) {
+            buffers.push_back(globalState->device.allocateCommandBuffers(vk::CommandBufferAllocateInfo{pool.pool, level, 1})[0]);
+        }
+        return buffers[used++];
+    }
+}// namespace kat
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace kat {
+
+    using FNRECORDRANGE = void(vk::CommandBuffer cmd, size_t begin, size_t end);
+
+    // Command pools per frame in flight and per job system thread, so any worker can record without locking.
+    // Buffers handed out during a frame stay valid until the same frame slot comes around again in beginFrame(),
+    // which resets the whole pool instead of individual buffers.
+    //
+    // Threads are told apart by JobSystem::currentWorkerIndex(), which gives every thread its own pool: the main
+    // thread and FramePipeline's render thread can both record, also while one runs the other's recordParallel
+    // jobs. beginFrame() must not overlap recording into the frame slot it resets.
+    class CommandRecorder {
+      public:
+        explicit CommandRecorder(_In_ uint32_t queueFamily = globalState->graphicsQueueFamily);
+        ~CommandRecorder();
+
+        CommandRecorder(const CommandRecorder &) = delete;
+        CommandRecorder &operator=(const CommandRecorder &) = delete;
+
+        // resets every pool of frame % FRAMES_IN_FLIGHT. the gpu has to be done with that frame's last submission.
+        void beginFrame(_In_ uint64_t frame);
+
+        // not begun. valid until the frame slot is reused.
+        [[nodiscard]] vk::CommandBuffer primary();
+        [[nodiscard]] vk::CommandBuffer secondary();
+
+        // splits [0, count) into chunks of grain items, records each into its own secondary buffer on the job
+        // system and executes them into primary in chunk order, so the result doesn't depend on scheduling.
+        //
+        // Inside a render pass, begin it with SECONDARY_COMMAND_BUFFERS contents and pass the render pass and
+        // subpass in inheritance (the framebuffer is optional but helps some drivers). Outside one, leave
+        // inheritance.renderPass null. Secondary buffers inherit no state: bind pipelines, descriptors and
+        // buffers again in every chunk.
+        void recordParallel(_In_ vk::CommandBuffer primary, _In_ const vk::CommandBufferInheritanceInfo &inheritance,
+                            _In_ size_t count, _In_ size_t grain, _In_ const std::function<FNRECORDRANGE> &record);
+
+      private:
+        // one per thread and frame slot, padded so neighbours don't share a cache line while recording
+        struct alignas(64) ThreadPool {
+            vk::CommandPool pool;
+            std::vector<vk::CommandBuffer> primaries;
+            std::vector<vk::CommandBuffer> secondaries;
+            size_t usedPrimaries = 0;
+            size_t usedSecondaries = 0;
+        };
+
+        uint32_t m_ThreadCount;
+        std::array<std::unique_ptr<ThreadPool[]>, FRAMES_IN_FLIGHT> m_Pools;
+        uint32_t m_Frame = 0;
+
+        [[nodiscard]] vk::CommandBuffer next(_In_ vk::CommandBufferLevel level);
+    };
+}// namespace kat
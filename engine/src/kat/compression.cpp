@@ -0,0 +1,262 @@
+#include "compression.hpp"
+
+#include "kat/jobs.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace kat {
+
+    namespace {
+        constexpr size_t MIN_MATCH = 4;
+        constexpr size_t LAST_LITERALS = 5; // the format ends every block with at least this many literals
+        constexpr size_t MATCH_FIND_LIMIT = 12; // and no match may start closer to the end than this
+        constexpr size_t MAX_OFFSET = 65535;
+        constexpr uint32_t HASH_BITS = 14;
+        constexpr uint32_t SKIP_TRIGGER = 6; // step up the search after 2^this bytes without a match
+
+        constexpr uint32_t STORED = 0x80000000u; // block header flag: the block's bytes are uncompressed
+
+        struct BlockHeader {
+            uint32_t rawSize;
+            uint32_t size; // | STORED
+        };
+
+        uint32_t read32(_In_ const uint8_t *p) noexcept {
+            uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        uint32_t hash(_In_ uint32_t sequence) noexcept {
+            return (sequence * 2654435761u) >> (32 - HASH_BITS);
+        }
+
+        uint8_t *writeLength(_Out_ uint8_t *out, _In_ size_t length) noexcept {
+            for (; length >= 255; length -= 255) {
+                *out++ = 255;
+            }
+            *out++ = static_cast<uint8_t>(length);
+            return out;
+        }
+
+        size_t readLength(_Inout_ const uint8_t *&in, _In_ const uint8_t *end) {
+            size_t length = 0;
+            uint8_t byte;
+            do {
+                if (in == end) throw std::runtime_error("Truncated lz4 block");
+                byte = *in++;
+                length += byte;
+            } while (byte == 255);
+            return length;
+        }
+
+        uint8_t *writeSequence(_Out_ uint8_t *out, _In_ const uint8_t *literals, _In_ size_t literalCount, _In_ size_t offset, _In_ size_t match) noexcept {
+            uint8_t *token = out++;
+            *token = static_cast<uint8_t>(std::min<size_t>(literalCount, 15) << 4);
+            if (literalCount >= 15) out = writeLength(out, literalCount - 15);
+            std::copy_n(literals, literalCount, out); // not memcpy, literals is null for an empty input
+            out += literalCount;
+            if (offset == 0) return out; // the last, literals only sequence
+
+            out[0] = static_cast<uint8_t>(offset);
+            out[1] = static_cast<uint8_t>(offset >> 8);
+            out += 2;
+            *token |= static_cast<uint8_t>(std::min<size_t>(match, 15));
+            if (match >= 15) out = writeLength(out, match - 15);
+            return out;
+        }
+
+        template<typename T>
+        void put(_Inout_ std::vector<std::byte> &out, _In_ const T &value) {
+            size_t at = out.size();
+            out.resize(at + sizeof(T));
+            std::memcpy(out.data() + at, &value, sizeof(T));
+        }
+    }// namespace
+
+    size_t lz4CompressBound(_In_ size_t size) noexcept {
+        return size + size / 255 + 16;
+    }
+
+    size_t lz4CompressBlock(_In_ std::span<const std::byte> src, _Out_ std::span<std::byte> dst) {
+        if (dst.size() < lz4CompressBound(src.size())) {
+            throw std::runtime_error("lz4 output buffer too small");
+        }
+
+        const auto *in = reinterpret_cast<const uint8_t *>(src.data());
+        const uint8_t *const end = in + src.size();
+        auto *out = reinterpret_cast<uint8_t *>(dst.data());
+        const uint8_t *anchor = in;
+
+        if (src.size() > MATCH_FIND_LIMIT) {
+            // positions relative to in. entries left over from an earlier block are either behind ip, and then
+            // just a candidate the compare below checks, or ahead of it and skipped.
+            thread_local std::vector<uint32_t> table(size_t{1} << HASH_BITS);
+            const uint8_t *const matchLimit = end - LAST_LITERALS;
+            const uint8_t *const findLimit = end - MATCH_FIND_LIMIT;
+
+            const uint8_t *ip = in;
+            while (ip <= findLimit) {
+                uint32_t sequence = read32(ip);
+                uint32_t &slot = table[hash(sequence)];
+                const uint8_t *ref = in + slot;
+                slot = static_cast<uint32_t>(ip - in);
+
+                if (ref >= ip || static_cast<size_t>(ip - ref) > MAX_OFFSET || read32(ref) != sequence) {
+                    ip += 1 + (static_cast<size_t>(ip - anchor) >> SKIP_TRIGGER);
+                    continue;
+                }
+
+                while (ip > anchor && ref > in && ip[-1] == ref[-1]) {
+                    ip--;
+                    ref--;
+                }
+                const uint8_t *matchEnd = ip + MIN_MATCH;
+                for (const uint8_t *r = ref + MIN_MATCH; matchEnd < matchLimit && *matchEnd == *r; r++) {
+                    matchEnd++;
+                }
+
+                out = writeSequence(out, anchor, static_cast<size_t>(ip - anchor), static_cast<size_t>(ip - ref), static_cast<size_t>(matchEnd - ip) - MIN_MATCH);
+                ip = anchor = matchEnd;
+                if (ip <= findLimit) {
+                    table[hash(read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - in);
+                }
+            }
+        }
+
+        out = writeSequence(out, anchor, static_cast<size_t>(end - anchor), 0, 0);
+        return static_cast<size_t>(out - reinterpret_cast<uint8_t *>(dst.data()));
+    }
+
+    void lz4DecompressBlock(_In_ std::span<const std::byte> src, _Out_ std::span<std::byte> dst) {
+        const auto *in = reinterpret_cast<const uint8_t *>(src.data());
+        const uint8_t *const inEnd = in + src.size();
+        auto *const outBegin = reinterpret_cast<uint8_t *>(dst.data());
+        uint8_t *out = outBegin;
+        uint8_t *const outEnd = out + dst.size();
+
+        while (true) {
+            if (in == inEnd) throw std::runtime_error("Truncated lz4 block");
+            const uint8_t token = *in++;
+
+            size_t literals = token >> 4;
+            if (literals == 15) literals += readLength(in, inEnd);
+            if (literals > static_cast<size_t>(inEnd - in) || literals > static_cast<size_t>(outEnd - out)) {
+                throw std::runtime_error("Malformed lz4 block");
+            }
+            std::copy_n(in, literals, out); // not memcpy, out is null for an empty output
+            in += literals;
+            out += literals;
+            if (in == inEnd) break;
+
+            if (inEnd - in < 2) throw std::runtime_error("Truncated lz4 block");
+            const size_t offset = in[0] | size_t{in[1]} << 8;
+            in += 2;
+            size_t match = token & 15;
+            if (match == 15) match += readLength(in, inEnd);
+            match += MIN_MATCH;
+            if (offset == 0 || offset > static_cast<size_t>(out - outBegin) || match > static_cast<size_t>(outEnd - out)) {
+                throw std::runtime_error("Malformed lz4 block");
+            }
+
+            const uint8_t *ref = out - offset;
+            if (offset >= match) {
+                std::memcpy(out, ref, match);
+                out += match;
+            } else {
+                // overlapping: the match repeats bytes it is writing itself
+                for (size_t i = 0; i < match; i++) {
+                    *out++ = *ref++;
+                }
+            }
+        }
+
+        if (out != outEnd) throw std::runtime_error("lz4 block is shorter than expected");
+    }
+
+    std::vector<std::byte> compress(_In_ std::span<const std::byte> data) {
+        const size_t blockCount = (data.size() + COMPRESSION_BLOCK_SIZE - 1) / COMPRESSION_BLOCK_SIZE;
+        std::vector<std::vector<std::byte>> blocks(blockCount);
+
+        jobSystem().parallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                std::span<const std::byte> raw = data.subspan(i * COMPRESSION_BLOCK_SIZE, std::min(COMPRESSION_BLOCK_SIZE, data.size() - i * COMPRESSION_BLOCK_SIZE));
+                std::vector<std::byte> &block = blocks[i];
+                block.resize(sizeof(BlockHeader) + lz4CompressBound(raw.size()));
+
+                size_t size = lz4CompressBlock(raw, std::span(block).subspan(sizeof(BlockHeader)));
+                BlockHeader header{static_cast<uint32_t>(raw.size()), static_cast<uint32_t>(size)};
+                if (size >= raw.size()) {
+                    std::memcpy(block.data() + sizeof(BlockHeader), raw.data(), raw.size());
+                    header.size = static_cast<uint32_t>(raw.size()) | STORED;
+                    size = raw.size();
+                }
+                std::memcpy(block.data(), &header, sizeof(header));
+                block.resize(sizeof(BlockHeader) + size);
+            }
+        });
+
+        std::vector<std::byte> out;
+        size_t total = sizeof(uint64_t);
+        for (const std::vector<std::byte> &block : blocks) {
+            total += block.size();
+        }
+        out.reserve(total);
+        put(out, static_cast<uint64_t>(data.size()));
+        for (const std::vector<std::byte> &block : blocks) {
+            out.insert(out.end(), block.begin(), block.end());
+        }
+        return out;
+    }
+
+    std::vector<std::byte> decompress(_In_ std::span<const std::byte> data) {
+        struct Block {
+            size_t src;
+            size_t dst;
+            BlockHeader header;
+        };
+
+        if (data.size() < sizeof(uint64_t)) throw std::runtime_error("Truncated compressed stream");
+        uint64_t rawSize;
+        std::memcpy(&rawSize, data.data(), sizeof(rawSize));
+
+        // headers first, so the blocks can be decoded in parallel straight into place
+        std::vector<Block> blocks;
+        size_t src = sizeof(uint64_t);
+        size_t dst = 0;
+        while (src < data.size()) {
+            if (data.size() - src < sizeof(BlockHeader)) throw std::runtime_error("Truncated compressed stream");
+            Block block{src + sizeof(BlockHeader), dst, {}};
+            std::memcpy(&block.header, data.data() + src, sizeof(BlockHeader));
+
+            size_t size = block.header.size & ~STORED;
+            if (size > data.size() - block.src || block.header.rawSize == 0 || block.header.rawSize > COMPRESSION_BLOCK_SIZE || block.header.rawSize > rawSize - dst ||
+                ((block.header.size & STORED) && size != block.header.rawSize)) {
+                throw std::runtime_error("Malformed compressed stream");
+            }
+            blocks.push_back(block);
+            src = block.src + size;
+            dst += block.header.rawSize;
+        }
+        if (dst != rawSize) throw std::runtime_error("Truncated compressed stream");
+        // no more than the blocks can hold, whatever the header claims, before anything that size is allocated
+        if (rawSize > blocks.size() * uint64_t{COMPRESSION_BLOCK_SIZE}) throw std::runtime_error("Malformed compressed stream");
+
+        std::vector<std::byte> out(rawSize);
+        jobSystem().parallelFor(blocks.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const Block &block = blocks[i];
+                std::span<const std::byte> in = data.subspan(block.src, block.header.size & ~STORED);
+                std::span<std::byte> raw = std::span(out).subspan(block.dst, block.header.rawSize);
+                if (block.header.size & STORED) {
+                    std::memcpy(raw.data(), in.data(), raw.size());
+                    continue;
+                }
+                lz4DecompressBlock(in, raw); // throws out of parallelFor
+            }
+        });
+        return out;
+    }
+}// namespace kat
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace kat {
+
+    // input bytes per independently compressed block of a stream
+    inline constexpr size_t COMPRESSION_BLOCK_SIZE = 256 * 1024;
+
+    // LZ4 block format (greedy, single probe hash table): compatible with any LZ4 decoder, and the decoder
+    // below takes any LZ4 block.
+    [[nodiscard]] size_t lz4CompressBound(_In_ size_t size) noexcept;
+
+    // dst needs lz4CompressBound(src.size()) bytes. returns the compressed size.
+    size_t lz4CompressBlock(_In_ std::span<const std::byte> src, _Out_ std::span<std::byte> dst);
+
+    // dst has to be exactly the uncompressed size. throws on malformed input rather than reading or writing
+    // out of bounds.
+    void lz4DecompressBlock(_In_ std::span<const std::byte> src, _Out_ std::span<std::byte> dst);
+
+    // A stream of COMPRESSION_BLOCK_SIZE blocks, each compressed on its own (or stored, if it didn't shrink),
+    // so both directions run in parallel on the job system and a reader can start on the first block before
+    // the rest has arrived.
+    [[nodiscard]] std::vector<std::byte> compress(_In_ std::span<const std::byte> data);
+    // throws on malformed input
+    [[nodiscard]] std::vector<std::byte> decompress(_In_ std::span<const std::byte> data);
+}// namespace kat
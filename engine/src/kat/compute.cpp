@@ -0,0 +1,153 @@
+#include "compute.hpp"
+
+#include "kat/gpu.hpp"
+#include "kat/gpu_sync.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace kat {
+
+    ComputePipeline::ComputePipeline(_In_ std::span<const uint32_t> spirv, _In_ std::span<const LayoutCache::SetOverride> overrides)
+        : m_Reflection(ShaderReflection::reflect(spirv)) {
+        if (m_Reflection.stage != vk::ShaderStageFlagBits::eCompute) {
+            throw std::runtime_error("Not a compute shader");
+        }
+
+        for (const LayoutCache::SetOverride &o : overrides) {
+            m_Overridden.push_back(o.set);
+        }
+        m_SetLayouts = layoutCache().setLayouts({&m_Reflection, 1}, overrides);
+        m_Layout = layoutCache().pipelineLayout({&m_Reflection, 1}, overrides);
+
+        vk::Device device = globalState->device;
+        vk::ShaderModule module = createShaderModule(spirv);
+        vk::ComputePipelineCreateInfo cpci{};
+        cpci.stage = vk::PipelineShaderStageCreateInfo{{}, vk::ShaderStageFlagBits::eCompute, module, m_Reflection.entryPoint.c_str()};
+        cpci.layout = m_Layout;
+        auto pipeline = device.createComputePipeline(nullptr, cpci);
+        device.destroyShaderModule(module);
+        if (pipeline.result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to create compute pipeline");
+        }
+        m_Pipeline = pipeline.value;
+    }
+
+    ComputePipeline::~ComputePipeline() {
+        deletionQueue().destroy(m_Pipeline); // dispatches may still be in flight
+    }
+
+    void ComputePipeline::bind(_In_ vk::CommandBuffer cmd) const {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, m_Pipeline);
+    }
+
+    void ComputePipeline::dispatch(_In_ vk::CommandBuffer cmd, _In_ glm::uvec3 threads) const {
+        glm::uvec3 groups = groupCount(threads);
+        if (groups.x == 0 || groups.y == 0 || groups.z == 0) return;
+        cmd.dispatch(groups.x, groups.y, groups.z);
+    }
+
+    void ComputePipeline::dispatch(_In_ vk::CommandBuffer cmd, _In_ uint32_t threads) const {
+        dispatch(cmd, glm::uvec3(threads, 1, 1));
+    }
+
+    void ComputePipeline::dispatchIndirect(_In_ vk::CommandBuffer cmd, _In_ vk::Buffer buffer, _In_ vk::DeviceSize offset) const {
+        cmd.dispatchIndirect(buffer, offset);
+    }
+
+    glm::uvec3 ComputePipeline::groupCount(_In_ glm::uvec3 threads) const noexcept {
+        glm::uvec3 size = glm::max(m_Reflection.localSize, glm::uvec3(1));
+        return (threads + size - glm::uvec3(1)) / size;
+    }
+
+    vk::Pipeline ComputePipeline::handle() const noexcept {
+        return m_Pipeline;
+    }
+
+    vk::PipelineLayout ComputePipeline::layout() const noexcept {
+        return m_Layout;
+    }
+
+    std::span<const vk::DescriptorSetLayout> ComputePipeline::setLayouts() const noexcept {
+        return m_SetLayouts;
+    }
+
+    const ShaderReflection &ComputePipeline::reflection() const noexcept {
+        return m_Reflection;
+    }
+
+    bool ComputePipeline::overridden(_In_ uint32_t set) const noexcept {
+        return std::find(m_Overridden.begin(), m_Overridden.end(), set) != m_Overridden.end();
+    }
+
+    ComputeBindings::ComputeBindings(_In_ const ComputePipeline &pipeline) : m_Pipeline(pipeline) {
+        vk::Device device = globalState->device;
+        std::span<const vk::DescriptorSetLayout> layouts = pipeline.setLayouts();
+
+        std::vector<vk::DescriptorPoolSize> sizes;
+        std::vector<uint32_t> owned;
+        for (const ShaderReflection::Binding &binding : pipeline.reflection().bindings) {
+            if (pipeline.overridden(binding.set)) continue;
+
+            auto size = std::find_if(sizes.begin(), sizes.end(), [&](const vk::DescriptorPoolSize &s) { return s.type == binding.type; });
+            if (size == sizes.end()) {
+                sizes.push_back(vk::DescriptorPoolSize{binding.type, binding.count});
+            } else {
+                size->descriptorCount += binding.count;
+            }
+            if (owned.empty() || owned.back() != binding.set) {
+                owned.push_back(binding.set);
+            }
+        }
+
+        m_Sets.resize(layouts.size());
+        if (owned.empty()) return;
+
+        m_Pool = device.createDescriptorPool(vk::DescriptorPoolCreateInfo{{}, static_cast<uint32_t>(owned.size()), sizes});
+
+        std::vector<vk::DescriptorSetLayout> ownedLayouts;
+        for (uint32_t set : owned) {
+            ownedLayouts.push_back(layouts[set]);
+        }
+        std::vector<vk::DescriptorSet> sets = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo{m_Pool, ownedLayouts});
+        for (size_t i = 0; i < owned.size(); i++) {
+            m_Sets[owned[i]] = sets[i];
+        }
+    }
+
+    ComputeBindings::~ComputeBindings() {
+        deletionQueue().destroy(m_Pool); // frees the sets with it, once dispatches using them are done
+    }
+
+    ComputeBindings &ComputeBindings::buffer(_In_ uint32_t set, _In_ uint32_t binding, _In_ vk::Buffer buffer, _In_ vk::DeviceSize offset,
+                                             _In_ vk::DeviceSize range) {
+        const ShaderReflection::Binding &reflected = find(set, binding);
+        vk::DescriptorBufferInfo info{buffer, offset, range};
+        globalState->device.updateDescriptorSets(vk::WriteDescriptorSet{m_Sets[set], binding, 0, 1, reflected.type, nullptr, &info}, {});
+        return *this;
+    }
+
+    ComputeBindings &ComputeBindings::image(_In_ uint32_t set, _In_ uint32_t binding, _In_ vk::ImageView view, _In_ vk::ImageLayout layout,
+                                            _In_ vk::Sampler sampler) {
+        const ShaderReflection::Binding &reflected = find(set, binding);
+        vk::DescriptorImageInfo info{sampler, view, layout};
+        globalState->device.updateDescriptorSets(vk::WriteDescriptorSet{m_Sets[set], binding, 0, 1, reflected.type, &info}, {});
+        return *this;
+    }
+
+    void ComputeBindings::bind(_In_ vk::CommandBuffer cmd) const {
+        for (uint32_t set = 0; set < m_Sets.size(); set++) {
+            if (m_Sets[set]) {
+                cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_Pipeline.layout(), set, m_Sets[set], {});
+            }
+        }
+    }
+
+    const ShaderReflection::Binding &ComputeBindings::find(_In_ uint32_t set, _In_ uint32_t binding) const {
+        for (const ShaderReflection::Binding &b : m_Pipeline.reflection().bindings) {
+            if (b.set == set && b.binding == binding && m_Sets[set]) return b;
+        }
+        throw std::runtime_error("The compute shader has no set " + std::to_string(set) + " binding " + std::to_string(binding));
+    }
+}// namespace kat
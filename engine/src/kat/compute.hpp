@@ -0,0 +1,84 @@
+#pragma once
+
+#include "kat/core.hpp"
+#include "kat/layout_cache.hpp"
+#include "kat/shader_reflection.hpp"
+
+#include <span>
+#include <vector>
+
+namespace kat {
+
+    // A compute shader ready to dispatch. Its layout comes from reflecting the SPIR-V through layoutCache(),
+    // so pipelines declaring the same sets share set layouts and bound sets stay valid between them.
+    //
+    // Record on command buffers from any queue family with compute, including computeTimeline()'s.
+    class ComputePipeline {
+      public:
+        explicit ComputePipeline(_In_ std::span<const uint32_t> spirv, _In_ std::span<const LayoutCache::SetOverride> overrides = {});
+        ~ComputePipeline();
+
+        ComputePipeline(const ComputePipeline &) = delete;
+        ComputePipeline &operator=(const ComputePipeline &) = delete;
+
+        void bind(_In_ vk::CommandBuffer cmd) const;
+
+        // the pipeline has to be bound. T is the shader's push constant block.
+        template<typename T>
+        void push(_In_ vk::CommandBuffer cmd, _In_ const T &constants) const {
+            cmd.pushConstants(m_Layout, vk::ShaderStageFlagBits::eCompute, m_Reflection.pushConstantOffset, sizeof(T), &constants);
+        }
+
+        // enough workgroups for threads invocations per dimension, the shader has to bounds check the remainder
+        void dispatch(_In_ vk::CommandBuffer cmd, _In_ glm::uvec3 threads) const;
+        void dispatch(_In_ vk::CommandBuffer cmd, _In_ uint32_t threads) const;
+        // a vk::DispatchIndirectCommand written by an earlier pass
+        void dispatchIndirect(_In_ vk::CommandBuffer cmd, _In_ vk::Buffer buffer, _In_ vk::DeviceSize offset = 0) const;
+
+        [[nodiscard]] glm::uvec3 groupCount(_In_ glm::uvec3 threads) const noexcept;
+
+        [[nodiscard]] vk::Pipeline handle() const noexcept;
+        [[nodiscard]] vk::PipelineLayout layout() const noexcept;
+        [[nodiscard]] std::span<const vk::DescriptorSetLayout> setLayouts() const noexcept;
+        [[nodiscard]] const ShaderReflection &reflection() const noexcept;
+        // set came from the overrides given to the constructor
+        [[nodiscard]] bool overridden(_In_ uint32_t set) const noexcept;
+
+      private:
+        ShaderReflection m_Reflection;
+        std::vector<uint32_t> m_Overridden;
+        std::vector<vk::DescriptorSetLayout> m_SetLayouts; // owned by layoutCache()
+        vk::PipelineLayout m_Layout;                       // owned by layoutCache()
+        vk::Pipeline m_Pipeline;
+    };
+
+    // Descriptor sets for the sets a ComputePipeline declares, except overridden ones, from a pool of their
+    // own. Descriptor types come from reflection.
+    //
+    // Writes are immediate: set everything before the first dispatch, and only change it once the gpu is done
+    // with the sets.
+    class ComputeBindings {
+      public:
+        explicit ComputeBindings(_In_ const ComputePipeline &pipeline);
+        ~ComputeBindings();
+
+        ComputeBindings(const ComputeBindings &) = delete;
+        ComputeBindings &operator=(const ComputeBindings &) = delete;
+
+        ComputeBindings &buffer(_In_ uint32_t set, _In_ uint32_t binding, _In_ vk::Buffer buffer, _In_ vk::DeviceSize offset = 0,
+                                _In_ vk::DeviceSize range = VK_WHOLE_SIZE);
+        // sampler only for combined image samplers
+        ComputeBindings &image(_In_ uint32_t set, _In_ uint32_t binding, _In_ vk::ImageView view, _In_ vk::ImageLayout layout,
+                               _In_ vk::Sampler sampler = {});
+
+        // binds every set it has, with the pipeline's layout
+        void bind(_In_ vk::CommandBuffer cmd) const;
+
+      private:
+        const ComputePipeline &m_Pipeline;
+        vk::DescriptorPool m_Pool;
+        std::vector<vk::DescriptorSet> m_Sets; // by set number, null for overridden sets
+
+        [[nodiscard]] const ShaderReflection::Binding &find(_In_ uint32_t set, _In_ uint32_t binding) const;
+    };
+}// namespace kat
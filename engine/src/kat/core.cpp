@@ -2,6 +2,18 @@
 #include <spdlog/spdlog.h>
 
 #include "kat/window.hpp"
+#include "kat/io.hpp"
+#include "kat/bindless.hpp"
+#include "kat/cache_registry.hpp"
+#include "kat/debug_draw.hpp"
+#include "kat/gpu_sync.hpp"
+#include "kat/jobs.hpp"
+#include "kat/layout_cache.hpp"
+#include "kat/scheduler.hpp"
+#include "kat/transform.hpp"
+
+#include <algorithm>
+#include <string_view>
 
 namespace kat {
 
@@ -11,6 +23,11 @@ namespace kat {
                                       _In_ bool enableDebug,
                                       _Out_opt_ vk::DebugUtilsMessengerEXT *dbgMsngr);
     vk::PhysicalDevice selectPhysicalDevice();
+    vk::Device createDevice(_Out_ uint32_t *queueFamily, _Out_ std::optional<std::pair<uint32_t, uint32_t>> *computeQueue, _Out_ bool *descriptorIndexing,
+                            _Out_ bool *memoryBudget);
+    bool supportsDescriptorIndexing(_In_ const vk::PhysicalDeviceVulkan12Features &features);
+    std::optional<uint32_t> findQueueFamily(_In_ const vk::PhysicalDevice &pd);
+    std::optional<std::pair<uint32_t, uint32_t>> findComputeQueue(_In_ const vk::PhysicalDevice &pd, _In_ uint32_t graphicsFamily);
 
     bool isPhysicalDeviceSupported(_In_ const vk::PhysicalDevice& pd);
     bool isPhysicalDeviceOptimal(_In_ const vk::PhysicalDevice& pd);
@@ -56,6 +73,27 @@ namespace kat {
             globalState->appVersion = initInfo.appVersion;
             globalState->vkInstance = createVulkanInstance(initInfo.appName, initInfo.appVersion, globalState->dldy, initInfo.enableDebug, &globalState->vkDebugMessenger);
             globalState->physicalDevice = selectPhysicalDevice();
+            std::optional<std::pair<uint32_t, uint32_t>> computeQueue;
+            globalState->device = createDevice(&globalState->graphicsQueueFamily, &computeQueue, &globalState->descriptorIndexing, &globalState->memoryBudget);
+            globalState->graphicsQueue = globalState->device.getQueue(globalState->graphicsQueueFamily, 0);
+            globalState->graphicsTimeline = std::make_unique<QueueTimeline>(globalState->graphicsQueue, globalState->graphicsQueueFamily);
+            std::vector<QueueTimeline *> timelines{globalState->graphicsTimeline.get()};
+            if (computeQueue) {
+                vk::Queue queue = globalState->device.getQueue(computeQueue->first, computeQueue->second);
+                globalState->computeTimeline = std::make_unique<QueueTimeline>(queue, computeQueue->first);
+                timelines.push_back(globalState->computeTimeline.get());
+            }
+            globalState->deletionQueue = std::make_unique<DeletionQueue>(std::move(timelines));
+            globalState->caches = std::make_unique<CacheRegistry>();
+            globalState->layoutCache = std::make_unique<LayoutCache>();
+            globalState->bindless = std::make_unique<BindlessHeap>();
+            globalState->jobSystem = std::make_unique<JobSystem>();
+#if KAT_DEBUG_DRAW
+            globalState->debugDraw = std::make_unique<DebugDraw>();
+#endif
+            globalState->ioScheduler = std::make_unique<IoScheduler>();
+            globalState->scheduler = std::make_unique<Scheduler>();
+            globalState->transforms = std::make_unique<TransformHierarchy>(globalState->entt_registry);
 
             WNDCLASSEXW wc{};
             wc.cbSize = sizeof(wc);
@@ -75,14 +113,46 @@ namespace kat {
 
     void terminate() {
         if (globalState) {
+            // stop resuming coroutines first, io and job callbacks may still touch their frames while shutting down
+            globalState->scheduler->shutdown();
+
+            // wait for the gpu once, up front, so everything below can be destroyed directly
+            if (globalState->deletionQueue) {
+                globalState->deletionQueue->flush();
+            }
+
+            globalState->transforms.reset();
+            globalState->bindless.reset();
+#if KAT_DEBUG_DRAW
+            globalState->debugDraw.reset();
+#endif
+            globalState->ioScheduler.reset();
+            globalState->jobSystem.reset();
+            globalState->scheduler.reset();
+            globalState->layoutCache.reset(); // after everyone holding its layouts
+            globalState->caches.reset(); // after the caches registered with it
+
+            // runs whatever the resets above deferred. has to happen before the device, and surfaces before the instance
+            globalState->deletionQueue.reset();
+            globalState->computeTimeline.reset();
+            globalState->graphicsTimeline.reset();
+
+            if (globalState->device) {
+                globalState->device.waitIdle();
+                globalState->device.destroy(vulkanAllocator());
+            }
+
             if (globalState->vkDebugMessenger) {
-                globalState->vkInstance.destroy(globalState->vkDebugMessenger, nullptr, globalState->dldy);
+                globalState->vkInstance.destroy(globalState->vkDebugMessenger, vulkanAllocator(), globalState->dldy);
             }
 
-            globalState->vkInstance.destroy();
+            globalState->vkInstance.destroy(vulkanAllocator());
 
             delete globalState;
             globalState = nullptr;
+
+            // everything the engine tracks should be gone by now
+            reportMemoryLeaks();
         }
     }
 
@@ -120,13 +190,13 @@ namespace kat {
         ici.setPEnabledExtensionNames(extensions).setPEnabledLayerNames(layers);
         ici.pApplicationInfo = &appInfo;
 
-        vk::Instance instance = vk::createInstance(ici);
+        vk::Instance instance = vk::createInstance(ici, vulkanAllocator());
 
         dldy = vk::DispatchLoaderDynamic(instance, vkGetInstanceProcAddr);
         dldy.init(instance);
 
         if (enableDebug && dbgMsngr) {
-            *dbgMsngr = instance.createDebugUtilsMessengerEXT(dci, nullptr, dldy);
+            *dbgMsngr = instance.createDebugUtilsMessengerEXT(dci, vulkanAllocator(), dldy);
         }
 
         return instance;
@@ -156,6 +226,98 @@ namespace kat {
         return supportedDevice;
     }
 
+    vk::Device createDevice(_Out_ uint32_t *queueFamily, _Out_ std::optional<std::pair<uint32_t, uint32_t>> *computeQueue, _Out_ bool *descriptorIndexing,
+                            _Out_ bool *memoryBudget) {
+        *queueFamily = findQueueFamily(globalState->physicalDevice).value();
+        *computeQueue = findComputeQueue(globalState->physicalDevice, *queueFamily);
+
+        auto supported = globalState->physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+        *descriptorIndexing = supportsDescriptorIndexing(supported.get<vk::PhysicalDeviceVulkan12Features>());
+
+        std::array<float, 2> priorities = {1.0f, 1.0f};
+        std::vector<vk::DeviceQueueCreateInfo> qcis = {vk::DeviceQueueCreateInfo{{}, *queueFamily, 1, priorities.data()}};
+        if (*computeQueue && (*computeQueue)->first == *queueFamily) {
+            qcis[0].queueCount = 2;
+        } else if (*computeQueue) {
+            qcis.push_back(vk::DeviceQueueCreateInfo{{}, (*computeQueue)->first, 1, priorities.data()});
+        }
+
+        std::vector<const char *> extensions = {
+                VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+        };
+
+        // optional, CacheRegistry only goes by its own budgets without it
+        auto available = globalState->physicalDevice.enumerateDeviceExtensionProperties();
+        *memoryBudget = std::any_of(available.begin(), available.end(), [](const vk::ExtensionProperties &e) {
+            return std::string_view(e.extensionName.data()) == VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+        });
+        if (*memoryBudget) {
+            extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+
+        // everything enabled here is checked for in isPhysicalDeviceSupported
+        vk::PhysicalDeviceVulkan12Features features12{};
+        features12.drawIndirectCount = VK_TRUE;
+        features12.timelineSemaphore = VK_TRUE;
+
+        // optional, BindlessHeap falls back to per-frame sets without it
+        if (*descriptorIndexing) {
+            features12.runtimeDescriptorArray = VK_TRUE;
+            features12.descriptorBindingPartiallyBound = VK_TRUE;
+            features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+            features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+            features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+            features12.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+        }
+
+        vk::PhysicalDeviceFeatures2 features{};
+        features.features.multiDrawIndirect = VK_TRUE;
+        features.features.drawIndirectFirstInstance = VK_TRUE;
+        features.pNext = &features12;
+
+        vk::DeviceCreateInfo dci{};
+        dci.setQueueCreateInfos(qcis).setPEnabledExtensionNames(extensions);
+        dci.pNext = &features;
+
+        vk::Device device = globalState->physicalDevice.createDevice(dci, vulkanAllocator());
+        spdlog::debug("Created logical device, queue family {}, async compute {}, descriptor indexing {}, memory budget {}", *queueFamily, computeQueue->has_value(),
+                      *descriptorIndexing, *memoryBudget);
+        return device;
+    }
+
+    bool supportsDescriptorIndexing(_In_ const vk::PhysicalDeviceVulkan12Features &features) {
+        return features.runtimeDescriptorArray && features.descriptorBindingPartiallyBound && features.descriptorBindingUpdateUnusedWhilePending &&
+               features.descriptorBindingSampledImageUpdateAfterBind && features.descriptorBindingStorageBufferUpdateAfterBind &&
+               features.shaderSampledImageArrayNonUniformIndexing && features.shaderStorageBufferArrayNonUniformIndexing;
+    }
+
+    std::optional<uint32_t> findQueueFamily(_In_ const vk::PhysicalDevice &pd) {
+        auto queueFamilies = pd.getQueueFamilyProperties();
+        for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+            auto flags = queueFamilies[i].queueFlags;
+            if ((flags & vk::QueueFlagBits::eGraphics) && (flags & vk::QueueFlagBits::eCompute) && pd.getWin32PresentationSupportKHR(i)) {
+                return i;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // a queue running next to the graphics one: the first compute-only family, else a second queue of the graphics family
+    std::optional<std::pair<uint32_t, uint32_t>> findComputeQueue(_In_ const vk::PhysicalDevice &pd, _In_ uint32_t graphicsFamily) {
+        auto queueFamilies = pd.getQueueFamilyProperties();
+        for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+            auto flags = queueFamilies[i].queueFlags;
+            if ((flags & vk::QueueFlagBits::eCompute) && !(flags & vk::QueueFlagBits::eGraphics)) {
+                return std::make_pair(i, 0u);
+            }
+        }
+        if (queueFamilies[graphicsFamily].queueCount > 1) {
+            return std::make_pair(graphicsFamily, 1u);
+        }
+        return std::nullopt;
+    }
+
     size_t createWindow(_In_ const WindowSettings &settings) {
         size_t id = globalState->window_idcounter++;
         globalState->windows[id] = std::make_unique<Window>(settings, id);
@@ -176,7 +338,18 @@ namespace kat {
             queueFamilyIndex++;
         }
 
-        if (!supportsPresentation) {
+        if (!supportsPresentation || !findQueueFamily(pd)) {
+            return false;
+        }
+
+        if (pd.getProperties().apiVersion < VK_API_VERSION_1_2) {
+            return false;
+        }
+
+        auto features = pd.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+        const auto &core = features.get<vk::PhysicalDeviceFeatures2>().features;
+        const auto &features12 = features.get<vk::PhysicalDeviceVulkan12Features>();
+        if (!core.multiDrawIndirect || !core.drawIndirectFirstInstance || !features12.drawIndirectCount || !features12.timelineSemaphore) {
             return false;
         }
 
@@ -237,6 +410,11 @@ namespace kat {
             DispatchMessageW(pMsg);
         }
 
+        globalState->ioScheduler->processCompletions();
+        globalState->scheduler->tick();
+        globalState->deletionQueue->collect();
+        globalState->caches->update();
+
         return std::nullopt;
     }
 
@@ -12,6 +12,8 @@
 
 #include <entt/entt.hpp>
 
+#include "kat/memory.hpp"
+
 #include <optional>
 
 #define KAT_SIGNAL(name, sign) ::entt::sigh<sign> name##Signal; ::entt::sink<decltype(name##Signal)> name{name##Signal}
@@ -20,14 +22,29 @@
 namespace kat {
     class Window;
     struct WindowSettings;
+    class IoScheduler;
+    class JobSystem;
+    class Scheduler;
+    class TransformHierarchy;
+    class BindlessHeap;
+    class QueueTimeline;
+    class DeletionQueue;
+    class DebugDraw;
+    class LayoutCache;
+    class CacheRegistry;
 
     inline const wchar_t* WCNAME = L"KatWindowClass";
 
+    // frames the cpu may record ahead of the gpu. per-frame resources come in this many copies.
+    inline constexpr uint32_t FRAMES_IN_FLIGHT = 2;
+
     struct Version {
         unsigned int major, minor, patch;
     };
 
     struct GlobalState {
+        KAT_TRACKED_CLASS(MemoryTag::CORE);
+
         HINSTANCE hInstance;
         int nCmdShow;
         std::string appName;
@@ -45,6 +62,26 @@ namespace kat {
         vk::DispatchLoaderDynamic dldy;
         vk::DebugUtilsMessengerEXT vkDebugMessenger;
         vk::PhysicalDevice physicalDevice;
+        vk::Device device;
+        uint32_t graphicsQueueFamily = 0; // graphics, compute and presentation
+        vk::Queue graphicsQueue; // submit through graphicsTimeline, so deletions know when the work is done
+        bool descriptorIndexing = false; // the update-after-bind, partially bound subset BindlessHeap uses
+        bool memoryBudget = false; // VK_EXT_memory_budget, CacheRegistry watches device heaps with it
+
+        std::unique_ptr<QueueTimeline> graphicsTimeline;
+        std::unique_ptr<QueueTimeline> computeTimeline; // a separate queue for async compute, null if the device has none
+        std::unique_ptr<DeletionQueue> deletionQueue;
+        std::unique_ptr<LayoutCache> layoutCache;
+        std::unique_ptr<CacheRegistry> caches;
+
+        std::unique_ptr<JobSystem> jobSystem;
+        std::unique_ptr<IoScheduler> ioScheduler;
+        std::unique_ptr<Scheduler> scheduler;
+        std::unique_ptr<TransformHierarchy> transforms;
+        std::unique_ptr<BindlessHeap> bindless;
+#if KAT_DEBUG_DRAW
+        std::unique_ptr<DebugDraw> debugDraw;
+#endif
     };
 
     extern GlobalState *globalState;
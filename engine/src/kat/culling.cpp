@@ -0,0 +1,262 @@
+#include "culling.hpp"
+
+#include "kat/jobs.hpp"
+#include "kat/transform.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include <intrin.h>
+#include <immintrin.h>
+
+#if defined(__clang__) || defined(__GNUC__)
+#define KAT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define KAT_TARGET_AVX2
+#endif
+
+namespace kat {
+
+    namespace {
+        // entities per job. also the unit results are collected in, so the output keeps gather order.
+        constexpr size_t CHUNK = 4096;
+
+        // every kernel appends the indices in [begin, end) that pass all six planes. radius is null for boxes,
+        // which instead project their extents onto each plane normal.
+        struct Soa {
+            const float *x, *y, *z;
+            const float *radius;
+            const float *ex, *ey, *ez;
+        };
+
+        inline float planeRadius(_In_ const glm::vec4 &p, _In_ const Soa &soa, _In_ size_t i) noexcept {
+            if (soa.radius) return soa.radius[i];
+            return std::abs(p.x) * soa.ex[i] + std::abs(p.y) * soa.ey[i] + std::abs(p.z) * soa.ez[i];
+        }
+
+        void cullScalar(_In_ const Frustum &frustum, _In_ const Soa &soa, _In_ size_t begin, _In_ size_t end, _Inout_ std::vector<uint32_t> &out) {
+            for (size_t i = begin; i < end; i++) {
+                bool inside = true;
+                for (const glm::vec4 &p : frustum.planes) {
+                    float d = (p.x * soa.x[i] + p.y * soa.y[i]) + (p.z * soa.z[i] + p.w); // grouped like the simd paths
+                    inside &= d >= -planeRadius(p, soa, i);
+                }
+                if (inside) out.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        void cullSse(_In_ const Frustum &frustum, _In_ const Soa &soa, _In_ size_t begin, _In_ size_t end, _Inout_ std::vector<uint32_t> &out) {
+            const __m128 signMask = _mm_set1_ps(-0.0f);
+
+            size_t i = begin;
+            for (; i + 4 <= end; i += 4) {
+                __m128 cx = _mm_loadu_ps(soa.x + i);
+                __m128 cy = _mm_loadu_ps(soa.y + i);
+                __m128 cz = _mm_loadu_ps(soa.z + i);
+                __m128 r = soa.radius ? _mm_loadu_ps(soa.radius + i) : _mm_setzero_ps();
+                __m128 ex = soa.radius ? r : _mm_loadu_ps(soa.ex + i);
+                __m128 ey = soa.radius ? r : _mm_loadu_ps(soa.ey + i);
+                __m128 ez = soa.radius ? r : _mm_loadu_ps(soa.ez + i);
+
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (const glm::vec4 &p : frustum.planes) {
+                    __m128 nx = _mm_set1_ps(p.x), ny = _mm_set1_ps(p.y), nz = _mm_set1_ps(p.z);
+                    __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_add_ps(_mm_mul_ps(nz, cz), _mm_set1_ps(p.w)));
+
+                    __m128 extent = r;
+                    if (!soa.radius) {
+                        extent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, nx), ex), _mm_mul_ps(_mm_andnot_ps(signMask, ny), ey)),
+                                            _mm_mul_ps(_mm_andnot_ps(signMask, nz), ez));
+                    }
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(d, _mm_xor_ps(extent, signMask)));
+                }
+
+                for (auto mask = static_cast<uint32_t>(_mm_movemask_ps(inside)); mask; mask &= mask - 1) {
+                    out.push_back(static_cast<uint32_t>(i + std::countr_zero(mask)));
+                }
+            }
+            cullScalar(frustum, soa, i, end, out);
+        }
+
+        KAT_TARGET_AVX2 void cullAvx2(_In_ const Frustum &frustum, _In_ const Soa &soa, _In_ size_t begin, _In_ size_t end, _Inout_ std::vector<uint32_t> &out) {
+            const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+            size_t i = begin;
+            for (; i + 8 <= end; i += 8) {
+                __m256 cx = _mm256_loadu_ps(soa.x + i);
+                __m256 cy = _mm256_loadu_ps(soa.y + i);
+                __m256 cz = _mm256_loadu_ps(soa.z + i);
+                __m256 r = soa.radius ? _mm256_loadu_ps(soa.radius + i) : _mm256_setzero_ps();
+                __m256 ex = soa.radius ? r : _mm256_loadu_ps(soa.ex + i);
+                __m256 ey = soa.radius ? r : _mm256_loadu_ps(soa.ey + i);
+                __m256 ez = soa.radius ? r : _mm256_loadu_ps(soa.ez + i);
+
+                __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (const glm::vec4 &p : frustum.planes) {
+                    __m256 nx = _mm256_set1_ps(p.x), ny = _mm256_set1_ps(p.y), nz = _mm256_set1_ps(p.z);
+                    // same association as the scalar path, fma would round differently and break the cross-check
+                    __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, cx), _mm256_mul_ps(ny, cy)), _mm256_add_ps(_mm256_mul_ps(nz, cz), _mm256_set1_ps(p.w)));
+
+                    __m256 extent = r;
+                    if (!soa.radius) {
+                        extent = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, nx), ex), _mm256_mul_ps(_mm256_andnot_ps(signMask, ny), ey)),
+                                               _mm256_mul_ps(_mm256_andnot_ps(signMask, nz), ez));
+                    }
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, _mm256_xor_ps(extent, signMask), _CMP_GE_OQ));
+                }
+
+                for (auto mask = static_cast<uint32_t>(_mm256_movemask_ps(inside)); mask; mask &= mask - 1) {
+                    out.push_back(static_cast<uint32_t>(i + std::countr_zero(mask)));
+                }
+            }
+            cullSse(frustum, soa, i, end, out);
+        }
+
+        using FNCULL = void(const Frustum &, const Soa &, size_t, size_t, std::vector<uint32_t> &);
+
+        FNCULL *kernelFor(_In_ CullPath path) {
+            if (path == CullPath::AUTO) path = CullingSystem::bestPath();
+            switch (path) {
+                case CullPath::AVX2:
+                    return cullAvx2;
+                case CullPath::SSE:
+                    return cullSse;
+                default:
+                    return cullScalar;
+            }
+        }
+    }// namespace
+
+    Frustum Frustum::fromMatrix(_In_ const glm::mat4 &m) noexcept {
+        glm::vec4 r0{m[0][0], m[1][0], m[2][0], m[3][0]};
+        glm::vec4 r1{m[0][1], m[1][1], m[2][1], m[3][1]};
+        glm::vec4 r2{m[0][2], m[1][2], m[2][2], m[3][2]};
+        glm::vec4 r3{m[0][3], m[1][3], m[2][3], m[3][3]};
+
+        Frustum f{{r3 + r0, r3 - r0, r3 + r1, r3 - r1, r2, r3 - r2}};
+        for (glm::vec4 &p : f.planes) {
+            p /= glm::length(glm::vec3(p));
+        }
+        return f;
+    }
+
+    void CullingSystem::gather(_In_ entt::registry &registry) {
+        auto boxes = registry.view<WorldTransform, BoundingBox>();
+        auto spheres = registry.view<WorldTransform, BoundingSphere>(entt::exclude<BoundingBox>);
+
+        auto reset = [](auto &...arrays) { (arrays.clear(), ...); };
+        reset(m_Boxes.x, m_Boxes.y, m_Boxes.z, m_Boxes.ex, m_Boxes.ey, m_Boxes.ez, m_Boxes.entities);
+        reset(m_Spheres.x, m_Spheres.y, m_Spheres.z, m_Spheres.radius, m_Spheres.entities);
+
+        for (auto [entity, world, box] : boxes.each()) {
+            const glm::mat4 &m = world.matrix;
+            glm::vec3 center = m * glm::vec4((box.min + box.max) * 0.5f, 1.0f);
+            glm::vec3 half = (box.max - box.min) * 0.5f;
+
+            // extent of the transformed box along each world axis
+            glm::vec3 extent{0.0f};
+            for (int c = 0; c < 3; c++) {
+                extent += glm::abs(glm::vec3(m[c])) * half[c];
+            }
+
+            m_Boxes.x.push_back(center.x);
+            m_Boxes.y.push_back(center.y);
+            m_Boxes.z.push_back(center.z);
+            m_Boxes.ex.push_back(extent.x);
+            m_Boxes.ey.push_back(extent.y);
+            m_Boxes.ez.push_back(extent.z);
+            m_Boxes.entities.push_back(entity);
+        }
+
+        for (auto [entity, world, sphere] : spheres.each()) {
+            const glm::mat4 &m = world.matrix;
+            glm::vec3 center = m * glm::vec4(sphere.center, 1.0f);
+            float scale = std::sqrt(std::max({glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+                                              glm::dot(glm::vec3(m[1]), glm::vec3(m[1])),
+                                              glm::dot(glm::vec3(m[2]), glm::vec3(m[2]))}));
+
+            m_Spheres.x.push_back(center.x);
+            m_Spheres.y.push_back(center.y);
+            m_Spheres.z.push_back(center.z);
+            m_Spheres.radius.push_back(sphere.radius * scale);
+            m_Spheres.entities.push_back(entity);
+        }
+    }
+
+    void CullingSystem::cull(_In_ std::span<const Frustum> frusta, _Out_ std::span<std::vector<entt::entity>> visible, _In_ CullPath path) const {
+        FNCULL *kernel = kernelFor(path);
+
+        const Soa sets[] = {
+                {m_Spheres.x.data(), m_Spheres.y.data(), m_Spheres.z.data(), m_Spheres.radius.data(), nullptr, nullptr, nullptr},
+                {m_Boxes.x.data(), m_Boxes.y.data(), m_Boxes.z.data(), nullptr, m_Boxes.ex.data(), m_Boxes.ey.data(), m_Boxes.ez.data()},
+        };
+        const std::vector<entt::entity> *entities[] = {&m_Spheres.entities, &m_Boxes.entities};
+
+        // one job per (view, set, chunk), each with its own output so nothing is shared while culling
+        struct Work {
+            size_t view, set, begin, end;
+        };
+        std::vector<Work> work;
+        for (size_t v = 0; v < frusta.size(); v++) {
+            for (size_t s = 0; s < 2; s++) {
+                size_t count = entities[s]->size();
+                for (size_t begin = 0; begin < count; begin += CHUNK) {
+                    work.push_back({v, s, begin, std::min(count, begin + CHUNK)});
+                }
+            }
+        }
+
+        std::vector<std::vector<uint32_t>> results(work.size());
+        jobSystem().parallelFor(work.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t w = begin; w < end; w++) {
+                const Work &job = work[w];
+                results[w].reserve(job.end - job.begin);
+                kernel(frusta[job.view], sets[job.set], job.begin, job.end, results[w]);
+            }
+        });
+
+        for (auto &list : visible) list.clear();
+        for (size_t w = 0; w < work.size(); w++) {
+            const std::vector<entt::entity> &source = *entities[work[w].set];
+            std::vector<entt::entity> &list = visible[work[w].view];
+            for (uint32_t index : results[w]) {
+                list.push_back(source[index]);
+            }
+        }
+    }
+
+    size_t CullingSystem::sphereCount() const noexcept {
+        return m_Spheres.entities.size();
+    }
+
+    size_t CullingSystem::boxCount() const noexcept {
+        return m_Boxes.entities.size();
+    }
+
+    CullPath CullingSystem::bestPath() noexcept {
+        static const CullPath best = [] {
+            int info[4];
+            __cpuid(info, 0);
+            int maxLeaf = info[0];
+
+            __cpuid(info, 1);
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool avx = (info[2] & (1 << 28)) != 0;
+
+            bool avx2 = false;
+            if (maxLeaf >= 7) {
+                int ext[4];
+                __cpuidex(ext, 7, 0);
+                avx2 = (ext[1] & (1 << 5)) != 0;
+            }
+
+            // the os has to save the ymm registers too
+            if (osxsave && avx && avx2 && (_xgetbv(0) & 0x6) == 0x6) {
+                return CullPath::AVX2;
+            }
+            return CullPath::SSE; // x64 baseline
+        }();
+        return best;
+    }
+}// namespace kat
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <array>
+#include <span>
+#include <vector>
+
+namespace kat {
+
+    // Bounds in the entity's local space, moved into world space with its WorldTransform when gathered.
+    // An entity with both uses the box.
+    struct BoundingSphere {
+        glm::vec3 center{0.0f};
+        float radius = 0.0f;
+    };
+
+    struct BoundingBox {
+        glm::vec3 min{0.0f};
+        glm::vec3 max{0.0f};
+    };
+
+    // Planes point inwards, xyz is the unit normal and w the distance, so a point p is inside when
+    // dot(xyz, p) + w >= 0 for every plane.
+    struct Frustum {
+        std::array<glm::vec4, 6> planes;
+
+        // expects vulkan clip space, depth in [0, 1]
+        [[nodiscard]] static Frustum fromMatrix(_In_ const glm::mat4 &viewProjection) noexcept;
+    };
+
+    enum class CullPath {
+        AUTO,
+        SCALAR, // reference implementation, the SIMD paths have to produce exactly the same lists
+        SSE,
+        AVX2,
+    };
+
+    // Snapshot of world-space bounds in SoA arrays, tested against any number of frusta at once.
+    class CullingSystem {
+      public:
+        // rebuilds the arrays from every entity with a WorldTransform and bounds. main thread only.
+        void gather(_In_ entt::registry &registry);
+
+        // visible[v] receives the entities inside frusta[v]: those with a bounding sphere, then those with a box,
+        // each in gather order. visible must have one entry per frustum. safe to call from several threads at
+        // once after gather.
+        void cull(_In_ std::span<const Frustum> frusta, _Out_ std::span<std::vector<entt::entity>> visible, _In_ CullPath path = CullPath::AUTO) const;
+
+        [[nodiscard]] size_t sphereCount() const noexcept;
+        [[nodiscard]] size_t boxCount() const noexcept;
+
+        // the widest path this cpu and os support
+        [[nodiscard]] static CullPath bestPath() noexcept;
+
+      private:
+        struct Spheres {
+            std::vector<float> x, y, z, radius;
+            std::vector<entt::entity> entities;
+        } m_Spheres;
+
+        struct Boxes {
+            std::vector<float> x, y, z;    // center
+            std::vector<float> ex, ey, ez; // half extent
+            std::vector<entt::entity> entities;
+        } m_Boxes;
+    };
+}// namespace kat
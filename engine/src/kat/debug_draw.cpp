@@ -0,0 +1,346 @@
+#include "debug_draw.hpp"
+
+#if KAT_DEBUG_DRAW
+#include "kat/gpu_layout.hpp"
+#include "kat/gpu_sync.hpp"
+#include "kat/jobs.hpp"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace kat {
+
+    namespace {
+        constexpr uint32_t DEBUG_LINE_VERT_SPV[] =
+#include "kat/shaders/debug_line.vert.spv.h"
+                ;
+
+        constexpr uint32_t DEBUG_LINE_FRAG_SPV[] =
+#include "kat/shaders/debug_line.frag.spv.h"
+                ;
+
+        constexpr uint32_t DEBUG_TEXT_VERT_SPV[] =
+#include "kat/shaders/debug_text.vert.spv.h"
+                ;
+
+        constexpr uint32_t DEBUG_TEXT_FRAG_SPV[] =
+#include "kat/shaders/debug_text.frag.spv.h"
+                ;
+
+        struct DebugPush {
+            glm::mat4 viewProjection;
+            glm::vec2 viewportSize;
+        };
+        KAT_GPU_STRUCT(STD430, DebugPush, KAT_GPU_FIELD(DebugPush, viewProjection), KAT_GPU_FIELD(DebugPush, viewportSize));
+
+        constexpr uint32_t SPHERE_SEGMENTS = 24;
+
+        // 3x5 pixel glyphs for ascii 32..127, bit y * 3 + x set where the pixel is lit. lowercase repeats
+        // uppercase, anything without a glyph of its own shows '?'.
+        constexpr uint16_t FONT[96] = {
+                0x0000, 0x2092, 0x002d, 0x5f7d, 0x20a3, 0x52a5, 0x20a3, 0x0012, 0x224a, 0x2922, 0x0aa8, 0x05d0,
+                0x1400, 0x01c0, 0x2000, 0x12a4, 0x7b6f, 0x749a, 0x73e7, 0x79a7, 0x49ed, 0x79cf, 0x7bcf, 0x24a7,
+                0x7bef, 0x79ef, 0x0410, 0x1410, 0x4454, 0x0e38, 0x1511, 0x20a3, 0x20a3, 0x5bea, 0x3aeb, 0x624e,
+                0x3b6b, 0x72cf, 0x12cf, 0x6b4e, 0x5bed, 0x7497, 0x2b24, 0x5aed, 0x7249, 0x5bfd, 0x5b6b, 0x2b6a,
+                0x12eb, 0x676a, 0x5aeb, 0x388e, 0x2497, 0x7b6d, 0x2b6d, 0x5fed, 0x5aad, 0x24ad, 0x72a7, 0x324b,
+                0x20a3, 0x6926, 0x20a3, 0x7000, 0x20a3, 0x5bea, 0x3aeb, 0x624e, 0x3b6b, 0x72cf, 0x12cf, 0x6b4e,
+                0x5bed, 0x7497, 0x2b24, 0x5aed, 0x7249, 0x5bfd, 0x5b6b, 0x2b6a, 0x12eb, 0x676a, 0x5aeb, 0x388e,
+                0x2497, 0x7b6d, 0x2b6d, 0x5fed, 0x5aad, 0x24ad, 0x72a7, 0x20a3, 0x2492, 0x20a3, 0x20a3, 0x20a3,
+        };
+
+        uint32_t packColor(const glm::vec4 &color) {
+            return glm::packUnorm4x8(color); // x in the low byte, which R8G8B8A8_UNORM reads as red
+        }
+
+        // the 12 edges of the box with corners indexed by bit 0 = x, 1 = y, 2 = z
+        std::array<glm::vec3, 24> boxEdges(const std::array<glm::vec3, 8> &corners) {
+            constexpr std::array<std::pair<int, int>, 12> EDGES = {{
+                    {0, 1}, {2, 3}, {4, 5}, {6, 7},
+                    {0, 2}, {1, 3}, {4, 6}, {5, 7},
+                    {0, 4}, {1, 5}, {2, 6}, {3, 7},
+            }};
+            std::array<glm::vec3, 24> points;
+            for (size_t i = 0; i < EDGES.size(); i++) {
+                points[i * 2] = corners[EDGES[i].first];
+                points[i * 2 + 1] = corners[EDGES[i].second];
+            }
+            return points;
+        }
+
+        vk::Pipeline createPipeline(vk::PipelineLayout layout, vk::RenderPass renderPass, uint32_t subpass, vk::SampleCountFlagBits samples,
+                                    std::span<const uint32_t> vertexSpirv, std::span<const uint32_t> fragmentSpirv,
+                                    std::span<const vk::VertexInputAttributeDescription> attributes, vk::PrimitiveTopology topology, bool depthTest) {
+            vk::Device device = globalState->device;
+
+            vk::ShaderModule vertex = createShaderModule(vertexSpirv);
+            vk::ShaderModule fragment = createShaderModule(fragmentSpirv);
+            std::array<vk::PipelineShaderStageCreateInfo, 2> stages = {
+                    vk::PipelineShaderStageCreateInfo{{}, vk::ShaderStageFlagBits::eVertex, vertex, "main"},
+                    vk::PipelineShaderStageCreateInfo{{}, vk::ShaderStageFlagBits::eFragment, fragment, "main"},
+            };
+
+            vk::VertexInputBindingDescription binding{0, 32, vk::VertexInputRate::eInstance};
+            vk::PipelineVertexInputStateCreateInfo vertexInput{{}, binding, attributes};
+            vk::PipelineInputAssemblyStateCreateInfo inputAssembly{{}, topology};
+            vk::PipelineViewportStateCreateInfo viewport{{}, 1, nullptr, 1, nullptr};
+
+            vk::PipelineRasterizationStateCreateInfo raster{};
+            raster.polygonMode = vk::PolygonMode::eFill;
+            raster.cullMode = vk::CullModeFlagBits::eNone;
+            raster.lineWidth = 1.0f;
+
+            vk::PipelineMultisampleStateCreateInfo multisample{{}, samples};
+
+            vk::PipelineDepthStencilStateCreateInfo depth{};
+            depth.depthTestEnable = depthTest;
+            depth.depthWriteEnable = VK_FALSE;
+            depth.depthCompareOp = vk::CompareOp::eLessOrEqual;
+
+            vk::PipelineColorBlendAttachmentState blend{};
+            blend.blendEnable = VK_TRUE;
+            blend.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+            blend.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+            blend.colorBlendOp = vk::BlendOp::eAdd;
+            blend.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+            blend.dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+            blend.alphaBlendOp = vk::BlendOp::eAdd;
+            blend.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+            vk::PipelineColorBlendStateCreateInfo colorBlend{{}, VK_FALSE, vk::LogicOp::eCopy, blend};
+
+            std::array<vk::DynamicState, 2> dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+            vk::PipelineDynamicStateCreateInfo dynamic{{}, dynamicStates};
+
+            vk::GraphicsPipelineCreateInfo gpci{};
+            gpci.setStages(stages);
+            gpci.pVertexInputState = &vertexInput;
+            gpci.pInputAssemblyState = &inputAssembly;
+            gpci.pViewportState = &viewport;
+            gpci.pRasterizationState = &raster;
+            gpci.pMultisampleState = &multisample;
+            gpci.pDepthStencilState = &depth;
+            gpci.pColorBlendState = &colorBlend;
+            gpci.pDynamicState = &dynamic;
+            gpci.layout = layout;
+            gpci.renderPass = renderPass;
+            gpci.subpass = subpass;
+
+            auto pipeline = device.createGraphicsPipeline(nullptr, gpci);
+            device.destroyShaderModule(vertex);
+            device.destroyShaderModule(fragment);
+            if (pipeline.result != vk::Result::eSuccess) {
+                throw std::runtime_error("Failed to create debug draw pipeline");
+            }
+            return pipeline.value;
+        }
+    }// namespace
+
+    DebugDraw::DebugDraw(_In_ const DebugDrawSettings &settings)
+        : m_Settings(settings), m_ThreadCount(jobSystem().threadSlotCount()), m_Threads(std::make_unique<ThreadBuffer[]>(m_ThreadCount)) {
+        vk::DeviceSize size = m_Settings.maxLines * sizeof(LineInstance) + m_Settings.maxGlyphs * sizeof(GlyphInstance);
+        for (Buffer &buffer : m_Buffers) {
+            buffer = Buffer(size, vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+        }
+
+        vk::PushConstantRange pushRange{vk::ShaderStageFlagBits::eVertex, 0, sizeof(DebugPush)};
+        m_PipelineLayout = globalState->device.createPipelineLayout(vk::PipelineLayoutCreateInfo{{}, {}, pushRange});
+    }
+
+    DebugDraw::~DebugDraw() {
+        destroyPipelines();
+        deletionQueue().destroy(m_PipelineLayout); // the last frames drawing with it may still be in flight
+    }
+
+    void DebugDraw::setTarget(_In_ vk::RenderPass renderPass, _In_ uint32_t subpass, _In_ vk::SampleCountFlagBits samples) {
+        destroyPipelines();
+
+        std::array<vk::VertexInputAttributeDescription, 3> lineAttributes = {
+                vk::VertexInputAttributeDescription{0, 0, vk::Format::eR32G32B32Sfloat, offsetof(LineInstance, from)},
+                vk::VertexInputAttributeDescription{1, 0, vk::Format::eR8G8B8A8Unorm, offsetof(LineInstance, color)},
+                vk::VertexInputAttributeDescription{2, 0, vk::Format::eR32G32B32Sfloat, offsetof(LineInstance, to)},
+        };
+        m_LinePipeline = createPipeline(m_PipelineLayout, renderPass, subpass, samples, DEBUG_LINE_VERT_SPV, DEBUG_LINE_FRAG_SPV,
+                                        lineAttributes, vk::PrimitiveTopology::eLineList, m_Settings.depthTest);
+
+        std::array<vk::VertexInputAttributeDescription, 5> glyphAttributes = {
+                vk::VertexInputAttributeDescription{0, 0, vk::Format::eR32G32B32Sfloat, offsetof(GlyphInstance, anchor)},
+                vk::VertexInputAttributeDescription{1, 0, vk::Format::eR8G8B8A8Unorm, offsetof(GlyphInstance, color)},
+                vk::VertexInputAttributeDescription{2, 0, vk::Format::eR32Uint, offsetof(GlyphInstance, bits)},
+                vk::VertexInputAttributeDescription{3, 0, vk::Format::eR32G32Sint, offsetof(GlyphInstance, cell)},
+                vk::VertexInputAttributeDescription{4, 0, vk::Format::eR32Sfloat, offsetof(GlyphInstance, scale)},
+        };
+        m_TextPipeline = createPipeline(m_PipelineLayout, renderPass, subpass, samples, DEBUG_TEXT_VERT_SPV, DEBUG_TEXT_FRAG_SPV,
+                                        glyphAttributes, vk::PrimitiveTopology::eTriangleStrip, false);
+    }
+
+    void DebugDraw::flush(_In_ vk::CommandBuffer cmd, _In_ uint32_t frame, _In_ const glm::mat4 &viewProjection, _In_ vk::Extent2D viewport) {
+        Buffer &buffer = m_Buffers[frame % FRAMES_IN_FLIGHT];
+        auto *lines = static_cast<LineInstance *>(buffer.mapped());
+        auto *glyphs = reinterpret_cast<GlyphInstance *>(lines + m_Settings.maxLines);
+
+        uint32_t lineCount = 0;
+        uint32_t glyphCount = 0;
+        bool dropped = false;
+        for (uint32_t i = 0; i < m_ThreadCount; i++) {
+            ThreadBuffer &thread = m_Threads[i];
+            std::lock_guard lock(thread.mutex);
+
+            auto n = static_cast<uint32_t>(std::min<size_t>(thread.lines.size(), m_Settings.maxLines - lineCount));
+            std::memcpy(lines + lineCount, thread.lines.data(), n * sizeof(LineInstance));
+            lineCount += n;
+
+            auto g = static_cast<uint32_t>(std::min<size_t>(thread.glyphs.size(), m_Settings.maxGlyphs - glyphCount));
+            std::memcpy(glyphs + glyphCount, thread.glyphs.data(), g * sizeof(GlyphInstance));
+            glyphCount += g;
+
+            dropped |= n < thread.lines.size() || g < thread.glyphs.size();
+            thread.lines.clear();
+            thread.glyphs.clear();
+        }
+
+        if (dropped && !m_Dropped) {
+            spdlog::warn("Debug draw buffers full, dropping primitives (maxLines {}, maxGlyphs {})", m_Settings.maxLines, m_Settings.maxGlyphs);
+        }
+        m_Dropped = dropped;
+
+        if (!m_LinePipeline || (lineCount == 0 && glyphCount == 0)) return;
+
+        vk::Viewport vp{0.0f, 0.0f, static_cast<float>(viewport.width), static_cast<float>(viewport.height), 0.0f, 1.0f};
+        cmd.setViewport(0, vp);
+        cmd.setScissor(0, vk::Rect2D{{0, 0}, viewport});
+
+        DebugPush push{viewProjection, glm::vec2(viewport.width, viewport.height)};
+        cmd.pushConstants<DebugPush>(m_PipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, push);
+
+        if (lineCount > 0) {
+            cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, m_LinePipeline);
+            cmd.bindVertexBuffers(0, buffer.handle(), vk::DeviceSize{0});
+            cmd.draw(2, lineCount, 0, 0);
+        }
+        if (glyphCount > 0) {
+            cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, m_TextPipeline);
+            cmd.bindVertexBuffers(0, buffer.handle(), vk::DeviceSize{m_Settings.maxLines * sizeof(LineInstance)});
+            cmd.draw(4, glyphCount, 0, 0);
+        }
+    }
+
+    void DebugDraw::addLine(_In_ const glm::vec3 &from, _In_ const glm::vec3 &to, _In_ uint32_t color) {
+        ThreadBuffer &thread = current();
+        std::lock_guard lock(thread.mutex);
+        thread.lines.push_back(LineInstance{from, color, to, 0.0f});
+    }
+
+    void DebugDraw::addLines(_In_ std::span<const glm::vec3> points, _In_ uint32_t color) {
+        ThreadBuffer &thread = current();
+        std::lock_guard lock(thread.mutex);
+        for (size_t i = 0; i + 1 < points.size(); i += 2) {
+            thread.lines.push_back(LineInstance{points[i], color, points[i + 1], 0.0f});
+        }
+    }
+
+    void DebugDraw::addText(_In_ const glm::vec3 &position, _In_ std::string_view text, _In_ uint32_t color, _In_ float scale) {
+        ThreadBuffer &thread = current();
+        std::lock_guard lock(thread.mutex);
+
+        glm::ivec2 cell{0, 0};
+        for (char c : text) {
+            if (c == '\n') {
+                cell = {0, cell.y + 1};
+                continue;
+            }
+
+            auto index = static_cast<unsigned char>(c);
+            uint16_t bits = index >= 32 && index < 128 ? FONT[index - 32] : FONT['?' - 32];
+            if (bits != 0) {
+                thread.glyphs.push_back(GlyphInstance{position, color, bits, cell, scale});
+            }
+            cell.x++;
+        }
+    }
+
+    DebugDraw::ThreadBuffer &DebugDraw::current() {
+        return m_Threads[JobSystem::currentWorkerIndex()];
+    }
+
+    void DebugDraw::destroyPipelines() {
+        // frames in flight may still use them after a setTarget
+        deletionQueue().destroy(m_LinePipeline);
+        deletionQueue().destroy(m_TextPipeline);
+        m_LinePipeline = nullptr;
+        m_TextPipeline = nullptr;
+    }
+
+    DebugDraw &debugDraw() {
+        return *globalState->debugDraw;
+    }
+
+    namespace debug {
+
+        void line(_In_ const glm::vec3 &from, _In_ const glm::vec3 &to, _In_ const glm::vec4 &color) {
+            if (!globalState || !globalState->debugDraw) return;
+            globalState->debugDraw->addLine(from, to, packColor(color));
+        }
+
+        void box(_In_ const glm::vec3 &min, _In_ const glm::vec3 &max, _In_ const glm::vec4 &color) {
+            box(glm::mat4(1.0f), min, max, color);
+        }
+
+        void box(_In_ const glm::mat4 &transform, _In_ const glm::vec3 &min, _In_ const glm::vec3 &max, _In_ const glm::vec4 &color) {
+            if (!globalState || !globalState->debugDraw) return;
+
+            std::array<glm::vec3, 8> corners;
+            for (int i = 0; i < 8; i++) {
+                glm::vec3 local{i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z};
+                corners[i] = glm::vec3(transform * glm::vec4(local, 1.0f));
+            }
+            auto points = boxEdges(corners);
+            globalState->debugDraw->addLines(points, packColor(color));
+        }
+
+        void sphere(_In_ const glm::vec3 &center, _In_ float radius, _In_ const glm::vec4 &color) {
+            if (!globalState || !globalState->debugDraw) return;
+
+            std::array<glm::vec3, SPHERE_SEGMENTS * 3 * 2> points;
+            size_t n = 0;
+            for (uint32_t i = 0; i < SPHERE_SEGMENTS; i++) {
+                float a0 = glm::two_pi<float>() * static_cast<float>(i) / SPHERE_SEGMENTS;
+                float a1 = glm::two_pi<float>() * static_cast<float>(i + 1) / SPHERE_SEGMENTS;
+                glm::vec2 p0 = glm::vec2(std::cos(a0), std::sin(a0)) * radius;
+                glm::vec2 p1 = glm::vec2(std::cos(a1), std::sin(a1)) * radius;
+
+                points[n++] = center + glm::vec3(p0.x, p0.y, 0.0f);
+                points[n++] = center + glm::vec3(p1.x, p1.y, 0.0f);
+                points[n++] = center + glm::vec3(p0.x, 0.0f, p0.y);
+                points[n++] = center + glm::vec3(p1.x, 0.0f, p1.y);
+                points[n++] = center + glm::vec3(0.0f, p0.x, p0.y);
+                points[n++] = center + glm::vec3(0.0f, p1.x, p1.y);
+            }
+            globalState->debugDraw->addLines(points, packColor(color));
+        }
+
+        void frustum(_In_ const glm::mat4 &viewProjection, _In_ const glm::vec4 &color) {
+            if (!globalState || !globalState->debugDraw) return;
+
+            glm::mat4 inverse = glm::inverse(viewProjection);
+            std::array<glm::vec3, 8> corners;
+            for (int i = 0; i < 8; i++) {
+                glm::vec4 ndc{i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : 0.0f, 1.0f};
+                glm::vec4 world = inverse * ndc;
+                corners[i] = glm::vec3(world) / world.w;
+            }
+            auto points = boxEdges(corners);
+            globalState->debugDraw->addLines(points, packColor(color));
+        }
+
+        void text(_In_ const glm::vec3 &position, _In_ std::string_view text, _In_ const glm::vec4 &color, _In_ float scale) {
+            if (!globalState || !globalState->debugDraw) return;
+            globalState->debugDraw->addText(position, text, packColor(color), scale);
+        }
+    }// namespace debug
+}// namespace kat
+#endif
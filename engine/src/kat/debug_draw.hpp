@@ -0,0 +1,122 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <string_view>
+
+#if KAT_DEBUG_DRAW
+#include "kat/gpu.hpp"
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+#endif
+
+// Immediate mode debug drawing, callable from any thread at any time. Primitives pile up in per-thread buffers
+// until the renderer flushes them into the frame: everything becomes lines drawn with one instanced draw, and
+// text labels a second one, whatever the number of primitives.
+//
+// Configure with -DKAT_DEBUG_DRAW=OFF to compile it out: the functions below become empty inlines and no
+// pipelines, buffers or shaders are built.
+namespace kat::debug {
+
+    inline constexpr glm::vec4 WHITE{1.0f, 1.0f, 1.0f, 1.0f};
+
+#if KAT_DEBUG_DRAW
+    void line(_In_ const glm::vec3 &from, _In_ const glm::vec3 &to, _In_ const glm::vec4 &color = WHITE);
+    void box(_In_ const glm::vec3 &min, _In_ const glm::vec3 &max, _In_ const glm::vec4 &color = WHITE);
+    // the local box [min, max] under transform
+    void box(_In_ const glm::mat4 &transform, _In_ const glm::vec3 &min, _In_ const glm::vec3 &max, _In_ const glm::vec4 &color = WHITE);
+    // three great circles
+    void sphere(_In_ const glm::vec3 &center, _In_ float radius, _In_ const glm::vec4 &color = WHITE);
+    // the frustum viewProjection sees, vulkan clip space
+    void frustum(_In_ const glm::mat4 &viewProjection, _In_ const glm::vec4 &color = WHITE);
+    // screen aligned, scale in pixels per font pixel. ascii only, lowercase is drawn as uppercase.
+    void text(_In_ const glm::vec3 &position, _In_ std::string_view text, _In_ const glm::vec4 &color = WHITE, _In_ float scale = 2.0f);
+#else
+    inline void line(_In_ const glm::vec3 &, _In_ const glm::vec3 &, _In_ const glm::vec4 & = WHITE) {}
+    inline void box(_In_ const glm::vec3 &, _In_ const glm::vec3 &, _In_ const glm::vec4 & = WHITE) {}
+    inline void box(_In_ const glm::mat4 &, _In_ const glm::vec3 &, _In_ const glm::vec3 &, _In_ const glm::vec4 & = WHITE) {}
+    inline void sphere(_In_ const glm::vec3 &, _In_ float, _In_ const glm::vec4 & = WHITE) {}
+    inline void frustum(_In_ const glm::mat4 &, _In_ const glm::vec4 & = WHITE) {}
+    inline void text(_In_ const glm::vec3 &, _In_ std::string_view, _In_ const glm::vec4 & = WHITE, _In_ float = 2.0f) {}
+#endif
+}// namespace kat::debug
+
+#if KAT_DEBUG_DRAW
+namespace kat {
+
+    struct DebugDrawSettings {
+        uint32_t maxLines = 1 << 18; // per frame, more are dropped
+        uint32_t maxGlyphs = 1 << 15;
+        bool depthTest = true; // lines only, text is always on top
+    };
+
+    // The engine owned sink behind kat::debug. Created in kat::init; the renderer calls setTarget once it has
+    // a render pass and flush once per frame.
+    class DebugDraw {
+      public:
+        KAT_TRACKED_CLASS(MemoryTag::CORE);
+
+        explicit DebugDraw(_In_ const DebugDrawSettings &settings = {});
+        ~DebugDraw();
+
+        DebugDraw(const DebugDraw &) = delete;
+        DebugDraw &operator=(const DebugDraw &) = delete;
+
+        // (re)creates the pipelines for drawing into subpass of renderPass
+        void setTarget(_In_ vk::RenderPass renderPass, _In_ uint32_t subpass, _In_ vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1);
+
+        // inside the render pass given to setTarget. moves everything added so far into frame's buffer and
+        // records the draws; later additions go to the next flush. sets its own viewport and scissor.
+        void flush(_In_ vk::CommandBuffer cmd, _In_ uint32_t frame, _In_ const glm::mat4 &viewProjection, _In_ vk::Extent2D viewport);
+
+        // thread safe
+        void addLine(_In_ const glm::vec3 &from, _In_ const glm::vec3 &to, _In_ uint32_t color);
+        void addLines(_In_ std::span<const glm::vec3> points, _In_ uint32_t color); // pairs
+        void addText(_In_ const glm::vec3 &position, _In_ std::string_view text, _In_ uint32_t color, _In_ float scale);
+
+      private:
+        // vertex inputs of shaders/debug_line.vert and shaders/debug_text.vert, one per instance
+        struct LineInstance {
+            glm::vec3 from;
+            uint32_t color;
+            glm::vec3 to;
+            float padding;
+        };
+        static_assert(sizeof(LineInstance) == 32);
+
+        struct GlyphInstance {
+            glm::vec3 anchor;
+            uint32_t color;
+            uint32_t bits; // 3x5, row major from the top left
+            glm::ivec2 cell;
+            float scale;
+        };
+        static_assert(sizeof(GlyphInstance) == 32);
+
+        struct alignas(64) ThreadBuffer {
+            std::mutex mutex; // only ever contended by the flush
+            std::vector<LineInstance> lines;
+            std::vector<GlyphInstance> glyphs;
+        };
+
+        DebugDrawSettings m_Settings;
+        uint32_t m_ThreadCount;
+        std::unique_ptr<ThreadBuffer[]> m_Threads;
+
+        std::array<Buffer, FRAMES_IN_FLIGHT> m_Buffers; // persistently mapped, lines then glyphs
+        vk::PipelineLayout m_PipelineLayout;
+        vk::Pipeline m_LinePipeline;
+        vk::Pipeline m_TextPipeline;
+        bool m_Dropped = false;
+
+        [[nodiscard]] ThreadBuffer &current();
+        void destroyPipelines();
+    };
+
+    [[nodiscard]] DebugDraw &debugDraw();
+}// namespace kat
+#endif
@@ -0,0 +1,248 @@
+#include "depth_pyramid.hpp"
+
+#include "kat/gpu.hpp"
+#include "kat/gpu_sync.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+
+namespace kat {
+
+    namespace {
+        constexpr uint32_t HIZ_COMP_SPV[] =
+#include "kat/shaders/hiz.comp.spv.h"
+                ;
+
+        constexpr uint32_t WORKGROUP_SIZE = 8;
+
+        struct HizPush {
+            uint32_t sourceSize[2];
+            uint32_t destinationSize[2];
+        };
+
+        vk::Extent2D levelExtent(_In_ vk::Extent2D base, _In_ uint32_t level) noexcept {
+            return {std::max(base.width >> level, 1u), std::max(base.height >> level, 1u)};
+        }
+    }// namespace
+
+    DepthPyramid::DepthPyramid(_In_ vk::Extent2D depthExtent, _In_ vk::ImageView depthView) : m_DepthExtent(depthExtent) {
+        vk::Device device = globalState->device;
+
+        m_Extent = vk::Extent2D{std::bit_floor(std::max(depthExtent.width, 1u)), std::bit_floor(std::max(depthExtent.height, 1u))};
+        m_LevelCount = static_cast<uint32_t>(std::bit_width(std::max(m_Extent.width, m_Extent.height)));
+
+        vk::ImageCreateInfo ici{};
+        ici.imageType = vk::ImageType::e2D;
+        ici.format = vk::Format::eR32Sfloat;
+        ici.extent = vk::Extent3D{m_Extent.width, m_Extent.height, 1};
+        ici.mipLevels = m_LevelCount;
+        ici.arrayLayers = 1;
+        ici.samples = vk::SampleCountFlagBits::e1;
+        ici.tiling = vk::ImageTiling::eOptimal;
+        ici.usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled;
+        ici.initialLayout = vk::ImageLayout::eUndefined;
+        m_Image = device.createImage(ici);
+
+        vk::MemoryRequirements requirements = device.getImageMemoryRequirements(m_Image);
+        m_Memory = device.allocateMemory(vk::MemoryAllocateInfo{requirements.size, findMemoryType(requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal)});
+        device.bindImageMemory(m_Image, m_Memory, 0);
+
+        vk::ImageViewCreateInfo ivci{{}, m_Image, vk::ImageViewType::e2D, vk::Format::eR32Sfloat, {}, {vk::ImageAspectFlagBits::eColor, 0, m_LevelCount, 0, 1}};
+        m_View = device.createImageView(ivci);
+        for (uint32_t level = 0; level < m_LevelCount; level++) {
+            ivci.subresourceRange.baseMipLevel = level;
+            ivci.subresourceRange.levelCount = 1;
+            m_LevelViews.push_back(device.createImageView(ivci));
+        }
+
+        // texelFetch ignores filtering, but the shaders still need a sampler to go with the image
+        vk::SamplerCreateInfo sci{};
+        sci.magFilter = vk::Filter::eNearest;
+        sci.minFilter = vk::Filter::eNearest;
+        sci.mipmapMode = vk::SamplerMipmapMode::eNearest;
+        sci.addressModeU = sci.addressModeV = sci.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+        sci.maxLod = VK_LOD_CLAMP_NONE;
+        m_Sampler = device.createSampler(sci);
+
+        std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {
+                vk::DescriptorSetLayoutBinding{0, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute},
+                vk::DescriptorSetLayoutBinding{1, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute},
+        };
+        m_SetLayout = device.createDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo{{}, bindings});
+
+        std::array<vk::DescriptorPoolSize, 2> poolSizes = {
+                vk::DescriptorPoolSize{vk::DescriptorType::eCombinedImageSampler, m_LevelCount},
+                vk::DescriptorPoolSize{vk::DescriptorType::eStorageImage, m_LevelCount},
+        };
+        m_DescriptorPool = device.createDescriptorPool(vk::DescriptorPoolCreateInfo{{}, m_LevelCount, poolSizes});
+
+        std::vector<vk::DescriptorSetLayout> layouts(m_LevelCount, m_SetLayout);
+        m_Sets = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo{m_DescriptorPool, layouts});
+
+        for (uint32_t level = 0; level < m_LevelCount; level++) {
+            vk::DescriptorImageInfo source = level == 0 ? vk::DescriptorImageInfo{m_Sampler, depthView, vk::ImageLayout::eDepthStencilReadOnlyOptimal}
+                                                        : vk::DescriptorImageInfo{m_Sampler, m_LevelViews[level - 1], vk::ImageLayout::eGeneral};
+            vk::DescriptorImageInfo destination{nullptr, m_LevelViews[level], vk::ImageLayout::eGeneral};
+
+            std::array<vk::WriteDescriptorSet, 2> writes = {
+                    vk::WriteDescriptorSet{m_Sets[level], 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &source},
+                    vk::WriteDescriptorSet{m_Sets[level], 1, 0, 1, vk::DescriptorType::eStorageImage, &destination},
+            };
+            device.updateDescriptorSets(writes, {});
+        }
+
+        vk::PushConstantRange pushRange{vk::ShaderStageFlagBits::eCompute, 0, sizeof(HizPush)};
+        m_PipelineLayout = device.createPipelineLayout(vk::PipelineLayoutCreateInfo{{}, m_SetLayout, pushRange});
+
+        vk::ShaderModule module = createShaderModule(HIZ_COMP_SPV);
+        vk::ComputePipelineCreateInfo cpci{};
+        cpci.stage = vk::PipelineShaderStageCreateInfo{{}, vk::ShaderStageFlagBits::eCompute, module, "main"};
+        cpci.layout = m_PipelineLayout;
+        auto pipeline = device.createComputePipeline(nullptr, cpci);
+        device.destroyShaderModule(module);
+        if (pipeline.result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to create depth pyramid pipeline");
+        }
+        m_Pipeline = pipeline.value;
+    }
+
+    DepthPyramid::~DepthPyramid() {
+        // the last build and the culls sampling it may still be in flight
+        DeletionQueue &deletions = deletionQueue();
+        deletions.destroy(m_Pipeline);
+        deletions.destroy(m_PipelineLayout);
+        deletions.destroy(m_DescriptorPool);
+        deletions.destroy(m_SetLayout);
+        deletions.destroy(m_Sampler);
+        for (vk::ImageView view : m_LevelViews) deletions.destroy(view);
+        deletions.destroy(m_View);
+        deletions.defer([image = m_Image, memory = m_Memory] {
+            globalState->device.destroyImage(image);
+            globalState->device.freeMemory(memory);
+        });
+    }
+
+    void DepthPyramid::build(_In_ vk::CommandBuffer cmd) {
+        // everything gets rewritten, so the old contents are discarded; the barrier still waits for last
+        // build's readers
+        vk::ImageMemoryBarrier discard{{}, vk::AccessFlagBits::eShaderWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral,
+                                       VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, m_Image, {vk::ImageAspectFlagBits::eColor, 0, m_LevelCount, 0, 1}};
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, discard);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, m_Pipeline);
+
+        for (uint32_t level = 0; level < m_LevelCount; level++) {
+            vk::Extent2D destination = levelExtent(m_Extent, level);
+            vk::Extent2D source = level == 0 ? m_DepthExtent : levelExtent(m_Extent, level - 1);
+
+            HizPush push{};
+            push.sourceSize[0] = source.width;
+            push.sourceSize[1] = source.height;
+            push.destinationSize[0] = destination.width;
+            push.destinationSize[1] = destination.height;
+
+            cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_PipelineLayout, 0, m_Sets[level], {});
+            cmd.pushConstants(m_PipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(push), &push);
+            cmd.dispatch((destination.width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, (destination.height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+
+            vk::ImageMemoryBarrier written{vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral,
+                                           VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, m_Image, {vk::ImageAspectFlagBits::eColor, level, 1, 0, 1}};
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, written);
+        }
+    }
+
+    vk::ImageView DepthPyramid::view() const noexcept {
+        return m_View;
+    }
+
+    vk::Sampler DepthPyramid::sampler() const noexcept {
+        return m_Sampler;
+    }
+
+    vk::Extent2D DepthPyramid::extent() const noexcept {
+        return m_Extent;
+    }
+
+    uint32_t DepthPyramid::levelCount() const noexcept {
+        return m_LevelCount;
+    }
+
+    DepthPyramid::Reference DepthPyramid::reference(_In_ const std::vector<float> &depth, _In_ vk::Extent2D depthExtent) {
+        Reference pyramid;
+        vk::Extent2D base{std::bit_floor(std::max(depthExtent.width, 1u)), std::bit_floor(std::max(depthExtent.height, 1u))};
+        uint32_t levelCount = static_cast<uint32_t>(std::bit_width(std::max(base.width, base.height)));
+
+        const std::vector<float> *source = &depth;
+        vk::Extent2D sourceExtent = depthExtent;
+
+        for (uint32_t level = 0; level < levelCount; level++) {
+            vk::Extent2D extent = levelExtent(base, level);
+            std::vector<float> texels(size_t{extent.width} * extent.height);
+
+            for (uint32_t y = 0; y < extent.height; y++) {
+                for (uint32_t x = 0; x < extent.width; x++) {
+                    uint32_t beginX = x * sourceExtent.width / extent.width;
+                    uint32_t beginY = y * sourceExtent.height / extent.height;
+                    uint32_t endX = std::max(((x + 1) * sourceExtent.width + extent.width - 1) / extent.width, beginX + 1);
+                    uint32_t endY = std::max(((y + 1) * sourceExtent.height + extent.height - 1) / extent.height, beginY + 1);
+
+                    float farthest = 0.0f;
+                    for (uint32_t sy = beginY; sy < endY; sy++) {
+                        for (uint32_t sx = beginX; sx < endX; sx++) {
+                            farthest = std::max(farthest, (*source)[size_t{sy} * sourceExtent.width + sx]);
+                        }
+                    }
+                    texels[size_t{y} * extent.width + x] = farthest;
+                }
+            }
+
+            pyramid.extents.push_back(extent);
+            pyramid.levels.push_back(std::move(texels));
+            source = &pyramid.levels.back();
+            sourceExtent = extent;
+        }
+        return pyramid;
+    }
+
+    bool DepthPyramid::occluded(_In_ const Reference &pyramid, _In_ const glm::mat4 &viewProjection, _In_ const glm::vec3 &center, _In_ float radius) {
+        if (pyramid.levels.empty()) return false;
+
+        glm::vec2 uvMin{1.0f}, uvMax{0.0f};
+        float nearest = 1.0f;
+
+        for (int i = 0; i < 8; i++) {
+            glm::vec3 corner = center + radius * glm::vec3((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+            glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+            if (clip.w <= 0.0f) return false;
+
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            glm::vec2 uv = glm::vec2(ndc) * 0.5f + 0.5f;
+            uvMin = glm::min(uvMin, uv);
+            uvMax = glm::max(uvMax, uv);
+            nearest = std::min(nearest, ndc.z);
+        }
+
+        uvMin = glm::clamp(uvMin, 0.0f, 1.0f);
+        uvMax = glm::clamp(uvMax, 0.0f, 1.0f);
+
+        const vk::Extent2D base = pyramid.extents[0];
+        glm::vec2 extent = (uvMax - uvMin) * glm::vec2(base.width, base.height);
+        int level = std::min(static_cast<int>(std::ceil(std::log2(std::max({extent.x, extent.y, 1.0f})))), static_cast<int>(pyramid.levels.size()) - 1);
+
+        const vk::Extent2D size = pyramid.extents[level];
+        glm::ivec2 levelSize{static_cast<int>(size.width), static_cast<int>(size.height)};
+        glm::ivec2 a = glm::clamp(glm::ivec2(uvMin * glm::vec2(levelSize)), glm::ivec2(0), levelSize - 1);
+        glm::ivec2 b = glm::clamp(glm::ivec2(uvMax * glm::vec2(levelSize)), glm::ivec2(0), levelSize - 1);
+
+        float farthest = 0.0f;
+        for (int y = a.y; y <= b.y; y++) {
+            for (int x = a.x; x <= b.x; x++) {
+                farthest = std::max(farthest, pyramid.levels[level][static_cast<size_t>(y) * size.width + x]);
+            }
+        }
+
+        return nearest > farthest;
+    }
+}// namespace kat
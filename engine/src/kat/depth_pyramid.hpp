@@ -0,0 +1,58 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <vector>
+
+namespace kat {
+
+    // Hierarchical depth (hi-z) built from a depth buffer by shaders/hiz.comp. Level 0 is the depth size rounded
+    // down to powers of two and every texel holds the farthest depth underneath it, so a bound whose nearest
+    // depth is behind that value is hidden. Assumes a conventional depth range, near 0 and far 1.
+    //
+    // The image stays in GENERAL layout. Recreate the pyramid when the depth buffer is resized.
+    class DepthPyramid {
+      public:
+        DepthPyramid(_In_ vk::Extent2D depthExtent, _In_ vk::ImageView depthView);
+        ~DepthPyramid();
+
+        DepthPyramid(const DepthPyramid &) = delete;
+        DepthPyramid &operator=(const DepthPyramid &) = delete;
+
+        // the depth image has to be in DEPTH_STENCIL_READ_ONLY_OPTIMAL with its writes made visible to compute
+        // shaders. leaves the pyramid ready for compute reads.
+        void build(_In_ vk::CommandBuffer cmd);
+
+        [[nodiscard]] vk::ImageView view() const noexcept;
+        [[nodiscard]] vk::Sampler sampler() const noexcept;
+        [[nodiscard]] vk::Extent2D extent() const noexcept;
+        [[nodiscard]] uint32_t levelCount() const noexcept;
+
+        // cpu implementation of the same pyramid and test, for checking the shaders against. depth is row major.
+        struct Reference {
+            std::vector<vk::Extent2D> extents;
+            std::vector<std::vector<float>> levels;
+        };
+        [[nodiscard]] static Reference reference(_In_ const std::vector<float> &depth, _In_ vk::Extent2D depthExtent);
+
+        // the test cull_occlusion.comp runs, on a world space sphere
+        [[nodiscard]] static bool occluded(_In_ const Reference &pyramid, _In_ const glm::mat4 &viewProjection, _In_ const glm::vec3 &center, _In_ float radius);
+
+      private:
+        vk::Extent2D m_DepthExtent;
+        vk::Extent2D m_Extent;
+        uint32_t m_LevelCount;
+
+        vk::Image m_Image;
+        vk::DeviceMemory m_Memory;
+        vk::ImageView m_View;
+        std::vector<vk::ImageView> m_LevelViews;
+        vk::Sampler m_Sampler;
+
+        vk::DescriptorSetLayout m_SetLayout;
+        vk::DescriptorPool m_DescriptorPool;
+        std::vector<vk::DescriptorSet> m_Sets; // one per level
+        vk::PipelineLayout m_PipelineLayout;
+        vk::Pipeline m_Pipeline;
+    };
+}// namespace kat
@@ -0,0 +1,83 @@
+#include "frame_pipeline.hpp"
+
+#include <spdlog/spdlog.h>
+
+namespace kat {
+
+    FramePipeline::FramePipeline(_In_ std::function<FNRENDERFRAME> render) : m_Render(std::move(render)) {
+        m_Thread = std::thread(&FramePipeline::renderMain, this);
+    }
+
+    FramePipeline::~FramePipeline() {
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Stopping = true;
+        }
+        m_Changed.notify_all();
+        m_Thread.join();
+    }
+
+    uint64_t FramePipeline::beginFrame() {
+        std::unique_lock lock(m_Mutex);
+        m_Frame = m_Submitted;
+
+        // frames m_Frame - 2 and before are done once m_Completed reaches m_Frame - 1
+        m_Changed.wait(lock, [this] { return m_Exception || m_Completed + 1 >= m_Frame; });
+        rethrow();
+        return m_Frame;
+    }
+
+    void FramePipeline::endFrame() {
+        {
+            std::lock_guard lock(m_Mutex);
+            rethrow();
+            m_Submitted = m_Frame + 1;
+        }
+        m_Changed.notify_all();
+    }
+
+    void FramePipeline::flush() {
+        std::unique_lock lock(m_Mutex);
+        m_Changed.wait(lock, [this] { return m_Exception || m_Completed == m_Submitted; });
+        rethrow();
+    }
+
+    uint64_t FramePipeline::frameIndex() const noexcept {
+        return m_Frame;
+    }
+
+    void FramePipeline::rethrow() {
+        // stays set, the render thread is gone
+        if (m_Exception) std::rethrow_exception(m_Exception);
+    }
+
+    void FramePipeline::renderMain() {
+        while (true) {
+            uint64_t frame;
+            {
+                std::unique_lock lock(m_Mutex);
+                m_Changed.wait(lock, [this] { return m_Stopping || m_Completed < m_Submitted; });
+                if (m_Completed == m_Submitted) return; // stopping, and nothing left to render
+                frame = m_Completed;
+            }
+
+            try {
+                m_Render(frame);
+            } catch (...) {
+                spdlog::error("Render thread stopped by an exception in frame {}", frame);
+                {
+                    std::lock_guard lock(m_Mutex);
+                    m_Exception = std::current_exception();
+                }
+                m_Changed.notify_all();
+                return;
+            }
+
+            {
+                std::lock_guard lock(m_Mutex);
+                m_Completed = frame + 1;
+            }
+            m_Changed.notify_all();
+        }
+    }
+}// namespace kat
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace kat {
+
+    using FNRENDERFRAME = void(uint64_t frame);
+
+    // Runs rendering on its own thread, one frame behind simulation. The thread that pumps messages stays the
+    // simulation thread and owns the registry; the render thread only sees what was extracted for it (see
+    // RenderExtractor, whose two worlds line up with the two frames in flight here).
+    //
+    //   while running:
+    //       pollMessages
+    //       frame = pipeline.beginFrame()   // sync point: frame - 2 has been rendered, its slot is free
+    //       simulate, extract into slot frame
+    //       pipeline.endFrame()             // hands frame to the render thread, which calls render(frame)
+    //
+    // While the render thread records and submits frame N the simulation thread is already on N + 1, and it
+    // can't get further ahead than that: beginFrame(N + 2) blocks until N is done.
+    //
+    // An exception thrown by render stops the render thread and is rethrown from every later beginFrame,
+    // endFrame or flush on the simulation thread.
+    class FramePipeline {
+      public:
+        explicit FramePipeline(_In_ std::function<FNRENDERFRAME> render);
+        // renders whatever was handed over, then joins
+        ~FramePipeline();
+
+        FramePipeline(const FramePipeline &) = delete;
+        FramePipeline &operator=(const FramePipeline &) = delete;
+
+        // simulation thread. returns the index of the frame to simulate and extract.
+        [[nodiscard]] uint64_t beginFrame();
+        void endFrame();
+
+        // simulation thread. waits until every frame handed over has been rendered, e.g. before resizing
+        // swapchains or tearing down resources the render thread uses.
+        void flush();
+
+        // the frame beginFrame last returned
+        [[nodiscard]] uint64_t frameIndex() const noexcept;
+
+      private:
+        std::function<FNRENDERFRAME> m_Render;
+
+        std::mutex m_Mutex;
+        std::condition_variable m_Changed;
+        uint64_t m_Frame = 0;     // simulation side
+        uint64_t m_Submitted = 0; // frames handed over
+        uint64_t m_Completed = 0; // frames rendered, always <= m_Submitted
+        bool m_Stopping = false;
+        std::exception_ptr m_Exception;
+
+        std::thread m_Thread;
+
+        // m_Mutex must be held
+        void rethrow();
+        void renderMain();
+    };
+}// namespace kat
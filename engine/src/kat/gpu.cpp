@@ -0,0 +1,138 @@
+#include "gpu.hpp"
+
+#include "kat/gpu_sync.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace kat {
+
+    uint32_t findMemoryType(_In_ uint32_t typeBits, _In_ vk::MemoryPropertyFlags properties) {
+        vk::PhysicalDeviceMemoryProperties memory = globalState->physicalDevice.getMemoryProperties();
+        for (uint32_t i = 0; i < memory.memoryTypeCount; i++) {
+            if ((typeBits & (1u << i)) && (memory.memoryTypes[i].propertyFlags & properties) == properties) {
+                return i;
+            }
+        }
+        throw std::runtime_error("No suitable memory type");
+    }
+
+    vk::ShaderModule createShaderModule(_In_ std::span<const uint32_t> spirv) {
+        vk::ShaderModuleCreateInfo smci{};
+        smci.codeSize = spirv.size_bytes();
+        smci.pCode = spirv.data();
+        return globalState->device.createShaderModule(smci);
+    }
+
+    void submitImmediate(_In_ const std::function<void(vk::CommandBuffer)> &record) {
+        vk::Device device = globalState->device;
+
+        vk::CommandPool pool = device.createCommandPool(vk::CommandPoolCreateInfo{vk::CommandPoolCreateFlagBits::eTransient, globalState->graphicsQueueFamily});
+        try {
+            vk::CommandBuffer cmd = device.allocateCommandBuffers(vk::CommandBufferAllocateInfo{pool, vk::CommandBufferLevel::ePrimary, 1})[0];
+            cmd.begin(vk::CommandBufferBeginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+            record(cmd);
+            cmd.end();
+
+            QueueTimeline &timeline = graphicsTimeline();
+            timeline.wait(timeline.submit({&cmd, 1}));
+        } catch (...) {
+            device.destroyCommandPool(pool);
+            throw;
+        }
+        device.destroyCommandPool(pool);
+    }
+
+    Buffer::Buffer(_In_ vk::DeviceSize size, _In_ vk::BufferUsageFlags usage, _In_ vk::MemoryPropertyFlags properties,
+                   _In_ std::span<const uint32_t> queueFamilies) : m_Size(size) {
+        vk::Device device = globalState->device;
+
+        std::vector<uint32_t> families(queueFamilies.begin(), queueFamilies.end());
+        std::sort(families.begin(), families.end());
+        families.erase(std::unique(families.begin(), families.end()), families.end());
+
+        vk::BufferCreateInfo bci{};
+        bci.size = size;
+        bci.usage = usage;
+        bci.sharingMode = vk::SharingMode::eExclusive;
+        if (families.size() > 1) {
+            bci.sharingMode = vk::SharingMode::eConcurrent;
+            bci.setQueueFamilyIndices(families);
+        }
+        m_Buffer = device.createBuffer(bci);
+
+        try {
+            vk::MemoryRequirements requirements = device.getBufferMemoryRequirements(m_Buffer);
+            vk::MemoryAllocateInfo mai{requirements.size, findMemoryType(requirements.memoryTypeBits, properties)};
+            m_Memory = device.allocateMemory(mai);
+            device.bindBufferMemory(m_Buffer, m_Memory, 0);
+
+            if (properties & vk::MemoryPropertyFlagBits::eHostVisible) {
+                m_Mapped = device.mapMemory(m_Memory, 0, VK_WHOLE_SIZE);
+            }
+        } catch (...) {
+            destroy();
+            throw;
+        }
+    }
+
+    Buffer::~Buffer() {
+        destroy();
+    }
+
+    Buffer::Buffer(Buffer &&other) noexcept
+        : m_Buffer(std::exchange(other.m_Buffer, nullptr)), m_Memory(std::exchange(other.m_Memory, nullptr)),
+          m_Size(std::exchange(other.m_Size, 0)), m_Mapped(std::exchange(other.m_Mapped, nullptr)) {
+    }
+
+    Buffer &Buffer::operator=(Buffer &&other) noexcept {
+        if (this != &other) {
+            destroy();
+            m_Buffer = std::exchange(other.m_Buffer, nullptr);
+            m_Memory = std::exchange(other.m_Memory, nullptr);
+            m_Size = std::exchange(other.m_Size, 0);
+            m_Mapped = std::exchange(other.m_Mapped, nullptr);
+        }
+        return *this;
+    }
+
+    vk::Buffer Buffer::handle() const noexcept {
+        return m_Buffer;
+    }
+
+    vk::DeviceSize Buffer::size() const noexcept {
+        return m_Size;
+    }
+
+    void *Buffer::mapped() const noexcept {
+        return m_Mapped;
+    }
+
+    Buffer::operator bool() const noexcept {
+        return static_cast<bool>(m_Buffer);
+    }
+
+    void Buffer::destroy() noexcept {
+        vk::Device device = globalState ? globalState->device : vk::Device{};
+        if (!device) return;
+
+        // frames in flight may still use it (a buffer grown mid-run gets replaced right after its last use was
+        // submitted). without a deletion queue, at shutdown, the device is idle already.
+        if (m_Buffer || m_Memory) {
+            auto release = [device, buffer = m_Buffer, memory = m_Memory] {
+                if (buffer) device.destroyBuffer(buffer);
+                if (memory) device.freeMemory(memory); // unmaps implicitly
+            };
+            if (globalState->deletionQueue) {
+                deletionQueue().defer(release);
+            } else {
+                release();
+            }
+        }
+        m_Buffer = nullptr;
+        m_Memory = nullptr;
+        m_Mapped = nullptr;
+        m_Size = 0;
+    }
+}// namespace kat
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <functional>
+#include <span>
+
+namespace kat {
+
+    // throws if no memory type in typeBits has all of the properties
+    [[nodiscard]] uint32_t findMemoryType(_In_ uint32_t typeBits, _In_ vk::MemoryPropertyFlags properties);
+
+    [[nodiscard]] vk::ShaderModule createShaderModule(_In_ std::span<const uint32_t> spirv);
+
+    // records into a one-off command buffer, submits it on the graphics queue and waits for it. for setup work
+    // only, never inside a frame.
+    void submitImmediate(_In_ const std::function<void(vk::CommandBuffer)> &record);
+
+    // A buffer with its own dedicated allocation on globalState->device. Host visible buffers stay mapped for
+    // their whole lifetime. Destroying or assigning over one hands the old buffer to deletionQueue(), so it can
+    // be replaced right after its last use was submitted.
+    class Buffer {
+      public:
+        Buffer() = default;
+        // queueFamilies: every family using the buffer. more than one makes it concurrent, so graphics and async
+        // compute can share it without ownership transfers.
+        Buffer(_In_ vk::DeviceSize size, _In_ vk::BufferUsageFlags usage, _In_ vk::MemoryPropertyFlags properties,
+               _In_ std::span<const uint32_t> queueFamilies = {});
+        ~Buffer();
+
+        Buffer(Buffer &&other) noexcept;
+        Buffer &operator=(Buffer &&other) noexcept;
+        Buffer(const Buffer &) = delete;
+        Buffer &operator=(const Buffer &) = delete;
+
+        [[nodiscard]] vk::Buffer handle() const noexcept;
+        [[nodiscard]] vk::DeviceSize size() const noexcept;
+
+        // null unless the memory is host visible
+        [[nodiscard]] void *mapped() const noexcept;
+
+        [[nodiscard]] explicit operator bool() const noexcept;
+
+      private:
+        vk::Buffer m_Buffer;
+        vk::DeviceMemory m_Memory;
+        vk::DeviceSize m_Size = 0;
+        void *m_Mapped = nullptr;
+
+        void destroy() noexcept;
+    };
+}// namespace kat
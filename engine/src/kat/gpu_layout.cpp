@@ -0,0 +1,33 @@
+#include "gpu_layout.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace kat {
+
+    void checkGpuBlock(_In_ const char *name, _In_ std::span<const GpuField> fields, _In_ uint32_t size,
+                       _In_ std::span<const uint32_t> memberOffsets, _In_ uint32_t blockSize, _In_ uint32_t runtimeStride) {
+        if (runtimeStride != 0 && memberOffsets.size() == 1) {
+            if (runtimeStride != size) {
+                throw std::runtime_error(std::string(name) + ": the shader's array stride is " + std::to_string(runtimeStride) +
+                                         ", sizeof is " + std::to_string(size));
+            }
+            return;
+        }
+
+        if (memberOffsets.size() != fields.size()) {
+            throw std::runtime_error(std::string(name) + ": the shader's block has " + std::to_string(memberOffsets.size()) +
+                                     " members, the struct " + std::to_string(fields.size()));
+        }
+        for (size_t i = 0; i < fields.size(); i++) {
+            if (memberOffsets[i] != fields[i].offset) {
+                throw std::runtime_error(std::string(name) + "::" + fields[i].name + " is at " + std::to_string(fields[i].offset) +
+                                         ", the shader reads it at " + std::to_string(memberOffsets[i]));
+            }
+        }
+        if (blockSize > size) {
+            throw std::runtime_error(std::string(name) + ": the shader's block is " + std::to_string(blockSize) +
+                                     " bytes, sizeof is " + std::to_string(size));
+        }
+    }
+}// namespace kat
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "kat/core.hpp"
+#include "kat/shader_reflection.hpp"
+
+#include <array>
+#include <cstddef>
+#include <span>
+
+// Compile time checks that a c++ struct has the std140 or std430 layout of its glsl twin, so it can be
+// memcpy'd into a mapped buffer as is:
+//
+//   struct Light {
+//       glm::vec3 position;
+//       float radius;
+//       glm::vec4 color;
+//   };
+//   KAT_GPU_STRUCT(STD430, Light, KAT_GPU_FIELD(Light, position), KAT_GPU_FIELD(Light, radius), KAT_GPU_FIELD(Light, color));
+//
+// Every member has to be listed, in order. Besides the offsets, sizeof of each member must equal its gpu size,
+// so a checked struct nested in another one (or in an array) needs explicit tail padding; checkGpuLayout
+// catches arrays of it in a storage buffer. glm::mat3 and bool never match, use mat3x4 (or vec4 columns) and
+// uint32_t.
+//
+// Push constant blocks are std430.
+#define KAT_GPU_FIELD(Struct, member)                                                                         \
+    ::kat::GpuField {                                                                                         \
+        #member, offsetof(Struct, member), sizeof(Struct::member),                                            \
+                ::kat::GpuTypeTraits<decltype(Struct::member)>::of(::kat::GpuLayout::STD140),                 \
+                ::kat::GpuTypeTraits<decltype(Struct::member)>::of(::kat::GpuLayout::STD430)                  \
+    }
+
+#define KAT_GPU_STRUCT(layout, Struct, ...)                                                                   \
+    [[maybe_unused]] constexpr auto katGpuFields(const Struct *) {                                            \
+        return std::array{__VA_ARGS__};                                                                       \
+    }                                                                                                         \
+    static_assert(::kat::gpuStructLayout<Struct>(::kat::GpuLayout::layout).mismatch < 0,                     \
+                  #Struct " doesn't have the " #layout " layout")
+
+namespace kat {
+
+    enum class GpuLayout {
+        STD140, // uniform buffers
+        STD430, // storage buffers and push constants
+    };
+
+    struct GpuType {
+        uint32_t align;
+        uint32_t size;
+    };
+
+    // one member, see KAT_GPU_FIELD
+    struct GpuField {
+        const char *name;
+        uint32_t offset; // in c++
+        uint32_t size;   // in c++
+        GpuType std140;
+        GpuType std430;
+
+        [[nodiscard]] constexpr GpuType type(GpuLayout layout) const noexcept {
+            return layout == GpuLayout::STD140 ? std140 : std430;
+        }
+    };
+
+    struct GpuStructLayout {
+        GpuType type;
+        int32_t mismatch; // -1 if everything matches, else the first bad field or the field count if sizeof is too small
+    };
+
+    namespace detail {
+        constexpr uint32_t roundUp(uint32_t value, uint32_t alignment) noexcept {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        // std140 rounds array (and matrix column) strides and alignments up to a vec4, std430 doesn't
+        constexpr GpuType arrayElement(GpuLayout layout, GpuType element) noexcept {
+            uint32_t stride = roundUp(element.size, element.align);
+            uint32_t align = element.align;
+            if (layout == GpuLayout::STD140) {
+                stride = roundUp(stride, 16);
+                align = roundUp(align, 16);
+            }
+            return GpuType{align, stride};
+        }
+    }// namespace detail
+
+    // the offsets std140/std430 assign to fields, compared with where c++ put them
+    constexpr GpuStructLayout gpuStructLayout(GpuLayout layout, std::span<const GpuField> fields, uint32_t size) noexcept {
+        uint32_t align = layout == GpuLayout::STD140 ? 16 : 1;
+        uint32_t cursor = 0;
+        int32_t mismatch = -1;
+
+        for (size_t i = 0; i < fields.size(); i++) {
+            GpuType type = fields[i].type(layout);
+            uint32_t offset = detail::roundUp(cursor, type.align);
+            if (mismatch < 0 && (offset != fields[i].offset || type.size != fields[i].size)) {
+                mismatch = static_cast<int32_t>(i);
+            }
+            align = align > type.align ? align : type.align;
+            cursor = offset + type.size;
+        }
+
+        if (mismatch < 0 && size < cursor) {
+            mismatch = static_cast<int32_t>(fields.size());
+        }
+        return GpuStructLayout{GpuType{align, detail::roundUp(cursor, align)}, mismatch};
+    }
+
+    // size and alignment of T under a layout. only what glsl can express is defined, anything else fails to
+    // compile.
+    template<typename T>
+    struct GpuTypeTraits;
+
+    template<>
+    struct GpuTypeTraits<float> {
+        static constexpr GpuType of(GpuLayout) noexcept { return {4, 4}; }
+    };
+
+    template<>
+    struct GpuTypeTraits<int32_t> {
+        static constexpr GpuType of(GpuLayout) noexcept { return {4, 4}; }
+    };
+
+    template<>
+    struct GpuTypeTraits<uint32_t> {
+        static constexpr GpuType of(GpuLayout) noexcept { return {4, 4}; }
+    };
+
+    template<>
+    struct GpuTypeTraits<double> {
+        static constexpr GpuType of(GpuLayout) noexcept { return {8, 8}; }
+    };
+
+    template<glm::length_t N, typename T, glm::qualifier Q>
+    struct GpuTypeTraits<glm::vec<N, T, Q>> {
+        static constexpr GpuType of(GpuLayout layout) noexcept {
+            uint32_t component = GpuTypeTraits<T>::of(layout).size;
+            return {(N == 1 ? 1 : N == 2 ? 2 : 4) * component, N * component};
+        }
+    };
+
+    // column major, a matrix is an array of its columns
+    template<glm::length_t C, glm::length_t R, typename T, glm::qualifier Q>
+    struct GpuTypeTraits<glm::mat<C, R, T, Q>> {
+        static constexpr GpuType of(GpuLayout layout) noexcept {
+            GpuType column = detail::arrayElement(layout, GpuTypeTraits<glm::vec<R, T, Q>>::of(layout));
+            return {column.align, C * column.size};
+        }
+    };
+
+    template<typename T, size_t N>
+    struct GpuTypeTraits<T[N]> {
+        static constexpr GpuType of(GpuLayout layout) noexcept {
+            GpuType element = detail::arrayElement(layout, GpuTypeTraits<T>::of(layout));
+            return {element.align, static_cast<uint32_t>(N) * element.size};
+        }
+    };
+
+    template<typename T, size_t N>
+    struct GpuTypeTraits<std::array<T, N>> : GpuTypeTraits<T[N]> {};
+
+    // structs declared with KAT_GPU_STRUCT
+    template<typename T>
+        requires requires(const T *t) { katGpuFields(t); }
+    struct GpuTypeTraits<T> {
+        static constexpr GpuType of(GpuLayout layout) noexcept {
+            constexpr auto fields = katGpuFields(static_cast<const T *>(nullptr));
+            return gpuStructLayout(layout, fields, sizeof(T)).type;
+        }
+    };
+
+    template<typename T>
+    constexpr GpuStructLayout gpuStructLayout(GpuLayout layout) noexcept {
+        constexpr auto fields = katGpuFields(static_cast<const T *>(nullptr));
+        return gpuStructLayout(layout, fields, sizeof(T));
+    }
+
+    // throws if the shader disagrees with fields: a block holding the struct directly, or a block whose only
+    // member is a runtime array of it
+    void checkGpuBlock(_In_ const char *name, _In_ std::span<const GpuField> fields, _In_ uint32_t size,
+                       _In_ std::span<const uint32_t> memberOffsets, _In_ uint32_t blockSize, _In_ uint32_t runtimeStride);
+
+    // for pipeline creation, catches a shader changed without its c++ struct (or the other way around)
+    template<typename T>
+    void checkGpuLayout(_In_ const ShaderReflection::Binding &binding, _In_ const char *name) {
+        constexpr auto fields = katGpuFields(static_cast<const T *>(nullptr));
+        checkGpuBlock(name, fields, sizeof(T), binding.memberOffsets, binding.blockSize, binding.runtimeStride);
+    }
+
+    template<typename T>
+    void checkGpuPushConstants(_In_ const ShaderReflection &reflection, _In_ const char *name) {
+        constexpr auto fields = katGpuFields(static_cast<const T *>(nullptr));
+        checkGpuBlock(name, fields, sizeof(T), reflection.pushConstantMembers,
+                      reflection.pushConstantOffset + reflection.pushConstantSize, 0);
+    }
+}// namespace kat
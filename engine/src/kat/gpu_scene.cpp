@@ -0,0 +1,376 @@
+#include "gpu_scene.hpp"
+
+#include "kat/gpu_sync.hpp"
+#include "kat/prefab.hpp"
+#include "kat/transform.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace kat {
+
+    namespace {
+        constexpr uint32_t CULL_COMP_SPV[] =
+#include "kat/shaders/cull.comp.spv.h"
+                ;
+
+        constexpr uint32_t CULL_OCCLUSION_COMP_SPV[] =
+#include "kat/shaders/cull_occlusion.comp.spv.h"
+                ;
+
+        constexpr uint32_t WORKGROUP_SIZE = 64;
+        constexpr vk::DeviceSize READBACK_DRAWS_OFFSET = 16;
+
+        struct CullPush {
+            glm::mat4 viewProjection;
+            uint32_t instanceCount;
+            uint32_t phase;
+            glm::vec2 pyramidSize;
+            uint32_t pyramidLevels;
+        };
+        KAT_GPU_STRUCT(STD430, CullPush, KAT_GPU_FIELD(CullPush, viewProjection), KAT_GPU_FIELD(CullPush, instanceCount), KAT_GPU_FIELD(CullPush, phase),
+                       KAT_GPU_FIELD(CullPush, pyramidSize), KAT_GPU_FIELD(CullPush, pyramidLevels));
+
+        // the shaders against the structs above, once, so an edit on either side fails loudly instead of culling garbage
+        void checkCullLayouts(_In_ std::span<const uint32_t> spirv) {
+            ShaderReflection reflection = ShaderReflection::reflect(spirv);
+            checkGpuPushConstants<CullPush>(reflection, "CullPush");
+            checkGpuLayout<GpuInstance>(reflection.bindings[0], "GpuInstance");
+            checkGpuLayout<GpuMesh>(reflection.bindings[1], "GpuMesh");
+        }
+
+        vk::Pipeline createCullPipeline(_In_ vk::PipelineLayout layout, _In_ std::span<const uint32_t> spirv) {
+            vk::Device device = globalState->device;
+
+            vk::ShaderModule module = createShaderModule(spirv);
+            vk::ComputePipelineCreateInfo cpci{};
+            cpci.stage = vk::PipelineShaderStageCreateInfo{{}, vk::ShaderStageFlagBits::eCompute, module, "main"};
+            cpci.layout = layout;
+            auto pipeline = device.createComputePipeline(nullptr, cpci);
+            device.destroyShaderModule(module);
+            if (pipeline.result != vk::Result::eSuccess) {
+                throw std::runtime_error("Failed to create culling pipeline");
+            }
+            return pipeline.value;
+        }
+    }// namespace
+
+    GpuScene::GpuScene(_In_ entt::registry &registry, _In_ const GpuSceneSettings &settings) : m_Registry(registry), m_Settings(settings) {
+        vk::Device device = globalState->device;
+
+        const auto deviceLocal = vk::MemoryPropertyFlagBits::eDeviceLocal;
+        const auto hostVisible = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+        using Usage = vk::BufferUsageFlagBits;
+
+        m_Instances = Buffer(vk::DeviceSize{settings.maxInstances} * sizeof(GpuInstance), Usage::eStorageBuffer | Usage::eTransferDst, deviceLocal);
+        m_Meshes = Buffer(vk::DeviceSize{settings.maxMeshes} * sizeof(GpuMesh), Usage::eStorageBuffer, hostVisible);
+        m_Draws = Buffer(vk::DeviceSize{settings.maxInstances} * sizeof(vk::DrawIndexedIndirectCommand), Usage::eStorageBuffer | Usage::eIndirectBuffer | Usage::eTransferSrc, deviceLocal);
+        m_DrawCount = Buffer(sizeof(uint32_t), Usage::eStorageBuffer | Usage::eIndirectBuffer | Usage::eTransferSrc | Usage::eTransferDst, deviceLocal);
+        m_Visibility = Buffer(vk::DeviceSize{settings.maxInstances} * sizeof(uint32_t), Usage::eStorageBuffer | Usage::eTransferSrc | Usage::eTransferDst, deviceLocal);
+        for (Buffer &staging : m_Staging) {
+            staging = Buffer(m_Instances.size(), Usage::eTransferSrc, hostVisible);
+        }
+        m_Readback = Buffer(READBACK_DRAWS_OFFSET + m_Draws.size(), Usage::eTransferDst, hostVisible);
+
+        std::array<vk::DescriptorSetLayoutBinding, 5> bindings;
+        for (uint32_t i = 0; i < bindings.size(); i++) {
+            bindings[i] = vk::DescriptorSetLayoutBinding{i, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute};
+        }
+        m_SetLayout = device.createDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo{{}, bindings});
+
+        vk::DescriptorPoolSize poolSize{vk::DescriptorType::eStorageBuffer, static_cast<uint32_t>(bindings.size())};
+        m_DescriptorPool = device.createDescriptorPool(vk::DescriptorPoolCreateInfo{{}, 1, poolSize});
+        m_Set = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo{m_DescriptorPool, m_SetLayout})[0];
+
+        std::array<vk::DescriptorBufferInfo, 5> infos = {
+                vk::DescriptorBufferInfo{m_Instances.handle(), 0, VK_WHOLE_SIZE},
+                vk::DescriptorBufferInfo{m_Meshes.handle(), 0, VK_WHOLE_SIZE},
+                vk::DescriptorBufferInfo{m_Draws.handle(), 0, VK_WHOLE_SIZE},
+                vk::DescriptorBufferInfo{m_DrawCount.handle(), 0, VK_WHOLE_SIZE},
+                vk::DescriptorBufferInfo{m_Visibility.handle(), 0, VK_WHOLE_SIZE},
+        };
+        std::array<vk::WriteDescriptorSet, 5> writes;
+        for (uint32_t i = 0; i < writes.size(); i++) {
+            writes[i] = vk::WriteDescriptorSet{m_Set, i, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &infos[i]};
+        }
+        device.updateDescriptorSets(writes, {});
+
+        // set 1 holds the depth pyramid and is only bound for the late phase
+        vk::DescriptorSetLayoutBinding pyramidBinding{0, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute};
+        m_PyramidSetLayout = device.createDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo{{}, pyramidBinding});
+
+        // one per frame in flight, so a new pyramid never rewrites a set a pending frame has bound
+        vk::DescriptorPoolSize pyramidPoolSize{vk::DescriptorType::eCombinedImageSampler, FRAMES_IN_FLIGHT};
+        m_PyramidPool = device.createDescriptorPool(vk::DescriptorPoolCreateInfo{{}, FRAMES_IN_FLIGHT, pyramidPoolSize});
+        std::array<vk::DescriptorSetLayout, FRAMES_IN_FLIGHT> pyramidLayouts;
+        pyramidLayouts.fill(m_PyramidSetLayout);
+        auto pyramidSets = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo{m_PyramidPool, pyramidLayouts});
+        std::copy(pyramidSets.begin(), pyramidSets.end(), m_PyramidSets.begin());
+
+        std::array<vk::DescriptorSetLayout, 2> setLayouts = {m_SetLayout, m_PyramidSetLayout};
+        vk::PushConstantRange pushRange{vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullPush)};
+        m_PipelineLayout = device.createPipelineLayout(vk::PipelineLayoutCreateInfo{{}, setLayouts, pushRange});
+
+        checkCullLayouts(CULL_COMP_SPV);
+        m_Pipeline = createCullPipeline(m_PipelineLayout, CULL_COMP_SPV);
+        m_OcclusionPipeline = createCullPipeline(m_PipelineLayout, CULL_OCCLUSION_COMP_SPV);
+
+        m_Registry.on_construct<MeshInstance>().connect<&GpuScene::onChanged>(*this);
+        m_Registry.on_update<MeshInstance>().connect<&GpuScene::onChanged>(*this);
+        m_Registry.on_destroy<MeshInstance>().connect<&GpuScene::onChanged>(*this);
+        m_Registry.on_construct<WorldTransform>().connect<&GpuScene::onChanged>(*this);
+        m_Registry.on_update<WorldTransform>().connect<&GpuScene::onChanged>(*this);
+        m_Registry.on_destroy<WorldTransform>().connect<&GpuScene::onChanged>(*this);
+
+        // prefabs hand over a whole range at once
+        auto constructed = [this](std::span<const entt::entity> entities) { m_Pending.insert(m_Pending.end(), entities.begin(), entities.end()); };
+        bulkConstruction(m_Registry).connect<MeshInstance, &GpuScene::onChanged>(*this, constructed);
+        bulkConstruction(m_Registry).connect<WorldTransform, &GpuScene::onChanged>(*this, constructed);
+
+        for (auto entity : m_Registry.view<MeshInstance>()) {
+            m_Pending.push_back(entity);
+        }
+    }
+
+    GpuScene::~GpuScene() {
+        m_Registry.on_construct<MeshInstance>().disconnect(this);
+        m_Registry.on_update<MeshInstance>().disconnect(this);
+        m_Registry.on_destroy<MeshInstance>().disconnect(this);
+        m_Registry.on_construct<WorldTransform>().disconnect(this);
+        m_Registry.on_update<WorldTransform>().disconnect(this);
+        m_Registry.on_destroy<WorldTransform>().disconnect(this);
+        bulkConstruction(m_Registry).disconnect(this);
+
+        // frames in flight may still cull and draw with them, the buffers defer themselves
+        DeletionQueue &deletions = deletionQueue();
+        deletions.destroy(m_Pipeline);
+        deletions.destroy(m_OcclusionPipeline);
+        deletions.destroy(m_PipelineLayout);
+        deletions.destroy(m_DescriptorPool);
+        deletions.destroy(m_PyramidPool);
+        deletions.destroy(m_SetLayout);
+        deletions.destroy(m_PyramidSetLayout);
+    }
+
+    uint32_t GpuScene::addMesh(_In_ uint32_t indexCount, _In_ uint32_t firstIndex, _In_ int32_t vertexOffset, _In_ const BoundingSphere &bounds) {
+        if (m_MeshCount >= m_Settings.maxMeshes) {
+            throw std::runtime_error("GpuScene mesh capacity exceeded");
+        }
+
+        // a new slot, so no frame in flight can be reading it
+        GpuMesh mesh{glm::vec4(bounds.center, bounds.radius), indexCount, firstIndex, vertexOffset, 0};
+        std::memcpy(static_cast<GpuMesh *>(m_Meshes.mapped()) + m_MeshCount, &mesh, sizeof(mesh));
+        return m_MeshCount++;
+    }
+
+    void GpuScene::sync(_In_ vk::CommandBuffer cmd, _In_ uint32_t frame) {
+        m_Frame = frame % FRAMES_IN_FLIGHT;
+        if (m_StalePyramidSets & (1u << m_Frame)) {
+            if (m_Pyramid) {
+                vk::DescriptorImageInfo image{m_Pyramid->sampler(), m_Pyramid->view(), vk::ImageLayout::eGeneral};
+                globalState->device.updateDescriptorSets(vk::WriteDescriptorSet{m_PyramidSets[m_Frame], 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &image}, {});
+            }
+            m_SetPyramids[m_Frame] = m_Pyramid;
+            m_StalePyramidSets &= ~(1u << m_Frame);
+        }
+
+        for (entt::entity entity : m_Pending) {
+            if (!m_Registry.valid(entity) || !m_Registry.all_of<MeshInstance, WorldTransform>(entity)) {
+                remove(entity);
+                continue;
+            }
+
+            uint32_t slot = slotOf(entity);
+            if (slot != NONE && m_Entities[slot] != entity) {
+                remove(m_Entities[slot]); // entity slot reused before the old one's removal was seen
+                slot = NONE;
+            }
+
+            if (slot == NONE) {
+                if (m_Entities.size() >= m_Settings.maxInstances) {
+                    spdlog::error("GpuScene instance capacity ({}) exceeded, entity {} is not drawn", m_Settings.maxInstances, static_cast<uint32_t>(entity));
+                    continue;
+                }
+
+                slot = static_cast<uint32_t>(m_Entities.size());
+                m_Entities.push_back(entity);
+
+                auto index = static_cast<size_t>(entt::to_entity(entity));
+                if (index >= m_Slots.size()) m_Slots.resize(index + 1, NONE);
+                m_Slots[index] = slot;
+                m_VisibilityMoves[slot] = NONE; // the slot may hold a removed instance's history
+            }
+            m_Dirty.push_back(slot);
+        }
+        m_Pending.clear();
+
+        std::sort(m_Dirty.begin(), m_Dirty.end());
+        m_Dirty.erase(std::unique(m_Dirty.begin(), m_Dirty.end()), m_Dirty.end());
+        while (!m_Dirty.empty() && m_Dirty.back() >= m_Entities.size()) m_Dirty.pop_back(); // removed since
+
+        if (m_Dirty.empty()) return;
+
+        // the previous frame's cull and vertex shaders must be done reading before the copies overwrite anything
+        vk::MemoryBarrier before{vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite};
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eVertexShader, vk::PipelineStageFlagBits::eTransfer, {}, before, {}, {});
+
+        // every source is an entry as it was after the last frame, and no source is also a destination (sources
+        // were past the end of the instances when they moved, destinations before it), so one copy does it
+        if (!m_VisibilityMoves.empty()) {
+            std::vector<vk::BufferCopy> moves;
+            for (auto [slot, source] : m_VisibilityMoves) {
+                if (source != NONE) moves.push_back({vk::DeviceSize{source} * sizeof(uint32_t), vk::DeviceSize{slot} * sizeof(uint32_t), sizeof(uint32_t)});
+            }
+            if (!moves.empty()) cmd.copyBuffer(m_Visibility.handle(), m_Visibility.handle(), moves);
+
+            vk::MemoryBarrier moved{vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferWrite};
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, moved, {}, {});
+            for (auto [slot, source] : m_VisibilityMoves) {
+                if (source == NONE) cmd.fillBuffer(m_Visibility.handle(), vk::DeviceSize{slot} * sizeof(uint32_t), sizeof(uint32_t), 0);
+            }
+            m_VisibilityMoves.clear();
+        }
+
+        // pack the dirty instances into staging, one copy region per run of consecutive slots
+        auto *staging = static_cast<GpuInstance *>(m_Staging[frame % FRAMES_IN_FLIGHT].mapped());
+        std::vector<vk::BufferCopy> regions;
+        for (size_t i = 0; i < m_Dirty.size(); i++) {
+            uint32_t slot = m_Dirty[i];
+            entt::entity entity = m_Entities[slot];
+
+            staging[i] = GpuInstance{m_Registry.get<WorldTransform>(entity).matrix, m_Registry.get<MeshInstance>(entity).mesh, {}};
+
+            if (!regions.empty() && regions.back().dstOffset + regions.back().size == vk::DeviceSize{slot} * sizeof(GpuInstance)) {
+                regions.back().size += sizeof(GpuInstance);
+            } else {
+                regions.push_back({i * sizeof(GpuInstance), vk::DeviceSize{slot} * sizeof(GpuInstance), sizeof(GpuInstance)});
+            }
+        }
+        m_Dirty.clear();
+
+        cmd.copyBuffer(m_Staging[frame % FRAMES_IN_FLIGHT].handle(), m_Instances.handle(), regions);
+
+        vk::MemoryBarrier after{vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite};
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eVertexShader, {}, after, {}, {});
+    }
+
+    void GpuScene::setDepthPyramid(_In_ const DepthPyramid *pyramid) {
+        m_Pyramid = pyramid;
+        m_StalePyramidSets = (1u << FRAMES_IN_FLIGHT) - 1;
+    }
+
+    void GpuScene::cull(_In_ vk::CommandBuffer cmd, _In_ const glm::mat4 &viewProjection, _In_ CullPhase phase) {
+        const DepthPyramid *pyramid = m_SetPyramids[m_Frame];
+        if (phase == CullPhase::LATE && !pyramid) {
+            throw std::logic_error("The late cull phase needs a depth pyramid, set before this frame's sync");
+        }
+
+        // last frame's indirect reads and readback copy have to finish before the arguments are rewritten
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eTransfer,
+                            vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader, {}, vk::MemoryBarrier{}, {}, {});
+
+        if (!m_VisibilityCleared) {
+            // nothing counts as visible before the first frame, the late phase picks everything up
+            cmd.fillBuffer(m_Visibility.handle(), 0, VK_WHOLE_SIZE, 0);
+            m_VisibilityCleared = true;
+        }
+        cmd.fillBuffer(m_DrawCount.handle(), 0, sizeof(uint32_t), 0);
+
+        vk::MemoryBarrier cleared{vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite};
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, cleared, {}, {});
+
+        CullPush push{};
+        push.viewProjection = viewProjection;
+        push.instanceCount = instanceCount();
+        push.phase = static_cast<uint32_t>(phase);
+
+        if (phase == CullPhase::LATE) {
+            push.pyramidSize = glm::vec2(pyramid->extent().width, pyramid->extent().height);
+            push.pyramidLevels = pyramid->levelCount();
+
+            cmd.bindPipeline(vk::PipelineBindPoint::eCompute, m_OcclusionPipeline);
+            cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_PipelineLayout, 0, {m_Set, m_PyramidSets[m_Frame]}, {});
+        } else {
+            cmd.bindPipeline(vk::PipelineBindPoint::eCompute, m_Pipeline);
+            cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_PipelineLayout, 0, m_Set, {});
+        }
+        cmd.pushConstants(m_PipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(push), &push);
+        cmd.dispatch((push.instanceCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+        // visibility is read back by the next phase's dispatch
+        vk::MemoryBarrier written{vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite};
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader, {}, written, {}, {});
+    }
+
+    void GpuScene::draw(_In_ vk::CommandBuffer cmd) const {
+        cmd.drawIndexedIndirectCount(m_Draws.handle(), 0, m_DrawCount.handle(), 0, m_Settings.maxInstances, sizeof(vk::DrawIndexedIndirectCommand));
+    }
+
+    void GpuScene::recordReadback(_In_ vk::CommandBuffer cmd) {
+        cmd.copyBuffer(m_DrawCount.handle(), m_Readback.handle(), vk::BufferCopy{0, 0, sizeof(uint32_t)});
+        cmd.copyBuffer(m_Draws.handle(), m_Readback.handle(), vk::BufferCopy{0, READBACK_DRAWS_OFFSET, m_Draws.size()});
+
+        vk::MemoryBarrier toHost{vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead};
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, toHost, {}, {});
+    }
+
+    std::vector<vk::DrawIndexedIndirectCommand> GpuScene::readback() const {
+        const auto *bytes = static_cast<const std::byte *>(m_Readback.mapped());
+
+        uint32_t count;
+        std::memcpy(&count, bytes, sizeof(count));
+        count = std::min(count, m_Settings.maxInstances);
+
+        std::vector<vk::DrawIndexedIndirectCommand> draws(count);
+        std::memcpy(draws.data(), bytes + READBACK_DRAWS_OFFSET, count * sizeof(vk::DrawIndexedIndirectCommand));
+        return draws;
+    }
+
+    vk::Buffer GpuScene::instanceBuffer() const noexcept {
+        return m_Instances.handle();
+    }
+
+    vk::Buffer GpuScene::drawBuffer() const noexcept {
+        return m_Draws.handle();
+    }
+
+    vk::Buffer GpuScene::drawCountBuffer() const noexcept {
+        return m_DrawCount.handle();
+    }
+
+    uint32_t GpuScene::instanceCount() const noexcept {
+        return static_cast<uint32_t>(m_Entities.size());
+    }
+
+    uint32_t GpuScene::slotOf(_In_ entt::entity entity) const noexcept {
+        auto index = static_cast<size_t>(entt::to_entity(entity));
+        return index < m_Slots.size() ? m_Slots[index] : NONE;
+    }
+
+    void GpuScene::remove(_In_ entt::entity entity) {
+        uint32_t slot = slotOf(entity);
+        if (slot == NONE || m_Entities[slot] != entity) return;
+
+        entt::entity last = m_Entities.back();
+        m_Entities[slot] = last;
+        m_Entities.pop_back();
+        m_Slots[static_cast<size_t>(entt::to_entity(entity))] = NONE;
+
+        // the moved instance takes its visibility history along, from wherever it is on the gpu right now
+        const auto lastSlot = static_cast<uint32_t>(m_Entities.size());
+        if (last != entity) {
+            m_Slots[static_cast<size_t>(entt::to_entity(last))] = slot;
+            m_Dirty.push_back(slot);
+
+            auto pending = m_VisibilityMoves.find(lastSlot);
+            m_VisibilityMoves[slot] = pending != m_VisibilityMoves.end() ? pending->second : lastSlot;
+        }
+        m_VisibilityMoves.erase(lastSlot);
+    }
+
+    void GpuScene::onChanged(_In_ entt::registry &, _In_ entt::entity entity) {
+        m_Pending.push_back(entity);
+    }
+}// namespace kat
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "kat/core.hpp"
+#include "kat/culling.hpp"
+#include "kat/depth_pyramid.hpp"
+#include "kat/gpu.hpp"
+#include "kat/gpu_layout.hpp"
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+namespace kat {
+
+    // Marks an entity (with a WorldTransform) for the gpu driven path. mesh comes from GpuScene::addMesh.
+    struct MeshInstance {
+        uint32_t mesh = 0;
+    };
+
+    // std430 layouts shared with shaders/cull.comp
+    struct GpuInstance {
+        glm::mat4 model;
+        uint32_t mesh;
+        uint32_t padding[3];
+    };
+    KAT_GPU_STRUCT(STD430, GpuInstance, KAT_GPU_FIELD(GpuInstance, model), KAT_GPU_FIELD(GpuInstance, mesh), KAT_GPU_FIELD(GpuInstance, padding));
+
+    struct GpuMesh {
+        glm::vec4 sphere;
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        uint32_t padding;
+    };
+    KAT_GPU_STRUCT(STD430, GpuMesh, KAT_GPU_FIELD(GpuMesh, sphere), KAT_GPU_FIELD(GpuMesh, indexCount), KAT_GPU_FIELD(GpuMesh, firstIndex),
+                   KAT_GPU_FIELD(GpuMesh, vertexOffset), KAT_GPU_FIELD(GpuMesh, padding));
+
+    enum class CullPhase : uint32_t {
+        ALL,   // frustum only, everything in view is drawn
+        EARLY, // frustum only, restricted to what the last LATE (or ALL) pass found visible
+        LATE,  // frustum and hi-z against the pyramid built from EARLY's depth; draws only what EARLY skipped
+    };
+
+    struct GpuSceneSettings {
+        uint32_t maxInstances = 1 << 16;
+        uint32_t maxMeshes = 1024;
+    };
+
+    // Instance data for every MeshInstance lives in a device local buffer that is kept in sync with the registry
+    // by uploading only what changed. Each frame a compute pass culls all of it and writes the draw arguments, so
+    // the cpu records one vkCmdDrawIndexedIndirectCount no matter how many objects there are.
+    //
+    // Draws use firstInstance as the instance index: the vertex shader reads instanceBuffer()[gl_InstanceIndex].
+    //
+    // With occlusion culling a frame runs in two phases, so nothing that was visible pops out for a frame:
+    //   cull(EARLY), draw(), pyramid.build(), cull(LATE), draw() again with the depth buffer loaded.
+    // Objects hidden last frame but revealed now are caught by LATE against this frame's depth.
+    class GpuScene {
+      public:
+        explicit GpuScene(_In_ entt::registry &registry, _In_ const GpuSceneSettings &settings = {});
+        ~GpuScene();
+
+        GpuScene(const GpuScene &) = delete;
+        GpuScene &operator=(const GpuScene &) = delete;
+
+        // range of an index buffer the caller binds before draw(), plus its local bounds
+        uint32_t addMesh(_In_ uint32_t indexCount, _In_ uint32_t firstIndex, _In_ int32_t vertexOffset, _In_ const BoundingSphere &bounds);
+
+        // records the upload of everything that changed since the last call. frame selects the staging buffer, the
+        // caller has to know the gpu finished with that frame's previous use (the usual frame fence).
+        void sync(_In_ vk::CommandBuffer cmd, _In_ uint32_t frame);
+
+        // the pyramid the LATE phase tests against, from the next sync() on (also after the pyramid was recreated).
+        // each frame in flight has its own descriptor set, written by sync once the gpu is done with it. the
+        // pyramid has to outlive the frames using it.
+        void setDepthPyramid(_In_ const DepthPyramid *pyramid);
+
+        // records the culling dispatch. the draw arguments are ready for the indirect stage afterwards.
+        void cull(_In_ vk::CommandBuffer cmd, _In_ const glm::mat4 &viewProjection, _In_ CullPhase phase = CullPhase::ALL);
+
+        // inside a render pass, with the pipeline, index and vertex buffers bound
+        void draw(_In_ vk::CommandBuffer cmd) const;
+
+        // copies the draw count and arguments into host memory; read them with readback() after the submission
+        // has completed
+        void recordReadback(_In_ vk::CommandBuffer cmd);
+        [[nodiscard]] std::vector<vk::DrawIndexedIndirectCommand> readback() const;
+
+        [[nodiscard]] vk::Buffer instanceBuffer() const noexcept;
+        [[nodiscard]] vk::Buffer drawBuffer() const noexcept;
+        [[nodiscard]] vk::Buffer drawCountBuffer() const noexcept;
+        [[nodiscard]] uint32_t instanceCount() const noexcept;
+
+      private:
+        static constexpr uint32_t NONE = ~0u;
+
+        entt::registry &m_Registry;
+        GpuSceneSettings m_Settings;
+
+        Buffer m_Instances;
+        Buffer m_Meshes;
+        Buffer m_Draws;
+        Buffer m_DrawCount;
+        Buffer m_Visibility;
+        bool m_VisibilityCleared = false;
+        std::array<Buffer, FRAMES_IN_FLIGHT> m_Staging;
+        Buffer m_Readback;
+
+        vk::DescriptorSetLayout m_SetLayout;
+        vk::DescriptorPool m_DescriptorPool;
+        vk::DescriptorSet m_Set;
+        vk::DescriptorSetLayout m_PyramidSetLayout;
+        vk::DescriptorPool m_PyramidPool;
+        std::array<vk::DescriptorSet, FRAMES_IN_FLIGHT> m_PyramidSets;
+        std::array<const DepthPyramid *, FRAMES_IN_FLIGHT> m_SetPyramids{}; // what each set was last written with
+        const DepthPyramid *m_Pyramid = nullptr;
+        uint32_t m_StalePyramidSets = 0; // bit per frame
+        uint32_t m_Frame = 0;            // of the last sync
+
+        vk::PipelineLayout m_PipelineLayout;
+        vk::Pipeline m_Pipeline;
+        vk::Pipeline m_OcclusionPipeline;
+
+        uint32_t m_MeshCount = 0;
+
+        // slot i of the instance buffer belongs to m_Entities[i]. removal moves the last slot into the hole.
+        std::vector<entt::entity> m_Entities;
+        std::vector<uint32_t> m_Slots; // entity slot -> instance slot
+        std::vector<entt::entity> m_Pending;
+        std::vector<uint32_t> m_Dirty;
+        // visibility history to move with the instances, applied by the next sync: instance slot -> the slot its
+        // entry is in on the gpu, NONE for new instances that start out hidden
+        std::unordered_map<uint32_t, uint32_t> m_VisibilityMoves;
+
+        [[nodiscard]] uint32_t slotOf(_In_ entt::entity entity) const noexcept;
+        void remove(_In_ entt::entity entity);
+
+        void onChanged(_In_ entt::registry &registry, _In_ entt::entity entity);
+    };
+}// namespace kat
@@ -0,0 +1,193 @@
+#include "gpu_sync.hpp"
+
+#include <spdlog/spdlog.h>
+
+namespace kat {
+
+    QueueTimeline::QueueTimeline(_In_ vk::Queue queue, _In_ uint32_t family) : m_Queue(queue), m_Family(family) {
+        vk::SemaphoreTypeCreateInfo type{vk::SemaphoreType::eTimeline, 0};
+        vk::SemaphoreCreateInfo sci{};
+        sci.pNext = &type;
+        m_Semaphore = globalState->device.createSemaphore(sci);
+    }
+
+    QueueTimeline::~QueueTimeline() {
+        globalState->device.destroySemaphore(m_Semaphore);
+    }
+
+    uint64_t QueueTimeline::submit(_In_ std::span<const vk::CommandBuffer> cmds, _In_ std::span<const SemaphoreWait> waits,
+                                   _In_ std::span<const vk::Semaphore> signals) {
+        std::vector<vk::Semaphore> waitSemaphores;
+        std::vector<uint64_t> waitValues;
+        std::vector<vk::PipelineStageFlags> waitStages;
+        waitSemaphores.reserve(waits.size());
+        waitValues.reserve(waits.size());
+        waitStages.reserve(waits.size());
+        for (const SemaphoreWait &wait : waits) {
+            waitSemaphores.push_back(wait.semaphore);
+            waitValues.push_back(wait.value);
+            waitStages.push_back(wait.stages);
+        }
+
+        std::vector<vk::Semaphore> signalSemaphores(signals.begin(), signals.end());
+        std::vector<uint64_t> signalValues(signals.size(), 0);
+        signalSemaphores.push_back(m_Semaphore);
+
+        std::lock_guard lock(m_SubmitMutex);
+        uint64_t point = m_Submitted.load(std::memory_order_relaxed) + 1;
+        signalValues.push_back(point);
+
+        vk::TimelineSemaphoreSubmitInfo timeline{};
+        timeline.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+        timeline.pWaitSemaphoreValues = waitValues.data();
+        timeline.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+        timeline.pSignalSemaphoreValues = signalValues.data();
+
+        vk::SubmitInfo si{};
+        si.pNext = &timeline;
+        si.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        si.pWaitSemaphores = waitSemaphores.data();
+        si.pWaitDstStageMask = waitStages.data();
+        si.commandBufferCount = static_cast<uint32_t>(cmds.size());
+        si.pCommandBuffers = cmds.data();
+        si.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        si.pSignalSemaphores = signalSemaphores.data();
+        m_Queue.submit(si);
+
+        m_Submitted.store(point, std::memory_order_release);
+        return point;
+    }
+
+    bool QueueTimeline::reached(_In_ uint64_t point) {
+        return point <= m_Completed.load(std::memory_order_acquire) || point <= completed();
+    }
+
+    uint64_t QueueTimeline::completed() {
+        uint64_t value = globalState->device.getSemaphoreCounterValue(m_Semaphore);
+
+        // several threads may refresh at once, never move the cache backwards
+        uint64_t cached = m_Completed.load(std::memory_order_relaxed);
+        while (cached < value && !m_Completed.compare_exchange_weak(cached, value, std::memory_order_release)) {
+        }
+        return value;
+    }
+
+    uint64_t QueueTimeline::lastSubmitted() const noexcept {
+        return m_Submitted.load(std::memory_order_acquire);
+    }
+
+    bool QueueTimeline::wait(_In_ uint64_t point, _In_ uint64_t timeout) {
+        if (point <= m_Completed.load(std::memory_order_acquire)) return true;
+
+        vk::SemaphoreWaitInfo swi{};
+        swi.semaphoreCount = 1;
+        swi.pSemaphores = &m_Semaphore;
+        swi.pValues = &point;
+        if (globalState->device.waitSemaphores(swi, timeout) == vk::Result::eTimeout) {
+            return false;
+        }
+        (void) completed();
+        return true;
+    }
+
+    void QueueTimeline::waitIdle() {
+        wait(lastSubmitted());
+    }
+
+    vk::Queue QueueTimeline::queue() const noexcept {
+        return m_Queue;
+    }
+
+    uint32_t QueueTimeline::family() const noexcept {
+        return m_Family;
+    }
+
+    vk::Semaphore QueueTimeline::semaphore() const noexcept {
+        return m_Semaphore;
+    }
+
+    DeletionQueue::DeletionQueue(_In_ std::vector<QueueTimeline *> timelines) : m_Timelines(std::move(timelines)) {
+    }
+
+    DeletionQueue::~DeletionQueue() {
+        std::vector<Entry> left(std::make_move_iterator(m_Entries.begin()), std::make_move_iterator(m_Entries.end()));
+        m_Entries.clear();
+        run(left);
+    }
+
+    void DeletionQueue::defer(_In_ std::function<void()> release) {
+        Entry entry{{}, std::move(release)};
+        entry.points.reserve(m_Timelines.size());
+
+        // read under the lock, so entries stay ordered by their points
+        std::lock_guard lock(m_Mutex);
+        for (QueueTimeline *timeline : m_Timelines) {
+            entry.points.push_back(timeline->lastSubmitted());
+        }
+        m_Entries.push_back(std::move(entry));
+    }
+
+    void DeletionQueue::collect() {
+        std::vector<Entry> ready;
+        {
+            std::lock_guard lock(m_Mutex);
+            while (!m_Entries.empty()) {
+                const Entry &front = m_Entries.front();
+                bool passed = true;
+                for (size_t i = 0; i < m_Timelines.size() && passed; i++) {
+                    passed = m_Timelines[i]->reached(front.points[i]);
+                }
+                if (!passed) break;
+
+                ready.push_back(std::move(m_Entries.front()));
+                m_Entries.pop_front();
+            }
+        }
+        run(ready);
+    }
+
+    void DeletionQueue::flush() {
+        for (QueueTimeline *timeline : m_Timelines) {
+            timeline->waitIdle();
+        }
+
+        // releases may defer more
+        while (true) {
+            std::vector<Entry> ready;
+            {
+                std::lock_guard lock(m_Mutex);
+                if (m_Entries.empty()) return;
+                ready.assign(std::make_move_iterator(m_Entries.begin()), std::make_move_iterator(m_Entries.end()));
+                m_Entries.clear();
+            }
+            run(ready);
+        }
+    }
+
+    size_t DeletionQueue::pending() const {
+        std::lock_guard lock(m_Mutex);
+        return m_Entries.size();
+    }
+
+    void DeletionQueue::run(_In_ std::vector<Entry> &ready) {
+        for (Entry &entry : ready) {
+            try {
+                entry.release();
+            } catch (const std::exception &e) {
+                spdlog::error("Uncaught exception in deferred release: {}", e.what());
+            }
+        }
+    }
+
+    QueueTimeline &graphicsTimeline() {
+        return *globalState->graphicsTimeline;
+    }
+
+    QueueTimeline &computeTimeline() {
+        return globalState->computeTimeline ? *globalState->computeTimeline : *globalState->graphicsTimeline;
+    }
+
+    DeletionQueue &deletionQueue() {
+        return *globalState->deletionQueue;
+    }
+}// namespace kat
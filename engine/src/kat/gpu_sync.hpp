@@ -0,0 +1,112 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace kat {
+
+    struct SemaphoreWait {
+        vk::Semaphore semaphore;
+        uint64_t value = 0; // ignored for binary semaphores
+        vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eAllCommands;
+    };
+
+    // A queue and the timeline semaphore counting its submissions. Every submit signals the next value and
+    // returns it, so "is this work done" is one integer compare instead of a fence per submission. To resume a
+    // coroutine at a point, co_await kat::waitForSemaphore(device, timeline.semaphore(), point).
+    class QueueTimeline {
+      public:
+        KAT_TRACKED_CLASS(MemoryTag::CORE);
+
+        QueueTimeline(_In_ vk::Queue queue, _In_ uint32_t family);
+        ~QueueTimeline();
+
+        QueueTimeline(const QueueTimeline &) = delete;
+        QueueTimeline &operator=(const QueueTimeline &) = delete;
+
+        // thread safe. binary semaphores in waits and signals are fine (e.g. for presentation); the timeline
+        // signal is appended.
+        uint64_t submit(_In_ std::span<const vk::CommandBuffer> cmds, _In_ std::span<const SemaphoreWait> waits = {},
+                        _In_ std::span<const vk::Semaphore> signals = {});
+
+        // thread safe
+        [[nodiscard]] bool reached(_In_ uint64_t point);
+        [[nodiscard]] uint64_t completed();
+        [[nodiscard]] uint64_t lastSubmitted() const noexcept;
+
+        // returns false on timeout
+        bool wait(_In_ uint64_t point, _In_ uint64_t timeout = UINT64_MAX);
+        void waitIdle();
+
+        [[nodiscard]] vk::Queue queue() const noexcept;
+        [[nodiscard]] uint32_t family() const noexcept;
+        [[nodiscard]] vk::Semaphore semaphore() const noexcept;
+
+      private:
+        vk::Queue m_Queue;
+        uint32_t m_Family;
+        vk::Semaphore m_Semaphore;
+
+        std::mutex m_SubmitMutex; // queues are externally synchronized
+        std::atomic<uint64_t> m_Submitted = 0;
+        std::atomic<uint64_t> m_Completed = 0; // cached, so polling doesn't always go to the driver
+    };
+
+    // Releases things once the gpu is done with them. defer() records what every timeline has submitted so far
+    // and the function runs from collect() once all of them passed it, so a resource can be handed over right
+    // after its last use was submitted, without waiting for the device.
+    //
+    // Work recorded but not submitted yet is not covered: submit it first, or defer after it was.
+    class DeletionQueue {
+      public:
+        KAT_TRACKED_CLASS(MemoryTag::CORE);
+
+        explicit DeletionQueue(_In_ std::vector<QueueTimeline *> timelines);
+        // runs everything left, the caller has to have waited for the timelines
+        ~DeletionQueue();
+
+        DeletionQueue(const DeletionQueue &) = delete;
+        DeletionQueue &operator=(const DeletionQueue &) = delete;
+
+        // thread safe
+        void defer(_In_ std::function<void()> release);
+
+        // anything vk::Device::destroy accepts
+        template<typename Handle>
+        void destroy(_In_ Handle handle) {
+            if (handle) defer([handle] { globalState->device.destroy(handle); });
+        }
+
+        // thread safe, releases run on the calling thread. pollMessages calls this once per frame.
+        void collect();
+
+        // waits for every timeline to go idle and runs everything
+        void flush();
+
+        [[nodiscard]] size_t pending() const;
+
+      private:
+        struct Entry {
+            std::vector<uint64_t> points; // one per timeline
+            std::function<void()> release;
+        };
+
+        std::vector<QueueTimeline *> m_Timelines;
+        mutable std::mutex m_Mutex;
+        std::deque<Entry> m_Entries; // points only grow, so the front is always the first to be ready
+
+        void run(_In_ std::vector<Entry> &ready);
+    };
+
+    [[nodiscard]] QueueTimeline &graphicsTimeline();
+    // the async compute queue, or the graphics timeline on devices without a second queue. work on it overlaps
+    // graphics only when the two differ; order them with SemaphoreWait on each other's semaphore.
+    [[nodiscard]] QueueTimeline &computeTimeline();
+    [[nodiscard]] DeletionQueue &deletionQueue();
+}// namespace kat
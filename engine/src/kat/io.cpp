@@ -0,0 +1,372 @@
+#include "io.hpp"
+#include "kat/jobs.hpp"
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace kat {
+
+    IoScheduler::IoScheduler(_In_ const IoSchedulerSettings &settings) : m_Settings(settings) {
+        m_Port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+        if (m_Port == nullptr) {
+            throw std::runtime_error("Failed to create io completion port");
+        }
+
+        m_Thread = std::thread(&IoScheduler::threadMain, this);
+    }
+
+    IoScheduler::~IoScheduler() {
+        // every request still completes exactly once: queued ones and in-flight ones as cancelled, finished ones
+        // waiting for processCompletions as they are. FRAME_QUEUE ones keep going to m_Completed, also the ones
+        // the io thread finishes, and run on this thread once everything has drained.
+        std::vector<Completion> immediate;
+        {
+            std::unique_lock lock(m_Mutex);
+            m_ShuttingDown = true;
+
+            while (!m_Queue.empty()) {
+                IoRequestId id = m_Queue.begin()->id;
+                Request request = std::move(m_Pending.at(id));
+                removePending(id);
+                complete(request, IoResult{.id = id, .status = IoStatus::CANCELLED, .error = ERROR_OPERATION_ABORTED, .offset = request.offset}, immediate);
+            }
+
+            for (const auto &batch : m_InFlight) {
+                for (auto &member : batch->members) member.cancelled = true;
+                CancelIoEx(batch->file->handle, &batch->overlapped);
+            }
+
+            m_Drained.wait(lock, [this] { return m_InFlight.empty(); });
+            immediate.insert(immediate.begin(), std::make_move_iterator(m_Completed.begin()), std::make_move_iterator(m_Completed.end()));
+            m_Completed.clear();
+        }
+
+        PostQueuedCompletionStatus(m_Port, 0, 0, nullptr);
+        m_Thread.join();
+
+        for (auto &[callback, result] : immediate) {
+            if (callback) callback(result);
+        }
+
+        CloseHandle(m_Port);
+    }
+
+    IoRequestId IoScheduler::submit(_In_ IoReadRequest &&request) {
+        std::vector<Completion> immediate;
+        IoRequestId id;
+
+        {
+            std::lock_guard lock(m_Mutex);
+            File *file = openFile(request.path);
+
+            // files are assumed not to change size while requests on them are outstanding
+            uint64_t available = request.offset < file->size ? file->size - request.offset : 0;
+            uint64_t size = request.size == 0 ? available : std::min<uint64_t>(request.size, available);
+            if (size > std::numeric_limits<uint32_t>::max()) {
+                releaseFile(file);
+                throw std::runtime_error("Read request is too large");
+            }
+
+            id = m_NextId++;
+            Request r{
+                    .id = id,
+                    .file = file,
+                    .offset = request.offset,
+                    .size = static_cast<uint32_t>(size),
+                    .priority = request.priority,
+                    .sequence = m_NextSequence++,
+                    .completionMode = request.completionMode,
+                    .onComplete = std::move(request.onComplete),
+            };
+
+            if (r.size == 0) {
+                complete(r, IoResult{.id = id, .offset = r.offset}, immediate);
+            } else {
+                m_Queue.insert(QueueKey{r.priority, r.sequence, id});
+                m_PendingByOffset.emplace(FileOffsetKey{file, r.offset}, id);
+                m_Pending.emplace(id, std::move(r));
+                dispatch(immediate);
+            }
+        }
+
+        for (auto &[callback, result] : immediate) {
+            if (callback) callback(result);
+        }
+        return id;
+    }
+
+    bool IoScheduler::cancel(_In_ IoRequestId id) {
+        std::vector<Completion> immediate;
+        bool found = false;
+
+        {
+            std::lock_guard lock(m_Mutex);
+
+            if (auto it = m_Pending.find(id); it != m_Pending.end()) {
+                Request request = std::move(it->second);
+                removePending(id);
+                complete(request, IoResult{.id = id, .status = IoStatus::CANCELLED, .error = ERROR_OPERATION_ABORTED, .offset = request.offset}, immediate);
+                found = true;
+            } else if (auto it = m_InFlightRequests.find(id); it != m_InFlightRequests.end()) {
+                Batch *batch = it->second;
+                bool allCancelled = true;
+                for (auto &member : batch->members) {
+                    if (member.id == id) member.cancelled = true;
+                    allCancelled = allCancelled && member.cancelled;
+                }
+
+                // other requests may still want the data from a coalesced read
+                if (allCancelled) {
+                    CancelIoEx(batch->file->handle, &batch->overlapped);
+                }
+                found = true;
+            }
+        }
+
+        for (auto &[callback, result] : immediate) {
+            if (callback) callback(result);
+        }
+        return found;
+    }
+
+    void IoScheduler::processCompletions() {
+        std::vector<Completion> completed;
+        {
+            std::lock_guard lock(m_Mutex);
+            completed.swap(m_Completed);
+        }
+
+        for (auto &[callback, result] : completed) {
+            if (callback) callback(result);
+        }
+    }
+
+    size_t IoScheduler::pendingCount() const {
+        std::lock_guard lock(m_Mutex);
+        return m_Pending.size() + m_InFlightRequests.size();
+    }
+
+    uint64_t IoScheduler::inFlightBytes() const {
+        std::lock_guard lock(m_Mutex);
+        return m_InFlightBytes;
+    }
+
+    IoScheduler::File *IoScheduler::openFile(_In_ const std::wstring &path) {
+        if (auto it = m_Files.find(path); it != m_Files.end()) {
+            it->second->users++;
+            return it->second.get();
+        }
+
+        HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+        if (handle == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Failed to open file for reading");
+        }
+
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(handle, &size) || CreateIoCompletionPort(handle, m_Port, 0, 0) == nullptr) {
+            CloseHandle(handle);
+            throw std::runtime_error("Failed to prepare file for overlapped reads");
+        }
+
+        auto file = std::make_unique<File>(File{.path = path, .handle = handle, .size = static_cast<uint64_t>(size.QuadPart), .users = 1});
+        File *ptr = file.get();
+        m_Files.emplace(path, std::move(file));
+        return ptr;
+    }
+
+    void IoScheduler::releaseFile(_In_ File *file) {
+        if (--file->users > 0) return;
+
+        CloseHandle(file->handle);
+        m_Files.erase(file->path); // destroys file
+    }
+
+    void IoScheduler::removePending(_In_ IoRequestId id) {
+        auto it = m_Pending.find(id);
+        if (it == m_Pending.end()) return;
+
+        const Request &request = it->second;
+        m_Queue.erase(QueueKey{request.priority, request.sequence, id});
+
+        auto [begin, end] = m_PendingByOffset.equal_range(FileOffsetKey{request.file, request.offset});
+        for (auto o = begin; o != end; ++o) {
+            if (o->second == id) {
+                m_PendingByOffset.erase(o);
+                break;
+            }
+        }
+
+        m_Pending.erase(it);
+    }
+
+    void IoScheduler::dispatch(_Inout_ std::vector<Completion> &immediate) {
+        while (!m_Queue.empty() && m_InFlight.size() < m_Settings.maxInFlightReads) {
+            IoRequestId headId = m_Queue.begin()->id;
+            const Request &head = m_Pending.at(headId);
+
+            File *file = head.file;
+            uint64_t begin = head.offset;
+            uint64_t end = head.offset + head.size;
+            std::vector<IoRequestId> ids{headId};
+
+            // grow the read forwards then backwards over neighbouring requests on the same file
+            auto first = m_PendingByOffset.lower_bound(FileOffsetKey{file, head.offset});
+            auto last = m_PendingByOffset.upper_bound(FileOffsetKey{file, std::numeric_limits<uint64_t>::max()});
+            for (auto it = first; it != last; ++it) {
+                if (it->second == headId) continue;
+
+                const Request &r = m_Pending.at(it->second);
+                if (r.offset > end + m_Settings.coalesceGap) break;
+
+                uint64_t newEnd = std::max(end, r.offset + r.size);
+                if (newEnd - begin > m_Settings.maxCoalescedSize) break;
+
+                end = newEnd;
+                ids.push_back(r.id);
+            }
+
+            for (auto it = first; it != m_PendingByOffset.begin();) {
+                --it;
+                if (it->first.first != file) break;
+
+                const Request &r = m_Pending.at(it->second);
+                if (r.offset + r.size + m_Settings.coalesceGap < begin) break;
+
+                uint64_t newEnd = std::max(end, r.offset + r.size);
+                if (newEnd - r.offset > m_Settings.maxCoalescedSize) break;
+
+                begin = r.offset;
+                end = newEnd;
+                ids.push_back(r.id);
+            }
+
+            // always allow one read through, even a huge one, so nothing can starve
+            uint64_t size = end - begin;
+            if (!m_InFlight.empty() && m_InFlightBytes + size > m_Settings.maxInFlightBytes) {
+                break;
+            }
+
+            auto batch = std::make_unique<Batch>();
+            batch->file = file;
+            batch->offset = begin;
+            batch->buffer.resize(size);
+            batch->members.reserve(ids.size());
+            batch->overlapped.Offset = static_cast<DWORD>(begin & 0xFFFFFFFFull);
+            batch->overlapped.OffsetHigh = static_cast<DWORD>(begin >> 32);
+
+            for (IoRequestId id : ids) {
+                batch->members.push_back(std::move(m_Pending.at(id)));
+                removePending(id);
+                m_InFlightRequests[id] = batch.get();
+            }
+
+            Batch *ptr = batch.get();
+            m_InFlight.push_back(std::move(batch));
+            m_InFlightBytes += size;
+
+            if (!ReadFile(file->handle, ptr->buffer.data(), static_cast<DWORD>(size), nullptr, &ptr->overlapped)) {
+                DWORD error = GetLastError();
+                if (error != ERROR_IO_PENDING) {
+                    spdlog::error("ReadFile failed ({})", error);
+                    finishBatch(ptr, 0, error, immediate);
+                }
+            }
+        }
+    }
+
+    void IoScheduler::complete(_Inout_ Request &request, _Inout_ IoResult &&result, _Inout_ std::vector<Completion> &immediate) {
+        releaseFile(request.file);
+        request.file = nullptr;
+
+        switch (request.completionMode) {
+            case IoCompletionMode::FRAME_QUEUE:
+                m_Completed.emplace_back(std::move(request.onComplete), std::move(result));
+                break;
+            case IoCompletionMode::IO_THREAD:
+                immediate.emplace_back(std::move(request.onComplete), std::move(result));
+                break;
+            case IoCompletionMode::JOB_SYSTEM:
+                immediate.emplace_back([onComplete = std::move(request.onComplete)](IoResult &r) {
+                    if (!onComplete) return;
+                    jobSystem().submit([onComplete, r = std::move(r)]() mutable { onComplete(r); });
+                }, std::move(result));
+                break;
+        }
+    }
+
+    void IoScheduler::finishBatch(_In_ Batch *batch, _In_ DWORD bytes, _In_ DWORD error, _Inout_ std::vector<Completion> &immediate) {
+        auto it = std::find_if(m_InFlight.begin(), m_InFlight.end(), [batch](const auto &b) { return b.get() == batch; });
+        std::unique_ptr<Batch> owned = std::move(*it);
+        m_InFlight.erase(it);
+        m_InFlightBytes -= owned->buffer.size();
+
+        bool failed = error != ERROR_SUCCESS && error != ERROR_HANDLE_EOF;
+
+        for (auto &member : owned->members) {
+            m_InFlightRequests.erase(member.id);
+
+            IoResult result{.id = member.id, .offset = member.offset};
+            if (member.cancelled) {
+                result.status = IoStatus::CANCELLED;
+                result.error = ERROR_OPERATION_ABORTED;
+            } else if (failed) {
+                result.status = IoStatus::FAILED;
+                result.error = error;
+            } else {
+                uint64_t relative = member.offset - owned->offset;
+                uint64_t available = bytes > relative ? bytes - relative : 0;
+                uint64_t size = std::min<uint64_t>(member.size, available);
+
+                if (owned->members.size() == 1 && relative == 0 && size == owned->buffer.size()) {
+                    result.data = std::move(owned->buffer);
+                } else {
+                    auto src = owned->buffer.begin() + static_cast<ptrdiff_t>(relative);
+                    result.data.assign(src, src + static_cast<ptrdiff_t>(size));
+                }
+            }
+
+            complete(member, std::move(result), immediate);
+        }
+
+        if (m_InFlight.empty()) {
+            m_Drained.notify_all();
+        }
+    }
+
+    void IoScheduler::threadMain() {
+        while (true) {
+            DWORD bytes = 0;
+            ULONG_PTR key = 0;
+            OVERLAPPED *overlapped = nullptr;
+
+            BOOL ok = GetQueuedCompletionStatus(m_Port, &bytes, &key, &overlapped, INFINITE);
+            if (overlapped == nullptr) {
+                break; // shutdown packet (or the port itself went away)
+            }
+            DWORD error = ok ? ERROR_SUCCESS : GetLastError();
+
+            std::vector<Completion> immediate;
+            {
+                std::lock_guard lock(m_Mutex);
+                auto it = std::find_if(m_InFlight.begin(), m_InFlight.end(), [overlapped](const auto &b) { return &b->overlapped == overlapped; });
+                if (it != m_InFlight.end()) {
+                    finishBatch(it->get(), bytes, error, immediate);
+                }
+
+                if (!m_ShuttingDown) {
+                    dispatch(immediate);
+                }
+            }
+
+            for (auto &[callback, result] : immediate) {
+                if (callback) callback(result);
+            }
+        }
+    }
+
+    IoScheduler &ioScheduler() {
+        return *globalState->ioScheduler;
+    }
+}// namespace kat
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace kat {
+
+    enum class IoPriority : uint8_t {
+        CRITICAL = 0,
+        HIGH,
+        NORMAL,
+        LOW,
+        BACKGROUND,
+    };
+
+    enum class IoStatus {
+        SUCCESS,
+        CANCELLED,
+        FAILED,
+    };
+
+    enum class IoCompletionMode {
+        FRAME_QUEUE, // callback runs on the main thread during kat::pollMessages
+        IO_THREAD,   // callback runs on the io thread as soon as the read finishes (keep it short)
+        JOB_SYSTEM,  // callback is submitted to the job system as soon as the read finishes
+    };
+
+    using IoRequestId = uint64_t;
+    inline constexpr IoRequestId INVALID_IO_REQUEST = 0;
+
+    struct IoResult {
+        IoRequestId id = INVALID_IO_REQUEST;
+        IoStatus status = IoStatus::SUCCESS;
+        DWORD error = ERROR_SUCCESS;
+        uint64_t offset = 0;
+        std::vector<std::byte> data; // may be shorter than requested if the read hit the end of the file
+    };
+
+    using FNIOCOMPLETE = void(IoResult &result);
+
+    struct IoReadRequest {
+        std::wstring path;
+        uint64_t offset = 0;
+        uint32_t size = 0; // 0 reads from offset to the end of the file
+
+        IoPriority priority = IoPriority::NORMAL;
+        IoCompletionMode completionMode = IoCompletionMode::FRAME_QUEUE;
+        std::function<FNIOCOMPLETE> onComplete;
+    };
+
+    struct IoSchedulerSettings {
+        uint64_t maxInFlightBytes = 64ull * 1024 * 1024;
+        uint32_t maxInFlightReads = 32;
+
+        // reads on the same file closer than this are merged into a single ReadFile
+        uint32_t coalesceGap = 64 * 1024;
+        uint32_t maxCoalescedSize = 4 * 1024 * 1024;
+    };
+
+    // Overlapped file reads completed through an io completion port. Requests are dispatched in priority
+    // order (FIFO within a priority), neighbouring requests on the same file are coalesced, and the total
+    // size of reads handed to the os is bounded by maxInFlightBytes.
+    class IoScheduler {
+      public:
+        KAT_TRACKED_CLASS(MemoryTag::CORE);
+
+        explicit IoScheduler(_In_ const IoSchedulerSettings &settings = {});
+        // cancels everything queued or in flight. every callback still runs once, FRAME_QUEUE ones that didn't
+        // get to processCompletions on the destroying thread.
+        ~IoScheduler();
+
+        IoScheduler(const IoScheduler &) = delete;
+        IoScheduler &operator=(const IoScheduler &) = delete;
+
+        // thread safe. throws if the file can't be opened. files are only held open (shared for reading and
+        // deleting, so they can be replaced by a rename) while requests on them are queued or in flight.
+        IoRequestId submit(_In_ IoReadRequest &&request);
+
+        // thread safe. the request still completes (with IoStatus::CANCELLED) through its usual path.
+        // returns false if the request already completed or doesn't exist.
+        bool cancel(_In_ IoRequestId id);
+
+        // runs all FRAME_QUEUE callbacks that finished since the last call. main thread only.
+        void processCompletions();
+
+        [[nodiscard]] size_t pendingCount() const;
+        [[nodiscard]] uint64_t inFlightBytes() const;
+
+      private:
+        // open while any queued or in-flight request reads it, closed with the last one
+        struct File {
+            std::wstring path;
+            HANDLE handle;
+            uint64_t size;
+            uint32_t users = 0;
+        };
+
+        struct Request {
+            IoRequestId id;
+            File *file;
+            uint64_t offset;
+            uint32_t size;
+            IoPriority priority;
+            uint64_t sequence;
+            IoCompletionMode completionMode;
+            std::function<FNIOCOMPLETE> onComplete;
+            bool cancelled = false;
+        };
+
+        struct Batch {
+            OVERLAPPED overlapped{};
+            File *file;
+            uint64_t offset;
+            std::vector<std::byte> buffer;
+            std::vector<Request> members;
+        };
+
+        struct QueueKey {
+            IoPriority priority;
+            uint64_t sequence;
+            IoRequestId id;
+
+            auto operator<=>(const QueueKey &) const = default;
+        };
+
+        using FileOffsetKey = std::pair<File *, uint64_t>;
+        using Completion = std::pair<std::function<FNIOCOMPLETE>, IoResult>;
+
+        IoSchedulerSettings m_Settings;
+        HANDLE m_Port;
+        std::thread m_Thread;
+
+        mutable std::mutex m_Mutex;
+        std::condition_variable m_Drained;
+        bool m_ShuttingDown = false;
+
+        IoRequestId m_NextId = 1;
+        uint64_t m_NextSequence = 0;
+
+        std::unordered_map<std::wstring, std::unique_ptr<File>> m_Files;
+        std::unordered_map<IoRequestId, Request> m_Pending;
+        std::set<QueueKey> m_Queue;
+        std::multimap<FileOffsetKey, IoRequestId> m_PendingByOffset;
+
+        std::unordered_map<IoRequestId, Batch *> m_InFlightRequests;
+        std::vector<std::unique_ptr<Batch>> m_InFlight;
+        uint64_t m_InFlightBytes = 0;
+
+        std::vector<Completion> m_Completed;
+
+        // everything below must be called with m_Mutex held. callbacks that have to run right away (IO_THREAD
+        // and JOB_SYSTEM completions) are appended to immediate and run by the caller once the lock is released.
+        File *openFile(_In_ const std::wstring &path);
+        void releaseFile(_In_ File *file);
+        void removePending(_In_ IoRequestId id);
+        void dispatch(_Inout_ std::vector<Completion> &immediate);
+        void complete(_Inout_ Request &request, _Inout_ IoResult &&result, _Inout_ std::vector<Completion> &immediate);
+        void finishBatch(_In_ Batch *batch, _In_ DWORD bytes, _In_ DWORD error, _Inout_ std::vector<Completion> &immediate);
+
+        void threadMain();
+    };
+
+    [[nodiscard]] IoScheduler &ioScheduler();
+}// namespace kat
@@ -0,0 +1,164 @@
+#include "jobs.hpp"
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace kat {
+
+    static thread_local uint32_t t_WorkerIndex = std::numeric_limits<uint32_t>::max();
+
+    namespace {
+        // a submitted job has nobody to throw to, whatever it throws is logged and dropped
+        void runJob(_In_ const std::function<FNJOB> &job) {
+            try {
+                job();
+            } catch (const std::exception &e) {
+                spdlog::error("Uncaught exception in job: {}", e.what());
+            } catch (...) {
+                spdlog::error("Uncaught exception in job");
+            }
+        }
+    }// namespace
+
+    JobSystem::JobSystem(_In_ uint32_t workerCount) {
+        if (workerCount == 0) {
+            workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        }
+
+        m_Workers.reserve(workerCount);
+        for (uint32_t i = 0; i < workerCount; i++) {
+            m_Workers.emplace_back(&JobSystem::workerMain, this, i);
+        }
+
+        spdlog::debug("Started job system with {} workers", workerCount);
+    }
+
+    JobSystem::~JobSystem() {
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Stopping = true;
+        }
+        m_Available.notify_all();
+
+        for (auto &worker : m_Workers) {
+            worker.join();
+        }
+    }
+
+    void JobSystem::submit(_In_ std::function<FNJOB> job) {
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Jobs.push_back(std::move(job));
+        }
+        m_Available.notify_one();
+    }
+
+    void JobSystem::parallelFor(_In_ size_t count, _In_ size_t grain, _In_ const std::function<FNJOBRANGE> &fn) {
+        if (count == 0) return;
+
+        grain = std::max<size_t>(grain, 1);
+        size_t chunks = (count + grain - 1) / grain;
+        if (chunks == 1) {
+            fn(0, count);
+            return;
+        }
+
+        // the first chunk to throw stops the others from starting, its exception is rethrown once all left
+        std::atomic<size_t> nextChunk = 0;
+        std::atomic<bool> failed = false;
+        std::exception_ptr exception;
+        auto work = [&] {
+            try {
+                for (size_t chunk = nextChunk.fetch_add(1); chunk < chunks; chunk = nextChunk.fetch_add(1)) {
+                    size_t begin = chunk * grain;
+                    fn(begin, std::min(count, begin + grain));
+                }
+            } catch (...) {
+                if (!failed.exchange(true)) exception = std::current_exception();
+                nextChunk = chunks;
+            }
+        };
+
+        // helpers reference this stack frame, so we have to wait for all of them to leave, not just for the
+        // chunks to run out
+        size_t helpers = std::min<size_t>(chunks - 1, m_Workers.size());
+        std::atomic<size_t> running = helpers;
+        for (size_t i = 0; i < helpers; i++) {
+            submit([&] {
+                struct Leave {
+                    std::atomic<size_t> &running;
+                    ~Leave() { running.fetch_sub(1, std::memory_order_release); }
+                } leave{running};
+                work();
+            });
+        }
+
+        work();
+
+        // helpers leave with a release, so their exception is visible once running reads 0
+        while (running.load(std::memory_order_acquire) != 0) {
+            if (!tryRunOne()) std::this_thread::yield();
+        }
+
+        if (exception) std::rethrow_exception(exception);
+    }
+
+    uint32_t JobSystem::workerCount() const noexcept {
+        return static_cast<uint32_t>(m_Workers.size());
+    }
+
+    uint32_t JobSystem::threadSlotCount() const noexcept {
+        return workerCount() + MAX_OTHER_THREADS;
+    }
+
+    uint32_t JobSystem::currentWorkerIndex() {
+        if (t_WorkerIndex == std::numeric_limits<uint32_t>::max()) {
+            JobSystem &jobs = *globalState->jobSystem;
+            uint32_t other = jobs.m_OtherThreads.fetch_add(1, std::memory_order_relaxed);
+            if (other >= MAX_OTHER_THREADS) {
+                jobs.m_OtherThreads.fetch_sub(1, std::memory_order_relaxed);
+                throw std::runtime_error("More threads use per-thread data than the job system has slots for");
+            }
+            t_WorkerIndex = jobs.workerCount() + other;
+        }
+        return t_WorkerIndex;
+    }
+
+    bool JobSystem::tryRunOne() {
+        std::function<FNJOB> job;
+        {
+            std::lock_guard lock(m_Mutex);
+            if (m_Jobs.empty()) return false;
+
+            job = std::move(m_Jobs.front());
+            m_Jobs.pop_front();
+        }
+
+        runJob(job);
+        return true;
+    }
+
+    void JobSystem::workerMain(_In_ uint32_t index) {
+        t_WorkerIndex = index;
+
+        while (true) {
+            std::function<FNJOB> job;
+            {
+                std::unique_lock lock(m_Mutex);
+                m_Available.wait(lock, [this] { return m_Stopping || !m_Jobs.empty(); });
+                if (m_Jobs.empty()) return; // stopping, and nothing left to drain
+
+                job = std::move(m_Jobs.front());
+                m_Jobs.pop_front();
+            }
+
+            runJob(job);
+        }
+    }
+
+    JobSystem &jobSystem() {
+        return *globalState->jobSystem;
+    }
+}// namespace kat
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kat {
+
+    using FNJOB = void();
+    using FNJOBRANGE = void(size_t begin, size_t end);
+
+    // Fixed pool of worker threads pulling from a single shared queue.
+    class JobSystem {
+      public:
+        KAT_TRACKED_CLASS(MemoryTag::CORE);
+
+        // 0 workers means one per hardware thread, minus the main thread
+        explicit JobSystem(_In_ uint32_t workerCount = 0);
+        ~JobSystem();
+
+        JobSystem(const JobSystem &) = delete;
+        JobSystem &operator=(const JobSystem &) = delete;
+
+        void submit(_In_ std::function<FNJOB> job);
+
+        // runs fn over [0, count) in chunks of grain items (the last one may be shorter). the calling thread
+        // takes part and doesn't return until every chunk is done, so it's fine to call this from inside a job.
+        // if fn throws, chunks not started yet are skipped and the first exception is rethrown here.
+        void parallelFor(_In_ size_t count, _In_ size_t grain, _In_ const std::function<FNJOBRANGE> &fn);
+
+        [[nodiscard]] uint32_t workerCount() const noexcept;
+
+        // threads other than the workers (the main thread, FramePipeline's render thread) that can have an index
+        static constexpr uint32_t MAX_OTHER_THREADS = 4;
+
+        // workerCount() + MAX_OTHER_THREADS, the size of per-thread data indexed by currentWorkerIndex()
+        [[nodiscard]] uint32_t threadSlotCount() const noexcept;
+
+        // 0..workerCount()-1 on worker threads. every other thread gets the next index after those the first time
+        // it asks and keeps it, so two threads never share one, even while a waiting parallelFor caller runs
+        // another thread's jobs. throws std::runtime_error once MAX_OTHER_THREADS threads have one.
+        [[nodiscard]] static uint32_t currentWorkerIndex();
+
+      private:
+        std::vector<std::thread> m_Workers;
+
+        std::mutex m_Mutex;
+        std::condition_variable m_Available;
+        std::deque<std::function<FNJOB>> m_Jobs;
+        bool m_Stopping = false;
+
+        std::atomic<uint32_t> m_OtherThreads = 0;
+
+        bool tryRunOne();
+        void workerMain(_In_ uint32_t index);
+    };
+
+    [[nodiscard]] JobSystem &jobSystem();
+}// namespace kat
@@ -0,0 +1,205 @@
+#include "layout_cache.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <numeric>
+#include <stdexcept>
+
+namespace kat {
+
+    namespace {
+        template<typename Handle>
+        uint64_t handleBits(Handle handle) {
+            return reinterpret_cast<uint64_t>(static_cast<typename Handle::CType>(handle));
+        }
+
+        template<typename Flags>
+        uint64_t flagBits(Flags flags) {
+            return static_cast<uint64_t>(static_cast<typename Flags::MaskType>(flags));
+        }
+
+        uint64_t floatBits(float f) {
+            return std::bit_cast<uint32_t>(f);
+        }
+    }// namespace
+
+    size_t LayoutCache::KeyHash::operator()(const Key &key) const noexcept {
+        // fnv-1a over the words
+        uint64_t hash = 14695981039346656037ull;
+        for (uint64_t word : key) {
+            hash ^= word;
+            hash *= 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+
+    LayoutCache::~LayoutCache() {
+        vk::Device device = globalState->device;
+        for (auto &[key, layout] : m_PipelineLayouts) device.destroyPipelineLayout(layout);
+        for (auto &[key, layout] : m_SetLayouts) device.destroyDescriptorSetLayout(layout);
+        for (auto &[key, sampler] : m_Samplers) device.destroySampler(sampler);
+    }
+
+    vk::DescriptorSetLayout LayoutCache::descriptorSetLayout(_In_ std::span<const vk::DescriptorSetLayoutBinding> bindings,
+                                                             _In_ vk::DescriptorSetLayoutCreateFlags flags,
+                                                             _In_ std::span<const vk::DescriptorBindingFlags> bindingFlags) {
+        if (!bindingFlags.empty() && bindingFlags.size() != bindings.size()) {
+            throw std::runtime_error("Binding flags don't match the bindings");
+        }
+
+        // sort so the same set in a different order hashes the same
+        std::vector<uint32_t> order(bindings.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return bindings[a].binding < bindings[b].binding;
+        });
+
+        std::vector<vk::DescriptorSetLayoutBinding> sortedBindings;
+        std::vector<vk::DescriptorBindingFlags> sortedFlags;
+        Key key{flagBits(flags), bindings.size()};
+        for (uint32_t i : order) {
+            const vk::DescriptorSetLayoutBinding &b = bindings[i];
+            sortedBindings.push_back(b);
+            key.insert(key.end(), {b.binding, static_cast<uint64_t>(b.descriptorType), b.descriptorCount, flagBits(b.stageFlags)});
+            key.push_back(bindingFlags.empty() ? 0 : flagBits(bindingFlags[i]));
+            if (!bindingFlags.empty()) sortedFlags.push_back(bindingFlags[i]);
+
+            key.push_back(b.pImmutableSamplers ? b.descriptorCount : 0);
+            if (b.pImmutableSamplers) {
+                for (uint32_t s = 0; s < b.descriptorCount; s++) {
+                    key.push_back(handleBits(b.pImmutableSamplers[s]));
+                }
+            }
+        }
+
+        std::lock_guard lock(m_Mutex);
+        auto it = m_SetLayouts.find(key);
+        if (it != m_SetLayouts.end()) {
+            return it->second;
+        }
+
+        vk::DescriptorSetLayoutCreateInfo info{flags, sortedBindings};
+        vk::DescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{sortedFlags};
+        if (!sortedFlags.empty()) {
+            info.pNext = &flagsInfo;
+        }
+
+        vk::DescriptorSetLayout layout = globalState->device.createDescriptorSetLayout(info);
+        m_SetLayouts.emplace(std::move(key), layout);
+        return layout;
+    }
+
+    vk::PipelineLayout LayoutCache::pipelineLayout(_In_ std::span<const vk::DescriptorSetLayout> setLayouts,
+                                                   _In_ std::span<const vk::PushConstantRange> pushConstants) {
+        Key key{setLayouts.size()};
+        for (vk::DescriptorSetLayout layout : setLayouts) {
+            key.push_back(handleBits(layout));
+        }
+        for (const vk::PushConstantRange &range : pushConstants) {
+            key.insert(key.end(), {flagBits(range.stageFlags), range.offset, range.size});
+        }
+
+        std::lock_guard lock(m_Mutex);
+        auto it = m_PipelineLayouts.find(key);
+        if (it != m_PipelineLayouts.end()) {
+            return it->second;
+        }
+
+        vk::PipelineLayout layout = globalState->device.createPipelineLayout(vk::PipelineLayoutCreateInfo{{}, setLayouts, pushConstants});
+        m_PipelineLayouts.emplace(std::move(key), layout);
+        return layout;
+    }
+
+    std::vector<vk::DescriptorSetLayout> LayoutCache::setLayouts(_In_ std::span<const ShaderReflection> stages,
+                                                                 _In_ std::span<const SetOverride> overrides) {
+        std::vector<ShaderReflection::Binding> bindings = ShaderReflection::merge(stages);
+
+        uint32_t setCount = bindings.empty() ? 0 : bindings.back().set + 1;
+        for (const SetOverride &o : overrides) {
+            setCount = std::max(setCount, o.set + 1);
+        }
+
+        std::vector<vk::DescriptorSetLayout> layouts(setCount);
+        for (const SetOverride &o : overrides) {
+            layouts[o.set] = o.layout;
+        }
+
+        // bindings are sorted by set, so each set is one run
+        auto begin = bindings.begin();
+        for (uint32_t set = 0; set < setCount; set++) {
+            auto end = std::find_if(begin, bindings.end(), [&](const ShaderReflection::Binding &b) { return b.set != set; });
+            if (!layouts[set]) {
+                std::vector<vk::DescriptorSetLayoutBinding> layoutBindings;
+                for (auto b = begin; b != end; ++b) {
+                    if (b->count == 0) {
+                        throw std::runtime_error("Set " + std::to_string(set) + " has a runtime sized array, it needs an override");
+                    }
+                    layoutBindings.push_back(vk::DescriptorSetLayoutBinding{b->binding, b->type, b->count, b->stages});
+                }
+                layouts[set] = descriptorSetLayout(layoutBindings);
+            }
+            begin = end;
+        }
+        return layouts;
+    }
+
+    vk::PipelineLayout LayoutCache::pipelineLayout(_In_ std::span<const ShaderReflection> stages,
+                                                   _In_ std::span<const SetOverride> overrides) {
+        std::vector<vk::DescriptorSetLayout> layouts = setLayouts(stages, overrides);
+
+        vk::ShaderStageFlags pushStages;
+        uint32_t pushBegin = UINT32_MAX;
+        uint32_t pushEnd = 0;
+        for (const ShaderReflection &stage : stages) {
+            if (stage.pushConstantSize == 0) continue;
+            pushStages |= stage.stage;
+            pushBegin = std::min(pushBegin, stage.pushConstantOffset);
+            pushEnd = std::max(pushEnd, stage.pushConstantOffset + stage.pushConstantSize);
+        }
+
+        if (!pushStages) {
+            return pipelineLayout(layouts);
+        }
+        vk::PushConstantRange range{pushStages, pushBegin, pushEnd - pushBegin};
+        return pipelineLayout(layouts, {&range, 1});
+    }
+
+    vk::Sampler LayoutCache::sampler(_In_ const vk::SamplerCreateInfo &info) {
+        if (info.pNext) {
+            throw std::runtime_error("Cached samplers can't have chained create infos");
+        }
+
+        Key key{
+                flagBits(info.flags),
+                static_cast<uint64_t>(info.magFilter),
+                static_cast<uint64_t>(info.minFilter),
+                static_cast<uint64_t>(info.mipmapMode),
+                static_cast<uint64_t>(info.addressModeU),
+                static_cast<uint64_t>(info.addressModeV),
+                static_cast<uint64_t>(info.addressModeW),
+                floatBits(info.mipLodBias),
+                info.anisotropyEnable,
+                floatBits(info.maxAnisotropy),
+                info.compareEnable,
+                static_cast<uint64_t>(info.compareOp),
+                floatBits(info.minLod),
+                floatBits(info.maxLod),
+                static_cast<uint64_t>(info.borderColor),
+                info.unnormalizedCoordinates,
+        };
+
+        std::lock_guard lock(m_Mutex);
+        auto it = m_Samplers.find(key);
+        if (it != m_Samplers.end()) {
+            return it->second;
+        }
+
+        vk::Sampler sampler = globalState->device.createSampler(info);
+        m_Samplers.emplace(std::move(key), sampler);
+        return sampler;
+    }
+
+    LayoutCache &layoutCache() {
+        return *globalState->layoutCache;
+    }
+}// namespace kat
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "kat/core.hpp"
+#include "kat/shader_reflection.hpp"
+
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace kat {
+
+    // Hash-consed descriptor set layouts, pipeline layouts and samplers: asking twice with equal create infos
+    // returns the same handle. Equal set layouts being the same object is what makes pipeline layouts
+    // compatible across pipelines, so sets bound for one stay bound for the next.
+    //
+    // The cache owns every handle it hands out and destroys them in its destructor, never earlier. Don't
+    // destroy them yourself. Thread safe.
+    class LayoutCache {
+      public:
+        KAT_TRACKED_CLASS(MemoryTag::CORE);
+
+        // a set whose layout doesn't come from reflection, ex: bindless().setLayout() for runtime arrays
+        struct SetOverride {
+            uint32_t set;
+            vk::DescriptorSetLayout layout;
+        };
+
+        LayoutCache() = default;
+        ~LayoutCache();
+
+        LayoutCache(const LayoutCache &) = delete;
+        LayoutCache &operator=(const LayoutCache &) = delete;
+
+        // binding order doesn't matter. bindingFlags is empty or has one entry per binding.
+        vk::DescriptorSetLayout descriptorSetLayout(_In_ std::span<const vk::DescriptorSetLayoutBinding> bindings,
+                                                    _In_ vk::DescriptorSetLayoutCreateFlags flags = {},
+                                                    _In_ std::span<const vk::DescriptorBindingFlags> bindingFlags = {});
+
+        vk::PipelineLayout pipelineLayout(_In_ std::span<const vk::DescriptorSetLayout> setLayouts,
+                                          _In_ std::span<const vk::PushConstantRange> pushConstants = {});
+
+        // one layout per set from 0 to the highest set any stage uses, gaps get an empty layout. runtime sized
+        // arrays need an override, their binding flags aren't in the SPIR-V.
+        std::vector<vk::DescriptorSetLayout> setLayouts(_In_ std::span<const ShaderReflection> stages,
+                                                        _In_ std::span<const SetOverride> overrides = {});
+
+        // setLayouts plus a single push constant range covering every stage's block. push with the stage flags
+        // of every stage that declares one.
+        vk::PipelineLayout pipelineLayout(_In_ std::span<const ShaderReflection> stages,
+                                          _In_ std::span<const SetOverride> overrides = {});
+
+        // throws for chained create infos, pNext isn't part of the key
+        vk::Sampler sampler(_In_ const vk::SamplerCreateInfo &info);
+
+      private:
+        using Key = std::vector<uint64_t>;
+
+        struct KeyHash {
+            size_t operator()(const Key &key) const noexcept;
+        };
+
+        std::mutex m_Mutex;
+        std::unordered_map<Key, vk::DescriptorSetLayout, KeyHash> m_SetLayouts;
+        std::unordered_map<Key, vk::PipelineLayout, KeyHash> m_PipelineLayouts;
+        std::unordered_map<Key, vk::Sampler, KeyHash> m_Samplers;
+    };
+
+    [[nodiscard]] LayoutCache &layoutCache();
+}// namespace kat
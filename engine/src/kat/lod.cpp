@@ -0,0 +1,119 @@
+#include "lod.hpp"
+
+#include "kat/gpu_scene.hpp"
+#include "kat/jobs.hpp"
+#include "kat/render_world.hpp"
+#include "kat/transform.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace kat {
+
+    namespace {
+        constexpr size_t LOD_GRAIN = 4096;
+        constexpr float MIN_DISTANCE = 1e-3f;
+        constexpr float FRAME_TIME_SMOOTHING = 0.1f;
+        constexpr float FRAME_TIME_DEADBAND = 0.05f; // relative to the target, no bias change inside it
+    }// namespace
+
+    LodView LodView::perspective(_In_ const glm::vec3 &position, _In_ const glm::mat4 &projection, _In_ float viewportHeight) noexcept {
+        return LodView{position, 0.5f * viewportHeight * std::abs(projection[1][1])};
+    }
+
+    LodSystem::LodSystem(_In_ const LodSettings &settings) : m_Settings(settings), m_Bias(settings.minBias) {
+    }
+
+    void LodSystem::update(_In_ entt::registry &registry, _In_ std::span<const LodView> views) {
+        views = views.first(std::min<size_t>(views.size(), MAX_LOD_VIEWS));
+        const float threshold = m_Settings.threshold * m_Bias;
+        const float hysteresis = m_Settings.hysteresis;
+
+        // walk the Lod storage by index so chunks can split it, the view only answers contains/get
+        auto view = registry.view<Lod, const WorldTransform>();
+        const entt::sparse_set &storage = registry.storage<Lod>();
+        const entt::entity *entities = storage.data();
+        const size_t count = storage.size();
+
+        m_Changed.resize((count + LOD_GRAIN - 1) / LOD_GRAIN);
+        jobSystem().parallelFor(count, LOD_GRAIN, [&](size_t begin, size_t end) {
+            std::vector<entt::entity> &changed = m_Changed[begin / LOD_GRAIN];
+            changed.clear();
+
+            for (size_t i = begin; i < end; i++) {
+                entt::entity entity = entities[i];
+                if (!view.contains(entity)) continue;
+
+                auto [lod, transform] = view.get(entity);
+                const glm::mat4 &m = transform.matrix;
+                glm::vec3 position(m[3]);
+                float scale = std::sqrt(std::max({glm::dot(glm::vec3(m[0]), glm::vec3(m[0])), glm::dot(glm::vec3(m[1]), glm::vec3(m[1])),
+                                                  glm::dot(glm::vec3(m[2]), glm::vec3(m[2]))}));
+
+                for (size_t v = 0; v < views.size(); v++) {
+                    float distance = std::max(glm::distance(position, views[v].position), MIN_DISTANCE);
+                    uint32_t level = select(lod, lod.levels[v], scale * views[v].pixelsPerUnit / distance, threshold, hysteresis);
+                    if (level != lod.levels[v]) {
+                        lod.levels[v] = static_cast<uint8_t>(level);
+                        if (v == 0) changed.push_back(entity);
+                    }
+                }
+            }
+        });
+
+        // patch fires the update signals, which aren't thread safe, so the primary view's choice is applied here
+        m_ChangedCount = 0;
+        for (const std::vector<entt::entity> &chunk : m_Changed) {
+            for (entt::entity entity : chunk) {
+                uint32_t mesh = registry.get<Lod>(entity).mesh(0);
+                if (registry.all_of<Renderable>(entity)) {
+                    registry.patch<Renderable>(entity, [mesh](Renderable &r) { r.mesh = mesh; });
+                }
+                if (registry.all_of<MeshInstance>(entity)) {
+                    registry.patch<MeshInstance>(entity, [mesh](MeshInstance &i) { i.mesh = mesh; });
+                }
+            }
+            m_ChangedCount += chunk.size();
+        }
+    }
+
+    void LodSystem::reportFrameTime(_In_ float seconds) noexcept {
+        if (m_Settings.targetFrameTime <= 0.0f) return;
+
+        m_FrameTime = m_FrameTime == 0.0f ? seconds : m_FrameTime + (seconds - m_FrameTime) * FRAME_TIME_SMOOTHING;
+        if (m_FrameTime > m_Settings.targetFrameTime * (1.0f + FRAME_TIME_DEADBAND)) {
+            m_Bias *= 1.0f + m_Settings.biasStep;
+        } else if (m_FrameTime < m_Settings.targetFrameTime * (1.0f - FRAME_TIME_DEADBAND)) {
+            m_Bias /= 1.0f + m_Settings.biasStep;
+        }
+        m_Bias = std::clamp(m_Bias, m_Settings.minBias, m_Settings.maxBias);
+    }
+
+    float LodSystem::bias() const noexcept {
+        return m_Bias;
+    }
+
+    void LodSystem::setBias(_In_ float bias) noexcept {
+        m_Bias = std::clamp(bias, m_Settings.minBias, m_Settings.maxBias);
+    }
+
+    size_t LodSystem::changed() const noexcept {
+        return m_ChangedCount;
+    }
+
+    uint32_t LodSystem::select(_In_ const Lod &lod, _In_ uint32_t current, _In_ float pixelsPerUnit, _In_ float threshold,
+                               _In_ float hysteresis) noexcept {
+        const uint32_t count = std::clamp<uint32_t>(lod.count, 1, MAX_LOD_LEVELS);
+        uint32_t level = std::min(current, count - 1);
+
+        // coarser while the next level is comfortably below the threshold, finer while this one is clearly
+        // above it. the band between the two is what keeps an entity at the boundary from flipping every frame.
+        while (level + 1 < count && lod.errors[level + 1] * pixelsPerUnit <= threshold * (1.0f - hysteresis)) {
+            level++;
+        }
+        while (level > 0 && lod.errors[level] * pixelsPerUnit > threshold * (1.0f + hysteresis)) {
+            level--;
+        }
+        return level;
+    }
+}// namespace kat
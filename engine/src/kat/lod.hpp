@@ -0,0 +1,81 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <array>
+#include <span>
+#include <vector>
+
+namespace kat {
+
+    inline constexpr uint32_t MAX_LOD_LEVELS = 8;
+    inline constexpr uint32_t MAX_LOD_VIEWS = 4;
+
+    // Mesh levels of detail of an entity (with a WorldTransform), finest first. errors[i] is how far level i
+    // strays from the full detail mesh, in the entity's local units; the cooker's simplification error. It has
+    // to grow with the level.
+    struct Lod {
+        std::array<uint32_t, MAX_LOD_LEVELS> meshes{};
+        std::array<float, MAX_LOD_LEVELS> errors{};
+        uint32_t count = 1;
+        std::array<uint8_t, MAX_LOD_VIEWS> levels{}; // selected per view by LodSystem
+
+        [[nodiscard]] uint32_t mesh(_In_ uint32_t view = 0) const noexcept {
+            return meshes[levels[view]];
+        }
+    };
+
+    // A perspective camera, as far as LOD cares
+    struct LodView {
+        glm::vec3 position{0.0f};
+        float pixelsPerUnit = 1.0f; // at distance 1: viewport height / 2 * projection[1][1]
+
+        [[nodiscard]] static LodView perspective(_In_ const glm::vec3 &position, _In_ const glm::mat4 &projection, _In_ float viewportHeight) noexcept;
+    };
+
+    struct LodSettings {
+        float threshold = 1.0f;   // pixels of error on screen a level may have
+        float hysteresis = 0.25f; // a level changes only once its error leaves threshold * (1 +- hysteresis)
+
+        // bias scales the threshold. it grows while frames take longer than targetFrameTime and shrinks back
+        // once they're faster; 0 keeps it where setBias put it.
+        float targetFrameTime = 0.0f; // seconds
+        float minBias = 1.0f;
+        float maxBias = 8.0f;
+        float biasStep = 0.05f; // relative change per reported frame
+    };
+
+    // Picks a level per entity and view from the projected error: the coarsest level whose error covers at
+    // most threshold * bias pixels. Runs over the registry in parallel on the job system.
+    //
+    // The level of the first view is also written to the entity's Renderable and MeshInstance, through patch so
+    // GpuScene picks the change up.
+    class LodSystem {
+      public:
+        explicit LodSystem(_In_ const LodSettings &settings = {});
+
+        // main thread. at most MAX_LOD_VIEWS views, the rest are ignored.
+        void update(_In_ entt::registry &registry, _In_ std::span<const LodView> views);
+
+        // last frame's duration in seconds, moves bias toward the frame time target
+        void reportFrameTime(_In_ float seconds) noexcept;
+
+        [[nodiscard]] float bias() const noexcept;
+        void setBias(_In_ float bias) noexcept;
+
+        // first view level changes in the last update
+        [[nodiscard]] size_t changed() const noexcept;
+
+        // the level to use next, given the one in use and how many pixels a local unit covers at the entity
+        [[nodiscard]] static uint32_t select(_In_ const Lod &lod, _In_ uint32_t current, _In_ float pixelsPerUnit, _In_ float threshold,
+                                             _In_ float hysteresis) noexcept;
+
+      private:
+        LodSettings m_Settings;
+        float m_Bias = 1.0f;
+        float m_FrameTime = 0.0f; // smoothed
+
+        std::vector<std::vector<entt::entity>> m_Changed; // per chunk
+        size_t m_ChangedCount = 0;
+    };
+}// namespace kat
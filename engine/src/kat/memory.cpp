@@ -0,0 +1,201 @@
+#include "memory.hpp"
+
+#include "kat/core.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <utility>
+
+namespace kat {
+
+    namespace {
+        struct TagCounters {
+            std::atomic<uint64_t> liveBytes{0};
+            std::atomic<uint64_t> peakBytes{0};
+            std::atomic<uint64_t> liveCount{0};
+            std::atomic<uint64_t> totalCount{0};
+        };
+
+        // static storage, zeroed before anything allocates
+        std::array<TagCounters, MEMORY_TAG_COUNT> counters;
+
+        TagCounters &countersOf(_In_ MemoryTag tag) noexcept {
+            return counters[static_cast<size_t>(tag)];
+        }
+
+        void *allocateAligned(_In_ size_t bytes, _In_ size_t alignment) noexcept {
+            if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) return ::operator new(bytes, std::nothrow);
+            return ::operator new(bytes, std::align_val_t{alignment}, std::nothrow);
+        }
+
+        void freeAligned(_In_ void *ptr, _In_ size_t alignment) noexcept {
+            if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+                ::operator delete(ptr);
+            } else {
+                ::operator delete(ptr, std::align_val_t{alignment});
+            }
+        }
+
+        // vulkan frees and reallocates without a size, so every block starts with one. the header sits right
+        // before the pointer handed out, the block starts offset bytes before that.
+        struct VulkanHeader {
+            size_t size;
+            size_t alignment;
+            size_t offset;
+        };
+
+        VulkanHeader *headerOf(_In_ void *ptr) noexcept {
+            return reinterpret_cast<VulkanHeader *>(static_cast<std::byte *>(ptr) - sizeof(VulkanHeader));
+        }
+
+        void *VKAPI_PTR vulkanAllocate(_In_ void *, _In_ size_t size, _In_ size_t alignment, _In_ VkSystemAllocationScope) {
+            alignment = std::max(alignment, alignof(VulkanHeader));
+            const size_t offset = (sizeof(VulkanHeader) + alignment - 1) / alignment * alignment;
+
+            auto *block = static_cast<std::byte *>(allocateAligned(offset + size, alignment));
+            if (!block) return nullptr; // the driver reports VK_ERROR_OUT_OF_HOST_MEMORY
+
+            void *ptr = block + offset;
+            *headerOf(ptr) = VulkanHeader{size, alignment, offset};
+            recordAllocation(MemoryTag::VULKAN, size);
+            return ptr;
+        }
+
+        void VKAPI_PTR vulkanFree(_In_ void *, _In_opt_ void *ptr) {
+            if (!ptr) return;
+
+            const VulkanHeader header = *headerOf(ptr);
+            recordFree(MemoryTag::VULKAN, header.size);
+            freeAligned(static_cast<std::byte *>(ptr) - header.offset, header.alignment);
+        }
+
+        void *VKAPI_PTR vulkanReallocate(_In_ void *userData, _In_opt_ void *original, _In_ size_t size, _In_ size_t alignment, _In_ VkSystemAllocationScope scope) {
+            if (!original) return vulkanAllocate(userData, size, alignment, scope);
+            if (size == 0) {
+                vulkanFree(userData, original);
+                return nullptr;
+            }
+
+            // on failure the original has to stay valid
+            void *ptr = vulkanAllocate(userData, size, alignment, scope);
+            if (!ptr) return nullptr;
+            std::memcpy(ptr, original, std::min(size, headerOf(original)->size));
+            vulkanFree(userData, original);
+            return ptr;
+        }
+
+        // memory the driver got by itself (executable memory for shaders, mostly), it only tells us about it
+        void VKAPI_PTR vulkanInternalAllocation(_In_ void *, _In_ size_t size, _In_ VkInternalAllocationType, _In_ VkSystemAllocationScope) {
+            recordAllocation(MemoryTag::VULKAN, size);
+        }
+
+        void VKAPI_PTR vulkanInternalFree(_In_ void *, _In_ size_t size, _In_ VkInternalAllocationType, _In_ VkSystemAllocationScope) {
+            recordFree(MemoryTag::VULKAN, size);
+        }
+
+        const vk::AllocationCallbacks vulkanCallbacks{nullptr, vulkanAllocate, vulkanReallocate, vulkanFree, vulkanInternalAllocation, vulkanInternalFree};
+    }// namespace
+
+    const char *memoryTagName(_In_ MemoryTag tag) noexcept {
+        switch (tag) {
+            case MemoryTag::CORE:
+                return "core";
+            case MemoryTag::WINDOW:
+                return "window";
+            case MemoryTag::VULKAN:
+                return "vulkan";
+            case MemoryTag::ECS:
+                return "ecs";
+            case MemoryTag::ASSETS:
+                return "assets";
+            default:
+                return "unknown";
+        }
+    }
+
+    void recordAllocation(_In_ MemoryTag tag, _In_ size_t bytes) noexcept {
+        TagCounters &c = countersOf(tag);
+        const uint64_t live = c.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        c.liveCount.fetch_add(1, std::memory_order_relaxed);
+        c.totalCount.fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t peak = c.peakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !c.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+    }
+
+    void recordFree(_In_ MemoryTag tag, _In_ size_t bytes) noexcept {
+        TagCounters &c = countersOf(tag);
+        c.liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+        c.liveCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void *trackedAllocate(_In_ MemoryTag tag, _In_ size_t bytes, _In_ size_t alignment) {
+        void *ptr = allocateAligned(bytes, alignment);
+        if (!ptr) throw std::bad_alloc();
+        recordAllocation(tag, bytes);
+        return ptr;
+    }
+
+    void trackedFree(_In_ MemoryTag tag, _In_ void *ptr, _In_ size_t bytes, _In_ size_t alignment) noexcept {
+        if (!ptr) return;
+        recordFree(tag, bytes);
+        freeAligned(ptr, alignment);
+    }
+
+    MemoryStats memoryStats(_In_ MemoryTag tag) noexcept {
+        const TagCounters &c = countersOf(tag);
+        return MemoryStats{tag, c.liveBytes.load(std::memory_order_relaxed), c.peakBytes.load(std::memory_order_relaxed),
+                           c.liveCount.load(std::memory_order_relaxed), c.totalCount.load(std::memory_order_relaxed)};
+    }
+
+    std::array<MemoryStats, MEMORY_TAG_COUNT> memoryStats() noexcept {
+        std::array<MemoryStats, MEMORY_TAG_COUNT> stats;
+        for (size_t i = 0; i < MEMORY_TAG_COUNT; i++) {
+            stats[i] = memoryStats(static_cast<MemoryTag>(i));
+        }
+        return stats;
+    }
+
+    bool reportMemoryLeaks() {
+        bool leaked = false;
+        for (const MemoryStats &stats : memoryStats()) {
+            if (stats.liveCount == 0 && stats.liveBytes == 0) continue;
+
+            spdlog::warn("Leaked {} bytes in {} allocations tagged {} (peak {} bytes, {} allocations made)", stats.liveBytes, stats.liveCount,
+                         memoryTagName(stats.tag), stats.peakBytes, stats.totalCount);
+            leaked = true;
+        }
+        if (!leaked) spdlog::debug("No tracked allocations leaked");
+        return leaked;
+    }
+
+    const vk::AllocationCallbacks *vulkanAllocator() noexcept {
+        return &vulkanCallbacks;
+    }
+
+    MemoryCharge::MemoryCharge(_In_ MemoryTag tag, _In_ size_t bytes) noexcept : m_Tag(tag), m_Bytes(bytes) {
+        if (m_Bytes > 0) recordAllocation(m_Tag, m_Bytes);
+    }
+
+    MemoryCharge::~MemoryCharge() {
+        if (m_Bytes > 0) recordFree(m_Tag, m_Bytes);
+    }
+
+    MemoryCharge::MemoryCharge(_Inout_ MemoryCharge &&other) noexcept : m_Tag(other.m_Tag), m_Bytes(std::exchange(other.m_Bytes, 0)) {}
+
+    MemoryCharge &MemoryCharge::operator=(_Inout_ MemoryCharge &&other) noexcept {
+        if (this != &other) {
+            if (m_Bytes > 0) recordFree(m_Tag, m_Bytes);
+            m_Tag = other.m_Tag;
+            m_Bytes = std::exchange(other.m_Bytes, 0);
+        }
+        return *this;
+    }
+
+    size_t MemoryCharge::bytes() const noexcept {
+        return m_Bytes;
+    }
+}// namespace kat
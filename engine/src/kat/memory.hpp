@@ -0,0 +1,115 @@
+#pragma once
+
+#include <sal.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace vk {
+    struct AllocationCallbacks;
+}
+
+// Class-level operator new/delete charging every heap instance of the class to a tag. Stack and member
+// instances aren't heap allocations and aren't counted.
+#define KAT_TRACKED_CLASS(tag)                                                                                                            \
+    static void *operator new(::std::size_t size) { return ::kat::trackedAllocate(tag, size); }                                          \
+    static void operator delete(void *ptr, ::std::size_t size) noexcept { ::kat::trackedFree(tag, ptr, size); }
+
+namespace kat {
+
+    enum class MemoryTag : uint8_t {
+        CORE,   // the engine's global state and subsystems
+        WINDOW, // windows and what they own on the host
+        VULKAN, // host memory of the vulkan driver, through vulkanAllocator()
+        ECS,    // engine side ECS structures (transform hierarchy)
+        ASSETS, // loaded asset files
+        COUNT,
+    };
+
+    inline constexpr size_t MEMORY_TAG_COUNT = static_cast<size_t>(MemoryTag::COUNT);
+
+    struct MemoryStats {
+        MemoryTag tag;
+        uint64_t liveBytes;
+        uint64_t peakBytes;
+        uint64_t liveCount;  // allocations not yet freed
+        uint64_t totalCount; // allocations ever made
+    };
+
+    [[nodiscard]] const char *memoryTagName(_In_ MemoryTag tag) noexcept;
+
+    // Counting only, for memory allocated elsewhere. Thread safe and lock free. A free has to be recorded under
+    // the tag and with the size of its allocation.
+    void recordAllocation(_In_ MemoryTag tag, _In_ size_t bytes) noexcept;
+    void recordFree(_In_ MemoryTag tag, _In_ size_t bytes) noexcept;
+
+    // Allocate and count. Throws std::bad_alloc like operator new.
+    [[nodiscard]] void *trackedAllocate(_In_ MemoryTag tag, _In_ size_t bytes, _In_ size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+    void trackedFree(_In_ MemoryTag tag, _In_ void *ptr, _In_ size_t bytes, _In_ size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__) noexcept;
+
+    // Counters change while they're read, so the fields of a tag are consistent only roughly.
+    [[nodiscard]] MemoryStats memoryStats(_In_ MemoryTag tag) noexcept;
+    [[nodiscard]] std::array<MemoryStats, MEMORY_TAG_COUNT> memoryStats() noexcept;
+
+    // logs every tag still holding allocations, returns whether there were any. kat::terminate calls it last.
+    bool reportMemoryLeaks();
+
+    // Allocation callbacks counting the driver's host memory under MemoryTag::VULKAN. Objects created with them
+    // have to be destroyed with them.
+    [[nodiscard]] const vk::AllocationCallbacks *vulkanAllocator() noexcept;
+
+    // Standard allocator counting under a tag, for containers the engine owns.
+    template<typename T, MemoryTag TAG>
+    struct TrackingAllocator {
+        using value_type = T;
+
+        TrackingAllocator() noexcept = default;
+        template<typename U>
+        TrackingAllocator(_In_ const TrackingAllocator<U, TAG> &) noexcept {}
+
+        [[nodiscard]] T *allocate(_In_ size_t n) {
+            return static_cast<T *>(trackedAllocate(TAG, n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(_In_ T *ptr, _In_ size_t n) noexcept {
+            trackedFree(TAG, ptr, n * sizeof(T), alignof(T));
+        }
+
+        template<typename U>
+        struct rebind {
+            using other = TrackingAllocator<U, TAG>;
+        };
+
+        template<typename U>
+        bool operator==(_In_ const TrackingAllocator<U, TAG> &) const noexcept {
+            return true;
+        }
+    };
+
+    template<typename T, MemoryTag TAG>
+    using TrackedVector = std::vector<T, TrackingAllocator<T, TAG>>;
+
+    // Counts bytes held by something else (a file's contents, a staging copy) under a tag for as long as it
+    // lives. Movable, the moved-from charge is empty.
+    class MemoryCharge {
+      public:
+        MemoryCharge() noexcept = default;
+        MemoryCharge(_In_ MemoryTag tag, _In_ size_t bytes) noexcept;
+        ~MemoryCharge();
+
+        MemoryCharge(_Inout_ MemoryCharge &&other) noexcept;
+        MemoryCharge &operator=(_Inout_ MemoryCharge &&other) noexcept;
+
+        MemoryCharge(const MemoryCharge &) = delete;
+        MemoryCharge &operator=(const MemoryCharge &) = delete;
+
+        [[nodiscard]] size_t bytes() const noexcept;
+
+      private:
+        MemoryTag m_Tag = MemoryTag::CORE;
+        size_t m_Bytes = 0;
+    };
+}// namespace kat
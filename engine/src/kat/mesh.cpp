@@ -0,0 +1,110 @@
+#include "mesh.hpp"
+
+#include <algorithm>
+
+namespace kat {
+
+    namespace {
+        template<typename T>
+        bool allBelow(_In_ std::span<const T> indices, _In_ uint32_t count) noexcept {
+            return std::all_of(indices.begin(), indices.end(), [count](T index) { return index < count; });
+        }
+    }// namespace
+
+    MeshFile::MeshFile(_In_ std::vector<std::byte> &&contents) : m_Contents(std::move(contents)), m_Charge(MemoryTag::ASSETS, m_Contents.capacity()) {
+        if (m_Contents.size() < sizeof(mesh::Header)) {
+            throw std::runtime_error("Mesh file is truncated");
+        }
+
+        m_Header = reinterpret_cast<const mesh::Header *>(m_Contents.data());
+        if (m_Header->magic != mesh::MAGIC) {
+            throw std::runtime_error("Not a cooked mesh file");
+        }
+        if (m_Header->version != mesh::VERSION) {
+            throw std::runtime_error("Unsupported mesh file version");
+        }
+        if (m_Header->indexSize != 2 && m_Header->indexSize != 4) {
+            throw std::runtime_error("Invalid mesh index size");
+        }
+
+        const std::pair<uint64_t, uint64_t> blocks[] = {
+                {m_Header->vertexOffset, uint64_t{m_Header->vertexCount} * sizeof(mesh::Vertex)},
+                {m_Header->indexOffset, uint64_t{m_Header->indexCount} * m_Header->indexSize},
+                {m_Header->meshletOffset, uint64_t{m_Header->meshletCount} * sizeof(mesh::Meshlet)},
+                {m_Header->meshletVertexOffset, uint64_t{m_Header->meshletVertexCount} * sizeof(uint32_t)},
+                {m_Header->meshletTriangleOffset, m_Header->meshletTriangleBytes},
+        };
+        for (const auto &[offset, size] : blocks) {
+            if (offset % mesh::BLOCK_ALIGNMENT != 0 || offset > m_Contents.size() || size > m_Contents.size() - offset) {
+                throw std::runtime_error("Mesh file is truncated");
+            }
+        }
+
+        // meshcook refuses to build bigger meshlets, anything else wasn't cooked for this runtime
+        for (const auto &meshlet : meshlets()) {
+            if (meshlet.vertexCount > mesh::MAX_MESHLET_VERTICES || meshlet.triangleCount > mesh::MAX_MESHLET_TRIANGLES ||
+                meshlet.vertexOffset > m_Header->meshletVertexCount || meshlet.vertexCount > m_Header->meshletVertexCount - meshlet.vertexOffset ||
+                meshlet.triangleOffset > m_Header->meshletTriangleBytes || meshlet.triangleCount * 3 > m_Header->meshletTriangleBytes - meshlet.triangleOffset) {
+                throw std::runtime_error("Mesh meshlet is out of bounds");
+            }
+
+            // local indices into the meshlet's own vertices
+            if (!allBelow(meshletTriangles().subspan(meshlet.triangleOffset, size_t{meshlet.triangleCount} * 3), meshlet.vertexCount)) {
+                throw std::runtime_error("Mesh meshlet triangle is out of bounds");
+            }
+        }
+
+        // the gpu reads through all of these, an index past the vertex block would fetch out of bounds. the blocks
+        // are aligned, so they can be read in place.
+        const std::byte *indices = m_Contents.data() + m_Header->indexOffset;
+        bool indicesValid = m_Header->indexSize == 2 ? allBelow<uint16_t>({reinterpret_cast<const uint16_t *>(indices), m_Header->indexCount}, m_Header->vertexCount)
+                                                      : allBelow<uint32_t>({reinterpret_cast<const uint32_t *>(indices), m_Header->indexCount}, m_Header->vertexCount);
+        if (!indicesValid || !allBelow(meshletVertices(), m_Header->vertexCount)) {
+            throw std::runtime_error("Mesh index is out of bounds");
+        }
+    }
+
+    const mesh::Header &MeshFile::header() const noexcept {
+        return *m_Header;
+    }
+
+    std::span<const std::byte> MeshFile::vertexData() const noexcept {
+        return block(m_Header->vertexOffset, uint64_t{m_Header->vertexCount} * sizeof(mesh::Vertex));
+    }
+
+    std::span<const std::byte> MeshFile::indexData() const noexcept {
+        return block(m_Header->indexOffset, uint64_t{m_Header->indexCount} * m_Header->indexSize);
+    }
+
+    std::span<const mesh::Meshlet> MeshFile::meshlets() const noexcept {
+        return {reinterpret_cast<const mesh::Meshlet *>(m_Contents.data() + m_Header->meshletOffset), m_Header->meshletCount};
+    }
+
+    std::span<const uint32_t> MeshFile::meshletVertices() const noexcept {
+        return {reinterpret_cast<const uint32_t *>(m_Contents.data() + m_Header->meshletVertexOffset), m_Header->meshletVertexCount};
+    }
+
+    std::span<const uint8_t> MeshFile::meshletTriangles() const noexcept {
+        return {reinterpret_cast<const uint8_t *>(m_Contents.data() + m_Header->meshletTriangleOffset), m_Header->meshletTriangleBytes};
+    }
+
+    vk::IndexType MeshFile::indexType() const noexcept {
+        return m_Header->indexSize == 2 ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+    }
+
+    vk::VertexInputBindingDescription MeshFile::vertexBinding(_In_ uint32_t binding) {
+        return {binding, sizeof(mesh::Vertex), vk::VertexInputRate::eVertex};
+    }
+
+    std::array<vk::VertexInputAttributeDescription, 3> MeshFile::vertexAttributes(_In_ uint32_t binding, _In_ uint32_t firstLocation) {
+        return {
+                vk::VertexInputAttributeDescription{firstLocation, binding, vk::Format::eR16G16B16A16Unorm, offsetof(mesh::Vertex, position)},
+                vk::VertexInputAttributeDescription{firstLocation + 1, binding, vk::Format::eR16G16Snorm, offsetof(mesh::Vertex, normal)},
+                vk::VertexInputAttributeDescription{firstLocation + 2, binding, vk::Format::eR16G16Sfloat, offsetof(mesh::Vertex, uv)},
+        };
+    }
+
+    std::span<const std::byte> MeshFile::block(_In_ uint64_t offset, _In_ uint64_t size) const noexcept {
+        return {m_Contents.data() + offset, size};
+    }
+}// namespace kat
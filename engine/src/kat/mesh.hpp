@@ -0,0 +1,48 @@
+#pragma once
+
+#include "kat/core.hpp"
+#include "kat/mesh_container.hpp"
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace kat {
+
+    // A cooked .kmsh file held in memory. Every block is uploaded as-is; the vertex attribute formats below
+    // unpack the quantized data in the input assembler, so nothing is decoded on the CPU.
+    class MeshFile {
+      public:
+        // throws if the file is malformed
+        explicit MeshFile(_In_ std::vector<std::byte> &&contents);
+
+        // the header points into the contents, which move along with it but can't be shared
+        MeshFile(const MeshFile &) = delete;
+        MeshFile &operator=(const MeshFile &) = delete;
+        MeshFile(MeshFile &&) noexcept = default;
+        MeshFile &operator=(MeshFile &&) noexcept = default;
+
+        [[nodiscard]] const mesh::Header &header() const noexcept;
+
+        [[nodiscard]] std::span<const std::byte> vertexData() const noexcept;
+        [[nodiscard]] std::span<const std::byte> indexData() const noexcept;
+        [[nodiscard]] std::span<const mesh::Meshlet> meshlets() const noexcept;
+        [[nodiscard]] std::span<const uint32_t> meshletVertices() const noexcept;
+        [[nodiscard]] std::span<const uint8_t> meshletTriangles() const noexcept;
+
+        [[nodiscard]] vk::IndexType indexType() const noexcept;
+
+        // positions come out in [0, 1] and have to be scaled by positionScale * 65535 and offset by positionOffset,
+        // normally folded into the model matrix
+        [[nodiscard]] static vk::VertexInputBindingDescription vertexBinding(_In_ uint32_t binding = 0);
+        [[nodiscard]] static std::array<vk::VertexInputAttributeDescription, 3> vertexAttributes(_In_ uint32_t binding = 0, _In_ uint32_t firstLocation = 0);
+
+      private:
+        std::vector<std::byte> m_Contents;
+        MemoryCharge m_Charge; // m_Contents, under MemoryTag::ASSETS
+        const mesh::Header *m_Header;
+
+        [[nodiscard]] std::span<const std::byte> block(_In_ uint64_t offset, _In_ uint64_t size) const noexcept;
+    };
+}// namespace kat
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+
+// On-disk layout of cooked meshes (.kmsh). Shared between the engine and tools/meshcook, so this header must
+// stay free of platform and vulkan includes.
+//
+// File: [Header][vertices][indices][meshlets][meshlet vertices][meshlet triangles], each block starting on a
+// BLOCK_ALIGNMENT boundary. Vertex, index and meshlet blocks are uploaded to GPU buffers unchanged.
+namespace kat::mesh {
+
+    inline constexpr uint32_t MAGIC = 0x48534D4B; // "KMSH"
+    inline constexpr uint32_t VERSION = 1;
+    inline constexpr uint32_t BLOCK_ALIGNMENT = 16;
+
+    inline constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+    inline constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+    // 16 bytes.
+    // position: unorm16 inside the mesh bounds, position = positionOffset + q * positionScale (w is padding)
+    // normal:   octahedral snorm16
+    // uv:       half floats
+    struct Vertex {
+        uint16_t position[4];
+        int16_t normal[2];
+        uint16_t uv[2];
+    };
+
+    struct Meshlet {
+        uint32_t vertexOffset;   // into the meshlet vertex block (uint32 mesh vertex indices)
+        uint32_t triangleOffset; // into the meshlet triangle block (3 uint8 local indices per triangle)
+        uint32_t vertexCount;
+        uint32_t triangleCount;
+
+        float center[3]; // bounding sphere, object space
+        float radius;
+
+        // backface cone: every triangle faces away from the camera when
+        //   dot(normalize(coneApex - cameraPosition), coneAxis) >= coneCutoff
+        // or, conservatively and without the apex,
+        //   dot(center - cameraPosition, coneAxis) >= coneCutoff * length(center - cameraPosition) + radius
+        // an axis of 0 with a cutoff of 1 never culls.
+        float coneAxis[3];
+        float coneCutoff;
+
+        float coneApex[3];
+        float padding;
+    };
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t indexSize; // 2 or 4
+        uint32_t meshletCount;
+        uint32_t meshletVertexCount;
+        uint32_t meshletTriangleBytes;
+
+        float positionOffset[3];
+        float positionScale[3];
+        float boundsCenter[3];
+        float boundsRadius;
+
+        uint64_t vertexOffset; // every offset is from the start of the file
+        uint64_t indexOffset;
+        uint64_t meshletOffset;
+        uint64_t meshletVertexOffset;
+        uint64_t meshletTriangleOffset;
+        uint64_t fileSize;
+    };
+
+    static_assert(sizeof(Vertex) == 16);
+    static_assert(sizeof(Meshlet) == 64);
+    static_assert(sizeof(Header) == 120);
+}// namespace kat::mesh
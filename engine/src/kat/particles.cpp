@@ -0,0 +1,208 @@
+#include "particles.hpp"
+
+#include "kat/gpu_sync.hpp"
+#include "kat/transform.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace kat {
+
+    namespace {
+        constexpr uint32_t PARTICLE_SIMULATE_COMP_SPV[] =
+#include "kat/shaders/particle_simulate.comp.spv.h"
+                ;
+
+        constexpr uint32_t PARTICLE_EMIT_COMP_SPV[] =
+#include "kat/shaders/particle_emit.comp.spv.h"
+                ;
+
+        constexpr uint32_t PARTICLE_FINALIZE_COMP_SPV[] =
+#include "kat/shaders/particle_finalize.comp.spv.h"
+                ;
+
+        constexpr uint32_t STATE_BINDING = 0;
+        constexpr uint32_t PARTICLES_BINDING = 1;
+        constexpr uint32_t EMITTERS_BINDING = 2;
+
+        struct ParticlePush {
+            glm::vec3 gravity;
+            float deltaTime;
+            uint32_t source;
+            uint32_t capacity;
+            uint32_t spawnCount;
+            uint32_t firstEmitter;
+            uint32_t emitterCount;
+            uint32_t seed;
+            float drag;
+        };
+        KAT_GPU_STRUCT(STD430, ParticlePush, KAT_GPU_FIELD(ParticlePush, gravity), KAT_GPU_FIELD(ParticlePush, deltaTime), KAT_GPU_FIELD(ParticlePush, source),
+                       KAT_GPU_FIELD(ParticlePush, capacity), KAT_GPU_FIELD(ParticlePush, spawnCount), KAT_GPU_FIELD(ParticlePush, firstEmitter),
+                       KAT_GPU_FIELD(ParticlePush, emitterCount), KAT_GPU_FIELD(ParticlePush, seed), KAT_GPU_FIELD(ParticlePush, drag));
+
+        // the optimizer strips what a pass doesn't use, so only bind and check what its reflection declares
+        void connect(_In_ const ComputePipeline &pipeline, _Inout_ ComputeBindings &bindings, _In_ uint32_t binding, _In_ vk::Buffer buffer) {
+            for (const ShaderReflection::Binding &b : pipeline.reflection().bindings) {
+                if (b.set != 0 || b.binding != binding) continue;
+
+                switch (binding) {
+                    case STATE_BINDING: checkGpuLayout<GpuParticleState>(b, "GpuParticleState"); break;
+                    case PARTICLES_BINDING: checkGpuLayout<GpuParticle>(b, "GpuParticle"); break;
+                    case EMITTERS_BINDING: checkGpuLayout<GpuParticleEmitter>(b, "GpuParticleEmitter"); break;
+                    default: break;
+                }
+                bindings.buffer(0, binding, buffer);
+            }
+        }
+    }// namespace
+
+    ParticleSystem::ParticleSystem(_In_ entt::registry &registry, _In_ const ParticleSettings &settings)
+        : m_Registry(registry), m_Settings(settings),
+          m_Family(settings.asyncCompute ? computeTimeline().family() : globalState->graphicsQueueFamily),
+          m_Simulate(PARTICLE_SIMULATE_COMP_SPV), m_Emit(PARTICLE_EMIT_COMP_SPV), m_Finalize(PARTICLE_FINALIZE_COMP_SPV),
+          m_SimulateBindings(m_Simulate), m_EmitBindings(m_Emit), m_FinalizeBindings(m_Finalize) {
+        const auto deviceLocal = vk::MemoryPropertyFlagBits::eDeviceLocal;
+        const auto hostVisible = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+        using Usage = vk::BufferUsageFlagBits;
+        std::array<uint32_t, 2> families = {globalState->graphicsQueueFamily, m_Family};
+
+        m_Particles = Buffer(2 * vk::DeviceSize{settings.maxParticles} * sizeof(GpuParticle), Usage::eStorageBuffer | Usage::eTransferSrc, deviceLocal, families);
+        m_State = Buffer(sizeof(GpuParticleState), Usage::eStorageBuffer | Usage::eIndirectBuffer | Usage::eTransferSrc | Usage::eTransferDst, deviceLocal, families);
+        m_Emitters = Buffer(FRAMES_IN_FLIGHT * vk::DeviceSize{settings.maxEmitters} * sizeof(GpuParticleEmitter), Usage::eStorageBuffer, hostVisible);
+        m_Readback = Buffer(sizeof(GpuParticleState) + m_Particles.size() / 2, Usage::eTransferDst, hostVisible);
+
+        for (ComputePipeline *pipeline : {&m_Simulate, &m_Emit, &m_Finalize}) {
+            checkGpuPushConstants<ParticlePush>(pipeline->reflection(), "ParticlePush");
+        }
+        connect(m_Simulate, m_SimulateBindings, STATE_BINDING, m_State.handle());
+        connect(m_Simulate, m_SimulateBindings, PARTICLES_BINDING, m_Particles.handle());
+        connect(m_Emit, m_EmitBindings, STATE_BINDING, m_State.handle());
+        connect(m_Emit, m_EmitBindings, PARTICLES_BINDING, m_Particles.handle());
+        connect(m_Emit, m_EmitBindings, EMITTERS_BINDING, m_Emitters.handle());
+        connect(m_Finalize, m_FinalizeBindings, STATE_BINDING, m_State.handle());
+    }
+
+    ParticleSystem::~ParticleSystem() = default;
+
+    void ParticleSystem::simulate(_In_ vk::CommandBuffer cmd, _In_ uint32_t frame, _In_ float deltaTime) {
+        uint32_t slot = frame % FRAMES_IN_FLIGHT;
+        auto *emitters = static_cast<GpuParticleEmitter *>(m_Emitters.mapped()) + vk::DeviceSize{slot} * m_Settings.maxEmitters;
+
+        uint32_t emitterCount = 0;
+        uint32_t spawnCount = 0;
+        bool dropped = false;
+        for (auto [entity, emitter, transform] : m_Registry.view<ParticleEmitter, const WorldTransform>().each()) {
+            if (!emitter.enabled) continue;
+
+            emitter.carry += emitter.rate * deltaTime;
+            auto count = static_cast<uint32_t>(emitter.carry);
+            emitter.carry -= static_cast<float>(count);
+            if (count == 0) continue;
+
+            if (emitterCount == m_Settings.maxEmitters) {
+                dropped = true;
+                continue;
+            }
+
+            const glm::mat4 &m = transform.matrix;
+            emitters[emitterCount++] = GpuParticleEmitter{glm::vec3(m[3]), spawnCount, glm::mat3(m) * emitter.velocity, emitter.spread,
+                                                          emitter.color, emitter.lifetime, count, {}};
+            spawnCount += count;
+        }
+        if (dropped && !m_Dropped) {
+            spdlog::warn("More than {} particle emitters spawning at once, skipping the rest", m_Settings.maxEmitters);
+        }
+        m_Dropped = dropped;
+
+        const vk::PipelineStageFlags passes = vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eDrawIndirect;
+        if (!m_Cleared) {
+            cmd.fillBuffer(m_State.handle(), 0, VK_WHOLE_SIZE, 0);
+            vk::MemoryBarrier cleared{vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eIndirectCommandRead};
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, passes, {}, cleared, {}, {});
+            m_Cleared = true;
+        }
+
+        // last frame's draw and readback have to be done reading before anything is overwritten
+        cmd.pipelineBarrier(consumerStages() | vk::PipelineStageFlagBits::eTransfer, passes, {}, vk::MemoryBarrier{}, {}, {});
+
+        ParticlePush push{m_Settings.gravity, deltaTime, m_Source, m_Settings.maxParticles, spawnCount, slot * m_Settings.maxEmitters,
+                          emitterCount, m_Seed++, m_Settings.drag};
+        const vk::MemoryBarrier between{vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite};
+
+        m_Simulate.bind(cmd);
+        m_SimulateBindings.bind(cmd);
+        m_Simulate.push(cmd, push);
+        m_Simulate.dispatchIndirect(cmd, m_State.handle(), offsetof(GpuParticleState, simulateArgs));
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, between, {}, {});
+
+        if (spawnCount > 0) {
+            m_Emit.bind(cmd);
+            m_EmitBindings.bind(cmd);
+            m_Emit.push(cmd, push);
+            m_Emit.dispatch(cmd, spawnCount);
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, between, {}, {});
+        }
+
+        m_Finalize.bind(cmd);
+        m_FinalizeBindings.bind(cmd);
+        m_Finalize.push(cmd, push);
+        m_Finalize.dispatch(cmd, 1);
+
+        vk::MemoryBarrier done{vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eIndirectCommandRead};
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, consumerStages() | passes, {}, done, {}, {});
+
+        m_Source = 1 - m_Source;
+    }
+
+    void ParticleSystem::recordReadback(_In_ vk::CommandBuffer cmd) {
+        m_ReadbackHalf = m_Source;
+
+        vk::MemoryBarrier toTransfer{vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead};
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer, {}, toTransfer, {}, {});
+
+        vk::DeviceSize half = m_Particles.size() / 2;
+        cmd.copyBuffer(m_State.handle(), m_Readback.handle(), vk::BufferCopy{0, 0, sizeof(GpuParticleState)});
+        cmd.copyBuffer(m_Particles.handle(), m_Readback.handle(), vk::BufferCopy{m_ReadbackHalf * half, sizeof(GpuParticleState), half});
+
+        vk::MemoryBarrier toHost{vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead};
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, toHost, {}, {});
+    }
+
+    ParticleReadback ParticleSystem::readback() const {
+        const auto *bytes = static_cast<const std::byte *>(m_Readback.mapped());
+
+        GpuParticleState state;
+        std::memcpy(&state, bytes, sizeof(state));
+        uint32_t count = std::min(state.count[m_ReadbackHalf], m_Settings.maxParticles);
+
+        ParticleReadback result{state.dropped, std::vector<GpuParticle>(count)};
+        std::memcpy(result.particles.data(), bytes + sizeof(GpuParticleState), count * sizeof(GpuParticle));
+        return result;
+    }
+
+    vk::Buffer ParticleSystem::particleBuffer() const noexcept {
+        return m_Particles.handle();
+    }
+
+    vk::Buffer ParticleSystem::drawBuffer() const noexcept {
+        return m_State.handle();
+    }
+
+    uint32_t ParticleSystem::liveOffset() const noexcept {
+        return m_Source * m_Settings.maxParticles;
+    }
+
+    uint32_t ParticleSystem::queueFamily() const noexcept {
+        return m_Family;
+    }
+
+    // what reads the results on the recording queue. a compute-only queue can't name graphics stages, the
+    // semaphore between the queues orders the draw there.
+    vk::PipelineStageFlags ParticleSystem::consumerStages() const noexcept {
+        if (m_Family != globalState->graphicsQueueFamily) return vk::PipelineStageFlagBits::eComputeShader;
+        return vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eDrawIndirect;
+    }
+}// namespace kat
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "kat/compute.hpp"
+#include "kat/core.hpp"
+#include "kat/gpu.hpp"
+#include "kat/gpu_layout.hpp"
+
+#include <vector>
+
+namespace kat {
+
+    // Spawns particles at the entity's WorldTransform. Everything after spawning happens on the gpu.
+    struct ParticleEmitter {
+        float rate = 50.0f;                   // particles per second
+        float lifetime = 2.0f;                // seconds
+        glm::vec3 velocity{0.0f, 1.0f, 0.0f}; // initial, in the emitter's local space
+        float spread = 0.25f;                 // random velocity added, up to this much per axis
+        glm::vec4 color{1.0f};
+        bool enabled = true;
+        float carry = 0.0f; // fraction of a particle owed from earlier frames, maintained by ParticleSystem
+    };
+
+    // std430 layouts shared with shaders/particles.glsl
+    struct GpuParticle {
+        glm::vec3 position;
+        float age;
+        glm::vec3 velocity;
+        float lifetime;
+        glm::vec4 color;
+    };
+    KAT_GPU_STRUCT(STD430, GpuParticle, KAT_GPU_FIELD(GpuParticle, position), KAT_GPU_FIELD(GpuParticle, age), KAT_GPU_FIELD(GpuParticle, velocity),
+                   KAT_GPU_FIELD(GpuParticle, lifetime), KAT_GPU_FIELD(GpuParticle, color));
+
+    struct GpuParticleEmitter {
+        glm::vec3 position;
+        uint32_t first; // of the frame's spawns, the running sum of counts before this emitter
+        glm::vec3 velocity;
+        float spread;
+        glm::vec4 color;
+        float lifetime;
+        uint32_t count;
+        uint32_t padding[2];
+    };
+    KAT_GPU_STRUCT(STD430, GpuParticleEmitter, KAT_GPU_FIELD(GpuParticleEmitter, position), KAT_GPU_FIELD(GpuParticleEmitter, first),
+                   KAT_GPU_FIELD(GpuParticleEmitter, velocity), KAT_GPU_FIELD(GpuParticleEmitter, spread), KAT_GPU_FIELD(GpuParticleEmitter, color),
+                   KAT_GPU_FIELD(GpuParticleEmitter, lifetime), KAT_GPU_FIELD(GpuParticleEmitter, count), KAT_GPU_FIELD(GpuParticleEmitter, padding));
+
+    // counters and the indirect arguments the last pass derives from them
+    struct GpuParticleState {
+        uint32_t count[2]; // particles in each half of the particle buffer
+        uint32_t dropped;  // spawns that didn't fit, since creation
+        uint32_t padding;
+        glm::uvec4 simulateArgs; // vk::DispatchIndirectCommand for the next frame
+        glm::uvec4 drawArgs;     // vk::DrawIndirectCommand
+    };
+    KAT_GPU_STRUCT(STD430, GpuParticleState, KAT_GPU_FIELD(GpuParticleState, count), KAT_GPU_FIELD(GpuParticleState, dropped),
+                   KAT_GPU_FIELD(GpuParticleState, padding), KAT_GPU_FIELD(GpuParticleState, simulateArgs), KAT_GPU_FIELD(GpuParticleState, drawArgs));
+
+    struct ParticleSettings {
+        uint32_t maxParticles = 1 << 18;
+        uint32_t maxEmitters = 1024; // spawning per frame, more are skipped
+        glm::vec3 gravity{0.0f, -9.81f, 0.0f};
+        float drag = 0.0f; // fraction of velocity lost per second
+        bool asyncCompute = true; // simulate() records for computeTimeline(), else for the graphics queue
+    };
+
+    struct ParticleReadback {
+        uint32_t dropped;
+        std::vector<GpuParticle> particles;
+    };
+
+    // Particles live in one device buffer with two halves. Each frame a compute pass ages last frame's half and
+    // appends the survivors to the other half, new particles are appended after them, and a last pass turns the
+    // count into the indirect arguments. The cpu never sees particle data, nor how many there are.
+    //
+    // Draw with drawIndirect(drawBuffer(), DRAW_OFFSET, 1, 0): 4 vertices (a triangle strip quad) per particle,
+    // the vertex shader reads particles[liveOffset() + gl_InstanceIndex] from particleBuffer().
+    //
+    // With asyncCompute on a device that has the queue, simulate()'s submission and the draw are on different
+    // queues: the draw has to wait for it on computeTimeline().semaphore(), and simulate() for the previous
+    // frame's draw on graphicsTimeline().semaphore().
+    class ParticleSystem {
+      public:
+        static constexpr vk::DeviceSize DRAW_OFFSET = offsetof(GpuParticleState, drawArgs);
+
+        explicit ParticleSystem(_In_ entt::registry &registry, _In_ const ParticleSettings &settings = {});
+        ~ParticleSystem();
+
+        ParticleSystem(const ParticleSystem &) = delete;
+        ParticleSystem &operator=(const ParticleSystem &) = delete;
+
+        // main thread: spawns for every enabled emitter and records the simulation. frame selects the emitter
+        // upload slot, the gpu has to be done with its previous use.
+        void simulate(_In_ vk::CommandBuffer cmd, _In_ uint32_t frame, _In_ float deltaTime);
+
+        // after simulate on the same queue: copies the live particles into host memory; read them with
+        // readback() after the submission has completed
+        void recordReadback(_In_ vk::CommandBuffer cmd);
+        [[nodiscard]] ParticleReadback readback() const;
+
+        [[nodiscard]] vk::Buffer particleBuffer() const noexcept;
+        [[nodiscard]] vk::Buffer drawBuffer() const noexcept;
+        // first live particle, in particles, after the last simulate()
+        [[nodiscard]] uint32_t liveOffset() const noexcept;
+        // the family simulate() records for
+        [[nodiscard]] uint32_t queueFamily() const noexcept;
+
+      private:
+        entt::registry &m_Registry;
+        ParticleSettings m_Settings;
+        uint32_t m_Family;
+
+        Buffer m_Particles;
+        Buffer m_State;
+        Buffer m_Emitters; // FRAMES_IN_FLIGHT slots of maxEmitters
+        Buffer m_Readback;
+
+        ComputePipeline m_Simulate;
+        ComputePipeline m_Emit;
+        ComputePipeline m_Finalize;
+        ComputeBindings m_SimulateBindings;
+        ComputeBindings m_EmitBindings;
+        ComputeBindings m_FinalizeBindings;
+
+        uint32_t m_Source = 0; // half holding last frame's particles
+        uint32_t m_Seed = 0;
+        bool m_Cleared = false;
+        bool m_Dropped = false;
+        uint32_t m_ReadbackHalf = 0;
+
+        [[nodiscard]] vk::PipelineStageFlags consumerStages() const noexcept;
+    };
+}// namespace kat
@@ -0,0 +1,50 @@
+#include "prefab.hpp"
+
+namespace kat {
+
+    BulkConstruction &bulkConstruction(_In_ entt::registry &registry) {
+        return registry.ctx().emplace<BulkConstruction>(); // the existing one if there is one
+    }
+
+    Prefab::HeldConstruction::HeldConstruction(_In_ const Prefab &prefab, _In_ entt::registry &registry, _In_ std::span<const entt::entity> entities,
+                                               _In_ std::span<const entt::id_type> overridden)
+        : m_Registry(registry), m_Entities(entities) {
+        auto inserted = [&](entt::id_type type) {
+            return std::find(overridden.begin(), overridden.end(), type) != overridden.end() ||
+                   std::any_of(prefab.m_Components.begin(), prefab.m_Components.end(), [type](const Component &c) { return c.type == type; });
+        };
+
+        for (const BulkConstruction::Listener &listener : bulkConstruction(registry).m_Listeners) {
+            if (inserted(listener.type)) m_Held.push_back(listener);
+        }
+        for (const BulkConstruction::Listener &listener : m_Held) {
+            listener.hold(registry);
+        }
+    }
+
+    Prefab::HeldConstruction::~HeldConstruction() {
+        if (m_Released) return;
+        try {
+            release();
+        } catch (...) {
+            // already unwinding from a failed insert, that one is reported
+        }
+    }
+
+    void Prefab::HeldConstruction::release() {
+        m_Released = true;
+        for (const BulkConstruction::Listener &listener : m_Held) {
+            listener.release(m_Registry);
+        }
+        for (const BulkConstruction::Listener &listener : m_Held) {
+            listener.constructed(m_Entities);
+        }
+    }
+
+    void Prefab::insertShared(_In_ entt::registry &registry, _In_ std::span<const entt::entity> entities, _In_ std::span<const entt::id_type> overridden) const {
+        for (const Component &component : m_Components) {
+            if (std::find(overridden.begin(), overridden.end(), component.type) != overridden.end()) continue;
+            component.insert(registry, entities);
+        }
+    }
+}// namespace kat
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace kat {
+
+    // Construction listeners that can take a whole range of entities at once. A system listening to
+    // on_construct<T> connects the same member here as well; Prefab::instantiate then disconnects it while the
+    // pools fill and hands it every new entity in one call, instead of one signal per entity. Lives in the
+    // registry's context, see bulkConstruction().
+    class BulkConstruction {
+      public:
+        using FNBULKCONSTRUCT = void(std::span<const entt::entity> entities);
+
+        // Candidate is the member of owner connected to on_construct<T>()
+        template<typename T, auto Candidate, typename Owner>
+        void connect(_In_ Owner &owner, _In_ std::function<FNBULKCONSTRUCT> constructed) {
+            m_Listeners.push_back(Listener{
+                    entt::type_id<T>().hash(),
+                    &owner,
+                    [&owner](_In_ entt::registry &registry) { registry.on_construct<T>().template disconnect<Candidate>(owner); },
+                    [&owner](_In_ entt::registry &registry) { registry.on_construct<T>().template connect<Candidate>(owner); },
+                    std::move(constructed),
+            });
+        }
+
+        // everything owner connected
+        void disconnect(_In_ const void *owner) {
+            std::erase_if(m_Listeners, [owner](const Listener &l) { return l.owner == owner; });
+        }
+
+      private:
+        friend class Prefab;
+
+        struct Listener {
+            entt::id_type type;
+            const void *owner;
+            std::function<void(entt::registry &)> hold;
+            std::function<void(entt::registry &)> release;
+            std::function<FNBULKCONSTRUCT> constructed;
+        };
+
+        std::vector<Listener> m_Listeners;
+    };
+
+    // the registry's BulkConstruction, created on first use
+    [[nodiscard]] BulkConstruction &bulkConstruction(_In_ entt::registry &registry);
+
+    // A set of component values new entities start with, defined once and stamped out in bulk. instantiate
+    // creates all entities in one registry call, then fills each component pool with one insert over the whole
+    // range: every pool grows once and the new components sit next to each other in it, in the order of the
+    // entities. Listeners connected to BulkConstruction (TransformHierarchy, SpatialIndex, GpuScene) hear about
+    // the range once, after every component is in; any other on_construct listener still gets each entity.
+    //
+    //     Prefab crate;
+    //     crate.set(Transform{}).set(MeshInstance{mesh}).set(BoundingBox{...});
+    //     std::vector<entt::entity> crates = crate.instantiate(registry, 5000);
+    //     std::vector<entt::entity> placed = crate.instantiate(registry, placements.size(), std::span<const Transform>(placements));
+    class Prefab {
+      public:
+        // replaces the value if the prefab already has a T
+        template<typename T>
+        Prefab &set(_In_ T component) {
+            const entt::id_type type = entt::type_id<T>().hash();
+            auto insert = [component = std::move(component)](_In_ entt::registry &registry, _In_ std::span<const entt::entity> entities) {
+                auto &storage = registry.storage<T>();
+                storage.reserve(storage.size() + entities.size());
+                registry.insert<T>(entities.begin(), entities.end(), component);
+            };
+
+            auto existing = std::find_if(m_Components.begin(), m_Components.end(), [type](const Component &c) { return c.type == type; });
+            if (existing != m_Components.end()) {
+                existing->insert = std::move(insert);
+            } else {
+                m_Components.push_back(Component{type, std::move(insert)});
+            }
+            return *this;
+        }
+
+        template<typename T>
+        Prefab &remove() {
+            const entt::id_type type = entt::type_id<T>().hash();
+            std::erase_if(m_Components, [type](const Component &c) { return c.type == type; });
+            return *this;
+        }
+
+        template<typename T>
+        [[nodiscard]] bool has() const noexcept {
+            const entt::id_type type = entt::type_id<T>().hash();
+            return std::any_of(m_Components.begin(), m_Components.end(), [type](const Component &c) { return c.type == type; });
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return m_Components.size();
+        }
+
+        // creates out.size() entities. each perInstance span holds one value per entity for its component type,
+        // taking the place of the prefab's value (the prefab doesn't need to have that type at all).
+        template<typename... Ts>
+        void instantiate(_In_ entt::registry &registry, _Out_ std::span<entt::entity> out, _In_ std::span<const Ts>... perInstance) const {
+            if (((perInstance.size() != out.size()) || ...)) {
+                throw std::runtime_error("Per instance components must have one value per entity");
+            }
+
+            registry.create(out.begin(), out.end());
+            if (out.empty()) return;
+
+            const std::array<entt::id_type, sizeof...(Ts)> overridden{entt::type_id<Ts>().hash()...};
+            HeldConstruction held(*this, registry, out, overridden);
+            insertShared(registry, out, overridden);
+            (insertEach(registry, out, perInstance), ...);
+            held.release();
+        }
+
+        template<typename... Ts>
+        [[nodiscard]] std::vector<entt::entity> instantiate(_In_ entt::registry &registry, _In_ size_t count, _In_ std::span<const Ts>... perInstance) const {
+            std::vector<entt::entity> entities(count);
+            instantiate(registry, std::span<entt::entity>(entities), perInstance...);
+            return entities;
+        }
+
+      private:
+        struct Component {
+            entt::id_type type;
+            std::function<void(entt::registry &, std::span<const entt::entity>)> insert;
+        };
+
+        std::vector<Component> m_Components;
+
+        // disconnects the bulk listeners of every type instantiate inserts, release() connects them again and
+        // notifies them. if an insert throws, the destructor does it for the entities as they are.
+        class HeldConstruction {
+          public:
+            HeldConstruction(_In_ const Prefab &prefab, _In_ entt::registry &registry, _In_ std::span<const entt::entity> entities,
+                             _In_ std::span<const entt::id_type> overridden);
+            ~HeldConstruction();
+
+            HeldConstruction(const HeldConstruction &) = delete;
+            HeldConstruction &operator=(const HeldConstruction &) = delete;
+
+            void release();
+
+          private:
+            entt::registry &m_Registry;
+            std::span<const entt::entity> m_Entities;
+            std::vector<BulkConstruction::Listener> m_Held; // copies, a listener may disconnect while notified
+            bool m_Released = false;
+        };
+
+        void insertShared(_In_ entt::registry &registry, _In_ std::span<const entt::entity> entities, _In_ std::span<const entt::id_type> overridden) const;
+
+        template<typename T>
+        static void insertEach(_In_ entt::registry &registry, _In_ std::span<const entt::entity> entities, _In_ std::span<const T> values) {
+            auto &storage = registry.storage<T>();
+            storage.reserve(storage.size() + entities.size());
+            registry.insert<T>(entities.begin(), entities.end(), values.begin());
+        }
+    };
+
+    // instantiate into the engine's registry
+    template<typename... Ts>
+    [[nodiscard]] std::vector<entt::entity> createEntities(_In_ const Prefab &prefab, _In_ size_t count, _In_ std::span<const Ts>... perInstance) {
+        return prefab.instantiate(entityRegistry(), count, perInstance...);
+    }
+}// namespace kat
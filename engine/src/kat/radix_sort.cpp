@@ -0,0 +1,91 @@
+#include "radix_sort.hpp"
+
+#include "kat/jobs.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace kat {
+
+    namespace {
+        constexpr uint32_t RADIX_BITS = 8;
+        constexpr uint32_t BUCKETS = 1u << RADIX_BITS;
+        constexpr uint32_t PASSES = 64 / RADIX_BITS;
+
+        // below this splitting costs more than it saves
+        constexpr size_t MIN_BLOCK = 16384;
+    }// namespace
+
+    void RadixSorter::sort(_Inout_ std::span<uint64_t> keys, _Inout_ std::span<uint32_t> values) {
+        assert(keys.size() == values.size());
+        const size_t count = keys.size();
+        if (count < 2) return;
+
+        JobSystem &jobs = jobSystem();
+        const size_t wanted = std::clamp<size_t>(count / MIN_BLOCK, 1, jobs.workerCount() + 1);
+        const size_t grain = (count + wanted - 1) / wanted;
+        const size_t blocks = (count + grain - 1) / grain; // rounding can leave fewer than asked for
+
+        m_Keys.resize(count);
+        m_Values.resize(count);
+        m_Offsets.resize(blocks * BUCKETS);
+        m_Differences.assign(blocks, 0);
+
+        // bits that differ from the first key anywhere; digits without any can be skipped
+        jobs.parallelFor(count, grain, [&](size_t begin, size_t end) {
+            uint64_t difference = 0;
+            for (size_t i = begin; i < end; i++) {
+                difference |= keys[i] ^ keys[0];
+            }
+            m_Differences[begin / grain] = difference;
+        });
+        uint64_t difference = 0;
+        for (uint64_t d : m_Differences) difference |= d;
+
+        uint64_t *srcKeys = keys.data();
+        uint32_t *srcValues = values.data();
+        uint64_t *dstKeys = m_Keys.data();
+        uint32_t *dstValues = m_Values.data();
+
+        for (uint32_t pass = 0; pass < PASSES; pass++) {
+            const uint32_t shift = pass * RADIX_BITS;
+            if (((difference >> shift) & (BUCKETS - 1)) == 0) continue;
+
+            jobs.parallelFor(count, grain, [&](size_t begin, size_t end) {
+                uint32_t *counts = &m_Offsets[(begin / grain) * BUCKETS];
+                std::fill_n(counts, BUCKETS, 0u);
+                for (size_t i = begin; i < end; i++) {
+                    counts[(srcKeys[i] >> shift) & (BUCKETS - 1)]++;
+                }
+            });
+
+            uint32_t offset = 0;
+            for (uint32_t digit = 0; digit < BUCKETS; digit++) {
+                for (size_t block = 0; block < blocks; block++) {
+                    uint32_t &slot = m_Offsets[block * BUCKETS + digit];
+                    uint32_t n = slot;
+                    slot = offset;
+                    offset += n;
+                }
+            }
+
+            jobs.parallelFor(count, grain, [&](size_t begin, size_t end) {
+                uint32_t *offsets = &m_Offsets[(begin / grain) * BUCKETS];
+                for (size_t i = begin; i < end; i++) {
+                    uint32_t target = offsets[(srcKeys[i] >> shift) & (BUCKETS - 1)]++;
+                    dstKeys[target] = srcKeys[i];
+                    dstValues[target] = srcValues[i];
+                }
+            });
+
+            std::swap(srcKeys, dstKeys);
+            std::swap(srcValues, dstValues);
+        }
+
+        // an odd number of passes leaves the result in scratch
+        if (srcKeys != keys.data()) {
+            std::copy_n(srcKeys, count, keys.data());
+            std::copy_n(srcValues, count, values.data());
+        }
+    }
+}// namespace kat
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <span>
+#include <vector>
+
+namespace kat {
+
+    // Stable LSD radix sort of 64 bit keys with a 32 bit payload, 8 bits per pass. Large inputs are split into
+    // one block per job system thread: every pass counts digits per block in parallel, turns the counts into
+    // offsets (digit major, block minor, which keeps it stable) and scatters the blocks in parallel. Passes over
+    // digits that are the same in every key are skipped, so keys that only use their top or bottom bits cost
+    // fewer than eight passes.
+    //
+    // Keeps its scratch memory between calls, keep one around per caller. Not thread safe itself.
+    class RadixSorter {
+      public:
+        // sorts keys ascending and applies the same permutation to values, which has to be as long as keys
+        void sort(_Inout_ std::span<uint64_t> keys, _Inout_ std::span<uint32_t> values);
+
+      private:
+        std::vector<uint64_t> m_Keys;
+        std::vector<uint32_t> m_Values;
+        std::vector<uint32_t> m_Offsets; // 256 per block
+        std::vector<uint64_t> m_Differences; // per block
+    };
+}// namespace kat
@@ -0,0 +1,92 @@
+#include "render_world.hpp"
+
+#include "kat/jobs.hpp"
+#include "kat/transform.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace kat {
+
+    namespace {
+        constexpr size_t EXTRACT_GRAIN = 4096;
+
+        constexpr uint64_t mask(uint32_t bits) {
+            return (uint64_t{1} << bits) - 1;
+        }
+    }// namespace
+
+    uint32_t sortkey::quantizeDepth(_In_ float depth) noexcept {
+        depth = std::clamp(depth, 0.0f, 1.0f); // also turns nan into 0
+        return static_cast<uint32_t>(depth * static_cast<float>(mask(DEPTH_BITS)));
+    }
+
+    uint64_t sortkey::make(_In_ uint8_t pass, _In_ uint16_t pipeline, _In_ uint32_t material, _In_ float depth, _In_ bool backToFront) noexcept {
+        uint64_t key = (pass & mask(PASS_BITS)) << (64 - PASS_BITS);
+        uint64_t d = quantizeDepth(depth);
+        uint64_t p = pipeline & mask(PIPELINE_BITS);
+        uint64_t m = material & mask(MATERIAL_BITS);
+
+        if (backToFront) {
+            d = ~d & mask(DEPTH_BITS);
+            return key | d << (PIPELINE_BITS + MATERIAL_BITS) | p << MATERIAL_BITS | m;
+        }
+        return key | p << (MATERIAL_BITS + DEPTH_BITS) | m << DEPTH_BITS | d;
+    }
+
+    RenderExtractor::RenderExtractor(_In_ const RenderExtractorSettings &settings) : m_Settings(settings) {
+    }
+
+    const RenderWorld &RenderExtractor::extract(_In_ const entt::registry &registry, _In_ std::span<const entt::entity> visible,
+                                                _In_ const glm::mat4 &viewProjection, _In_ uint64_t frame) {
+        RenderWorld &world = m_Worlds[frame % WORLD_COUNT];
+        world.frame = frame;
+        world.viewProjection = viewProjection;
+
+        auto view = registry.view<const WorldTransform, const Renderable>();
+        JobSystem &jobs = jobSystem();
+
+        // count per chunk, then every chunk writes its packets at a known offset, keeping the order of visible
+        // without any synchronisation
+        const size_t chunks = (visible.size() + EXTRACT_GRAIN - 1) / EXTRACT_GRAIN;
+        m_ChunkOffsets.assign(chunks + 1, 0);
+        jobs.parallelFor(visible.size(), EXTRACT_GRAIN, [&](size_t begin, size_t end) {
+            uint32_t n = 0;
+            for (size_t i = begin; i < end; i++) {
+                n += view.contains(visible[i]) ? 1 : 0;
+            }
+            m_ChunkOffsets[begin / EXTRACT_GRAIN + 1] = n;
+        });
+        std::partial_sum(m_ChunkOffsets.begin(), m_ChunkOffsets.end(), m_ChunkOffsets.begin());
+
+        const uint32_t count = m_ChunkOffsets.back();
+        world.packets.resize(count);
+        world.keys.resize(count);
+        world.order.resize(count);
+
+        jobs.parallelFor(visible.size(), EXTRACT_GRAIN, [&](size_t begin, size_t end) {
+            uint32_t out = m_ChunkOffsets[begin / EXTRACT_GRAIN];
+            for (size_t i = begin; i < end; i++) {
+                entt::entity entity = visible[i];
+                if (!view.contains(entity)) continue;
+
+                const auto &[transform, renderable] = view.get(entity);
+                glm::vec4 clip = viewProjection * transform.matrix[3];
+                float depth = clip.w > 0.0f ? clip.z / clip.w : 0.0f;
+                bool backToFront = (m_Settings.backToFrontPasses >> (renderable.pass & 15)) & 1;
+
+                world.packets[out] = RenderPacket{transform.matrix, renderable.mesh, renderable.material, renderable.pipeline, renderable.pass, entity};
+                world.keys[out] = sortkey::make(renderable.pass, renderable.pipeline, renderable.material, depth, backToFront);
+                world.order[out] = out;
+                out++;
+            }
+        });
+
+        m_Sorter.sort(world.keys, world.order);
+        return world;
+    }
+
+    const RenderWorld &RenderExtractor::world(_In_ uint64_t frame) const noexcept {
+        return m_Worlds[frame % WORLD_COUNT];
+    }
+}// namespace kat
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "kat/core.hpp"
+#include "kat/radix_sort.hpp"
+
+#include <array>
+#include <span>
+#include <vector>
+
+namespace kat {
+
+    // What to draw an entity (with a WorldTransform) with. pass orders whole groups of draws, e.g. opaque
+    // before transparent; ids are whatever the renderer uses to look pipelines and materials up.
+    struct Renderable {
+        uint32_t mesh = 0;
+        uint32_t material = 0;
+        uint16_t pipeline = 0;
+        uint8_t pass = 0;
+    };
+
+    // Everything recording needs about one draw, copied out of the registry so the render side never touches it.
+    struct RenderPacket {
+        glm::mat4 model;
+        uint32_t mesh;
+        uint32_t material;
+        uint16_t pipeline;
+        uint8_t pass;
+        entt::entity entity;
+    };
+
+    // Sort key layout, most significant first:
+    //   front to back: pass:4 | pipeline:12 | material:24 | depth:24
+    //   back to front: pass:4 | ~depth:24   | pipeline:12 | material:24
+    // so opaque passes group by state and go near to far within it, and blended passes are strictly far to
+    // near. ids are truncated to their field.
+    namespace sortkey {
+        inline constexpr uint32_t PASS_BITS = 4;
+        inline constexpr uint32_t PIPELINE_BITS = 12;
+        inline constexpr uint32_t MATERIAL_BITS = 24;
+        inline constexpr uint32_t DEPTH_BITS = 24;
+
+        // depth in [0, 1], clamped
+        [[nodiscard]] uint32_t quantizeDepth(_In_ float depth) noexcept;
+
+        [[nodiscard]] uint64_t make(_In_ uint8_t pass, _In_ uint16_t pipeline, _In_ uint32_t material, _In_ float depth, _In_ bool backToFront) noexcept;
+
+        [[nodiscard]] constexpr uint32_t pass(_In_ uint64_t key) noexcept {
+            return static_cast<uint32_t>(key >> (64 - PASS_BITS));
+        }
+    }// namespace sortkey
+
+    // One frame's extracted draws. packets are in extraction order; order lists them sorted by key, so record
+    // packets[order[i]] for i in [0, size).
+    struct RenderWorld {
+        uint64_t frame = 0;
+        glm::mat4 viewProjection{1.0f};
+        std::vector<RenderPacket> packets;
+        std::vector<uint64_t> keys; // sorted
+        std::vector<uint32_t> order;
+
+        [[nodiscard]] size_t size() const noexcept { return packets.size(); }
+        [[nodiscard]] const RenderPacket &sorted(_In_ size_t i) const noexcept { return packets[order[i]]; }
+    };
+
+    struct RenderExtractorSettings {
+        uint16_t backToFrontPasses = 0; // bit n set sorts pass n far to near
+    };
+
+    // The extraction phase between simulation and recording: turns the visible entities into packets in a
+    // RenderWorld and sorts them. There are two worlds used alternately by frame index, so simulation can
+    // extract frame N + 1 while frame N is still being recorded from the other; the caller has to make sure
+    // recording of N - 1 finished before extracting N + 1, which FramePipeline::beginFrame does.
+    class RenderExtractor {
+      public:
+        static constexpr uint32_t WORLD_COUNT = 2;
+
+        explicit RenderExtractor(_In_ const RenderExtractorSettings &settings = {});
+
+        // main thread. entities in visible without a Renderable or WorldTransform are skipped; packet order
+        // follows visible. depth is the packet origin's depth under viewProjection.
+        const RenderWorld &extract(_In_ const entt::registry &registry, _In_ std::span<const entt::entity> visible,
+                                   _In_ const glm::mat4 &viewProjection, _In_ uint64_t frame);
+
+        [[nodiscard]] const RenderWorld &world(_In_ uint64_t frame) const noexcept;
+
+      private:
+        RenderExtractorSettings m_Settings;
+        std::array<RenderWorld, WORLD_COUNT> m_Worlds;
+        RadixSorter m_Sorter;
+        std::vector<uint32_t> m_ChunkOffsets;
+    };
+}// namespace kat
@@ -0,0 +1,135 @@
+#include "scheduler.hpp"
+#include <spdlog/spdlog.h>
+
+namespace kat {
+
+    Scheduler::~Scheduler() {
+        shutdown();
+
+        std::unordered_set<void *> roots;
+        {
+            std::lock_guard lock(m_Mutex);
+            roots.swap(m_Roots);
+            m_Ready.clear();
+            m_NextFrame.clear();
+            m_GpuWaits.clear();
+        }
+
+        if (!roots.empty()) {
+            spdlog::debug("Destroying {} unfinished tasks", roots.size());
+        }
+
+        // destroying a root also destroys every task it is (transitively) awaiting
+        for (void *root : roots) {
+            std::coroutine_handle<>::from_address(root).destroy();
+        }
+    }
+
+    void Scheduler::spawn(_In_ Task<void> &&task) {
+        if (stopped()) return;
+
+        Detached detached = runDetached(std::move(task));
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Roots.insert(detached.handle.address());
+        }
+        detached.handle.resume();
+    }
+
+    void Scheduler::tick() {
+        if (stopped()) return;
+
+        std::vector<std::coroutine_handle<>> resume;
+        {
+            std::lock_guard lock(m_Mutex);
+            resume.swap(m_NextFrame);
+
+            std::erase_if(m_GpuWaits, [&resume](const GpuWait &wait) {
+                bool signalled = wait.fence ? wait.device.getFenceStatus(wait.fence) == vk::Result::eSuccess
+                                            : wait.device.getSemaphoreCounterValue(wait.semaphore) >= wait.value;
+                if (signalled) resume.push_back(wait.handle);
+                return signalled;
+            });
+        }
+
+        for (auto handle : resume) {
+            handle.resume();
+        }
+
+        // anything posted while running the above still gets to run this frame, but only one round of it so a
+        // coroutine that keeps re-posting itself can't stall the frame
+        resume.clear();
+        {
+            std::lock_guard lock(m_Mutex);
+            resume.swap(m_Ready);
+        }
+
+        for (auto handle : resume) {
+            handle.resume();
+        }
+
+        m_FrameIndex.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Scheduler::post(_In_ std::coroutine_handle<> handle) {
+        if (stopped()) return;
+
+        std::lock_guard lock(m_Mutex);
+        m_Ready.push_back(handle);
+    }
+
+    void Scheduler::postNextFrame(_In_ std::coroutine_handle<> handle) {
+        if (stopped()) return;
+
+        std::lock_guard lock(m_Mutex);
+        m_NextFrame.push_back(handle);
+    }
+
+    void Scheduler::waitForFence(_In_ vk::Device device, _In_ vk::Fence fence, _In_ std::coroutine_handle<> handle) {
+        if (stopped()) return;
+
+        std::lock_guard lock(m_Mutex);
+        m_GpuWaits.push_back(GpuWait{device, fence, nullptr, 0, handle});
+    }
+
+    void Scheduler::waitForSemaphore(_In_ vk::Device device, _In_ vk::Semaphore semaphore, _In_ uint64_t value, _In_ std::coroutine_handle<> handle) {
+        if (stopped()) return;
+
+        std::lock_guard lock(m_Mutex);
+        m_GpuWaits.push_back(GpuWait{device, nullptr, semaphore, value, handle});
+    }
+
+    void Scheduler::shutdown() noexcept {
+        m_Stopped.store(true);
+    }
+
+    bool Scheduler::stopped() const noexcept {
+        return m_Stopped.load(std::memory_order_relaxed);
+    }
+
+    size_t Scheduler::liveTaskCount() const {
+        std::lock_guard lock(m_Mutex);
+        return m_Roots.size();
+    }
+
+    uint64_t Scheduler::frameIndex() const noexcept {
+        return m_FrameIndex.load(std::memory_order_relaxed);
+    }
+
+    Scheduler::Detached Scheduler::runDetached(Task<void> task) {
+        try {
+            co_await std::move(task);
+        } catch (const std::exception &e) {
+            spdlog::error("Unhandled exception in task: {}", e.what());
+        }
+    }
+
+    void Scheduler::forget(_In_ std::coroutine_handle<> handle) {
+        std::lock_guard lock(m_Mutex);
+        m_Roots.erase(handle.address());
+    }
+
+    Scheduler &scheduler() {
+        return *globalState->scheduler;
+    }
+}// namespace kat
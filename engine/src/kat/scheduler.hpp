@@ -0,0 +1,226 @@
+#pragma once
+
+#include "kat/core.hpp"
+#include "kat/io.hpp"
+#include "kat/jobs.hpp"
+#include "kat/task.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <mutex>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+namespace kat {
+
+    // Engine owned home for coroutines. Spawned tasks live here until they finish, and every awaitable below
+    // hands its coroutine back to the scheduler so it gets resumed on the main thread during tick(), which
+    // kat::pollMessages calls once per frame.
+    class Scheduler {
+      public:
+        KAT_TRACKED_CLASS(MemoryTag::CORE);
+
+        Scheduler() = default;
+        ~Scheduler();
+
+        Scheduler(const Scheduler &) = delete;
+        Scheduler &operator=(const Scheduler &) = delete;
+
+        // starts running the task immediately, on the calling thread, up to its first suspension.
+        void spawn(_In_ Task<void> &&task);
+
+        // main thread only.
+        void tick();
+
+        // thread safe. the handle is resumed on the main thread during the current (if it's still running) or next tick.
+        void post(_In_ std::coroutine_handle<> handle);
+
+        // thread safe. the handle is resumed during the next tick, never the current one.
+        void postNextFrame(_In_ std::coroutine_handle<> handle);
+
+        void waitForFence(_In_ vk::Device device, _In_ vk::Fence fence, _In_ std::coroutine_handle<> handle);
+        void waitForSemaphore(_In_ vk::Device device, _In_ vk::Semaphore semaphore, _In_ uint64_t value, _In_ std::coroutine_handle<> handle);
+
+        // after this nothing is resumed any more. the remaining tasks are destroyed with the scheduler.
+        void shutdown() noexcept;
+
+        [[nodiscard]] bool stopped() const noexcept;
+        [[nodiscard]] size_t liveTaskCount() const;
+        [[nodiscard]] uint64_t frameIndex() const noexcept;
+
+      private:
+        struct Detached {
+            struct promise_type {
+                Scheduler *scheduler;
+
+                promise_type(Scheduler &self, Task<void> &) noexcept : scheduler(&self) {}
+
+                Detached get_return_object() noexcept { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+                std::suspend_always initial_suspend() const noexcept { return {}; }
+
+                auto final_suspend() const noexcept {
+                    struct Forget {
+                        bool await_ready() const noexcept { return false; }
+                        void await_suspend(std::coroutine_handle<promise_type> h) const noexcept {
+                            h.promise().scheduler->forget(h);
+                            h.destroy();
+                        }
+                        void await_resume() const noexcept {}
+                    };
+                    return Forget{};
+                }
+
+                void return_void() const noexcept {}
+                void unhandled_exception() const noexcept {}
+            };
+
+            std::coroutine_handle<promise_type> handle;
+        };
+
+        struct GpuWait {
+            vk::Device device;
+            vk::Fence fence;
+            vk::Semaphore semaphore;
+            uint64_t value;
+            std::coroutine_handle<> handle;
+        };
+
+        std::atomic<bool> m_Stopped = false;
+        std::atomic<uint64_t> m_FrameIndex = 0;
+
+        mutable std::mutex m_Mutex;
+        std::unordered_set<void *> m_Roots;
+        std::vector<std::coroutine_handle<>> m_Ready;
+        std::vector<std::coroutine_handle<>> m_NextFrame;
+        std::vector<GpuWait> m_GpuWaits;
+
+        Detached runDetached(Task<void> task);
+        void forget(_In_ std::coroutine_handle<> handle);
+    };
+
+    [[nodiscard]] Scheduler &scheduler();
+
+    struct NextFrameAwaiter {
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) const { scheduler().postNextFrame(h); }
+        void await_resume() const noexcept {}
+    };
+
+    struct MainThreadAwaiter {
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) const { scheduler().post(h); }
+        void await_resume() const noexcept {}
+    };
+
+    struct JobThreadAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> h) const {
+            jobSystem().submit([h] {
+                if (!scheduler().stopped()) h.resume();
+            });
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    template<typename F>
+    struct JobAwaiter {
+        using result_type = std::invoke_result_t<F &>;
+
+        F fn;
+        std::conditional_t<std::is_void_v<result_type>, bool, std::optional<result_type>> result{};
+        std::exception_ptr exception;
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> h) {
+            jobSystem().submit([this, h] {
+                try {
+                    if constexpr (std::is_void_v<result_type>) {
+                        fn();
+                    } else {
+                        result.emplace(fn());
+                    }
+                } catch (...) {
+                    exception = std::current_exception();
+                }
+                scheduler().post(h);
+            });
+        }
+
+        result_type await_resume() {
+            if (exception) std::rethrow_exception(exception);
+            if constexpr (!std::is_void_v<result_type>) {
+                return std::move(*result);
+            }
+        }
+    };
+
+    struct ReadFileAwaiter {
+        IoReadRequest request;
+        IoResult result;
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> h) {
+            request.completionMode = IoCompletionMode::IO_THREAD;
+            request.onComplete = [this, h](IoResult &r) {
+                result = std::move(r);
+                scheduler().post(h);
+            };
+            ioScheduler().submit(std::move(request));
+        }
+
+        IoResult await_resume() { return std::move(result); }
+    };
+
+    struct FenceAwaiter {
+        vk::Device device;
+        vk::Fence fence;
+
+        bool await_ready() const { return device.getFenceStatus(fence) == vk::Result::eSuccess; }
+        void await_suspend(std::coroutine_handle<> h) const { scheduler().waitForFence(device, fence, h); }
+        void await_resume() const noexcept {}
+    };
+
+    struct SemaphoreAwaiter {
+        vk::Device device;
+        vk::Semaphore semaphore;
+        uint64_t value;
+
+        bool await_ready() const { return device.getSemaphoreCounterValue(semaphore) >= value; }
+        void await_suspend(std::coroutine_handle<> h) const { scheduler().waitForSemaphore(device, semaphore, value, h); }
+        void await_resume() const noexcept {}
+    };
+
+    // co_await nextFrame(): resume on the main thread next frame
+    [[nodiscard]] inline NextFrameAwaiter nextFrame() noexcept { return {}; }
+
+    // co_await switchToMainThread(): resume on the main thread, this frame if possible
+    [[nodiscard]] inline MainThreadAwaiter switchToMainThread() noexcept { return {}; }
+
+    // co_await switchToJobs(): continue running on a job worker
+    [[nodiscard]] inline JobThreadAwaiter switchToJobs() noexcept { return {}; }
+
+    // co_await runOnJobs(fn): run fn on a job worker, resume on the main thread with its result
+    template<typename F>
+    [[nodiscard]] JobAwaiter<std::decay_t<F>> runOnJobs(F &&fn) {
+        return JobAwaiter<std::decay_t<F>>{std::forward<F>(fn)};
+    }
+
+    // co_await readFileAsync(request): resume on the main thread with the read data. onComplete and completionMode are ignored.
+    [[nodiscard]] inline ReadFileAwaiter readFileAsync(_In_ IoReadRequest request) {
+        return ReadFileAwaiter{std::move(request)};
+    }
+
+    [[nodiscard]] inline FenceAwaiter waitForFence(_In_ vk::Device device, _In_ vk::Fence fence) {
+        return FenceAwaiter{device, fence};
+    }
+
+    // timeline semaphore wait, resumes once the counter reaches value
+    [[nodiscard]] inline SemaphoreAwaiter waitForSemaphore(_In_ vk::Device device, _In_ vk::Semaphore semaphore, _In_ uint64_t value) {
+        return SemaphoreAwaiter{device, semaphore, value};
+    }
+}// namespace kat
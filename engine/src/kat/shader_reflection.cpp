@@ -0,0 +1,477 @@
+#include "shader_reflection.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace kat {
+
+    namespace {
+        // the parts of the SPIR-V spec reflection needs, numbers from the unified spec
+        namespace spv {
+            constexpr uint32_t MAGIC = 0x07230203;
+            constexpr size_t HEADER_WORDS = 5;
+
+            enum Op : uint32_t {
+                OpEntryPoint = 15,
+                OpExecutionMode = 16,
+                OpTypeInt = 21,
+                OpTypeFloat = 22,
+                OpTypeVector = 23,
+                OpTypeMatrix = 24,
+                OpTypeImage = 25,
+                OpTypeSampler = 26,
+                OpTypeSampledImage = 27,
+                OpTypeArray = 28,
+                OpTypeRuntimeArray = 29,
+                OpTypeStruct = 30,
+                OpTypePointer = 32,
+                OpConstant = 43,
+                OpVariable = 59,
+                OpDecorate = 71,
+                OpMemberDecorate = 72,
+                OpTypeAccelerationStructureKHR = 5341,
+            };
+
+            enum Decoration : uint32_t {
+                Block = 2,
+                BufferBlock = 3,
+                ArrayStride = 6,
+                MatrixStride = 7,
+                BuiltIn = 11,
+                Location = 30,
+                Binding = 33,
+                DescriptorSet = 34,
+                Offset = 35,
+            };
+
+            enum StorageClass : uint32_t {
+                UniformConstant = 0,
+                Input = 1,
+                Uniform = 2,
+                PushConstant = 9,
+                StorageBuffer = 12,
+            };
+
+            enum Dim : uint32_t {
+                DimBuffer = 5,
+                DimSubpassData = 6,
+            };
+
+            constexpr uint32_t EXECUTION_MODE_LOCAL_SIZE = 17;
+        }// namespace spv
+
+        struct Type {
+            uint32_t op;
+            std::vector<uint32_t> operands; // everything after the result id
+        };
+
+        struct Decorations {
+            std::optional<uint32_t> set, binding, location, arrayStride;
+            bool builtIn = false;
+            bool block = false;
+            bool bufferBlock = false;
+        };
+
+        struct MemberDecorations {
+            uint32_t offset = 0;
+            uint32_t matrixStride = 0;
+        };
+
+        struct Variable {
+            uint32_t id;
+            uint32_t type; // a pointer
+            uint32_t storage;
+        };
+
+        struct Module {
+            std::unordered_map<uint32_t, Type> types;
+            std::unordered_map<uint32_t, uint32_t> constants;
+            std::unordered_map<uint32_t, Decorations> decorations;
+            std::unordered_map<uint32_t, std::vector<MemberDecorations>> members;
+            std::vector<Variable> variables;
+
+            const Type &type(uint32_t id) const {
+                auto it = types.find(id);
+                if (it == types.end()) throw std::runtime_error("SPIR-V references an unknown type");
+                return it->second;
+            }
+
+            const Decorations *decorationsOf(uint32_t id) const {
+                auto it = decorations.find(id);
+                return it == decorations.end() ? nullptr : &it->second;
+            }
+
+            uint32_t constant(uint32_t id) const {
+                auto it = constants.find(id);
+                if (it == constants.end()) throw std::runtime_error("SPIR-V array length is not a plain constant");
+                return it->second;
+            }
+
+            std::vector<uint32_t> memberOffsets(uint32_t structId) const {
+                const Type &t = type(structId);
+                auto it = members.find(structId);
+                std::vector<uint32_t> offsets(t.operands.size(), 0);
+                for (size_t i = 0; it != members.end() && i < offsets.size() && i < it->second.size(); i++) {
+                    offsets[i] = it->second[i].offset;
+                }
+                return offsets;
+            }
+
+            // the element stride of a block's trailing runtime array, 0 without one
+            uint32_t runtimeStride(uint32_t structId) const {
+                const Type &t = type(structId);
+                if (t.op != spv::OpTypeStruct || t.operands.empty()) return 0;
+
+                uint32_t last = t.operands.back();
+                if (type(last).op != spv::OpTypeRuntimeArray) return 0;
+                const Decorations *d = decorationsOf(last);
+                return d && d->arrayStride ? *d->arrayStride : 0;
+            }
+
+            // byte size under the explicit layout the offsets and strides describe
+            uint32_t sizeOf(uint32_t id, uint32_t matrixStride = 0) const {
+                const Type &t = type(id);
+                switch (t.op) {
+                    case spv::OpTypeInt:
+                    case spv::OpTypeFloat:
+                        return t.operands[0] / 8;
+                    case spv::OpTypeVector:
+                        return t.operands[1] * sizeOf(t.operands[0]);
+                    case spv::OpTypeMatrix:
+                        return t.operands[1] * (matrixStride ? matrixStride : sizeOf(t.operands[0]));
+                    case spv::OpTypeArray: {
+                        const Decorations *d = decorationsOf(id);
+                        uint32_t stride = d && d->arrayStride ? *d->arrayStride : sizeOf(t.operands[0], matrixStride);
+                        return constant(t.operands[1]) * stride;
+                    }
+                    case spv::OpTypeRuntimeArray:
+                        return 0;
+                    case spv::OpTypeStruct: {
+                        auto it = members.find(id);
+                        uint32_t size = 0;
+                        for (size_t i = 0; i < t.operands.size(); i++) {
+                            MemberDecorations m = it != members.end() && i < it->second.size() ? it->second[i] : MemberDecorations{};
+                            size = std::max(size, m.offset + sizeOf(t.operands[i], m.matrixStride));
+                        }
+                        return size;
+                    }
+                    default:
+                        throw std::runtime_error("SPIR-V type without a size");
+                }
+            }
+        };
+
+        std::string readString(std::span<const uint32_t> words, size_t *wordCount) {
+            std::string s;
+            for (size_t i = 0; i < words.size(); i++) {
+                for (int b = 0; b < 4; b++) {
+                    char c = static_cast<char>((words[i] >> (b * 8)) & 0xFF);
+                    if (c == '\0') {
+                        *wordCount = i + 1;
+                        return s;
+                    }
+                    s.push_back(c);
+                }
+            }
+            throw std::runtime_error("Unterminated SPIR-V string");
+        }
+
+        // operand words (after the opcode word) reflect reads from each instruction it looks at, so a short
+        // instruction throws instead of reading past it into the next one
+        size_t minOperands(uint32_t op) {
+            switch (op) {
+                case spv::OpTypeSampler:
+                case spv::OpTypeStruct:
+                case spv::OpTypeAccelerationStructureKHR: return 1;
+                case spv::OpExecutionMode:
+                case spv::OpTypeFloat:
+                case spv::OpTypeSampledImage:
+                case spv::OpTypeRuntimeArray:
+                case spv::OpDecorate: return 2;
+                case spv::OpEntryPoint:
+                case spv::OpTypeInt:
+                case spv::OpTypeVector:
+                case spv::OpTypeMatrix:
+                case spv::OpTypeArray:
+                case spv::OpTypePointer:
+                case spv::OpConstant:
+                case spv::OpVariable:
+                case spv::OpMemberDecorate: return 3;
+                case spv::OpTypeImage: return 8;
+                default: return 0;
+            }
+        }
+
+        // literal operand words following the decorations reflect reads a value from
+        size_t decorationOperands(uint32_t decoration) {
+            switch (decoration) {
+                case spv::ArrayStride:
+                case spv::MatrixStride:
+                case spv::Location:
+                case spv::Binding:
+                case spv::DescriptorSet:
+                case spv::Offset: return 1;
+                default: return 0;
+            }
+        }
+
+        vk::ShaderStageFlagBits stageOf(uint32_t executionModel) {
+            switch (executionModel) {
+                case 0: return vk::ShaderStageFlagBits::eVertex;
+                case 1: return vk::ShaderStageFlagBits::eTessellationControl;
+                case 2: return vk::ShaderStageFlagBits::eTessellationEvaluation;
+                case 3: return vk::ShaderStageFlagBits::eGeometry;
+                case 4: return vk::ShaderStageFlagBits::eFragment;
+                case 5: return vk::ShaderStageFlagBits::eCompute;
+                default: throw std::runtime_error("Unsupported SPIR-V execution model");
+            }
+        }
+
+        vk::DescriptorType descriptorTypeOf(const Module &module, uint32_t storage, const Type &type, uint32_t typeId) {
+            if (storage == spv::StorageBuffer) return vk::DescriptorType::eStorageBuffer;
+            if (storage == spv::Uniform) {
+                const Decorations *d = module.decorationsOf(typeId);
+                return d && d->bufferBlock ? vk::DescriptorType::eStorageBuffer : vk::DescriptorType::eUniformBuffer;
+            }
+
+            switch (type.op) {
+                case spv::OpTypeSampler:
+                    return vk::DescriptorType::eSampler;
+                case spv::OpTypeSampledImage: {
+                    const Type &image = module.type(type.operands[0]);
+                    return image.operands[1] == spv::DimBuffer ? vk::DescriptorType::eUniformTexelBuffer : vk::DescriptorType::eCombinedImageSampler;
+                }
+                case spv::OpTypeImage: {
+                    uint32_t dim = type.operands[1];
+                    uint32_t sampled = type.operands[5];
+                    if (dim == spv::DimSubpassData) return vk::DescriptorType::eInputAttachment;
+                    if (dim == spv::DimBuffer) return sampled == 2 ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eUniformTexelBuffer;
+                    return sampled == 2 ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+                }
+                case spv::OpTypeAccelerationStructureKHR:
+                    return vk::DescriptorType::eAccelerationStructureKHR;
+                default:
+                    throw std::runtime_error("Unsupported SPIR-V descriptor type");
+            }
+        }
+
+        vk::Format vertexFormatOf(const Type &component, uint32_t count) {
+            constexpr vk::Format FLOATS[] = {vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat};
+            constexpr vk::Format INTS[] = {vk::Format::eR32Sint, vk::Format::eR32G32Sint, vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint};
+            constexpr vk::Format UINTS[] = {vk::Format::eR32Uint, vk::Format::eR32G32Uint, vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint};
+
+            if (count < 1 || count > 4 || component.operands[0] != 32) {
+                throw std::runtime_error("Unsupported SPIR-V vertex input type");
+            }
+            if (component.op == spv::OpTypeFloat) return FLOATS[count - 1];
+            return component.operands[1] ? INTS[count - 1] : UINTS[count - 1];
+        }
+    }// namespace
+
+    ShaderReflection ShaderReflection::reflect(_In_ std::span<const uint32_t> spirv) {
+        if (spirv.size() < spv::HEADER_WORDS || spirv[0] != spv::MAGIC) {
+            throw std::runtime_error("Not a SPIR-V module");
+        }
+
+        ShaderReflection reflection{};
+        Module module;
+        bool hasEntryPoint = false;
+        uint32_t entryId = 0;
+
+        for (size_t i = spv::HEADER_WORDS; i < spirv.size();) {
+            uint32_t op = spirv[i] & 0xFFFF;
+            uint32_t count = spirv[i] >> 16;
+            if (count == 0 || i + count > spirv.size()) {
+                throw std::runtime_error("Truncated SPIR-V instruction");
+            }
+            std::span<const uint32_t> words = spirv.subspan(i + 1, count - 1);
+            i += count;
+
+            if (words.size() < minOperands(op) || (op == spv::OpDecorate && words.size() < 2 + decorationOperands(words[1])) ||
+                (op == spv::OpMemberDecorate && words.size() < 3 + decorationOperands(words[2]))) {
+                throw std::runtime_error("Malformed SPIR-V instruction");
+            }
+
+            switch (op) {
+                case spv::OpEntryPoint:
+                    // several entry points per module aren't supported, the first one wins
+                    if (!hasEntryPoint) {
+                        hasEntryPoint = true;
+                        reflection.stage = stageOf(words[0]);
+                        entryId = words[1];
+                        size_t nameWords = 0;
+                        reflection.entryPoint = readString(words.subspan(2), &nameWords);
+                    }
+                    break;
+                case spv::OpExecutionMode:
+                    if (words[0] == entryId && words[1] == spv::EXECUTION_MODE_LOCAL_SIZE) {
+                        if (words.size() < 5) throw std::runtime_error("Malformed SPIR-V instruction");
+                        reflection.localSize = {words[2], words[3], words[4]};
+                    }
+                    break;
+                case spv::OpTypeInt:
+                case spv::OpTypeFloat:
+                case spv::OpTypeVector:
+                case spv::OpTypeMatrix:
+                case spv::OpTypeImage:
+                case spv::OpTypeSampler:
+                case spv::OpTypeSampledImage:
+                case spv::OpTypeArray:
+                case spv::OpTypeRuntimeArray:
+                case spv::OpTypeStruct:
+                case spv::OpTypePointer:
+                case spv::OpTypeAccelerationStructureKHR:
+                    module.types[words[0]] = Type{op, {words.begin() + 1, words.end()}};
+                    break;
+                case spv::OpConstant:
+                    module.constants[words[1]] = words[2];
+                    break;
+                case spv::OpVariable:
+                    module.variables.push_back(Variable{words[1], words[0], words[2]});
+                    break;
+                case spv::OpDecorate: {
+                    Decorations &d = module.decorations[words[0]];
+                    switch (words[1]) {
+                        case spv::Block: d.block = true; break;
+                        case spv::BufferBlock: d.bufferBlock = true; break;
+                        case spv::ArrayStride: d.arrayStride = words[2]; break;
+                        case spv::BuiltIn: d.builtIn = true; break;
+                        case spv::Location: d.location = words[2]; break;
+                        case spv::Binding: d.binding = words[2]; break;
+                        case spv::DescriptorSet: d.set = words[2]; break;
+                        default: break;
+                    }
+                    break;
+                }
+                case spv::OpMemberDecorate: {
+                    auto &members = module.members[words[0]];
+                    if (members.size() <= words[1]) members.resize(words[1] + 1);
+                    if (words[2] == spv::Offset) members[words[1]].offset = words[3];
+                    if (words[2] == spv::MatrixStride) members[words[1]].matrixStride = words[3];
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        if (!hasEntryPoint) {
+            throw std::runtime_error("SPIR-V module has no entry point");
+        }
+
+        uint32_t pushEnd = 0;
+        for (const Variable &variable : module.variables) {
+            const Type &pointer = module.type(variable.type);
+            uint32_t typeId = pointer.operands[1];
+            const Decorations *decorations = module.decorationsOf(variable.id);
+
+            switch (variable.storage) {
+                case spv::UniformConstant:
+                case spv::Uniform:
+                case spv::StorageBuffer: {
+                    if (!decorations || !decorations->set || !decorations->binding) break;
+
+                    // arrays of descriptors: multiply out the lengths and look at what's inside
+                    uint32_t descriptorCount = 1;
+                    const Type *type = &module.type(typeId);
+                    while (type->op == spv::OpTypeArray || type->op == spv::OpTypeRuntimeArray) {
+                        descriptorCount = type->op == spv::OpTypeArray ? descriptorCount * module.constant(type->operands[1]) : 0;
+                        typeId = type->operands[0];
+                        type = &module.type(typeId);
+                    }
+
+                    vk::DescriptorType descriptorType = descriptorTypeOf(module, variable.storage, *type, typeId);
+                    Binding binding{*decorations->set, *decorations->binding, descriptorType, descriptorCount, reflection.stage};
+                    if (type->op == spv::OpTypeStruct) {
+                        binding.memberOffsets = module.memberOffsets(typeId);
+                        binding.blockSize = module.sizeOf(typeId);
+                        binding.runtimeStride = module.runtimeStride(typeId);
+                    }
+                    reflection.bindings.push_back(std::move(binding));
+                    break;
+                }
+                case spv::PushConstant: {
+                    reflection.pushConstantMembers = module.memberOffsets(typeId);
+                    auto begin = std::min_element(reflection.pushConstantMembers.begin(), reflection.pushConstantMembers.end());
+                    reflection.pushConstantOffset = begin == reflection.pushConstantMembers.end() ? 0 : *begin;
+                    pushEnd = module.sizeOf(typeId);
+                    break;
+                }
+                case spv::Input: {
+                    if (reflection.stage != vk::ShaderStageFlagBits::eVertex) break;
+                    if (!decorations || decorations->builtIn || !decorations->location) break;
+
+                    const Type &type = module.type(typeId);
+                    uint32_t location = *decorations->location;
+                    if (type.op == spv::OpTypeInt || type.op == spv::OpTypeFloat) {
+                        reflection.vertexInputs.push_back(VertexInput{location, vertexFormatOf(type, 1), 4});
+                    } else if (type.op == spv::OpTypeVector) {
+                        const Type &component = module.type(type.operands[0]);
+                        reflection.vertexInputs.push_back(VertexInput{location, vertexFormatOf(component, type.operands[1]), 4 * type.operands[1]});
+                    } else if (type.op == spv::OpTypeMatrix) {
+                        // one location per column
+                        const Type &column = module.type(type.operands[0]);
+                        const Type &component = module.type(column.operands[0]);
+                        for (uint32_t c = 0; c < type.operands[1]; c++) {
+                            reflection.vertexInputs.push_back(VertexInput{location + c, vertexFormatOf(component, column.operands[1]), 4 * column.operands[1]});
+                        }
+                    } else {
+                        throw std::runtime_error("Unsupported SPIR-V vertex input type");
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        if (pushEnd > 0) {
+            reflection.pushConstantSize = pushEnd - reflection.pushConstantOffset;
+        }
+
+        std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const Binding &a, const Binding &b) {
+            return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+        });
+        std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(), [](const VertexInput &a, const VertexInput &b) {
+            return a.location < b.location;
+        });
+        return reflection;
+    }
+
+    std::vector<ShaderReflection::Binding> ShaderReflection::merge(_In_ std::span<const ShaderReflection> stages) {
+        std::vector<Binding> merged;
+        for (const ShaderReflection &stage : stages) {
+            for (const Binding &binding : stage.bindings) {
+                auto it = std::find_if(merged.begin(), merged.end(), [&](const Binding &b) {
+                    return b.set == binding.set && b.binding == binding.binding;
+                });
+                if (it == merged.end()) {
+                    merged.push_back(binding);
+                } else if (it->type != binding.type || it->count != binding.count) {
+                    throw std::runtime_error("Shader stages disagree about set " + std::to_string(binding.set) + " binding " + std::to_string(binding.binding));
+                } else {
+                    it->stages |= binding.stages;
+                }
+            }
+        }
+
+        std::sort(merged.begin(), merged.end(), [](const Binding &a, const Binding &b) {
+            return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+        });
+        return merged;
+    }
+
+    std::vector<vk::VertexInputAttributeDescription> ShaderReflection::packedAttributes(_In_ uint32_t binding, _Out_ uint32_t *stride) const {
+        std::vector<vk::VertexInputAttributeDescription> attributes;
+        attributes.reserve(vertexInputs.size());
+
+        uint32_t offset = 0;
+        for (const VertexInput &input : vertexInputs) {
+            attributes.push_back(vk::VertexInputAttributeDescription{input.location, binding, input.format, offset});
+            offset += input.size;
+        }
+        *stride = offset;
+        return attributes;
+    }
+}// namespace kat
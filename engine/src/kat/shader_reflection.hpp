@@ -0,0 +1,53 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <span>
+#include <string>
+#include <vector>
+
+namespace kat {
+
+    // What a SPIR-V module declares about its interface, read straight from the binary: entry point and stage,
+    // descriptor bindings, push constant range and vertex inputs. Enough to build layouts without restating
+    // them next to every shader.
+    struct ShaderReflection {
+        struct Binding {
+            uint32_t set;
+            uint32_t binding;
+            vk::DescriptorType type;
+            uint32_t count; // 0 for runtime sized arrays
+            vk::ShaderStageFlags stages;
+
+            // uniform and storage buffers only, for checking c++ structs against the shader (see gpu_layout.hpp)
+            std::vector<uint32_t> memberOffsets; // of the block's top level members
+            uint32_t blockSize = 0; // without the trailing runtime array, if any
+            uint32_t runtimeStride = 0; // of the trailing runtime array, 0 without one
+        };
+
+        struct VertexInput {
+            uint32_t location;
+            vk::Format format; // the 32 bit format matching the glsl type, override it for packed inputs
+            uint32_t size;
+        };
+
+        std::string entryPoint;
+        vk::ShaderStageFlagBits stage = vk::ShaderStageFlagBits::eVertex;
+        std::vector<Binding> bindings; // sorted by set, then binding
+        uint32_t pushConstantOffset = 0;
+        uint32_t pushConstantSize = 0; // 0 without a push constant block
+        std::vector<uint32_t> pushConstantMembers; // offsets of the block's members
+        std::vector<VertexInput> vertexInputs; // vertex shaders only, sorted by location
+        glm::uvec3 localSize{0}; // compute shaders only
+
+        // throws if the module is malformed or uses something reflection doesn't understand
+        [[nodiscard]] static ShaderReflection reflect(_In_ std::span<const uint32_t> spirv);
+
+        // bindings of every stage merged, stage flags or'ed together. throws if two stages disagree about a
+        // binding's type or count.
+        [[nodiscard]] static std::vector<Binding> merge(_In_ std::span<const ShaderReflection> stages);
+
+        // vertexInputs tightly packed, in location order, into one binding. stride receives the total size.
+        [[nodiscard]] std::vector<vk::VertexInputAttributeDescription> packedAttributes(_In_ uint32_t binding, _Out_ uint32_t *stride) const;
+    };
+}// namespace kat
@@ -0,0 +1,317 @@
+#include "snapshot.hpp"
+
+#include "kat/compression.hpp"
+#include "kat/scheduler.hpp"
+#include "kat/transform.hpp"
+
+#include <spdlog/spdlog.h>
+
+namespace kat {
+
+    namespace {
+        constexpr uint32_t SNAPSHOT_MAGIC = 0x504e534b; // "KSNP"
+        constexpr uint32_t NONE = ~0u;
+
+        static_assert(sizeof(entt::entity) == sizeof(uint32_t), "Snapshots store entities as 32 bit identifiers");
+
+        // uncompressed, in front of the compressed payload:
+        //   u32 entity count, entities
+        //   u32 column count, per column: u32 type id, u32 type version, u32 element size, u32 count, u64 byte count,
+        //                                 u32 entity indices[count], bytes
+        struct FileHeader {
+            uint32_t magic;
+            uint32_t version;
+        };
+
+        template<typename T>
+        void put(_Inout_ std::vector<std::byte> &out, _In_ const T &value) {
+            size_t at = out.size();
+            out.resize(at + sizeof(T));
+            std::memcpy(out.data() + at, &value, sizeof(T));
+        }
+
+        template<typename T>
+        void putArray(_Inout_ std::vector<std::byte> &out, _In_ std::span<const T> values) {
+            size_t at = out.size();
+            out.resize(at + values.size_bytes());
+            std::memcpy(out.data() + at, values.data(), values.size_bytes());
+        }
+
+        struct Reader {
+            std::span<const std::byte> data;
+            size_t at = 0;
+
+            std::span<const std::byte> bytes(_In_ uint64_t size) {
+                if (size > data.size() - at) throw std::runtime_error("Truncated snapshot");
+                std::span<const std::byte> result = data.subspan(at, static_cast<size_t>(size));
+                at += static_cast<size_t>(size);
+                return result;
+            }
+
+            template<typename T>
+            T get() {
+                T value;
+                std::memcpy(&value, bytes(sizeof(T)).data(), sizeof(T));
+                return value;
+            }
+
+            template<typename T>
+            std::vector<T> array(_In_ uint64_t count) {
+                if (count > (data.size() - at) / sizeof(T)) throw std::runtime_error("Truncated snapshot");
+                std::vector<T> values(static_cast<size_t>(count));
+                std::memcpy(values.data(), bytes(count * sizeof(T)).data(), values.size() * sizeof(T));
+                return values;
+            }
+        };
+
+        // plain synchronous io, Snapshot::load runs on a job worker that needs the whole file before it can decode.
+        // shared for deleting like IoScheduler's reads, so a save can replace the file while it's being loaded.
+        std::vector<std::byte> readFile(_In_ const std::wstring &path) {
+            HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file == INVALID_HANDLE_VALUE) {
+                throw std::runtime_error("Failed to open snapshot for reading");
+            }
+
+            LARGE_INTEGER size{};
+            if (!GetFileSizeEx(file, &size)) {
+                CloseHandle(file);
+                throw std::runtime_error("Failed to read snapshot");
+            }
+
+            std::vector<std::byte> data(static_cast<size_t>(size.QuadPart));
+            size_t read = 0;
+            while (read < data.size()) {
+                DWORD chunk = static_cast<DWORD>(std::min<size_t>(data.size() - read, 1u << 30));
+                DWORD done = 0;
+                if (!ReadFile(file, data.data() + read, chunk, &done, nullptr) || done == 0) {
+                    CloseHandle(file);
+                    throw std::runtime_error("Failed to read snapshot");
+                }
+                read += done;
+            }
+            CloseHandle(file);
+            return data;
+        }
+
+        // into a temporary next to path first, so a failed or interrupted save leaves the old file alone
+        void writeFile(_In_ const std::wstring &path, _In_ std::span<const std::byte> data) {
+            std::wstring temporary = path + L".tmp";
+            HANDLE file = CreateFileW(temporary.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file == INVALID_HANDLE_VALUE) {
+                throw std::runtime_error("Failed to open snapshot for writing");
+            }
+
+            size_t written = 0;
+            while (written < data.size()) {
+                DWORD chunk = static_cast<DWORD>(std::min<size_t>(data.size() - written, 1u << 30));
+                DWORD done = 0;
+                if (!WriteFile(file, data.data() + written, chunk, &done, nullptr)) {
+                    CloseHandle(file);
+                    DeleteFileW(temporary.c_str());
+                    throw std::runtime_error("Failed to write snapshot");
+                }
+                written += done;
+            }
+            CloseHandle(file);
+
+            if (!MoveFileExW(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+                DeleteFileW(temporary.c_str());
+                throw std::runtime_error("Failed to replace snapshot");
+            }
+        }
+    }// namespace
+
+    entt::entity SnapshotEntityMap::operator()(_In_ entt::entity saved) const noexcept {
+        auto slot = static_cast<size_t>(entt::to_entity(saved));
+        if (slot >= m_Index.size() || m_Index[slot] == NONE || m_Saved[m_Index[slot]] != saved) return entt::null;
+        return m_Restored[m_Index[slot]];
+    }
+
+    std::span<const entt::entity> SnapshotEntityMap::entities() const noexcept {
+        return m_Restored;
+    }
+
+    const SnapshotTypes::Type *SnapshotTypes::find(_In_ uint32_t id, _Out_ uint32_t &index) const noexcept {
+        for (uint32_t i = 0; i < m_Types.size(); i++) {
+            if (m_Types[i].id == id) {
+                index = i;
+                return &m_Types[i];
+            }
+        }
+        return nullptr;
+    }
+
+    SnapshotTypes engineSnapshotTypes() {
+        SnapshotTypes types;
+        types.add<Transform>("kat::Transform");
+        types.add<Parent>("kat::Parent", 0, [](Parent &parent, const SnapshotEntityMap &map) { parent.entity = map(parent.entity); });
+        return types;
+    }
+
+    Snapshot Snapshot::capture(_In_ entt::registry &registry, _In_ const SnapshotTypes &types) {
+        Snapshot snapshot;
+        snapshot.m_Types = &types;
+
+        std::vector<uint32_t> index; // entity slot -> position in m_Entities
+        for (uint32_t t = 0; t < types.m_Types.size(); t++) {
+            SnapshotTypes::Column column;
+            column.type = t;
+            std::span<const entt::entity> entities = types.m_Types[t].capture(registry, column.bytes);
+            if (entities.empty()) continue;
+
+            snapshot.m_ByteSize += column.bytes.size();
+            column.entities.resize(entities.size());
+            for (size_t i = 0; i < entities.size(); i++) {
+                auto slot = static_cast<size_t>(entt::to_entity(entities[i]));
+                if (slot >= index.size()) index.resize(slot + 1, NONE);
+                if (index[slot] == NONE) {
+                    index[slot] = static_cast<uint32_t>(snapshot.m_Entities.size());
+                    snapshot.m_Entities.push_back(entities[i]);
+                }
+                column.entities[i] = index[slot];
+            }
+            snapshot.m_Columns.push_back(std::move(column));
+        }
+        snapshot.m_ByteSize += snapshot.m_Entities.size() * sizeof(entt::entity);
+        return snapshot;
+    }
+
+    std::vector<std::byte> Snapshot::encode() const {
+        size_t size = 2 * sizeof(uint32_t) + m_Entities.size() * sizeof(uint32_t);
+        for (const SnapshotTypes::Column &column : m_Columns) {
+            size += 4 * sizeof(uint32_t) + sizeof(uint64_t) + column.entities.size() * sizeof(uint32_t) + column.bytes.size();
+        }
+
+        std::vector<std::byte> payload;
+        payload.reserve(size);
+        put(payload, static_cast<uint32_t>(m_Entities.size()));
+        putArray<entt::entity>(payload, m_Entities);
+        put(payload, static_cast<uint32_t>(m_Columns.size()));
+        for (const SnapshotTypes::Column &column : m_Columns) {
+            const SnapshotTypes::Type &type = m_Types->m_Types[column.type];
+            put(payload, type.id);
+            put(payload, type.version);
+            put(payload, type.elementSize);
+            put(payload, static_cast<uint32_t>(column.entities.size()));
+            put(payload, static_cast<uint64_t>(column.bytes.size()));
+            putArray<uint32_t>(payload, column.entities);
+            putArray<std::byte>(payload, column.bytes);
+        }
+
+        std::vector<std::byte> file;
+        put(file, FileHeader{SNAPSHOT_MAGIC, SNAPSHOT_VERSION});
+        std::vector<std::byte> compressed = compress(payload);
+        file.insert(file.end(), compressed.begin(), compressed.end());
+        return file;
+    }
+
+    Snapshot Snapshot::decode(_In_ std::span<const std::byte> file, _In_ const SnapshotTypes &types) {
+        Reader header{file};
+        auto fileHeader = header.get<FileHeader>();
+        if (fileHeader.magic != SNAPSHOT_MAGIC) {
+            throw std::runtime_error("Not a snapshot");
+        }
+        if (fileHeader.version != SNAPSHOT_VERSION) {
+            throw std::runtime_error("Snapshot version " + std::to_string(fileHeader.version) + " can't be read, expected " + std::to_string(SNAPSHOT_VERSION));
+        }
+
+        std::vector<std::byte> payload = decompress(file.subspan(header.at));
+        Reader in{payload};
+
+        Snapshot snapshot;
+        snapshot.m_Types = &types;
+        snapshot.m_Entities = in.array<entt::entity>(in.get<uint32_t>());
+        const size_t entityCount = snapshot.m_Entities.size();
+        snapshot.m_ByteSize = entityCount * sizeof(entt::entity);
+
+        std::vector<uint32_t> seen(entityCount, NONE); // last column an entity appeared in, duplicates would break insert
+        const auto columnCount = in.get<uint32_t>();
+        for (uint32_t c = 0; c < columnCount; c++) {
+            const auto id = in.get<uint32_t>();
+            const auto version = in.get<uint32_t>();
+            const auto elementSize = in.get<uint32_t>();
+            const auto count = in.get<uint32_t>();
+            const auto byteCount = in.get<uint64_t>();
+
+            SnapshotTypes::Column column;
+            const SnapshotTypes::Type *type = types.find(id, column.type);
+            if (type == nullptr) {
+                spdlog::warn("Skipping {} components of an unregistered type ({:#010x}) in a snapshot", count, id);
+                in.bytes(uint64_t{count} * sizeof(uint32_t));
+                in.bytes(byteCount);
+                continue;
+            }
+            if (version != type->version) {
+                throw std::runtime_error("Snapshot has version " + std::to_string(version) + " of " + type->name + ", expected " + std::to_string(type->version));
+            }
+            if (elementSize != type->elementSize) {
+                throw std::runtime_error("Snapshot has " + type->name + " with a different size or encoding");
+            }
+
+            column.entities = in.array<uint32_t>(count);
+            for (uint32_t entity : column.entities) {
+                if (entity >= entityCount || seen[entity] == c) throw std::runtime_error("Malformed snapshot");
+                seen[entity] = c;
+            }
+            std::span<const std::byte> bytes = in.bytes(byteCount);
+            column.bytes.assign(bytes.begin(), bytes.end());
+            snapshot.m_ByteSize += bytes.size();
+
+            type->stage(column);
+            column.bytes = {};
+            snapshot.m_Columns.push_back(std::move(column));
+        }
+        return snapshot;
+    }
+
+    Snapshot Snapshot::load(_In_ const std::wstring &path, _In_ const SnapshotTypes &types) {
+        return decode(readFile(path), types);
+    }
+
+    SnapshotEntityMap Snapshot::merge(_In_ entt::registry &registry) {
+        if (m_Types == nullptr) {
+            throw std::runtime_error("Snapshot was already merged");
+        }
+
+        SnapshotEntityMap map;
+        map.m_Saved = std::move(m_Entities);
+        map.m_Restored.resize(map.m_Saved.size());
+        registry.create(map.m_Restored.begin(), map.m_Restored.end());
+        for (size_t i = 0; i < map.m_Saved.size(); i++) {
+            auto slot = static_cast<size_t>(entt::to_entity(map.m_Saved[i]));
+            if (slot >= map.m_Index.size()) map.m_Index.resize(slot + 1, NONE);
+            map.m_Index[slot] = static_cast<uint32_t>(i);
+        }
+
+        std::vector<entt::entity> entities;
+        for (SnapshotTypes::Column &column : m_Columns) {
+            entities.resize(column.entities.size());
+            for (size_t i = 0; i < entities.size(); i++) {
+                entities[i] = map.m_Restored[column.entities[i]];
+            }
+            m_Types->m_Types[column.type].merge(registry, column, entities, map);
+        }
+
+        m_Columns.clear();
+        m_Types = nullptr;
+        return map;
+    }
+
+    size_t Snapshot::entityCount() const noexcept {
+        return m_Entities.size();
+    }
+
+    size_t Snapshot::byteSize() const noexcept {
+        return m_ByteSize;
+    }
+
+    Task<void> saveSnapshot(_In_ entt::registry &registry, _In_ const SnapshotTypes &types, _In_ std::wstring path) {
+        Snapshot snapshot = Snapshot::capture(registry, types);
+        co_await runOnJobs([&snapshot, &path] { writeFile(path, snapshot.encode()); });
+    }
+
+    Task<SnapshotEntityMap> loadSnapshot(_In_ entt::registry &registry, _In_ const SnapshotTypes &types, _In_ std::wstring path) {
+        Snapshot snapshot = co_await runOnJobs([&types, &path] { return Snapshot::load(path, types); });
+        co_return snapshot.merge(registry);
+    }
+}// namespace kat
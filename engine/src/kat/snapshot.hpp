@@ -0,0 +1,239 @@
+#pragma once
+
+#include "kat/core.hpp"
+#include "kat/task.hpp"
+
+#include <algorithm>
+#include <any>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace kat {
+
+    // bumped whenever the file layout changes. component layouts are versioned separately, per type.
+    inline constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+    // Saved entity -> the entity it was restored as
+    class SnapshotEntityMap {
+      public:
+        // entt::null for entities that weren't in the snapshot
+        [[nodiscard]] entt::entity operator()(_In_ entt::entity saved) const noexcept;
+
+        // restored entities, in the order the snapshot stored them
+        [[nodiscard]] std::span<const entt::entity> entities() const noexcept;
+
+      private:
+        std::vector<entt::entity> m_Saved;
+        std::vector<entt::entity> m_Restored;
+        std::vector<uint32_t> m_Index; // entity slot of a saved entity -> position in the arrays above
+
+        friend class Snapshot;
+    };
+
+    template<typename T>
+    using FNSNAPSHOTREMAP = void(T &component, const SnapshotEntityMap &map);
+
+    template<typename T>
+    using FNSNAPSHOTSAVE = void(const T &component, std::vector<std::byte> &out);
+
+    // reads one component from the bytes save wrote for it
+    template<typename T>
+    using FNSNAPSHOTLOAD = T(std::span<const std::byte> bytes);
+
+    // The component types a snapshot carries. Types are identified in the file by name, so the file doesn't
+    // depend on the order things were registered in or on compiler type ids. version is the type's own
+    // layout version: a snapshot with a different one is refused rather than misread.
+    //
+    // Trivially copyable types are saved as their bytes, a whole pool at a time. Anything else needs save and
+    // load functions, called per component. Components holding entities need remap, which runs on restore
+    // with the saved -> restored mapping.
+    class SnapshotTypes {
+      public:
+        template<typename T>
+        SnapshotTypes &add(_In_ std::string_view name, _In_ uint32_t version = 0, _In_ FNSNAPSHOTREMAP<T> *remap = nullptr) {
+            static_assert(std::is_trivially_copyable_v<T>, "Components that aren't trivially copyable need save and load functions");
+            m_Types.push_back(bulkType<T>(name, version, remap));
+            return *this;
+        }
+
+        template<typename T>
+        SnapshotTypes &add(_In_ std::string_view name, _In_ uint32_t version, _In_ std::function<FNSNAPSHOTSAVE<T>> save,
+                           _In_ std::function<FNSNAPSHOTLOAD<T>> load, _In_ FNSNAPSHOTREMAP<T> *remap = nullptr) {
+            m_Types.push_back(customType<T>(name, version, std::move(save), std::move(load), remap));
+            return *this;
+        }
+
+      private:
+        // one pool's worth of components, as stored in the file
+        struct Column {
+            uint32_t type = 0; // index into m_Types
+            std::vector<uint32_t> entities; // indices into the snapshot's entity table
+            std::vector<std::byte> bytes;
+            std::any staged; // std::vector<T> decoded from bytes, ready to insert
+        };
+
+        struct Type {
+            std::string name;
+            uint32_t id;
+            uint32_t version;
+            uint32_t elementSize; // 0 when saved per component by a save function
+
+            // main thread: appends the pool's components to bytes, returns the entities they belong to in order
+            std::function<std::span<const entt::entity>(entt::registry &registry, std::vector<std::byte> &bytes)> capture;
+            // any thread: bytes -> staged
+            std::function<void(Column &column)> stage;
+            // main thread: inserts staged for the restored entities
+            std::function<void(entt::registry &registry, Column &column, std::span<const entt::entity> entities, const SnapshotEntityMap &map)> merge;
+        };
+
+        std::vector<Type> m_Types;
+
+        [[nodiscard]] const Type *find(_In_ uint32_t id, _Out_ uint32_t &index) const noexcept;
+
+        template<typename T>
+        static void insert(_In_ entt::registry &registry, _Inout_ Column &column, _In_ std::span<const entt::entity> entities, _In_ const SnapshotEntityMap &map,
+                           _In_ FNSNAPSHOTREMAP<T> *remap) {
+            auto &storage = registry.storage<T>();
+            storage.reserve(storage.size() + entities.size());
+            if constexpr (std::is_empty_v<T>) {
+                registry.insert<T>(entities.begin(), entities.end());
+            } else {
+                auto &values = std::any_cast<std::vector<T> &>(column.staged);
+                if (remap) {
+                    for (T &value : values) {
+                        remap(value, map);
+                    }
+                }
+                registry.insert<T>(entities.begin(), entities.end(), values.begin());
+            }
+            column.staged.reset();
+        }
+
+        template<typename T>
+        static Type bulkType(_In_ std::string_view name, _In_ uint32_t version, _In_ FNSNAPSHOTREMAP<T> *remap) {
+            constexpr uint32_t elementSize = std::is_empty_v<T> ? 1 : sizeof(T); // empty types save no bytes, 1 just marks them bulk
+
+            Type type{std::string(name), entt::hashed_string::value(name.data(), name.size()), version, elementSize};
+            type.capture = [](entt::registry &registry, std::vector<std::byte> &bytes) -> std::span<const entt::entity> {
+                auto &storage = registry.storage<T>();
+                if constexpr (!std::is_empty_v<T>) {
+                    // the pool keeps its components in fixed size pages, in the same order as its entities
+                    constexpr size_t pageSize = entt::component_traits<T>::page_size;
+                    bytes.resize(storage.size() * sizeof(T));
+                    for (size_t first = 0; first < storage.size(); first += pageSize) {
+                        size_t count = std::min(pageSize, storage.size() - first);
+                        std::memcpy(bytes.data() + first * sizeof(T), storage.raw()[first / pageSize], count * sizeof(T));
+                    }
+                }
+                return {storage.data(), storage.size()};
+            };
+            type.stage = [](Column &column) {
+                if constexpr (std::is_empty_v<T>) {
+                    if (!column.bytes.empty()) throw std::runtime_error("Malformed component in snapshot");
+                } else {
+                    if (column.bytes.size() != column.entities.size() * sizeof(T)) throw std::runtime_error("Malformed component in snapshot");
+                    std::vector<T> values(column.entities.size());
+                    std::memcpy(values.data(), column.bytes.data(), values.size() * sizeof(T));
+                    column.staged = std::move(values);
+                }
+            };
+            type.merge = [remap](entt::registry &registry, Column &column, std::span<const entt::entity> entities, const SnapshotEntityMap &map) {
+                insert<T>(registry, column, entities, map, remap);
+            };
+            return type;
+        }
+
+        template<typename T>
+        static Type customType(_In_ std::string_view name, _In_ uint32_t version, _In_ std::function<FNSNAPSHOTSAVE<T>> save,
+                               _In_ std::function<FNSNAPSHOTLOAD<T>> load, _In_ FNSNAPSHOTREMAP<T> *remap) {
+            Type type{std::string(name), entt::hashed_string::value(name.data(), name.size()), version, 0};
+            type.capture = [save = std::move(save)](entt::registry &registry, std::vector<std::byte> &bytes) -> std::span<const entt::entity> {
+                auto &storage = registry.storage<T>();
+                const entt::entity *entities = storage.data();
+                for (size_t i = 0; i < storage.size(); i++) {
+                    // each component behind its size
+                    size_t at = bytes.size();
+                    bytes.resize(at + sizeof(uint32_t));
+                    save(storage.get(entities[i]), bytes);
+                    auto size = static_cast<uint32_t>(bytes.size() - at - sizeof(uint32_t));
+                    std::memcpy(bytes.data() + at, &size, sizeof(size));
+                }
+                return {storage.data(), storage.size()};
+            };
+            type.stage = [load = std::move(load)](Column &column) {
+                std::vector<T> values;
+                values.reserve(column.entities.size());
+                std::span<const std::byte> rest = column.bytes;
+                for (size_t i = 0; i < column.entities.size(); i++) {
+                    uint32_t size = 0;
+                    if (rest.size() >= sizeof(size)) std::memcpy(&size, rest.data(), sizeof(size));
+                    if (rest.size() < sizeof(size) + size_t{size}) throw std::runtime_error("Truncated component in snapshot");
+                    values.push_back(load(rest.subspan(sizeof(size), size)));
+                    rest = rest.subspan(sizeof(size) + size);
+                }
+                column.staged = std::move(values);
+            };
+            type.merge = [remap](entt::registry &registry, Column &column, std::span<const entt::entity> entities, const SnapshotEntityMap &map) {
+                insert<T>(registry, column, entities, map, remap);
+            };
+            return type;
+        }
+
+        friend class Snapshot;
+    };
+
+    // The engine's own components: Transform and Parent
+    [[nodiscard]] SnapshotTypes engineSnapshotTypes();
+
+    // The registered components of a registry, copied out of it.
+    //
+    //     file = Snapshot::capture(registry, types).encode();            // main thread, then any thread
+    //     Snapshot::decode(file, types).merge(registry);                 // any thread, then main thread
+    //
+    // or saveSnapshot/loadSnapshot below, which do the same from a coroutine with the slow parts on the job
+    // system. Only entities that have at least one registered component are saved.
+    class Snapshot {
+      public:
+        // main thread. types has to outlive the snapshot.
+        [[nodiscard]] static Snapshot capture(_In_ entt::registry &registry, _In_ const SnapshotTypes &types);
+
+        // any thread: the versioned file contents, compressed
+        [[nodiscard]] std::vector<std::byte> encode() const;
+
+        // any thread: parses and decompresses a file, and decodes the components so merge only has to insert
+        // them. throws on a malformed file, a different SNAPSHOT_VERSION or a component version mismatch;
+        // components of types that aren't registered are skipped.
+        [[nodiscard]] static Snapshot decode(_In_ std::span<const std::byte> file, _In_ const SnapshotTypes &types);
+
+        // any thread: reads the file synchronously and decodes it
+        [[nodiscard]] static Snapshot load(_In_ const std::wstring &path, _In_ const SnapshotTypes &types);
+
+        // main thread: creates the entities and their components in registry, each pool filled in one insert.
+        // a snapshot can be merged once.
+        SnapshotEntityMap merge(_In_ entt::registry &registry);
+
+        [[nodiscard]] size_t entityCount() const noexcept;
+        // entity and component bytes, roughly what the snapshot takes up once merged
+        [[nodiscard]] size_t byteSize() const noexcept;
+
+      private:
+        const SnapshotTypes *m_Types = nullptr;
+        std::vector<entt::entity> m_Entities; // as they were in the saved registry
+        std::vector<SnapshotTypes::Column> m_Columns;
+        size_t m_ByteSize = 0;
+    };
+
+    // captures on the thread that starts the task (the main thread), then encodes and writes the file on the
+    // job system. the file is replaced only once it's completely written.
+    Task<void> saveSnapshot(_In_ entt::registry &registry, _In_ const SnapshotTypes &types, _In_ std::wstring path);
+
+    // reads and decodes off the main thread, then merges into registry when the coroutine resumes on the main
+    // thread, between two frames
+    Task<SnapshotEntityMap> loadSnapshot(_In_ entt::registry &registry, _In_ const SnapshotTypes &types, _In_ std::wstring path);
+}// namespace kat
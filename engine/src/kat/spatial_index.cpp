@@ -0,0 +1,411 @@
+#include "spatial_index.hpp"
+
+#include "kat/prefab.hpp"
+#include "kat/transform.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace kat {
+
+    namespace {
+        struct Box {
+            glm::vec3 min, max;
+        };
+
+        float area(_In_ const glm::vec3 &min, _In_ const glm::vec3 &max) noexcept {
+            glm::vec3 d = max - min;
+            return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+        }
+
+        bool contains(_In_ const glm::vec3 &outerMin, _In_ const glm::vec3 &outerMax, _In_ const Box &inner) noexcept {
+            return glm::all(glm::lessThanEqual(outerMin, inner.min)) && glm::all(glm::lessThanEqual(inner.max, outerMax));
+        }
+
+        bool overlaps(_In_ const glm::vec3 &aMin, _In_ const glm::vec3 &aMax, _In_ const glm::vec3 &bMin, _In_ const glm::vec3 &bMax) noexcept {
+            return glm::all(glm::lessThanEqual(aMin, bMax)) && glm::all(glm::lessThanEqual(bMin, aMax));
+        }
+
+        bool overlapsSphere(_In_ const glm::vec3 &min, _In_ const glm::vec3 &max, _In_ const glm::vec3 &center, _In_ float radius) noexcept {
+            glm::vec3 d = glm::clamp(center, min, max) - center;
+            return glm::dot(d, d) <= radius * radius;
+        }
+
+        bool overlapsFrustum(_In_ const glm::vec3 &min, _In_ const glm::vec3 &max, _In_ const Frustum &frustum) noexcept {
+            glm::vec3 center = (min + max) * 0.5f;
+            glm::vec3 extent = (max - min) * 0.5f;
+            for (const glm::vec4 &p : frustum.planes) {
+                if (glm::dot(glm::vec3(p), center) + p.w < -glm::dot(glm::abs(glm::vec3(p)), extent)) return false;
+            }
+            return true;
+        }
+
+        // slab test, invDirection may hold infinities for axis-parallel rays
+        bool overlapsRay(_In_ const glm::vec3 &min, _In_ const glm::vec3 &max, _In_ const glm::vec3 &origin, _In_ const glm::vec3 &invDirection, _In_ float maxDistance) noexcept {
+            float tMin = 0.0f, tMax = maxDistance;
+            for (int k = 0; k < 3; k++) {
+                float t1 = (min[k] - origin[k]) * invDirection[k];
+                float t2 = (max[k] - origin[k]) * invDirection[k];
+                // 0 * inf is nan when the origin sits on a slab plane, min/max below drop it
+                tMin = std::max(tMin, std::min(t1, t2));
+                tMax = std::min(tMax, std::max(t1, t2));
+            }
+            return tMin <= tMax;
+        }
+
+        // world space bounds of an entity, false if it has nothing to index
+        bool worldBounds(_In_ const entt::registry &registry, _In_ entt::entity entity, _Out_ Box &out) {
+            const auto *world = registry.try_get<WorldTransform>(entity);
+            if (!world) return false;
+            const glm::mat4 &m = world->matrix;
+
+            if (const auto *box = registry.try_get<BoundingBox>(entity)) {
+                glm::vec3 center = m * glm::vec4((box->min + box->max) * 0.5f, 1.0f);
+                glm::vec3 half = (box->max - box->min) * 0.5f;
+                glm::vec3 extent = glm::abs(glm::vec3(m[0])) * half.x + glm::abs(glm::vec3(m[1])) * half.y + glm::abs(glm::vec3(m[2])) * half.z;
+                out = {center - extent, center + extent};
+                return true;
+            }
+
+            if (const auto *sphere = registry.try_get<BoundingSphere>(entity)) {
+                glm::vec3 center = m * glm::vec4(sphere->center, 1.0f);
+                float scale = std::sqrt(std::max({glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+                                                  glm::dot(glm::vec3(m[1]), glm::vec3(m[1])),
+                                                  glm::dot(glm::vec3(m[2]), glm::vec3(m[2]))}));
+                glm::vec3 extent{sphere->radius * scale};
+                out = {center - extent, center + extent};
+                return true;
+            }
+
+            return false;
+        }
+    }// namespace
+
+    SpatialIndex::SpatialIndex(_In_ entt::registry &registry, _In_ float margin) : m_Registry(registry), m_Margin(margin) {
+        m_Registry.on_construct<WorldTransform>().connect<&SpatialIndex::onChanged>(*this);
+        m_Registry.on_update<WorldTransform>().connect<&SpatialIndex::onChanged>(*this);
+        m_Registry.on_destroy<WorldTransform>().connect<&SpatialIndex::onChanged>(*this);
+        m_Registry.on_construct<BoundingBox>().connect<&SpatialIndex::onChanged>(*this);
+        m_Registry.on_update<BoundingBox>().connect<&SpatialIndex::onChanged>(*this);
+        m_Registry.on_destroy<BoundingBox>().connect<&SpatialIndex::onChanged>(*this);
+        m_Registry.on_construct<BoundingSphere>().connect<&SpatialIndex::onChanged>(*this);
+        m_Registry.on_update<BoundingSphere>().connect<&SpatialIndex::onChanged>(*this);
+        m_Registry.on_destroy<BoundingSphere>().connect<&SpatialIndex::onChanged>(*this);
+
+        // prefabs hand over a whole range at once
+        auto constructed = [this](std::span<const entt::entity> entities) { m_Pending.insert(m_Pending.end(), entities.begin(), entities.end()); };
+        bulkConstruction(m_Registry).connect<WorldTransform, &SpatialIndex::onChanged>(*this, constructed);
+        bulkConstruction(m_Registry).connect<BoundingBox, &SpatialIndex::onChanged>(*this, constructed);
+        bulkConstruction(m_Registry).connect<BoundingSphere, &SpatialIndex::onChanged>(*this, constructed);
+
+        // pick up whatever already exists
+        for (auto entity : m_Registry.view<WorldTransform>()) {
+            m_Pending.push_back(entity);
+        }
+    }
+
+    SpatialIndex::~SpatialIndex() {
+        m_Registry.on_construct<WorldTransform>().disconnect(this);
+        m_Registry.on_update<WorldTransform>().disconnect(this);
+        m_Registry.on_destroy<WorldTransform>().disconnect(this);
+        m_Registry.on_construct<BoundingBox>().disconnect(this);
+        m_Registry.on_update<BoundingBox>().disconnect(this);
+        m_Registry.on_destroy<BoundingBox>().disconnect(this);
+        m_Registry.on_construct<BoundingSphere>().disconnect(this);
+        m_Registry.on_update<BoundingSphere>().disconnect(this);
+        m_Registry.on_destroy<BoundingSphere>().disconnect(this);
+        bulkConstruction(m_Registry).disconnect(this);
+    }
+
+    void SpatialIndex::update() {
+        if (m_Pending.empty()) return;
+
+        std::unique_lock lock(m_Mutex);
+        for (entt::entity entity : m_Pending) {
+            // destroy signals fire before the component goes away, so the state is only looked at here
+            Box bounds;
+            if (!m_Registry.valid(entity) || !worldBounds(m_Registry, entity, bounds)) {
+                remove(entity);
+                continue;
+            }
+
+            int32_t leaf = leafOf(entity);
+            if (leaf != NONE && m_Nodes[leaf].entity != entity) {
+                // slot reused by a new entity before the old one's removal was processed
+                remove(m_Nodes[leaf].entity);
+                leaf = NONE;
+            }
+
+            if (leaf != NONE) {
+                Node &node = m_Nodes[leaf];
+                node.tightMin = bounds.min;
+                node.tightMax = bounds.max;
+                if (contains(node.min, node.max, bounds)) continue;
+
+                removeLeaf(leaf);
+            } else {
+                leaf = allocate();
+                m_Nodes[leaf].entity = entity;
+                m_Nodes[leaf].tightMin = bounds.min;
+                m_Nodes[leaf].tightMax = bounds.max;
+
+                auto slot = static_cast<size_t>(entt::to_entity(entity));
+                if (slot >= m_Leaves.size()) m_Leaves.resize(slot + 1, NONE);
+                m_Leaves[slot] = leaf;
+                m_LeafCount++;
+            }
+
+            m_Nodes[leaf].min = bounds.min - glm::vec3(m_Margin);
+            m_Nodes[leaf].max = bounds.max + glm::vec3(m_Margin);
+            insertLeaf(leaf);
+        }
+        m_Pending.clear();
+    }
+
+    void SpatialIndex::queryBox(_In_ const glm::vec3 &min, _In_ const glm::vec3 &max, _Inout_ std::vector<entt::entity> &out) const {
+        query([&](const glm::vec3 &a, const glm::vec3 &b) { return overlaps(a, b, min, max); },
+              [&](const glm::vec3 &a, const glm::vec3 &b) { return overlaps(a, b, min, max); }, out);
+    }
+
+    void SpatialIndex::querySphere(_In_ const glm::vec3 &center, _In_ float radius, _Inout_ std::vector<entt::entity> &out) const {
+        auto test = [&](const glm::vec3 &a, const glm::vec3 &b) { return overlapsSphere(a, b, center, radius); };
+        query(test, test, out);
+    }
+
+    void SpatialIndex::queryFrustum(_In_ const Frustum &frustum, _Inout_ std::vector<entt::entity> &out) const {
+        auto test = [&](const glm::vec3 &a, const glm::vec3 &b) { return overlapsFrustum(a, b, frustum); };
+        query(test, test, out);
+    }
+
+    void SpatialIndex::queryRay(_In_ const glm::vec3 &origin, _In_ const glm::vec3 &direction, _In_ float maxDistance, _Inout_ std::vector<entt::entity> &out) const {
+        glm::vec3 invDirection = 1.0f / direction;
+        auto test = [&](const glm::vec3 &a, const glm::vec3 &b) { return overlapsRay(a, b, origin, invDirection, maxDistance); };
+        query(test, test, out);
+    }
+
+    size_t SpatialIndex::size() const {
+        std::shared_lock lock(m_Mutex);
+        return m_LeafCount;
+    }
+
+    uint32_t SpatialIndex::height() const {
+        std::shared_lock lock(m_Mutex);
+        return m_Root == NONE ? 0 : static_cast<uint32_t>(m_Nodes[m_Root].height);
+    }
+
+    template<typename NodeTest, typename LeafTest>
+    void SpatialIndex::query(NodeTest &&overlapsNode, LeafTest &&overlapsLeaf, _Inout_ std::vector<entt::entity> &out) const {
+        std::shared_lock lock(m_Mutex);
+        if (m_Root == NONE) return;
+
+        // rotations keep the tree shallow enough for the inline stack, but nothing bounds the height of one
+        // built over many coincident boxes, so past it the stack moves to the heap
+        int32_t local[128];
+        std::vector<int32_t> spilled;
+        int32_t *stack = local;
+        size_t capacity = std::size(local);
+        size_t top = 0;
+        auto push = [&](int32_t index) {
+            if (top == capacity) {
+                spilled.resize(capacity * 2);
+                if (stack == local) std::copy(local, local + top, spilled.begin());
+                stack = spilled.data();
+                capacity = spilled.size();
+            }
+            stack[top++] = index;
+        };
+
+        push(m_Root);
+        while (top > 0) {
+            const Node &node = m_Nodes[stack[--top]];
+            if (!overlapsNode(node.min, node.max)) continue;
+
+            if (node.leaf()) {
+                if (overlapsLeaf(node.tightMin, node.tightMax)) out.push_back(node.entity);
+            } else {
+                push(node.child1);
+                push(node.child2);
+            }
+        }
+    }
+
+    int32_t SpatialIndex::allocate() {
+        if (m_FreeList == NONE) {
+            m_Nodes.emplace_back();
+            return static_cast<int32_t>(m_Nodes.size() - 1);
+        }
+
+        int32_t node = m_FreeList;
+        m_FreeList = m_Nodes[node].parent;
+        m_Nodes[node] = Node{};
+        return node;
+    }
+
+    void SpatialIndex::release(_In_ int32_t node) {
+        m_Nodes[node].parent = m_FreeList;
+        m_Nodes[node].height = -1;
+        m_FreeList = node;
+    }
+
+    void SpatialIndex::insertLeaf(_In_ int32_t leaf) {
+        if (m_Root == NONE) {
+            m_Root = leaf;
+            m_Nodes[leaf].parent = NONE;
+            return;
+        }
+
+        const glm::vec3 leafMin = m_Nodes[leaf].min, leafMax = m_Nodes[leaf].max;
+
+        // descend towards the sibling that adds the least surface area, counting the growth pushed onto ancestors
+        int32_t index = m_Root;
+        while (!m_Nodes[index].leaf()) {
+            const Node &node = m_Nodes[index];
+            float nodeArea = area(node.min, node.max);
+            float combinedArea = area(glm::min(node.min, leafMin), glm::max(node.max, leafMax));
+
+            float cost = 2.0f * combinedArea;
+            float inheritance = 2.0f * (combinedArea - nodeArea);
+
+            auto childCost = [&](int32_t child) {
+                const Node &c = m_Nodes[child];
+                float grown = area(glm::min(c.min, leafMin), glm::max(c.max, leafMax));
+                return (c.leaf() ? grown : grown - area(c.min, c.max)) + inheritance;
+            };
+            float cost1 = childCost(node.child1);
+            float cost2 = childCost(node.child2);
+
+            if (cost < cost1 && cost < cost2) break;
+            index = cost1 < cost2 ? node.child1 : node.child2;
+        }
+
+        int32_t sibling = index;
+        int32_t oldParent = m_Nodes[sibling].parent;
+        int32_t newParent = allocate();
+
+        Node &parent = m_Nodes[newParent];
+        parent.parent = oldParent;
+        parent.min = glm::min(m_Nodes[sibling].min, leafMin);
+        parent.max = glm::max(m_Nodes[sibling].max, leafMax);
+        parent.height = m_Nodes[sibling].height + 1;
+        parent.child1 = sibling;
+        parent.child2 = leaf;
+
+        if (oldParent != NONE) {
+            Node &old = m_Nodes[oldParent];
+            (old.child1 == sibling ? old.child1 : old.child2) = newParent;
+        } else {
+            m_Root = newParent;
+        }
+        m_Nodes[sibling].parent = newParent;
+        m_Nodes[leaf].parent = newParent;
+
+        refit(m_Nodes[leaf].parent);
+    }
+
+    void SpatialIndex::removeLeaf(_In_ int32_t leaf) {
+        if (leaf == m_Root) {
+            m_Root = NONE;
+            return;
+        }
+
+        int32_t parent = m_Nodes[leaf].parent;
+        int32_t grandParent = m_Nodes[parent].parent;
+        int32_t sibling = m_Nodes[parent].child1 == leaf ? m_Nodes[parent].child2 : m_Nodes[parent].child1;
+
+        m_Nodes[sibling].parent = grandParent;
+        release(parent);
+
+        if (grandParent == NONE) {
+            m_Root = sibling;
+            return;
+        }
+
+        Node &grand = m_Nodes[grandParent];
+        (grand.child1 == parent ? grand.child1 : grand.child2) = sibling;
+        refit(grandParent);
+    }
+
+    void SpatialIndex::refit(_In_ int32_t from) {
+        for (int32_t index = from; index != NONE; index = m_Nodes[index].parent) {
+            index = balance(index);
+
+            Node &node = m_Nodes[index];
+            const Node &a = m_Nodes[node.child1];
+            const Node &b = m_Nodes[node.child2];
+            node.height = 1 + std::max(a.height, b.height);
+            node.min = glm::min(a.min, b.min);
+            node.max = glm::max(a.max, b.max);
+        }
+    }
+
+    // single AVL style rotation when one child is more than one level taller than the other. returns the node
+    // now sitting where a was.
+    int32_t SpatialIndex::balance(_In_ int32_t iA) {
+        Node &A = m_Nodes[iA];
+        if (A.leaf() || A.height < 2) return iA;
+
+        int32_t iB = A.child1, iC = A.child2;
+        int32_t heightDiff = m_Nodes[iC].height - m_Nodes[iB].height;
+        if (heightDiff >= -1 && heightDiff <= 1) return iA;
+
+        // promote the taller child (up) over a; its shorter grandchild moves under a
+        int32_t iUp = heightDiff > 1 ? iC : iB;
+        int32_t iStay = heightDiff > 1 ? iB : iC;
+        Node &Up = m_Nodes[iUp];
+        int32_t iF = Up.child1, iG = Up.child2;
+
+        Up.child1 = iA;
+        Up.parent = A.parent;
+        A.parent = iUp;
+
+        if (Up.parent != NONE) {
+            Node &p = m_Nodes[Up.parent];
+            (p.child1 == iA ? p.child1 : p.child2) = iUp;
+        } else {
+            m_Root = iUp;
+        }
+
+        int32_t iTall = m_Nodes[iF].height > m_Nodes[iG].height ? iF : iG;
+        int32_t iShort = iTall == iF ? iG : iF;
+
+        Up.child2 = iTall;
+        if (heightDiff > 1) {
+            A.child2 = iShort;
+        } else {
+            A.child1 = iShort;
+        }
+        m_Nodes[iShort].parent = iA;
+
+        const Node &stay = m_Nodes[iStay];
+        const Node &shortNode = m_Nodes[iShort];
+        const Node &tall = m_Nodes[iTall];
+        A.min = glm::min(stay.min, shortNode.min);
+        A.max = glm::max(stay.max, shortNode.max);
+        A.height = 1 + std::max(stay.height, shortNode.height);
+        Up.min = glm::min(A.min, tall.min);
+        Up.max = glm::max(A.max, tall.max);
+        Up.height = 1 + std::max(A.height, tall.height);
+
+        return iUp;
+    }
+
+    void SpatialIndex::remove(_In_ entt::entity entity) {
+        int32_t leaf = leafOf(entity);
+        if (leaf == NONE || m_Nodes[leaf].entity != entity) return;
+
+        removeLeaf(leaf);
+        release(leaf);
+        m_Leaves[static_cast<size_t>(entt::to_entity(entity))] = NONE;
+        m_LeafCount--;
+    }
+
+    int32_t SpatialIndex::leafOf(_In_ entt::entity entity) const noexcept {
+        auto slot = static_cast<size_t>(entt::to_entity(entity));
+        return slot < m_Leaves.size() ? m_Leaves[slot] : NONE;
+    }
+
+    void SpatialIndex::onChanged(_In_ entt::registry &, _In_ entt::entity entity) {
+        m_Pending.push_back(entity);
+    }
+}// namespace kat
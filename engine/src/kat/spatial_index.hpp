@@ -0,0 +1,82 @@
+#pragma once
+
+#include "kat/core.hpp"
+#include "kat/culling.hpp"
+
+#include <shared_mutex>
+#include <vector>
+
+namespace kat {
+
+    // Dynamic AABB tree over every entity with a WorldTransform and a BoundingBox or BoundingSphere. It listens
+    // to the registry for changes to those components and only touches the entities that moved, instead of
+    // being rebuilt each frame. Leaves keep a box enlarged by a margin, so small movements don't change the tree.
+    //
+    // update() is main thread only, after the transform hierarchy has run. queries can be made from any number
+    // of threads at once, including while update() waits for them to finish.
+    class SpatialIndex {
+      public:
+        explicit SpatialIndex(_In_ entt::registry &registry, _In_ float margin = 0.1f);
+        ~SpatialIndex();
+
+        SpatialIndex(const SpatialIndex &) = delete;
+        SpatialIndex &operator=(const SpatialIndex &) = delete;
+
+        // applies everything that changed since the last call
+        void update();
+
+        // all query results are appended to out, in no particular order
+        void queryBox(_In_ const glm::vec3 &min, _In_ const glm::vec3 &max, _Inout_ std::vector<entt::entity> &out) const;
+        void querySphere(_In_ const glm::vec3 &center, _In_ float radius, _Inout_ std::vector<entt::entity> &out) const;
+        void queryFrustum(_In_ const Frustum &frustum, _Inout_ std::vector<entt::entity> &out) const;
+
+        // entities whose bounds the segment origin + t * direction, t in [0, maxDistance], passes through.
+        // direction doesn't need to be normalized, maxDistance is in units of its length.
+        void queryRay(_In_ const glm::vec3 &origin, _In_ const glm::vec3 &direction, _In_ float maxDistance, _Inout_ std::vector<entt::entity> &out) const;
+
+        [[nodiscard]] size_t size() const;
+        [[nodiscard]] uint32_t height() const;
+
+      private:
+        static constexpr int32_t NONE = -1;
+
+        struct Node {
+            glm::vec3 min, max;           // enlarged for leaves
+            glm::vec3 tightMin, tightMax; // leaves only
+            int32_t parent = NONE;        // next free node while on the free list
+            int32_t child1 = NONE, child2 = NONE;
+            int32_t height = 0; // -1 while free
+            entt::entity entity = entt::null;
+
+            [[nodiscard]] bool leaf() const noexcept { return child1 == NONE; }
+        };
+
+        entt::registry &m_Registry;
+        float m_Margin;
+
+        mutable std::shared_mutex m_Mutex;
+        std::vector<Node> m_Nodes;
+        int32_t m_Root = NONE;
+        int32_t m_FreeList = NONE;
+        size_t m_LeafCount = 0;
+        std::vector<int32_t> m_Leaves; // entity slot -> leaf node
+
+        std::vector<entt::entity> m_Pending; // main thread only, not covered by the mutex
+
+        int32_t allocate();
+        void release(_In_ int32_t node);
+
+        void insertLeaf(_In_ int32_t leaf);
+        void removeLeaf(_In_ int32_t leaf);
+        int32_t balance(_In_ int32_t a);
+        void refit(_In_ int32_t from);
+
+        void remove(_In_ entt::entity entity);
+        [[nodiscard]] int32_t leafOf(_In_ entt::entity entity) const noexcept;
+
+        template<typename NodeTest, typename LeafTest>
+        void query(NodeTest &&overlapsNode, LeafTest &&overlapsLeaf, _Inout_ std::vector<entt::entity> &out) const;
+
+        void onChanged(_In_ entt::registry &registry, _In_ entt::entity entity);
+    };
+}// namespace kat
@@ -0,0 +1,224 @@
+#include "sprite_batcher.hpp"
+
+#include "kat/gpu_sync.hpp"
+#include "kat/layout_cache.hpp"
+#include "kat/transform.hpp"
+
+#include <glm/gtc/packing.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace kat {
+
+    namespace {
+        constexpr uint32_t SPRITE_VERT_SPV[] =
+#include "kat/shaders/sprite.vert.spv.h"
+                ;
+
+        constexpr uint32_t SPRITE_FRAG_SPV[] =
+#include "kat/shaders/sprite.frag.spv.h"
+                ;
+
+        // flips floats so their bits sort like the values: negatives reversed below positives
+        uint32_t orderedBits(float value) {
+            auto bits = std::bit_cast<uint32_t>(value);
+            return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+        }
+    }// namespace
+
+    void SpriteBatchList::build(_In_ const entt::registry &registry) {
+        auto view = registry.view<const WorldTransform, const Sprite>();
+
+        m_Unsorted.clear();
+        m_Arrays.clear();
+        m_Keys.clear();
+        for (auto [entity, transform, sprite] : view.each()) {
+            const glm::mat4 &m = transform.matrix;
+            glm::vec2 axisX = glm::vec2(m[0]) * sprite.size.x;
+            glm::vec2 axisY = glm::vec2(m[1]) * sprite.size.y;
+            glm::vec2 origin = glm::vec2(m[3]) - axisX * sprite.pivot.x - axisY * sprite.pivot.y;
+            float z = m[3].z;
+
+            m_Unsorted.push_back(SpriteInstance{axisX, axisY, origin, z, glm::packUnorm4x8(sprite.color), sprite.uv, sprite.arrayLayer, {}});
+            m_Arrays.push_back(sprite.textureArray);
+            m_Keys.push_back(sortKey(sprite.layer, z, sprite.textureArray));
+        }
+
+        m_Order.resize(m_Keys.size());
+        for (uint32_t i = 0; i < m_Order.size(); i++) {
+            m_Order[i] = i;
+        }
+        m_Sorter.sort(m_Keys, m_Order);
+
+        // a batch runs until the texture array changes. the array is the least significant part of the key, so
+        // sprites sharing layer and z are grouped by array as well.
+        m_Instances.resize(m_Order.size());
+        m_Batches.clear();
+        for (uint32_t i = 0; i < m_Order.size(); i++) {
+            uint32_t source = m_Order[i];
+            m_Instances[i] = m_Unsorted[source];
+
+            uint32_t array = m_Arrays[source];
+            if (m_Batches.empty() || m_Batches.back().textureArray != array) {
+                m_Batches.push_back(SpriteBatch{array, i, 0});
+            }
+            m_Batches.back().instanceCount++;
+        }
+    }
+
+    std::span<const SpriteInstance> SpriteBatchList::instances() const noexcept {
+        return m_Instances;
+    }
+
+    std::span<const SpriteBatch> SpriteBatchList::batches() const noexcept {
+        return m_Batches;
+    }
+
+    uint64_t SpriteBatchList::sortKey(_In_ int16_t layer, _In_ float z, _In_ uint32_t textureArray) noexcept {
+        auto orderedLayer = static_cast<uint64_t>(static_cast<uint16_t>(layer) ^ 0x8000u); // signed to unsigned order
+        return orderedLayer << 48 | static_cast<uint64_t>(orderedBits(z)) << 16 | (textureArray & 0xFFFFu);
+    }
+
+    SpriteBatcher::SpriteBatcher(_In_ const SpriteBatcherSettings &settings) : m_Settings(settings) {
+        vk::Device device = globalState->device;
+
+        for (Buffer &buffer : m_Buffers) {
+            buffer = Buffer(m_Settings.maxSprites * sizeof(SpriteInstance), vk::BufferUsageFlagBits::eVertexBuffer,
+                            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+        }
+
+        std::array<ShaderReflection, 2> reflections = {ShaderReflection::reflect(SPRITE_VERT_SPV), ShaderReflection::reflect(SPRITE_FRAG_SPV)};
+        m_SetLayout = layoutCache().setLayouts(reflections)[0];
+        m_PipelineLayout = layoutCache().pipelineLayout(reflections);
+
+        vk::DescriptorPoolSize poolSize{vk::DescriptorType::eCombinedImageSampler, m_Settings.maxTextureArrays};
+        m_Pool = device.createDescriptorPool(vk::DescriptorPoolCreateInfo{{}, m_Settings.maxTextureArrays, poolSize});
+    }
+
+    SpriteBatcher::~SpriteBatcher() {
+        // frames in flight may still draw with them
+        deletionQueue().destroy(m_Pipeline);
+        deletionQueue().destroy(m_Pool); // the layouts belong to layoutCache()
+    }
+
+    uint32_t SpriteBatcher::addTextureArray(_In_ vk::ImageView view, _In_ vk::Sampler sampler) {
+        if (m_Sets.size() >= m_Settings.maxTextureArrays) {
+            throw std::runtime_error("Too many sprite texture arrays");
+        }
+
+        vk::DescriptorSet set = globalState->device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo{m_Pool, m_SetLayout})[0];
+        vk::DescriptorImageInfo image{sampler, view, vk::ImageLayout::eShaderReadOnlyOptimal};
+        globalState->device.updateDescriptorSets(vk::WriteDescriptorSet{set, 0, 0, vk::DescriptorType::eCombinedImageSampler, image}, {});
+
+        m_Sets.push_back(set);
+        return static_cast<uint32_t>(m_Sets.size() - 1);
+    }
+
+    void SpriteBatcher::setTarget(_In_ vk::RenderPass renderPass, _In_ uint32_t subpass, _In_ vk::SampleCountFlagBits samples) {
+        vk::Device device = globalState->device;
+        deletionQueue().destroy(m_Pipeline); // frames in flight may still use it
+
+        vk::ShaderModule vertex = createShaderModule(SPRITE_VERT_SPV);
+        vk::ShaderModule fragment = createShaderModule(SPRITE_FRAG_SPV);
+        std::array<vk::PipelineShaderStageCreateInfo, 2> stages = {
+                vk::PipelineShaderStageCreateInfo{{}, vk::ShaderStageFlagBits::eVertex, vertex, "main"},
+                vk::PipelineShaderStageCreateInfo{{}, vk::ShaderStageFlagBits::eFragment, fragment, "main"},
+        };
+
+        vk::VertexInputBindingDescription binding{0, sizeof(SpriteInstance), vk::VertexInputRate::eInstance};
+        std::array<vk::VertexInputAttributeDescription, 7> attributes = {
+                vk::VertexInputAttributeDescription{0, 0, vk::Format::eR32G32Sfloat, offsetof(SpriteInstance, axisX)},
+                vk::VertexInputAttributeDescription{1, 0, vk::Format::eR32G32Sfloat, offsetof(SpriteInstance, axisY)},
+                vk::VertexInputAttributeDescription{2, 0, vk::Format::eR32G32Sfloat, offsetof(SpriteInstance, origin)},
+                vk::VertexInputAttributeDescription{3, 0, vk::Format::eR32Sfloat, offsetof(SpriteInstance, z)},
+                vk::VertexInputAttributeDescription{4, 0, vk::Format::eR8G8B8A8Unorm, offsetof(SpriteInstance, color)},
+                vk::VertexInputAttributeDescription{5, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(SpriteInstance, uv)},
+                vk::VertexInputAttributeDescription{6, 0, vk::Format::eR32Uint, offsetof(SpriteInstance, arrayLayer)},
+        };
+        vk::PipelineVertexInputStateCreateInfo vertexInput{{}, binding, attributes};
+        vk::PipelineInputAssemblyStateCreateInfo inputAssembly{{}, vk::PrimitiveTopology::eTriangleStrip};
+        vk::PipelineViewportStateCreateInfo viewport{{}, 1, nullptr, 1, nullptr};
+
+        vk::PipelineRasterizationStateCreateInfo raster{};
+        raster.polygonMode = vk::PolygonMode::eFill;
+        raster.cullMode = vk::CullModeFlagBits::eNone;
+        raster.lineWidth = 1.0f;
+
+        vk::PipelineMultisampleStateCreateInfo multisample{{}, samples};
+        vk::PipelineDepthStencilStateCreateInfo depth{};
+
+        vk::PipelineColorBlendAttachmentState blend{};
+        blend.blendEnable = VK_TRUE;
+        blend.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+        blend.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+        blend.colorBlendOp = vk::BlendOp::eAdd;
+        blend.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+        blend.dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+        blend.alphaBlendOp = vk::BlendOp::eAdd;
+        blend.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+        vk::PipelineColorBlendStateCreateInfo colorBlend{{}, VK_FALSE, vk::LogicOp::eCopy, blend};
+
+        std::array<vk::DynamicState, 2> dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+        vk::PipelineDynamicStateCreateInfo dynamic{{}, dynamicStates};
+
+        vk::GraphicsPipelineCreateInfo gpci{};
+        gpci.setStages(stages);
+        gpci.pVertexInputState = &vertexInput;
+        gpci.pInputAssemblyState = &inputAssembly;
+        gpci.pViewportState = &viewport;
+        gpci.pRasterizationState = &raster;
+        gpci.pMultisampleState = &multisample;
+        gpci.pDepthStencilState = &depth;
+        gpci.pColorBlendState = &colorBlend;
+        gpci.pDynamicState = &dynamic;
+        gpci.layout = m_PipelineLayout;
+        gpci.renderPass = renderPass;
+        gpci.subpass = subpass;
+
+        auto pipeline = device.createGraphicsPipeline(nullptr, gpci);
+        device.destroyShaderModule(vertex);
+        device.destroyShaderModule(fragment);
+        if (pipeline.result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to create sprite pipeline");
+        }
+        m_Pipeline = pipeline.value;
+    }
+
+    void SpriteBatcher::prepare(_In_ const entt::registry &registry) {
+        m_List.build(registry);
+    }
+
+    void SpriteBatcher::draw(_In_ vk::CommandBuffer cmd, _In_ uint32_t frame, _In_ const glm::mat4 &viewProjection) {
+        std::span<const SpriteInstance> instances = m_List.instances();
+        bool dropped = instances.size() > m_Settings.maxSprites;
+        if (dropped && !m_Dropped) {
+            spdlog::warn("{} sprites but room for {}, dropping the rest", instances.size(), m_Settings.maxSprites);
+        }
+        m_Dropped = dropped;
+
+        const auto count = static_cast<uint32_t>(std::min<size_t>(instances.size(), m_Settings.maxSprites));
+        if (!m_Pipeline || count == 0) return;
+
+        Buffer &buffer = m_Buffers[frame % FRAMES_IN_FLIGHT];
+        std::memcpy(buffer.mapped(), instances.data(), count * sizeof(SpriteInstance));
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, m_Pipeline);
+        cmd.pushConstants<glm::mat4>(m_PipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, viewProjection);
+        cmd.bindVertexBuffers(0, buffer.handle(), vk::DeviceSize{0});
+
+        for (const SpriteBatch &batch : m_List.batches()) {
+            if (batch.firstInstance >= count) break;
+            if (batch.textureArray >= m_Sets.size()) continue; // not registered, nothing to sample
+
+            cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_PipelineLayout, 0, m_Sets[batch.textureArray], {});
+            cmd.draw(4, std::min(batch.instanceCount, count - batch.firstInstance), 0, batch.firstInstance);
+        }
+    }
+
+    const SpriteBatchList &SpriteBatcher::list() const noexcept {
+        return m_List;
+    }
+}// namespace kat
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "kat/core.hpp"
+#include "kat/gpu.hpp"
+#include "kat/radix_sort.hpp"
+
+#include <array>
+#include <vector>
+
+namespace kat {
+
+    // A textured quad in the xy plane of the entity's WorldTransform, for UI and 2D overlays. The image is a
+    // layer of a texture array registered with SpriteBatcher, so sprites only split batches when their arrays
+    // differ, never because their images do.
+    //
+    // Draw order: ascending layer, then ascending world z within a layer. Sprites at the same layer and z keep
+    // no particular order, which lets them group by array. Within a layer z wins over batching: sprites of
+    // different arrays alternating in z cost a draw each, so keep those in one array or on layers of their own.
+    struct Sprite {
+        uint32_t textureArray = 0; // from SpriteBatcher::addTextureArray
+        uint32_t arrayLayer = 0;
+        glm::vec4 uv{0.0f, 0.0f, 1.0f, 1.0f}; // min, max
+        glm::vec4 color{1.0f};
+        glm::vec2 size{1.0f};
+        glm::vec2 pivot{0.5f}; // the point of the quad at the transform's origin, 0 to 1
+        int16_t layer = 0;
+    };
+
+    // vertex input of shaders/sprite.vert, one per instance
+    struct SpriteInstance {
+        glm::vec2 axisX;
+        glm::vec2 axisY;
+        glm::vec2 origin; // corner at uv.min
+        float z;
+        uint32_t color; // rgba8
+        glm::vec4 uv;
+        uint32_t arrayLayer;
+        uint32_t padding[3];
+    };
+    static_assert(sizeof(SpriteInstance) == 64);
+
+    // consecutive instances sharing a texture array, one instanced draw
+    struct SpriteBatch {
+        uint32_t textureArray;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+    };
+
+    // The cpu half of the batcher, no vulkan involved: gathers sprites, sorts them and cuts the result into
+    // batches.
+    class SpriteBatchList {
+      public:
+        // main thread, reads Sprite and WorldTransform
+        void build(_In_ const entt::registry &registry);
+
+        [[nodiscard]] std::span<const SpriteInstance> instances() const noexcept;
+        [[nodiscard]] std::span<const SpriteBatch> batches() const noexcept;
+
+        // layer:16 | z:32 (order preserving float bits) | textureArray:16
+        [[nodiscard]] static uint64_t sortKey(_In_ int16_t layer, _In_ float z, _In_ uint32_t textureArray) noexcept;
+
+      private:
+        std::vector<SpriteInstance> m_Unsorted;
+        std::vector<uint32_t> m_Arrays;
+        std::vector<uint64_t> m_Keys;
+        std::vector<uint32_t> m_Order;
+        RadixSorter m_Sorter;
+
+        std::vector<SpriteInstance> m_Instances;
+        std::vector<SpriteBatch> m_Batches;
+    };
+
+    struct SpriteBatcherSettings {
+        uint32_t maxSprites = 1 << 16; // per frame, more are dropped
+        uint32_t maxTextureArrays = 64;
+    };
+
+    // Draws every Sprite from one per-frame instance buffer, one instanced draw per batch. Blended, no depth
+    // writes, meant to go last in a pass.
+    class SpriteBatcher {
+      public:
+        explicit SpriteBatcher(_In_ const SpriteBatcherSettings &settings = {});
+        ~SpriteBatcher();
+
+        SpriteBatcher(const SpriteBatcher &) = delete;
+        SpriteBatcher &operator=(const SpriteBatcher &) = delete;
+
+        // a 2D_ARRAY view in SHADER_READ_ONLY_OPTIMAL. it has to outlive the batcher.
+        uint32_t addTextureArray(_In_ vk::ImageView view, _In_ vk::Sampler sampler);
+
+        // (re)creates the pipeline for drawing into subpass of renderPass
+        void setTarget(_In_ vk::RenderPass renderPass, _In_ uint32_t subpass, _In_ vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1);
+
+        // gathers and sorts on the cpu, main thread
+        void prepare(_In_ const entt::registry &registry);
+
+        // inside the render pass given to setTarget, with viewport and scissor set. frame selects the instance
+        // buffer, the gpu has to be done with its previous use.
+        void draw(_In_ vk::CommandBuffer cmd, _In_ uint32_t frame, _In_ const glm::mat4 &viewProjection);
+
+        [[nodiscard]] const SpriteBatchList &list() const noexcept;
+
+      private:
+        SpriteBatcherSettings m_Settings;
+        SpriteBatchList m_List;
+
+        std::array<Buffer, FRAMES_IN_FLIGHT> m_Buffers;
+        vk::DescriptorSetLayout m_SetLayout;
+        vk::DescriptorPool m_Pool;
+        std::vector<vk::DescriptorSet> m_Sets; // per texture array
+        vk::PipelineLayout m_PipelineLayout;
+        vk::Pipeline m_Pipeline;
+        bool m_Dropped = false;
+    };
+}// namespace kat
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace kat {
+
+    template<typename T = void>
+    class Task;
+
+    namespace detail {
+        struct TaskPromiseBase {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr exception;
+
+            struct FinalAwaiter {
+                bool await_ready() const noexcept { return false; }
+
+                // symmetric transfer back into whoever awaited us, so long await chains don't grow the stack
+                template<typename P>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) const noexcept {
+                    std::coroutine_handle<> continuation = h.promise().continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept {}
+            };
+
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            FinalAwaiter final_suspend() const noexcept { return {}; }
+            void unhandled_exception() noexcept { exception = std::current_exception(); }
+        };
+
+        template<typename T>
+        struct TaskPromise : TaskPromiseBase {
+            std::optional<T> value;
+
+            Task<T> get_return_object() noexcept;
+
+            template<typename U>
+            void return_value(U &&v) { value.emplace(std::forward<U>(v)); }
+
+            T result() {
+                if (exception) std::rethrow_exception(exception);
+                return std::move(*value);
+            }
+        };
+
+        template<>
+        struct TaskPromise<void> : TaskPromiseBase {
+            Task<void> get_return_object() noexcept;
+
+            void return_void() const noexcept {}
+
+            void result() const {
+                if (exception) std::rethrow_exception(exception);
+            }
+        };
+    }// namespace detail
+
+    // Lazily started coroutine. Nothing runs until the task is co_awaited (or handed to Scheduler::spawn),
+    // and the awaiting coroutine is resumed on whichever thread the task finishes on.
+    template<typename T>
+    class [[nodiscard]] Task {
+      public:
+        using promise_type = detail::TaskPromise<T>;
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        Task() noexcept = default;
+        Task(Task &&other) noexcept : m_Handle(std::exchange(other.m_Handle, nullptr)) {}
+
+        Task &operator=(Task &&other) noexcept {
+            if (this != &other) {
+                if (m_Handle) m_Handle.destroy();
+                m_Handle = std::exchange(other.m_Handle, nullptr);
+            }
+            return *this;
+        }
+
+        ~Task() {
+            if (m_Handle) m_Handle.destroy();
+        }
+
+        [[nodiscard]] bool valid() const noexcept { return static_cast<bool>(m_Handle); }
+        [[nodiscard]] bool done() const noexcept { return !m_Handle || m_Handle.done(); }
+
+        auto operator co_await() && noexcept {
+            struct Awaiter {
+                handle_type handle;
+
+                bool await_ready() const noexcept { return !handle || handle.done(); }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                    handle.promise().continuation = awaiting;
+                    return handle;
+                }
+
+                T await_resume() { return handle.promise().result(); }
+            };
+            return Awaiter{m_Handle};
+        }
+
+      private:
+        handle_type m_Handle;
+
+        explicit Task(handle_type handle) noexcept : m_Handle(handle) {}
+
+        friend struct detail::TaskPromise<T>;
+    };
+
+    namespace detail {
+        template<typename T>
+        Task<T> TaskPromise<T>::get_return_object() noexcept {
+            return Task<T>{std::coroutine_handle<TaskPromise<T>>::from_promise(*this)};
+        }
+
+        inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+            return Task<void>{std::coroutine_handle<TaskPromise<void>>::from_promise(*this)};
+        }
+    }// namespace detail
+}// namespace kat
@@ -0,0 +1,123 @@
+#include "texture.hpp"
+
+#include <algorithm>
+
+namespace kat {
+
+    TextureFile::TextureFile(_In_ std::vector<std::byte> &&contents) : m_Contents(std::move(contents)), m_Charge(MemoryTag::ASSETS, m_Contents.capacity()) {
+        if (m_Contents.size() < sizeof(texture::Header)) {
+            throw std::runtime_error("Texture file is truncated");
+        }
+
+        m_Header = reinterpret_cast<const texture::Header *>(m_Contents.data());
+        if (m_Header->magic != texture::MAGIC) {
+            throw std::runtime_error("Not a cooked texture file");
+        }
+        if (m_Header->version != texture::VERSION) {
+            throw std::runtime_error("Unsupported texture file version");
+        }
+
+        const texture::FormatInfo format = texture::formatInfo(m_Header->format);
+        if (format.blockBytes == 0 || format.vkFormat != m_Header->vkFormat) {
+            throw std::runtime_error("Texture format is invalid");
+        }
+        // a 32 bit extent has at most 32 mip levels
+        if (m_Header->width == 0 || m_Header->height == 0 || m_Header->depth == 0 || m_Header->mipCount == 0 || m_Header->mipCount > 32 ||
+            m_Header->layerCount == 0) {
+            throw std::runtime_error("Texture extent is invalid");
+        }
+
+        // offsets and sizes come from the file, compare against what's left so a huge offset can't wrap around
+        const uint64_t size = m_Contents.size();
+        uint64_t regionBytes = uint64_t{m_Header->regionCount} * sizeof(texture::Region);
+        if (m_Header->regionOffset > size || regionBytes > size - m_Header->regionOffset || m_Header->dataOffset > size ||
+            m_Header->dataSize > size - m_Header->dataOffset || m_Header->regionOffset % alignof(texture::Region) != 0 ||
+            m_Header->dataOffset % texture::DATA_ALIGNMENT != 0) {
+            throw std::runtime_error("Texture file is truncated");
+        }
+
+        const auto *regions = reinterpret_cast<const texture::Region *>(m_Contents.data() + m_Header->regionOffset);
+        m_Regions = {regions, m_Header->regionCount};
+
+        for (const auto &region : m_Regions) {
+            if (region.bufferOffset > m_Header->dataSize || region.byteSize > m_Header->dataSize - region.bufferOffset ||
+                region.bufferOffset % texture::DATA_ALIGNMENT != 0) {
+                throw std::runtime_error("Texture region is out of bounds");
+            }
+
+            if (region.mipLevel >= m_Header->mipCount || region.layerCount == 0 || region.baseArrayLayer > m_Header->layerCount ||
+                region.layerCount > m_Header->layerCount - region.baseArrayLayer) {
+                throw std::runtime_error("Texture region is out of bounds");
+            }
+
+            const uint32_t mipWidth = std::max(m_Header->width >> region.mipLevel, 1u);
+            const uint32_t mipHeight = std::max(m_Header->height >> region.mipLevel, 1u);
+            const uint32_t mipDepth = std::max(m_Header->depth >> region.mipLevel, 1u);
+            if (region.width == 0 || region.height == 0 || region.depth == 0 || region.width > mipWidth || region.height > mipHeight ||
+                region.depth > mipDepth) {
+                throw std::runtime_error("Texture region is out of bounds");
+            }
+
+            // the texels the copy reads, with 0 row length and image height meaning tightly packed like in vulkan.
+            // every factor is compared against what's left of byteSize so the product can't wrap around either.
+            const uint32_t rowLength = region.bufferRowLength != 0 ? region.bufferRowLength : region.width;
+            const uint32_t imageHeight = region.bufferImageHeight != 0 ? region.bufferImageHeight : region.height;
+            if (rowLength < region.width || imageHeight < region.height) {
+                throw std::runtime_error("Texture region is out of bounds");
+            }
+
+            uint64_t bytes = (uint64_t{rowLength} + format.blockWidth - 1) / format.blockWidth * format.blockBytes;
+            for (uint64_t factor : {(uint64_t{imageHeight} + format.blockHeight - 1) / format.blockHeight, uint64_t{region.depth}, uint64_t{region.layerCount}}) {
+                if (bytes > region.byteSize / factor) {
+                    throw std::runtime_error("Texture region is out of bounds");
+                }
+                bytes *= factor;
+            }
+        }
+    }
+
+    const texture::Header &TextureFile::header() const noexcept {
+        return *m_Header;
+    }
+
+    std::span<const texture::Region> TextureFile::regions() const noexcept {
+        return m_Regions;
+    }
+
+    std::span<const std::byte> TextureFile::data() const noexcept {
+        return {m_Contents.data() + m_Header->dataOffset, m_Header->dataSize};
+    }
+
+    std::vector<vk::BufferImageCopy> TextureFile::copyRegions(_In_ vk::DeviceSize stagingOffset) const {
+        std::vector<vk::BufferImageCopy> copies;
+        copies.reserve(m_Regions.size());
+
+        for (const auto &region : m_Regions) {
+            vk::BufferImageCopy copy{};
+            copy.bufferOffset = stagingOffset + region.bufferOffset;
+            copy.bufferRowLength = region.bufferRowLength;
+            copy.bufferImageHeight = region.bufferImageHeight;
+            copy.imageSubresource = vk::ImageSubresourceLayers{vk::ImageAspectFlagBits::eColor, region.mipLevel, region.baseArrayLayer, region.layerCount};
+            copy.imageOffset = vk::Offset3D{0, 0, 0};
+            copy.imageExtent = vk::Extent3D{region.width, region.height, region.depth};
+            copies.push_back(copy);
+        }
+
+        return copies;
+    }
+
+    vk::ImageCreateInfo TextureFile::imageCreateInfo(_In_ vk::ImageUsageFlags usage) const {
+        vk::ImageCreateInfo ici{};
+        ici.imageType = m_Header->depth > 1 ? vk::ImageType::e3D : vk::ImageType::e2D;
+        ici.format = static_cast<vk::Format>(m_Header->vkFormat);
+        ici.extent = vk::Extent3D{m_Header->width, m_Header->height, m_Header->depth};
+        ici.mipLevels = m_Header->mipCount;
+        ici.arrayLayers = m_Header->layerCount;
+        ici.samples = vk::SampleCountFlagBits::e1;
+        ici.tiling = vk::ImageTiling::eOptimal;
+        ici.usage = usage | vk::ImageUsageFlagBits::eTransferDst;
+        ici.sharingMode = vk::SharingMode::eExclusive;
+        ici.initialLayout = vk::ImageLayout::eUndefined;
+        return ici;
+    }
+}// namespace kat
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "kat/core.hpp"
+#include "kat/texture_container.hpp"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace kat {
+
+    // A cooked .ktex file held in memory. Loading never touches the texel data: data() goes straight into a
+    // staging buffer and copyRegions() describes the upload.
+    class TextureFile {
+      public:
+        // throws if the file is malformed
+        explicit TextureFile(_In_ std::vector<std::byte> &&contents);
+
+        // the header and regions point into the contents, which move along with them but can't be shared
+        TextureFile(const TextureFile &) = delete;
+        TextureFile &operator=(const TextureFile &) = delete;
+        TextureFile(TextureFile &&) noexcept = default;
+        TextureFile &operator=(TextureFile &&) noexcept = default;
+
+        [[nodiscard]] const texture::Header &header() const noexcept;
+        [[nodiscard]] std::span<const texture::Region> regions() const noexcept;
+
+        // the texel data block, to be copied into staging memory unchanged
+        [[nodiscard]] std::span<const std::byte> data() const noexcept;
+
+        // stagingOffset is where data() was placed in the staging buffer. it has to be a multiple of
+        // texture::DATA_ALIGNMENT (and of optimalBufferCopyOffsetAlignment for best performance).
+        [[nodiscard]] std::vector<vk::BufferImageCopy> copyRegions(_In_ vk::DeviceSize stagingOffset) const;
+
+        [[nodiscard]] vk::ImageCreateInfo imageCreateInfo(_In_ vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled) const;
+
+      private:
+        std::vector<std::byte> m_Contents;
+        MemoryCharge m_Charge; // m_Contents, under MemoryTag::ASSETS
+        const texture::Header *m_Header;
+        std::span<const texture::Region> m_Regions;
+    };
+}// namespace kat
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+
+// On-disk layout of cooked textures (.ktex). Shared between the engine and tools/texcook, so this header must
+// stay free of platform and vulkan includes.
+//
+// File: [Header][Region * regionCount][padding][data]
+// Every region maps 1:1 onto a VkBufferImageCopy whose bufferOffset is relative to the start of the data
+// block, so a loader copies the data block into staging as-is and issues one vkCmdCopyBufferToImage.
+namespace kat::texture {
+
+    inline constexpr uint32_t MAGIC = 0x5845544B; // "KTEX"
+    inline constexpr uint32_t VERSION = 1;
+
+    // offsets of the data block and of every region inside it are multiples of this. it covers the 4 byte and
+    // texel block size rules of vkCmdCopyBufferToImage for every format below.
+    inline constexpr uint32_t DATA_ALIGNMENT = 16;
+
+    enum class Format : uint32_t {
+        RGBA8_UNORM = 0,
+        RGBA8_SRGB,
+        BC1_UNORM,
+        BC1_SRGB,
+        BC3_UNORM,
+        BC3_SRGB,
+        BC4_UNORM,
+        BC5_UNORM,
+        BC7_UNORM,
+        BC7_SRGB,
+    };
+
+    struct FormatInfo {
+        uint32_t vkFormat; // VkFormat value
+        uint32_t blockWidth;
+        uint32_t blockHeight;
+        uint32_t blockBytes;
+        bool srgb;
+    };
+
+    [[nodiscard]] constexpr FormatInfo formatInfo(Format format) noexcept {
+        switch (format) {
+            case Format::RGBA8_UNORM: return {37, 1, 1, 4, false}; // VK_FORMAT_R8G8B8A8_UNORM
+            case Format::RGBA8_SRGB: return {43, 1, 1, 4, true};   // VK_FORMAT_R8G8B8A8_SRGB
+            case Format::BC1_UNORM: return {133, 4, 4, 8, false};  // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+            case Format::BC1_SRGB: return {134, 4, 4, 8, true};    // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+            case Format::BC3_UNORM: return {137, 4, 4, 16, false}; // VK_FORMAT_BC3_UNORM_BLOCK
+            case Format::BC3_SRGB: return {138, 4, 4, 16, true};   // VK_FORMAT_BC3_SRGB_BLOCK
+            case Format::BC4_UNORM: return {139, 4, 4, 8, false};  // VK_FORMAT_BC4_UNORM_BLOCK
+            case Format::BC5_UNORM: return {141, 4, 4, 16, false}; // VK_FORMAT_BC5_UNORM_BLOCK
+            case Format::BC7_UNORM: return {145, 4, 4, 16, false}; // VK_FORMAT_BC7_UNORM_BLOCK
+            case Format::BC7_SRGB: return {146, 4, 4, 16, true};   // VK_FORMAT_BC7_SRGB_BLOCK
+        }
+        return {0, 1, 1, 0, false};
+    }
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        Format format;
+        uint32_t vkFormat;
+
+        uint32_t width;
+        uint32_t height;
+        uint32_t depth;
+        uint32_t mipCount;
+        uint32_t layerCount;
+        uint32_t regionCount;
+
+        uint64_t regionOffset; // from the start of the file
+        uint64_t dataOffset;   // from the start of the file
+        uint64_t dataSize;
+    };
+
+    // mirrors VkBufferImageCopy (color aspect, zero image offset)
+    struct Region {
+        uint64_t bufferOffset; // from the start of the data block
+        uint64_t byteSize;
+        uint32_t bufferRowLength;
+        uint32_t bufferImageHeight;
+        uint32_t mipLevel;
+        uint32_t baseArrayLayer;
+        uint32_t layerCount;
+        uint32_t width;
+        uint32_t height;
+        uint32_t depth;
+    };
+
+    static_assert(sizeof(Header) == 64);
+    static_assert(sizeof(Region) == 48);
+
+    [[nodiscard]] constexpr uint64_t alignUp(uint64_t value, uint64_t alignment) noexcept {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // bytes of one array layer of one mip level
+    [[nodiscard]] constexpr uint64_t imageSize(Format format, uint32_t width, uint32_t height, uint32_t depth = 1) noexcept {
+        FormatInfo info = formatInfo(format);
+        uint64_t blocksX = (width + info.blockWidth - 1) / info.blockWidth;
+        uint64_t blocksY = (height + info.blockHeight - 1) / info.blockHeight;
+        return blocksX * blocksY * depth * info.blockBytes;
+    }
+}// namespace kat::texture
@@ -0,0 +1,294 @@
+#include "transform.hpp"
+
+#include "kat/jobs.hpp"
+#include "kat/prefab.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <numeric>
+
+#include <immintrin.h>
+
+namespace kat {
+
+    namespace {
+        constexpr size_t PARALLEL_GRAIN = 1024;
+
+        // out = a * b, glm column-major layout. out must not alias b.
+        inline void multiply(_In_ const glm::mat4 &a, _In_ const glm::mat4 &b, _Out_ glm::mat4 &out) noexcept {
+            const float *pa = &a[0][0];
+            const float *pb = &b[0][0];
+            float *po = &out[0][0];
+
+            __m128 a0 = _mm_loadu_ps(pa);
+            __m128 a1 = _mm_loadu_ps(pa + 4);
+            __m128 a2 = _mm_loadu_ps(pa + 8);
+            __m128 a3 = _mm_loadu_ps(pa + 12);
+
+            for (int c = 0; c < 4; c++) {
+                __m128 r = _mm_mul_ps(a0, _mm_set1_ps(pb[c * 4 + 0]));
+                r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(pb[c * 4 + 1])));
+                r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(pb[c * 4 + 2])));
+                r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(pb[c * 4 + 3])));
+                _mm_storeu_ps(po + c * 4, r);
+            }
+        }
+
+        inline glm::mat4 compose(_In_ const glm::vec3 &t, _In_ const glm::quat &q, _In_ const glm::vec3 &s) noexcept {
+            float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+            float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+            float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+            return glm::mat4{
+                    {(1.0f - 2.0f * (yy + zz)) * s.x, 2.0f * (xy + wz) * s.x, 2.0f * (xz - wy) * s.x, 0.0f},
+                    {2.0f * (xy - wz) * s.y, (1.0f - 2.0f * (xx + zz)) * s.y, 2.0f * (yz + wx) * s.y, 0.0f},
+                    {2.0f * (xz + wy) * s.z, 2.0f * (yz - wx) * s.z, (1.0f - 2.0f * (xx + yy)) * s.z, 0.0f},
+                    {t.x, t.y, t.z, 1.0f},
+            };
+        }
+
+        template<typename F>
+        void forRange(_In_ size_t begin, _In_ size_t end, F &&fn) {
+            if (end - begin >= PARALLEL_GRAIN * 2) {
+                jobSystem().parallelFor(end - begin, PARALLEL_GRAIN, [&](size_t b, size_t e) { fn(begin + b, begin + e); });
+            } else {
+                fn(begin, end);
+            }
+        }
+    }// namespace
+
+    TransformHierarchy::TransformHierarchy(_In_ entt::registry &registry) : m_Registry(registry) {
+        m_Registry.on_construct<Transform>().connect<&TransformHierarchy::onStructureChanged>(*this);
+        m_Registry.on_construct<Transform>().connect<&TransformHierarchy::onTransformChanged>(*this); // a re-added Transform keeps its slot
+        m_Registry.on_destroy<Transform>().connect<&TransformHierarchy::onStructureChanged>(*this);
+        m_Registry.on_update<Transform>().connect<&TransformHierarchy::onTransformChanged>(*this);
+        m_Registry.on_construct<Parent>().connect<&TransformHierarchy::onStructureChanged>(*this);
+        m_Registry.on_update<Parent>().connect<&TransformHierarchy::onStructureChanged>(*this);
+        m_Registry.on_destroy<Parent>().connect<&TransformHierarchy::onStructureChanged>(*this);
+
+        // prefabs hand over a whole range at once
+        BulkConstruction &bulk = bulkConstruction(m_Registry);
+        bulk.connect<Transform, &TransformHierarchy::onStructureChanged>(*this, [this](std::span<const entt::entity>) { m_StructureChanged = true; });
+        bulk.connect<Transform, &TransformHierarchy::onTransformChanged>(
+                *this, [this](std::span<const entt::entity> entities) { m_Changed.insert(m_Changed.end(), entities.begin(), entities.end()); });
+        bulk.connect<Parent, &TransformHierarchy::onStructureChanged>(*this, [this](std::span<const entt::entity>) { m_StructureChanged = true; });
+    }
+
+    TransformHierarchy::~TransformHierarchy() {
+        m_Registry.on_construct<Transform>().disconnect(this);
+        m_Registry.on_destroy<Transform>().disconnect(this);
+        m_Registry.on_update<Transform>().disconnect(this);
+        m_Registry.on_construct<Parent>().disconnect(this);
+        m_Registry.on_update<Parent>().disconnect(this);
+        m_Registry.on_destroy<Parent>().disconnect(this);
+        bulkConstruction(m_Registry).disconnect(this);
+    }
+
+    void TransformHierarchy::update() {
+        if (m_StructureChanged) {
+            rebuild(); // reads every Transform, so changed ones only need their flag below
+        }
+        for (entt::entity entity : m_Changed) {
+            uint32_t i = indexOf(entity);
+            if (i == NONE || m_Entities[i] != entity) continue; // destroyed since, its slot may be reused
+
+            const auto &t = m_Registry.get<Transform>(entity);
+            m_Positions[i] = t.position;
+            m_Rotations[i] = t.rotation;
+            m_Scales[i] = t.scale;
+            m_Dirty[i] = 1;
+        }
+        m_Changed.clear();
+
+        // parents come first, so one forward pass pushes dirtiness down every subtree
+        const size_t count = m_Entities.size();
+        size_t dirtyCount = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (m_Parents[i] != NONE) m_Dirty[i] |= m_Dirty[m_Parents[i]];
+            dirtyCount += m_Dirty[i];
+        }
+
+        m_LastUpdateCount = dirtyCount;
+        if (dirtyCount == 0) return;
+
+        forRange(0, count, [this](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                if (m_Dirty[i]) m_Local[i] = compose(m_Positions[i], m_Rotations[i], m_Scales[i]);
+            }
+        });
+
+        // every parent of a level lives in an earlier level, so each level can be split across workers
+        for (size_t level = 0; level + 1 < m_LevelStart.size(); level++) {
+            forRange(m_LevelStart[level], m_LevelStart[level + 1], [this](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    if (!m_Dirty[i]) continue;
+                    if (m_Parents[i] == NONE) {
+                        m_World[i] = m_Local[i];
+                    } else {
+                        multiply(m_World[m_Parents[i]], m_Local[i], m_World[i]);
+                    }
+                }
+            });
+        }
+
+        // registry writes stay on this thread; on_update<WorldTransform> listeners see the final matrices
+        for (size_t i = 0; i < count; i++) {
+            if (!m_Dirty[i]) continue;
+            m_Dirty[i] = 0;
+            m_Registry.emplace_or_replace<WorldTransform>(m_Entities[i], m_World[i]);
+        }
+    }
+
+    size_t TransformHierarchy::size() const noexcept {
+        return m_Entities.size();
+    }
+
+    size_t TransformHierarchy::lastUpdateCount() const noexcept {
+        return m_LastUpdateCount;
+    }
+
+    void TransformHierarchy::rebuild() {
+        auto view = m_Registry.view<Transform>();
+
+        std::vector<entt::entity> entities(view.begin(), view.end());
+        std::vector<uint32_t> depth(entities.size(), NONE);
+
+        // the previous layout, so entities that kept their parent also keep their matrices
+        auto oldEntities = std::move(m_Entities);
+        auto oldParents = std::move(m_Parents);
+        auto oldLocal = std::move(m_Local);
+        auto oldWorld = std::move(m_World);
+        auto oldIndex = std::move(m_Index);
+        auto oldPosition = [&](entt::entity entity) -> uint32_t {
+            auto slot = static_cast<size_t>(entt::to_entity(entity));
+            uint32_t at = slot < oldIndex.size() ? oldIndex[slot] : NONE;
+            return at != NONE && oldEntities[at] == entity ? at : NONE; // the slot may have been recycled
+        };
+
+        m_Index.clear();
+        for (uint32_t i = 0; i < entities.size(); i++) {
+            auto slot = static_cast<size_t>(entt::to_entity(entities[i]));
+            if (slot >= m_Index.size()) m_Index.resize(slot + 1, NONE);
+            m_Index[slot] = i;
+        }
+
+        // parent index in the unsorted list, NONE for roots and for parents without a Transform
+        std::vector<uint32_t> parentOf(entities.size(), NONE);
+        for (uint32_t i = 0; i < entities.size(); i++) {
+            if (const auto *parent = m_Registry.try_get<Parent>(entities[i]); parent && m_Registry.valid(parent->entity)) {
+                parentOf[i] = indexOf(parent->entity);
+            }
+        }
+
+        // walk up to the first ancestor with a known depth, then assign depths on the way back down
+        std::vector<uint32_t> chain;
+        std::vector<uint8_t> onChain(entities.size(), 0);
+        for (uint32_t i = 0; i < entities.size(); i++) {
+            uint32_t at = i;
+            while (at != NONE && depth[at] == NONE) {
+                if (onChain[at]) {
+                    spdlog::error("Transform hierarchy has a cycle, detaching entity {}", static_cast<uint32_t>(entities[chain.back()]));
+                    parentOf[chain.back()] = NONE;
+                    at = NONE;
+                    break;
+                }
+                onChain[at] = 1;
+                chain.push_back(at);
+                at = parentOf[at];
+            }
+
+            uint32_t d = at == NONE ? 0 : depth[at] + 1;
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+                depth[*it] = d++;
+                onChain[*it] = 0;
+            }
+            chain.clear();
+        }
+
+        std::vector<uint32_t> order(entities.size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return depth[a] < depth[b]; });
+
+        std::vector<uint32_t> sortedPosition(entities.size());
+        for (uint32_t i = 0; i < order.size(); i++) sortedPosition[order[i]] = i;
+
+        const size_t count = entities.size();
+        m_Entities.resize(count);
+        m_Parents.resize(count);
+        m_Positions.resize(count);
+        m_Rotations.resize(count);
+        m_Scales.resize(count);
+        m_Local.resize(count);
+        m_World.resize(count);
+        m_Dirty.resize(count);
+        m_LevelStart.clear();
+
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t src = order[i];
+            const auto &t = m_Registry.get<Transform>(entities[src]);
+
+            // only new and reparented entities are dirty, update() pushes that down to their subtrees
+            const uint32_t old = oldPosition(entities[src]);
+            const entt::entity parent = parentOf[src] == NONE ? entt::entity{entt::null} : entities[parentOf[src]];
+            const entt::entity oldParent = old == NONE || oldParents[old] == NONE ? entt::entity{entt::null} : oldEntities[oldParents[old]];
+            if (old != NONE && parent == oldParent) {
+                m_Local[i] = oldLocal[old];
+                m_World[i] = oldWorld[old];
+                m_Dirty[i] = 0;
+            } else {
+                m_Dirty[i] = 1;
+            }
+
+            m_Entities[i] = entities[src];
+            m_Parents[i] = parentOf[src] == NONE ? NONE : sortedPosition[parentOf[src]];
+            m_Positions[i] = t.position;
+            m_Rotations[i] = t.rotation;
+            m_Scales[i] = t.scale;
+            m_Index[static_cast<size_t>(entt::to_entity(entities[src]))] = i;
+
+            while (m_LevelStart.size() <= depth[src]) m_LevelStart.push_back(i);
+        }
+        m_LevelStart.push_back(static_cast<uint32_t>(count));
+
+        m_StructureChanged = false;
+    }
+
+    uint32_t TransformHierarchy::indexOf(_In_ entt::entity entity) const noexcept {
+        auto slot = static_cast<size_t>(entt::to_entity(entity));
+        return slot < m_Index.size() ? m_Index[slot] : NONE;
+    }
+
+    void TransformHierarchy::onTransformChanged(_In_ entt::registry &, _In_ entt::entity entity) {
+        m_Changed.push_back(entity);
+    }
+
+    void TransformHierarchy::onStructureChanged(_In_ entt::registry &, _In_ entt::entity) {
+        m_StructureChanged = true;
+    }
+
+    TransformHierarchy &transforms() {
+        return *globalState->transforms;
+    }
+
+    entt::entity createEntity(_In_ const Transform &transform, _In_ entt::entity parent) {
+        entt::entity entity = createEntity();
+        globalState->entt_registry.emplace<Transform>(entity, transform);
+        if (parent != entt::null) {
+            globalState->entt_registry.emplace<Parent>(entity, parent);
+        }
+        return entity;
+    }
+
+    void setTransform(_In_ entt::entity entity, _In_ const Transform &transform) {
+        globalState->entt_registry.emplace_or_replace<Transform>(entity, transform);
+    }
+
+    void setParent(_In_ entt::entity child, _In_ entt::entity parent) {
+        if (parent == entt::null) {
+            globalState->entt_registry.remove<Parent>(child);
+        } else {
+            globalState->entt_registry.emplace_or_replace<Parent>(child, parent);
+        }
+    }
+}// namespace kat
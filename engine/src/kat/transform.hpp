@@ -0,0 +1,84 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+
+namespace kat {
+
+    // Local transform, relative to the Parent if there is one. Change it through registry.patch/replace (or
+    // setTransform) rather than through a reference from get<>, otherwise the hierarchy never hears about it.
+    struct Transform {
+        glm::vec3 position{0.0f};
+        glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+        glm::vec3 scale{1.0f};
+    };
+
+    struct Parent {
+        entt::entity entity = entt::null;
+    };
+
+    // Written by TransformHierarchy::update for every entity with a Transform. Treat as read only.
+    struct WorldTransform {
+        glm::mat4 matrix{1.0f};
+    };
+
+    // Keeps every Transform entity in flat arrays sorted by depth (parents always before their children), so
+    // world matrices are composed in one forward pass. Only entities whose Transform changed, and everything
+    // below them, are recomputed; spawning, destroying and reparenting re-sort the arrays but only dirty the new
+    // and reparented entities.
+    class TransformHierarchy {
+      public:
+        KAT_TRACKED_CLASS(MemoryTag::ECS);
+
+        explicit TransformHierarchy(_In_ entt::registry &registry);
+        ~TransformHierarchy();
+
+        TransformHierarchy(const TransformHierarchy &) = delete;
+        TransformHierarchy &operator=(const TransformHierarchy &) = delete;
+
+        // recomputes dirty world matrices and writes them to WorldTransform. main thread only.
+        void update();
+
+        [[nodiscard]] size_t size() const noexcept;
+        [[nodiscard]] size_t lastUpdateCount() const noexcept; // world matrices recomputed by the last update
+
+      private:
+        static constexpr uint32_t NONE = ~0u;
+
+        entt::registry &m_Registry;
+
+        // SoA, indexed by position in depth order
+        TrackedVector<entt::entity, MemoryTag::ECS> m_Entities;
+        TrackedVector<uint32_t, MemoryTag::ECS> m_Parents;
+        TrackedVector<glm::vec3, MemoryTag::ECS> m_Positions;
+        TrackedVector<glm::quat, MemoryTag::ECS> m_Rotations;
+        TrackedVector<glm::vec3, MemoryTag::ECS> m_Scales;
+        TrackedVector<glm::mat4, MemoryTag::ECS> m_Local;
+        TrackedVector<glm::mat4, MemoryTag::ECS> m_World;
+        TrackedVector<uint8_t, MemoryTag::ECS> m_Dirty;
+        TrackedVector<uint32_t, MemoryTag::ECS> m_LevelStart; // m_LevelStart[d] is the first index at depth d, plus one past the end
+
+        TrackedVector<uint32_t, MemoryTag::ECS> m_Index; // entity slot -> position in the arrays above
+        TrackedVector<entt::entity, MemoryTag::ECS> m_Changed;
+        bool m_StructureChanged = true;
+        size_t m_LastUpdateCount = 0;
+
+        void rebuild();
+        [[nodiscard]] uint32_t indexOf(_In_ entt::entity entity) const noexcept;
+
+        void onTransformChanged(_In_ entt::registry &registry, _In_ entt::entity entity);
+        void onStructureChanged(_In_ entt::registry &registry, _In_ entt::entity entity);
+    };
+
+    [[nodiscard]] TransformHierarchy &transforms();
+
+    entt::entity createEntity(_In_ const Transform &transform, _In_ entt::entity parent = entt::null);
+
+    void setTransform(_In_ entt::entity entity, _In_ const Transform &transform);
+
+    // entt::null detaches
+    void setParent(_In_ entt::entity child, _In_ entt::entity parent);
+}// namespace kat
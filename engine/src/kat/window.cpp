@@ -2,6 +2,8 @@
 #include <spdlog/spdlog.h>
 #include <windowsx.h>
 
+#include "kat/gpu_sync.hpp"
+
 namespace kat {
     DWORD WindowStyle::winStyle() const noexcept {
         DWORD ws = 0;
@@ -50,7 +52,7 @@ namespace kat {
         m_Handle = CreateWindowExW(wsex, WCNAME, settings.title.c_str(), ws, settings.position.x, settings.position.y, settings.size.width, settings.size.height, nullptr, nullptr, globalState->hInstance, this);
 
         vk::Win32SurfaceCreateInfoKHR surfaceCreateInfo{{}, globalState->hInstance, m_Handle};
-        m_Surface = globalState->vkInstance.createWin32SurfaceKHR(surfaceCreateInfo, nullptr, globalState->dldy);
+        m_Surface = globalState->vkInstance.createWin32SurfaceKHR(surfaceCreateInfo, vulkanAllocator(), globalState->dldy);
 
         ShowWindow(m_Handle, globalState->nCmdShow);
         UpdateWindow(m_Handle);
@@ -650,7 +652,11 @@ namespace kat {
     }
 
     void Window::cleanup() {
-        globalState->vkInstance.destroySurfaceKHR(m_Surface, nullptr, globalState->dldy);
+        // frames already submitted may still present to it
+        deletionQueue().defer([surface = m_Surface] {
+            globalState->vkInstance.destroySurfaceKHR(surface, vulkanAllocator(), globalState->dldy);
+        });
+        m_Surface = nullptr;
         spdlog::debug("Cleaned up window internals.");
     }
 
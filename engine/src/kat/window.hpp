@@ -127,6 +127,8 @@ namespace kat {
 
     class Window {
       public:
+        KAT_TRACKED_CLASS(MemoryTag::WINDOW);
+
         Window(_In_ const WindowSettings &settings, _In_ size_t id);
         ~Window();
 
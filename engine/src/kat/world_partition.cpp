@@ -0,0 +1,257 @@
+#include "world_partition.hpp"
+
+#include "kat/jobs.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace kat {
+
+    namespace {
+        bool inactive(_In_ CellState state) noexcept {
+            return state == CellState::UNLOADED || state == CellState::FAILED;
+        }
+    }// namespace
+
+    WorldPartition::WorldPartition(_In_ entt::registry &registry, _In_ const SnapshotTypes &types, _In_ const WorldPartitionSettings &settings)
+        : m_Registry(registry), m_Types(types), m_Settings(settings) {
+        m_Settings.unloadRadius = std::max(m_Settings.unloadRadius, m_Settings.loadRadius);
+    }
+
+    WorldPartition::~WorldPartition() {
+        std::unique_lock lock(m_Mutex);
+        m_Idle.wait(lock, [this] { return m_InFlight == 0; });
+    }
+
+    void WorldPartition::addCell(_In_ glm::ivec2 cell, _In_ std::wstring path) {
+        auto [it, inserted] = m_Cells.try_emplace(key(cell));
+        if (!inserted) {
+            throw std::runtime_error("World cell " + std::to_string(cell.x) + ", " + std::to_string(cell.y) + " was added twice");
+        }
+        it->second.coord = cell;
+        it->second.path = std::move(path);
+    }
+
+    void WorldPartition::update(_In_ const glm::vec3 &camera, _In_ const glm::vec3 &velocity) {
+        m_Frame++;
+
+        // a teleport shouldn't make the ranking scan half the world
+        glm::vec2 position(camera.x, camera.z);
+        glm::vec2 ahead = glm::vec2(velocity.x, velocity.z) * m_Settings.lookahead;
+        float aheadLength = glm::length(ahead);
+        if (aheadLength > m_Settings.loadRadius) {
+            ahead *= m_Settings.loadRadius / aheadLength;
+        }
+        rank(position, position + ahead);
+        collectLoaded();
+
+        // backwards, setState swaps the last active cell into the one it removes
+        for (size_t i = m_Active.size(); i-- > 0;) {
+            Cell &cell = m_Cells.at(m_Active[i]);
+            if (cell.keptFrame == m_Frame) continue;
+
+            if (cell.state == CellState::READY) {
+                cell.staged.reset();
+                setState(cell, CellState::UNLOADED);
+            } else if (cell.state == CellState::RESIDENT) {
+                startUnload(cell);
+            }
+            // LOADING ones are dropped once they arrive
+        }
+
+        for (Cell *cell : m_Ranked) {
+            if (m_Loading >= m_Settings.maxConcurrentLoads) break;
+            if (cell->wanted && cell->state == CellState::UNLOADED) {
+                startLoad(*cell);
+            }
+        }
+
+        runSlice();
+    }
+
+    CellState WorldPartition::state(_In_ glm::ivec2 cell) const {
+        auto it = m_Cells.find(key(cell));
+        return it == m_Cells.end() ? CellState::UNLOADED : it->second.state;
+    }
+
+    glm::ivec2 WorldPartition::cellAt(_In_ const glm::vec3 &position) const noexcept {
+        return glm::ivec2(glm::floor(glm::vec2(position.x, position.z) / m_Settings.cellSize));
+    }
+
+    size_t WorldPartition::residentBytes() const noexcept {
+        return m_ResidentBytes;
+    }
+
+    size_t WorldPartition::residentCount() const noexcept {
+        return m_ResidentCount;
+    }
+
+    uint64_t WorldPartition::key(_In_ glm::ivec2 cell) noexcept {
+        return uint64_t{static_cast<uint32_t>(cell.x)} << 32 | static_cast<uint32_t>(cell.y);
+    }
+
+    float WorldPartition::distance(_In_ glm::ivec2 cell, _In_ glm::vec2 point) const noexcept {
+        glm::vec2 min = glm::vec2(cell) * m_Settings.cellSize;
+        glm::vec2 max = min + m_Settings.cellSize;
+        return glm::length(glm::max(glm::max(min - point, point - max), glm::vec2(0.0f)));
+    }
+
+    void WorldPartition::collectLoaded() {
+        std::vector<Loaded> loaded;
+        {
+            std::lock_guard lock(m_Mutex);
+            loaded.swap(m_Loaded);
+        }
+
+        for (Loaded &result : loaded) {
+            Cell &cell = m_Cells.at(result.key);
+            m_Loading--;
+            if (!result.snapshot) {
+                setState(cell, CellState::FAILED);
+                continue;
+            }
+
+            if (cell.bytes == 0) {
+                cell.bytes = result.snapshot->byteSize();
+                m_MeasuredBytes += cell.bytes;
+                m_MeasuredCount++;
+            }
+            if (cell.keptFrame != m_Frame) {
+                setState(cell, CellState::UNLOADED);
+                continue;
+            }
+            cell.staged = std::move(result.snapshot);
+            setState(cell, CellState::READY);
+        }
+    }
+
+    void WorldPartition::rank(_In_ glm::vec2 camera, _In_ glm::vec2 predicted) {
+        const float radius = m_Settings.unloadRadius;
+        glm::ivec2 first(glm::floor((glm::min(camera, predicted) - radius) / m_Settings.cellSize));
+        glm::ivec2 last(glm::floor((glm::max(camera, predicted) + radius) / m_Settings.cellSize));
+
+        m_Ranked.clear();
+        for (int y = first.y; y <= last.y; y++) {
+            for (int x = first.x; x <= last.x; x++) {
+                auto it = m_Cells.find(key({x, y}));
+                if (it == m_Cells.end() || it->second.state == CellState::FAILED) continue;
+
+                Cell &cell = it->second;
+                cell.distance = std::min(distance(cell.coord, camera), distance(cell.coord, predicted));
+                cell.wanted = false;
+                if (cell.distance <= radius) m_Ranked.push_back(&cell);
+            }
+        }
+        std::sort(m_Ranked.begin(), m_Ranked.end(), [](const Cell *a, const Cell *b) {
+            if (a->distance != b->distance) return a->distance < b->distance;
+            return key(a->coord) < key(b->coord);
+        });
+
+        // cells nobody measured yet count as the average of those that were
+        const size_t estimate = m_MeasuredCount > 0 ? m_MeasuredBytes / m_MeasuredCount : 0;
+        size_t total = 0;
+        for (Cell *cell : m_Ranked) {
+            const bool near = cell->distance <= m_Settings.loadRadius;
+            if (!near && cell->state == CellState::UNLOADED) continue; // between the radii only what's there stays
+
+            // in order: the first cell that doesn't fit ends it, the nearest one is always kept
+            size_t bytes = cell->bytes > 0 ? cell->bytes : estimate;
+            if (total > 0 && total + bytes > m_Settings.memoryBudget) break;
+            total += bytes;
+            cell->keptFrame = m_Frame;
+            cell->wanted = near;
+        }
+    }
+
+    void WorldPartition::startLoad(_Inout_ Cell &cell) {
+        setState(cell, CellState::LOADING);
+        m_Loading++;
+        {
+            std::lock_guard lock(m_Mutex);
+            m_InFlight++;
+        }
+
+        jobSystem().submit([this, k = key(cell.coord), path = cell.path] {
+            Loaded loaded{k, std::nullopt};
+            try {
+                loaded.snapshot = Snapshot::load(path, m_Types);
+            } catch (const std::exception &e) {
+                spdlog::error("Failed to load world cell: {}", e.what());
+            }
+
+            // notified under the lock, the destructor may be waiting to free m_Idle
+            std::lock_guard lock(m_Mutex);
+            m_Loaded.push_back(std::move(loaded));
+            m_InFlight--;
+            m_Idle.notify_all();
+        });
+    }
+
+    void WorldPartition::startUnload(_Inout_ Cell &cell) {
+        OnCellUnloadingSignal.publish(cell.coord, std::span<const entt::entity>(cell.entities));
+        setState(cell, CellState::UNLOADING);
+    }
+
+    void WorldPartition::finishUnload(_Inout_ Cell &cell) {
+        m_ResidentBytes -= cell.bytes;
+        m_ResidentCount--;
+        cell.entities = {};
+        setState(cell, CellState::UNLOADED);
+    }
+
+    void WorldPartition::merge(_Inout_ Cell &cell) {
+        SnapshotEntityMap map = cell.staged->merge(m_Registry);
+        cell.staged.reset();
+        cell.entities.assign(map.entities().begin(), map.entities().end());
+
+        m_ResidentBytes += cell.bytes;
+        m_ResidentCount++;
+        setState(cell, CellState::RESIDENT);
+        OnCellLoadedSignal.publish(cell.coord, std::span<const entt::entity>(cell.entities));
+    }
+
+    void WorldPartition::runSlice() {
+        using Clock = std::chrono::steady_clock;
+        const auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(m_Settings.timeSlice));
+
+        for (bool first = true; first || Clock::now() < deadline; first = false) {
+            // unloading first, it frees memory the loads are counted against
+            auto unloading = std::find_if(m_Active.begin(), m_Active.end(), [this](uint64_t k) { return m_Cells.at(k).state == CellState::UNLOADING; });
+            if (unloading != m_Active.end()) {
+                Cell &cell = m_Cells.at(*unloading);
+                size_t count = std::min<size_t>(m_Settings.unloadBatch, cell.entities.size());
+
+                // the game may have destroyed some of them already
+                m_Destroy.clear();
+                for (size_t i = cell.entities.size() - count; i < cell.entities.size(); i++) {
+                    if (m_Registry.valid(cell.entities[i])) m_Destroy.push_back(cell.entities[i]);
+                }
+                m_Registry.destroy(m_Destroy.begin(), m_Destroy.end());
+                cell.entities.resize(cell.entities.size() - count);
+
+                if (cell.entities.empty()) finishUnload(cell);
+                continue;
+            }
+
+            auto ready = std::find_if(m_Ranked.begin(), m_Ranked.end(), [](const Cell *c) { return c->state == CellState::READY; });
+            if (ready == m_Ranked.end()) break;
+            merge(**ready);
+        }
+    }
+
+    void WorldPartition::setState(_Inout_ Cell &cell, _In_ CellState state) {
+        const bool was = !inactive(cell.state);
+        const bool is = !inactive(state);
+        if (!was && is) {
+            m_Active.push_back(key(cell.coord));
+        } else if (was && !is) {
+            auto it = std::find(m_Active.begin(), m_Active.end(), key(cell.coord));
+            *it = m_Active.back();
+            m_Active.pop_back();
+        }
+        cell.state = state;
+    }
+}// namespace kat
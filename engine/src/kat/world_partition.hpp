@@ -0,0 +1,121 @@
+#pragma once
+
+#include "kat/core.hpp"
+#include "kat/snapshot.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace kat {
+
+    struct WorldPartitionSettings {
+        float cellSize = 64.0f; // cells are squares on the xz plane
+        float loadRadius = 256.0f;   // cells nearer than this to the camera are loaded
+        float unloadRadius = 320.0f; // and stay until they're further than this
+        float lookahead = 1.0f; // seconds of camera velocity; cells near where the camera is headed rank as near
+
+        size_t memoryBudget = 256ull * 1024 * 1024; // resident cells, by Snapshot::byteSize
+        uint32_t maxConcurrentLoads = 4;
+
+        float timeSlice = 0.002f;    // seconds of creating and destroying entities per update, at least one step runs
+        uint32_t unloadBatch = 1024; // entities destroyed between checks of the time slice
+    };
+
+    enum class CellState : uint8_t {
+        UNLOADED,
+        LOADING,   // reading and decoding on the job system
+        READY,     // decoded, waiting for a time slice to create its entities
+        RESIDENT,
+        UNLOADING, // destroying its entities, a batch at a time
+        FAILED,    // its snapshot couldn't be loaded, it isn't tried again
+    };
+
+    // Streams a large world in and out around the camera. The world is cut into square cells, each saved as a
+    // snapshot (see Snapshot) by the level cooker and registered here with addCell.
+    //
+    // Every update ranks the cells around the camera, nearest first, where near means close to the camera or to
+    // where its velocity takes it within lookahead seconds. Cells are kept in that order as long as they fit the
+    // memory budget, the rest are unloaded. Files are read and decoded on the job system; creating and destroying
+    // entities happens on the main thread, spread over frames by timeSlice. A cell's entities are created in one
+    // go, so cells should be small enough for that to fit a slice.
+    class WorldPartition {
+      public:
+        WorldPartition(_In_ entt::registry &registry, _In_ const SnapshotTypes &types, _In_ const WorldPartitionSettings &settings = {});
+        ~WorldPartition(); // waits for loads still running, leaves resident cells' entities alone
+
+        WorldPartition(const WorldPartition &) = delete;
+        WorldPartition &operator=(const WorldPartition &) = delete;
+
+        // main thread
+        void addCell(_In_ glm::ivec2 cell, _In_ std::wstring path);
+
+        // main thread, once per frame
+        void update(_In_ const glm::vec3 &camera, _In_ const glm::vec3 &velocity);
+
+        [[nodiscard]] CellState state(_In_ glm::ivec2 cell) const;
+        [[nodiscard]] glm::ivec2 cellAt(_In_ const glm::vec3 &position) const noexcept;
+        [[nodiscard]] size_t residentBytes() const noexcept;
+        [[nodiscard]] size_t residentCount() const noexcept;
+
+        // right after a cell's entities were created, and before they're destroyed. streaming the assets they
+        // use (textures, meshes) hooks in here.
+        KAT_SIGNAL(OnCellLoaded, void(glm::ivec2, std::span<const entt::entity>));
+        KAT_SIGNAL(OnCellUnloading, void(glm::ivec2, std::span<const entt::entity>));
+
+      private:
+        struct Cell {
+            glm::ivec2 coord;
+            std::wstring path;
+            CellState state = CellState::UNLOADED;
+            size_t bytes = 0; // measured by the first load, 0 before
+            float distance = 0.0f; // ranking of the last update
+            uint64_t keptFrame = 0; // last update that ranked it within the budget
+            bool wanted = false;    // within loadRadius and the budget in the last update
+
+            std::optional<Snapshot> staged; // READY
+            std::vector<entt::entity> entities; // RESIDENT, and what's left to destroy while UNLOADING
+        };
+
+        struct Loaded {
+            uint64_t key;
+            std::optional<Snapshot> snapshot; // empty if the load failed
+        };
+
+        entt::registry &m_Registry;
+        const SnapshotTypes &m_Types;
+        WorldPartitionSettings m_Settings;
+
+        std::unordered_map<uint64_t, Cell> m_Cells;
+        std::vector<uint64_t> m_Active; // cells that aren't UNLOADED or FAILED
+        std::vector<Cell *> m_Ranked;   // scratch, nearest first
+        std::vector<entt::entity> m_Destroy; // scratch
+        uint64_t m_Frame = 0;
+        uint32_t m_Loading = 0;
+        size_t m_ResidentBytes = 0;
+        size_t m_ResidentCount = 0;
+        size_t m_MeasuredBytes = 0; // over every cell measured so far, for estimating the others
+        size_t m_MeasuredCount = 0;
+
+        std::mutex m_Mutex;
+        std::condition_variable m_Idle;
+        std::vector<Loaded> m_Loaded; // finished on the job system, not yet seen by update
+        uint32_t m_InFlight = 0;      // jobs still running
+
+        [[nodiscard]] static uint64_t key(_In_ glm::ivec2 cell) noexcept;
+        [[nodiscard]] float distance(_In_ glm::ivec2 cell, _In_ glm::vec2 point) const noexcept;
+
+        void collectLoaded();
+        void rank(_In_ glm::vec2 camera, _In_ glm::vec2 predicted);
+        void startLoad(_Inout_ Cell &cell);
+        void startUnload(_Inout_ Cell &cell);
+        void finishUnload(_Inout_ Cell &cell);
+        void merge(_Inout_ Cell &cell);
+        void runSlice();
+        void setState(_Inout_ Cell &cell, _In_ CellState state);
+    };
+}// namespace kat
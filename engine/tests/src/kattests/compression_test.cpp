@@ -0,0 +1,129 @@
+#include "kat/compression.hpp"
+
+#include "test.hpp"
+
+#include <cstring>
+
+namespace {
+    using namespace kat;
+
+    std::vector<std::byte> randomBytes(_In_ test::Random &random, _In_ size_t size) {
+        std::vector<std::byte> bytes(size);
+        for (std::byte &b : bytes) b = static_cast<std::byte>(random.next());
+        return bytes;
+    }
+
+    // short runs of a few symbols, compresses well but not down to nothing
+    std::vector<std::byte> repetitiveBytes(_In_ test::Random &random, _In_ size_t size) {
+        std::vector<std::byte> bytes(size);
+        for (size_t i = 0; i < size;) {
+            auto symbol = static_cast<std::byte>('a' + random.next() % 4);
+            for (size_t run = random.next() % 32 + 1; run > 0 && i < size; run--) bytes[i++] = symbol;
+        }
+        return bytes;
+    }
+
+    std::vector<std::byte> blockRoundTrip(_In_ std::span<const std::byte> raw, _Out_ size_t &compressedSize) {
+        std::vector<std::byte> compressed(lz4CompressBound(raw.size()));
+        compressedSize = lz4CompressBlock(raw, compressed);
+        std::vector<std::byte> out(raw.size());
+        lz4DecompressBlock(std::span(compressed).first(compressedSize), out);
+        return out;
+    }
+}// namespace
+
+KAT_TEST(compression, lz4RoundTrips) {
+    test::Random random(5);
+    size_t size = 0;
+
+    KAT_CHECK(blockRoundTrip({}, size).empty());
+
+    std::vector<std::byte> noise = randomBytes(random, 100'000);
+    KAT_CHECK(blockRoundTrip(noise, size) == noise);
+    KAT_CHECK(size <= lz4CompressBound(noise.size()));
+
+    std::vector<std::byte> runs = repetitiveBytes(random, 100'000);
+    KAT_CHECK(blockRoundTrip(runs, size) == runs);
+    KAT_CHECK(size < runs.size() / 2);
+
+    // one long overlapping match
+    std::vector<std::byte> zeros(COMPRESSION_BLOCK_SIZE);
+    KAT_CHECK(blockRoundTrip(zeros, size) == zeros);
+    KAT_CHECK(size < 2048);
+
+    // inputs shorter than the minimum match distance from the end are all literals
+    for (size_t small = 1; small <= 16; small++) {
+        std::vector<std::byte> bytes = repetitiveBytes(random, small);
+        KAT_CHECK(blockRoundTrip(bytes, size) == bytes);
+    }
+}
+
+KAT_TEST(compression, streamRoundTrips) {
+    test::Random random(6);
+
+    KAT_CHECK(decompress(compress({})).empty());
+
+    std::vector<std::byte> noise = randomBytes(random, 1000);
+    KAT_CHECK(decompress(compress(noise)) == noise);
+
+    std::vector<std::byte> exact = repetitiveBytes(random, COMPRESSION_BLOCK_SIZE);
+    KAT_CHECK(decompress(compress(exact)) == exact);
+
+    // several blocks, stored (random) and compressed (repetitive) ones mixed, the last one partial
+    std::vector<std::byte> mixed;
+    for (int block = 0; block < 4; block++) {
+        std::vector<std::byte> part = block % 2 == 0 ? repetitiveBytes(random, COMPRESSION_BLOCK_SIZE) : randomBytes(random, COMPRESSION_BLOCK_SIZE);
+        mixed.insert(mixed.end(), part.begin(), part.end());
+    }
+    mixed.resize(mixed.size() - 12'345);
+    std::vector<std::byte> compressed = compress(mixed);
+    KAT_CHECK(compressed.size() < mixed.size());
+    KAT_CHECK(decompress(compressed) == mixed);
+}
+
+KAT_TEST(compression, malformedInputThrows) {
+    test::Random random(7);
+    std::vector<std::byte> runs = repetitiveBytes(random, 10'000);
+    std::vector<std::byte> block(lz4CompressBound(runs.size()));
+    block.resize(lz4CompressBlock(runs, block));
+
+    std::vector<std::byte> out(runs.size());
+    KAT_CHECK(test::throws([&] { lz4DecompressBlock({}, out); }));
+    KAT_CHECK(test::throws([&] { lz4DecompressBlock(std::span(block).first(block.size() - 1), out); }));
+    KAT_CHECK(test::throws([&] { lz4DecompressBlock(block, std::span(out).first(out.size() - 1)); }));
+
+    std::vector<std::byte> longer(runs.size() + 1);
+    KAT_CHECK(test::throws([&] { lz4DecompressBlock(block, longer); }));
+
+    // a match before the start of the output
+    const std::byte backwards[] = {std::byte{0x00}, std::byte{0x01}, std::byte{0x00}};
+    KAT_CHECK(test::throws([&] { lz4DecompressBlock(backwards, out); }));
+
+    // random corruption either throws or decodes to something, it never reads or writes out of bounds
+    for (int i = 0; i < 1000; i++) {
+        std::vector<std::byte> corrupt = block;
+        corrupt[random.next() % corrupt.size()] = static_cast<std::byte>(random.next());
+        try {
+            lz4DecompressBlock(corrupt, out);
+        } catch (const std::runtime_error &) {
+        }
+    }
+
+    std::vector<std::byte> stream = compress(repetitiveBytes(random, 2 * COMPRESSION_BLOCK_SIZE + 100));
+    KAT_CHECK(test::throws([&] { (void) decompress(std::span(stream).first(4)); }));
+    KAT_CHECK(test::throws([&] { (void) decompress(std::span(stream).first(stream.size() - 1)); }));
+
+    // a raw size in the header the blocks don't add up to, it must throw before allocating it
+    for (uint64_t rawSize : {uint64_t{1} << 40, ~uint64_t{0}, uint64_t{2} * COMPRESSION_BLOCK_SIZE}) {
+        std::vector<std::byte> oversized = stream;
+        std::memcpy(oversized.data(), &rawSize, sizeof(rawSize));
+        KAT_CHECK(test::throws([&] { (void) decompress(oversized); }));
+    }
+
+    // the first block header claiming nothing or more than a block
+    for (uint32_t blockRawSize : {uint32_t{0}, uint32_t{COMPRESSION_BLOCK_SIZE + 1}}) {
+        std::vector<std::byte> badBlock = stream;
+        std::memcpy(badBlock.data() + sizeof(uint64_t), &blockRawSize, sizeof(blockRawSize));
+        KAT_CHECK(test::throws([&] { (void) decompress(badBlock); }));
+    }
+}
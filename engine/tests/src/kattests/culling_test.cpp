@@ -0,0 +1,107 @@
+#include "kat/culling.hpp"
+#include "kat/transform.hpp"
+
+#include "test.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+
+namespace {
+    using namespace kat;
+
+    // count spheres and count boxes with random world transforms, scattered around and through the frusta
+    void populate(_Inout_ entt::registry &registry, _In_ size_t count, _In_ uint64_t seed) {
+        test::Random random(seed);
+        for (size_t i = 0; i < count * 2; i++) {
+            glm::mat4 m = glm::translate(glm::mat4(1.0f), {random.uniform(-60.0f, 60.0f), random.uniform(-60.0f, 60.0f), random.uniform(-120.0f, 20.0f)});
+            m = glm::rotate(m, random.uniform(0.0f, 6.28f), glm::normalize(glm::vec3(random.uniform(-1.0f, 1.0f), 1.0f, random.uniform(-1.0f, 1.0f))));
+            m = glm::scale(m, glm::vec3(random.uniform(0.2f, 3.0f), random.uniform(0.2f, 3.0f), random.uniform(0.2f, 3.0f)));
+
+            entt::entity entity = registry.create();
+            registry.emplace<WorldTransform>(entity, m);
+            if (i % 2 == 0) {
+                registry.emplace<BoundingSphere>(entity, glm::vec3(random.uniform(-1.0f, 1.0f), 0.0f, 0.0f), random.uniform(0.1f, 4.0f));
+            } else {
+                glm::vec3 min(random.uniform(-3.0f, 0.0f), random.uniform(-3.0f, 0.0f), random.uniform(-3.0f, 0.0f));
+                registry.emplace<BoundingBox>(entity, min, min + glm::vec3(random.uniform(0.1f, 4.0f), random.uniform(0.1f, 4.0f), random.uniform(0.1f, 4.0f)));
+            }
+        }
+    }
+
+    std::vector<Frustum> frusta(_In_ uint64_t seed) {
+        test::Random random(seed);
+        std::vector<Frustum> out;
+        for (int v = 0; v < 3; v++) {
+            glm::vec3 eye(random.uniform(-10.0f, 10.0f), random.uniform(-5.0f, 5.0f), random.uniform(0.0f, 10.0f));
+            glm::vec3 target(random.uniform(-20.0f, 20.0f), random.uniform(-10.0f, 10.0f), -50.0f);
+            glm::mat4 projection = glm::perspectiveRH_ZO(random.uniform(0.6f, 1.6f), random.uniform(0.5f, 2.0f), 0.1f, random.uniform(40.0f, 150.0f));
+            out.push_back(Frustum::fromMatrix(projection * glm::lookAtRH(eye, target, glm::vec3(0.0f, 1.0f, 0.0f))));
+        }
+        return out;
+    }
+
+    std::vector<CullPath> simdPaths() {
+        std::vector<CullPath> paths{CullPath::SSE};
+        if (CullingSystem::bestPath() == CullPath::AVX2) paths.push_back(CullPath::AVX2);
+        return paths;
+    }
+}// namespace
+
+// every count below 20 ends on a different number of remainder lanes for the 4 and 8 wide kernels, the others
+// also split into several job chunks
+KAT_TEST(culling, simdMatchesScalar) {
+    const size_t counts[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 4095, 4101, 20003};
+
+    for (size_t count : counts) {
+        entt::registry registry;
+        populate(registry, count, count + 1);
+
+        CullingSystem culling;
+        culling.gather(registry);
+        KAT_CHECK(culling.sphereCount() == count);
+        KAT_CHECK(culling.boxCount() == count);
+
+        std::vector<Frustum> views = frusta(count + 7);
+        std::vector<std::vector<entt::entity>> expected(views.size());
+        culling.cull(views, expected, CullPath::SCALAR);
+
+        for (CullPath path : simdPaths()) {
+            std::vector<std::vector<entt::entity>> visible(views.size());
+            culling.cull(views, visible, path);
+            for (size_t v = 0; v < views.size(); v++) {
+                KAT_CHECK(visible[v] == expected[v]);
+            }
+        }
+    }
+}
+
+// the scalar path itself, against hand placed bounds
+KAT_TEST(culling, scalarReference) {
+    entt::registry registry;
+    auto sphere = [&](glm::vec3 position, float radius) {
+        entt::entity entity = registry.create();
+        registry.emplace<WorldTransform>(entity, glm::translate(glm::mat4(1.0f), position));
+        registry.emplace<BoundingSphere>(entity, glm::vec3(0.0f), radius);
+        return entity;
+    };
+
+    entt::entity ahead = sphere({0.0f, 0.0f, -10.0f}, 1.0f);
+    entt::entity behind = sphere({0.0f, 0.0f, 10.0f}, 1.0f);
+    entt::entity beyondFar = sphere({0.0f, 0.0f, -200.0f}, 1.0f);
+    entt::entity straddlingLeft = sphere({-10.5f, 0.0f, -10.0f}, 1.0f); // 90 degree fov: the left plane is at x = -10
+
+    CullingSystem culling;
+    culling.gather(registry);
+
+    glm::mat4 viewProjection = glm::perspectiveRH_ZO(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+    Frustum frustum = Frustum::fromMatrix(viewProjection);
+    std::vector<std::vector<entt::entity>> visible(1);
+    culling.cull({&frustum, 1}, visible, CullPath::SCALAR);
+
+    auto contains = [&](entt::entity entity) { return std::find(visible[0].begin(), visible[0].end(), entity) != visible[0].end(); };
+    KAT_CHECK(contains(ahead));
+    KAT_CHECK(!contains(behind));
+    KAT_CHECK(!contains(beyondFar));
+    KAT_CHECK(contains(straddlingLeft));
+}
@@ -0,0 +1,132 @@
+#include "kat/depth_pyramid.hpp"
+
+#include "test.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    using namespace kat;
+
+    constexpr vk::Extent2D EXTENT{64, 64};
+
+    // with an identity view projection world space is ndc: x and y map to uv * 2 - 1, z is the depth
+    const glm::mat4 IDENTITY{1.0f};
+
+    std::vector<float> fill(_In_ vk::Extent2D extent, _In_ float (*depthAt)(uint32_t x, uint32_t y)) {
+        std::vector<float> depth(size_t{extent.width} * extent.height);
+        for (uint32_t y = 0; y < extent.height; y++) {
+            for (uint32_t x = 0; x < extent.width; x++) {
+                depth[size_t{y} * extent.width + x] = depthAt(x, y);
+            }
+        }
+        return depth;
+    }
+
+    // the left half is a near wall, the right half far background. every mip level has a texel edge at x = 0.
+    float halves(uint32_t x, uint32_t) {
+        return x < EXTENT.width / 2 ? 0.2f : 0.9f;
+    }
+}// namespace
+
+KAT_TEST(depthPyramid, levelsHoldTheFarthestDepth) {
+    test::Random random(3);
+    std::vector<float> depth(size_t{EXTENT.width} * EXTENT.height);
+    for (float &d : depth) d = random.uniform(0.0f, 1.0f);
+
+    DepthPyramid::Reference pyramid = DepthPyramid::reference(depth, EXTENT);
+    KAT_CHECK(pyramid.levels.size() == 7);
+    KAT_CHECK(pyramid.extents.back().width == 1 && pyramid.extents.back().height == 1);
+    KAT_CHECK(pyramid.levels.back()[0] == *std::max_element(depth.begin(), depth.end()));
+
+    for (size_t level = 1; level < pyramid.levels.size(); level++) {
+        const vk::Extent2D fine = pyramid.extents[level - 1];
+        const vk::Extent2D coarse = pyramid.extents[level];
+        for (uint32_t y = 0; y < coarse.height; y++) {
+            for (uint32_t x = 0; x < coarse.width; x++) {
+                const std::vector<float> &f = pyramid.levels[level - 1];
+                float farthest = std::max({f[size_t{2 * y} * fine.width + 2 * x], f[size_t{2 * y} * fine.width + 2 * x + 1],
+                                           f[size_t{2 * y + 1} * fine.width + 2 * x], f[size_t{2 * y + 1} * fine.width + 2 * x + 1]});
+                KAT_CHECK(pyramid.levels[level][size_t{y} * coarse.width + x] == farthest);
+            }
+        }
+    }
+}
+
+// level 0 is rounded down to powers of two, the texels on the cut edges fold into their neighbours
+KAT_TEST(depthPyramid, nonPowerOfTwoKeepsEveryTexel) {
+    const vk::Extent2D extent{10, 6};
+    std::vector<float> depth(size_t{extent.width} * extent.height, 0.1f);
+    depth.back() = 0.8f; // bottom right, outside the 8x4 base
+
+    DepthPyramid::Reference pyramid = DepthPyramid::reference(depth, extent);
+    KAT_CHECK(pyramid.extents[0].width == 8 && pyramid.extents[0].height == 4);
+    KAT_CHECK(pyramid.levels[0].back() == 0.8f);
+    KAT_CHECK(pyramid.levels.back()[0] == 0.8f);
+}
+
+KAT_TEST(depthPyramid, occludedAndVisible) {
+    DepthPyramid::Reference pyramid = DepthPyramid::reference(fill(EXTENT, halves), EXTENT);
+
+    KAT_CHECK(DepthPyramid::occluded(pyramid, IDENTITY, {-0.5f, 0.0f, 0.5f}, 0.1f));  // behind the wall
+    KAT_CHECK(!DepthPyramid::occluded(pyramid, IDENTITY, {-0.5f, 0.0f, 0.1f}, 0.05f)); // in front of it
+    KAT_CHECK(!DepthPyramid::occluded(pyramid, IDENTITY, {0.5f, 0.0f, 0.5f}, 0.1f));  // over the background
+    KAT_CHECK(DepthPyramid::occluded(pyramid, IDENTITY, {0.5f, 0.0f, 0.97f}, 0.02f)); // behind the background
+
+    // nothing behind the camera is culled
+    glm::mat4 perspective = glm::perspectiveRH_ZO(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+    KAT_CHECK(!DepthPyramid::occluded(pyramid, perspective, {0.0f, 0.0f, 5.0f}, 1.0f));
+
+    DepthPyramid::Reference empty;
+    KAT_CHECK(!DepthPyramid::occluded(empty, IDENTITY, {0.0f, 0.0f, 0.5f}, 0.1f));
+}
+
+// boxes reaching over a texel edge of the level they're tested at have to see the far side too
+KAT_TEST(depthPyramid, boxStraddlingMipEdges) {
+    DepthPyramid::Reference pyramid = DepthPyramid::reference(fill(EXTENT, halves), EXTENT);
+
+    KAT_CHECK(!DepthPyramid::occluded(pyramid, IDENTITY, {0.0f, 0.0f, 0.5f}, 0.3f));   // across the middle, coarse level
+    KAT_CHECK(!DepthPyramid::occluded(pyramid, IDENTITY, {0.02f, 0.0f, 0.5f}, 0.03f)); // one fine texel over the edge
+    KAT_CHECK(DepthPyramid::occluded(pyramid, IDENTITY, {-0.05f, 0.0f, 0.5f}, 0.04f)); // up to the edge, not over it
+
+    // across the horizontal edges, which are all on the wall
+    KAT_CHECK(DepthPyramid::occluded(pyramid, IDENTITY, {-0.5f, 0.0f, 0.6f}, 0.3f));
+    KAT_CHECK(DepthPyramid::occluded(pyramid, IDENTITY, {-0.51f, 0.49f, 0.5f}, 0.07f));
+}
+
+// whatever level a bound is tested at, it's only occluded if every level 0 texel under it is in front of it
+KAT_TEST(depthPyramid, conservativeAgainstLevelZero) {
+    test::Random random(11);
+    std::vector<float> depth(size_t{EXTENT.width} * EXTENT.height);
+    for (uint32_t ty = 0; ty < EXTENT.height; ty += 4) {
+        for (uint32_t tx = 0; tx < EXTENT.width; tx += 4) {
+            float d = random.uniform(0.2f, 0.9f);
+            for (uint32_t y = ty; y < ty + 4; y++) {
+                for (uint32_t x = tx; x < tx + 4; x++) depth[size_t{y} * EXTENT.width + x] = d;
+            }
+        }
+    }
+    DepthPyramid::Reference pyramid = DepthPyramid::reference(depth, EXTENT);
+
+    size_t occluded = 0;
+    for (int i = 0; i < 4000; i++) {
+        glm::vec3 center(random.uniform(-0.9f, 0.9f), random.uniform(-0.9f, 0.9f), random.uniform(0.1f, 0.99f));
+        float radius = random.uniform(0.005f, 0.3f);
+        if (!DepthPyramid::occluded(pyramid, IDENTITY, center, radius)) continue;
+        occluded++;
+
+        auto texel = [](float ndc, uint32_t size) {
+            return std::clamp(static_cast<int>(std::floor((ndc * 0.5f + 0.5f) * static_cast<float>(size))), 0, static_cast<int>(size) - 1);
+        };
+        float farthest = 0.0f;
+        for (int y = texel(center.y - radius, EXTENT.height); y <= texel(center.y + radius, EXTENT.height); y++) {
+            for (int x = texel(center.x - radius, EXTENT.width); x <= texel(center.x + radius, EXTENT.width); x++) {
+                farthest = std::max(farthest, depth[static_cast<size_t>(y) * EXTENT.width + x]);
+            }
+        }
+        KAT_CHECK(center.z - radius > farthest);
+    }
+    KAT_CHECK(occluded > 0 && occluded < 4000);
+}
@@ -0,0 +1,49 @@
+#include "kat/jobs.hpp"
+
+#include "test.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+
+using namespace kat;
+
+KAT_TEST(jobs, parallelForCoversTheRange) {
+    // KAT_CHECK isn't thread safe, the chunks only record
+    std::vector<std::atomic<int>> hits(10'007);
+    std::atomic<bool> oversized = false;
+    jobSystem().parallelFor(hits.size(), 64, [&](size_t begin, size_t end) {
+        if (end - begin > 64) oversized = true;
+        for (size_t i = begin; i < end; i++) hits[i]++;
+    });
+    KAT_CHECK(!oversized);
+
+    bool once = true;
+    for (const std::atomic<int> &hit : hits) once = once && hit == 1;
+    KAT_CHECK(once);
+}
+
+// whichever thread runs the throwing chunk, the caller gets the exception
+KAT_TEST(jobs, parallelForRethrows) {
+    for (size_t thrower : {size_t{0}, size_t{511}, size_t{1023}}) {
+        bool caught = false;
+        try {
+            jobSystem().parallelFor(1024, 1, [&](size_t begin, size_t) {
+                if (begin == thrower) throw std::runtime_error("chunk failed");
+            });
+        } catch (const std::runtime_error &) {
+            caught = true;
+        }
+        KAT_CHECK(caught);
+    }
+
+    bool caught = false;
+    try {
+        jobSystem().parallelFor(256, 1, [](size_t begin, size_t) {
+            if (begin % 2 == 1) throw 42; // not a std::exception
+        });
+    } catch (int) {
+        caught = true;
+    }
+    KAT_CHECK(caught);
+}
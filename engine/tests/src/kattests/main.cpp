@@ -0,0 +1,67 @@
+#include "kat/core.hpp"
+#include "kat/jobs.hpp"
+
+#include "test.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+namespace kat::test {
+
+    namespace {
+        size_t failures = 0;
+    }// namespace
+
+    std::vector<Test> &tests() {
+        static std::vector<Test> registered;
+        return registered;
+    }
+
+    void fail(_In_ const char *file, _In_ int line, _In_ const char *expression) {
+        std::fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+        failures++;
+    }
+}// namespace kat::test
+
+// kattests [prefix...]: runs every test whose name starts with one of the prefixes, all of them without any
+int main(int argc, char **argv) {
+    using namespace kat;
+
+    spdlog::set_level(spdlog::level::warn);
+
+    // only what cpu side code reaches through the global accessors
+    globalState = new GlobalState();
+    globalState->jobSystem = std::make_unique<JobSystem>();
+
+    size_t run = 0;
+    size_t failed = 0;
+    for (const test::Test &t : test::tests()) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc && !selected; i++) {
+            selected = std::string_view(t.name).starts_with(argv[i]);
+        }
+        if (!selected) continue;
+
+        size_t before = test::failures;
+        try {
+            t.fn();
+        } catch (const std::exception &e) {
+            test::fail(__FILE__, __LINE__, e.what());
+        }
+        run++;
+
+        bool passed = test::failures == before;
+        failed += passed ? 0 : 1;
+        std::printf("%s %s\n", passed ? "[ ok ]" : "[FAIL]", t.name);
+    }
+
+    globalState->jobSystem.reset();
+    delete globalState;
+    globalState = nullptr;
+
+    std::printf("%zu of %zu tests passed\n", run - failed, run);
+    return run == 0 || failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+#include "kat/snapshot.hpp"
+#include "kat/transform.hpp"
+
+#include "test.hpp"
+
+namespace {
+    using namespace kat;
+
+    struct Scene {
+        std::vector<entt::entity> entities;
+        std::vector<entt::entity> destroyed; // earlier versions of some of the entities
+    };
+
+    // every entity has a Transform, two thirds a Parent pointing at an earlier one. some ids are recycled so the
+    // saved entities don't all have version 0.
+    Scene buildScene(_Inout_ entt::registry &registry, _In_ size_t count) {
+        test::Random random(13);
+        Scene scene;
+        std::vector<entt::entity> &entities = scene.entities;
+        for (size_t i = 0; i < count; i++) {
+            entt::entity entity = registry.create();
+            if (i % 7 == 3) {
+                registry.destroy(entity);
+                scene.destroyed.push_back(entity);
+                entity = registry.create();
+            }
+            registry.emplace<Transform>(entity, Transform{.position = {random.uniform(-100.0f, 100.0f), random.uniform(-100.0f, 100.0f), random.uniform(-100.0f, 100.0f)},
+                                                          .scale = glm::vec3(random.uniform(0.5f, 2.0f))});
+            if (i % 3 != 0 && !entities.empty()) {
+                registry.emplace<Parent>(entity, Parent{entities[random.next() % entities.size()]});
+            }
+            entities.push_back(entity);
+        }
+        return scene;
+    }
+}// namespace
+
+KAT_TEST(snapshot, roundTripRemapsParents) {
+    const SnapshotTypes types = engineSnapshotTypes();
+
+    entt::registry saved;
+    const Scene scene = buildScene(saved, 5000);
+    const std::vector<entt::entity> &entities = scene.entities;
+    std::vector<std::byte> file = Snapshot::capture(saved, types).encode();
+
+    // the restored entities can't get the saved ids, the registry already has some of its own
+    entt::registry restored;
+    for (int i = 0; i < 100; i++) (void) restored.create();
+
+    Snapshot snapshot = Snapshot::decode(file, types);
+    KAT_CHECK(snapshot.entityCount() == entities.size());
+    SnapshotEntityMap map = snapshot.merge(restored);
+    KAT_CHECK(map.entities().size() == entities.size());
+    KAT_CHECK(restored.storage<Transform>().size() == saved.storage<Transform>().size());
+    KAT_CHECK(restored.storage<Parent>().size() == saved.storage<Parent>().size());
+
+    bool transforms = true;
+    bool parents = true;
+    bool moved = false;
+    for (entt::entity entity : entities) {
+        entt::entity copy = map(entity);
+        if (!restored.valid(copy)) {
+            KAT_CHECK(restored.valid(copy));
+            continue;
+        }
+        moved = moved || copy != entity;
+
+        const Transform &before = saved.get<Transform>(entity);
+        const Transform &after = restored.get<Transform>(copy);
+        transforms = transforms && before.position == after.position && before.rotation == after.rotation && before.scale == after.scale;
+
+        // a parent points at the restored copy of the saved parent, not at the saved id
+        const Parent *parent = saved.try_get<Parent>(entity);
+        const Parent *restoredParent = restored.try_get<Parent>(copy);
+        parents = parents && (parent == nullptr) == (restoredParent == nullptr);
+        if (parent && restoredParent) parents = parents && restoredParent->entity == map(parent->entity) && restoredParent->entity != entt::null;
+    }
+    KAT_CHECK(transforms);
+    KAT_CHECK(parents);
+    KAT_CHECK(moved);
+
+    // entities that weren't saved and earlier versions of saved ones map to nothing
+    KAT_CHECK(map(saved.create()) == entt::null);
+    bool stale = true;
+    for (entt::entity entity : scene.destroyed) stale = stale && map(entity) == entt::null;
+    KAT_CHECK(stale && !scene.destroyed.empty());
+
+    KAT_CHECK(test::throws([&] { (void) snapshot.merge(restored); }));
+}
+
+KAT_TEST(snapshot, malformedFilesThrow) {
+    const SnapshotTypes types = engineSnapshotTypes();
+
+    entt::registry registry;
+    (void) buildScene(registry, 100);
+    std::vector<std::byte> file = Snapshot::capture(registry, types).encode();
+
+    KAT_CHECK(test::throws([&] { (void) Snapshot::decode(std::span(file).first(6), types); }));
+    KAT_CHECK(test::throws([&] { (void) Snapshot::decode(std::span(file).first(file.size() - 1), types); }));
+
+    std::vector<std::byte> wrongMagic = file;
+    wrongMagic[0] ^= std::byte{0xff};
+    KAT_CHECK(test::throws([&] { (void) Snapshot::decode(wrongMagic, types); }));
+
+    // a component layout version the file wasn't written with is refused rather than misread
+    SnapshotTypes newer;
+    newer.add<Transform>("kat::Transform", 1);
+    KAT_CHECK(test::throws([&] { (void) Snapshot::decode(file, newer); }));
+
+    // types the reader doesn't know are skipped
+    SnapshotTypes transformsOnly;
+    transformsOnly.add<Transform>("kat::Transform");
+    entt::registry restored;
+    Snapshot::decode(file, transformsOnly).merge(restored);
+    KAT_CHECK(restored.storage<Transform>().size() == 100);
+    KAT_CHECK(restored.storage<Parent>().empty());
+}
@@ -0,0 +1,101 @@
+#include "kat/sprite_batcher.hpp"
+#include "kat/transform.hpp"
+
+#include "test.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+    using namespace kat;
+
+    void sprite(_Inout_ entt::registry &registry, _In_ uint32_t textureArray, _In_ float z, _In_ int16_t layer = 0) {
+        entt::entity entity = registry.create();
+        registry.emplace<WorldTransform>(entity, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, z)));
+        Sprite s{};
+        s.textureArray = textureArray;
+        s.layer = layer;
+        registry.emplace<Sprite>(entity, s);
+    }
+
+    bool ascendingDepth(_In_ const SpriteBatchList &list) {
+        std::span<const SpriteInstance> instances = list.instances();
+        for (size_t i = 1; i < instances.size(); i++) {
+            if (instances[i].z < instances[i - 1].z) return false;
+        }
+        return true;
+    }
+
+    uint32_t instanceTotal(_In_ const SpriteBatchList &list) {
+        uint32_t total = 0;
+        for (const SpriteBatch &batch : list.batches()) total += batch.instanceCount;
+        return total;
+    }
+}// namespace
+
+KAT_TEST(spriteBatch, oneArrayIsOneBatch) {
+    entt::registry registry;
+    for (int i = 0; i < 100; i++) sprite(registry, 3, static_cast<float>((i * 37) % 100) - 50.0f);
+
+    SpriteBatchList list;
+    list.build(registry);
+    KAT_CHECK(list.batches().size() == 1);
+    KAT_CHECK(list.batches()[0].textureArray == 3);
+    KAT_CHECK(list.batches()[0].firstInstance == 0 && list.batches()[0].instanceCount == 100);
+    KAT_CHECK(ascendingDepth(list));
+}
+
+// sprites at the same layer and z have no order to keep, so they group by array
+KAT_TEST(spriteBatch, sameDepthGroupsByArray) {
+    entt::registry registry;
+    for (int i = 0; i < 50; i++) sprite(registry, i % 2, 1.0f);
+    for (int i = 0; i < 50; i++) sprite(registry, i % 2, 2.0f);
+
+    SpriteBatchList list;
+    list.build(registry);
+    KAT_CHECK(list.batches().size() == 4);
+    KAT_CHECK(instanceTotal(list) == 100);
+    for (const SpriteBatch &batch : list.batches()) KAT_CHECK(batch.instanceCount == 25);
+}
+
+// the layer goes before z: a far sprite on a higher layer still draws after a near one below it
+KAT_TEST(spriteBatch, layersBeforeDepth) {
+    entt::registry registry;
+    sprite(registry, 0, 10.0f, -1);
+    sprite(registry, 1, -10.0f, 2);
+    sprite(registry, 0, 5.0f, -1);
+    sprite(registry, 1, -20.0f, 2);
+
+    SpriteBatchList list;
+    list.build(registry);
+    KAT_CHECK(list.batches().size() == 2);
+    KAT_CHECK(list.batches()[0].textureArray == 0 && list.batches()[0].instanceCount == 2);
+    KAT_CHECK(list.batches()[1].textureArray == 1 && list.batches()[1].instanceCount == 2);
+    KAT_CHECK(list.instances()[0].z == 5.0f && list.instances()[1].z == 10.0f);
+    KAT_CHECK(list.instances()[2].z == -20.0f && list.instances()[3].z == -10.0f);
+}
+
+// the documented limit: within a layer z order wins over batching, so arrays alternating in depth cost a batch
+// per sprite. put such sprites on separate layers or in one array.
+KAT_TEST(spriteBatch, interleavedDepthSplitsBatches) {
+    entt::registry registry;
+    for (int i = 0; i < 16; i++) sprite(registry, i % 2, static_cast<float>(i));
+
+    SpriteBatchList list;
+    list.build(registry);
+    KAT_CHECK(list.batches().size() == 16);
+    KAT_CHECK(ascendingDepth(list));
+
+    entt::registry layered;
+    for (int i = 0; i < 16; i++) sprite(layered, i % 2, static_cast<float>(i), static_cast<int16_t>(i % 2));
+
+    list.build(layered);
+    KAT_CHECK(list.batches().size() == 2);
+}
+
+KAT_TEST(spriteBatch, empty) {
+    entt::registry registry;
+    SpriteBatchList list;
+    list.build(registry);
+    KAT_CHECK(list.batches().empty());
+    KAT_CHECK(list.instances().empty());
+}
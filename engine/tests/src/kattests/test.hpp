@@ -0,0 +1,76 @@
+#pragma once
+
+#include "kat/core.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// A small test runner. KAT_TEST registers a test, KAT_CHECK records a failure and lets the test carry on so
+// one run reports every broken expectation.
+//
+// Tests run on the main thread with the cpu side of the engine up (globalState with a job system), nothing
+// that needs a window or a vulkan device.
+namespace kat::test {
+
+    using FNTEST = void();
+
+    struct Test {
+        const char *name; // "suite.name", ctest runs one suite per entry
+        FNTEST *fn;
+    };
+
+    std::vector<Test> &tests();
+    void fail(_In_ const char *file, _In_ int line, _In_ const char *expression);
+
+    struct Registrar {
+        Registrar(_In_ const char *name, _In_ FNTEST *fn) {
+            tests().push_back(Test{name, fn});
+        }
+    };
+
+    // deterministic, so a failure reproduces
+    class Random {
+      public:
+        explicit Random(_In_ uint64_t seed) : m_State(seed * 0x9E3779B97F4A7C15ull + 1) {}
+
+        uint32_t next() noexcept {
+            m_State ^= m_State << 13;
+            m_State ^= m_State >> 7;
+            m_State ^= m_State << 17;
+            return static_cast<uint32_t>(m_State >> 32);
+        }
+
+        // [lo, hi)
+        float uniform(_In_ float lo, _In_ float hi) noexcept {
+            return lo + (hi - lo) * static_cast<float>(next() >> 8) * (1.0f / 16777216.0f);
+        }
+
+      private:
+        uint64_t m_State;
+    };
+
+    // true if fn throws a std::runtime_error, which is what the engine throws on bad input
+    template<typename F>
+    bool throws(F &&fn) {
+        try {
+            fn();
+        } catch (const std::runtime_error &) {
+            return true;
+        }
+        return false;
+    }
+}// namespace kat::test
+
+#define KAT_TEST_CONCAT2(a, b) a##b
+#define KAT_TEST_CONCAT(a, b) KAT_TEST_CONCAT2(a, b)
+
+#define KAT_TEST(suite, name)                                                                                              \
+    static void suite##_##name();                                                                                          \
+    static ::kat::test::Registrar KAT_TEST_CONCAT(suite##_##name, Registrar)(#suite "." #name, suite##_##name);            \
+    static void suite##_##name()
+
+#define KAT_CHECK(expression)                                                                                              \
+    do {                                                                                                                   \
+        if (!(expression)) ::kat::test::fail(__FILE__, __LINE__, #expression);                                             \
+    } while (false)
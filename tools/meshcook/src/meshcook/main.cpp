@@ -0,0 +1,110 @@
+#include "mesh.hpp"
+#include "meshlets.hpp"
+#include "optimize.hpp"
+#include "writer.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+namespace {
+    using namespace kat;
+
+    void usage() {
+        std::puts("usage: meshcook [options] <input.obj> -o <output.kmsh>\n"
+                  "\n"
+                  "options:\n"
+                  "  --overdraw-threshold <f>  allowed cache miss ratio growth for overdraw sorting (default 1.05)\n"
+                  "  --no-overdraw             skip overdraw optimisation\n"
+                  "  --max-vertices <n>        vertices per meshlet (default and at most 64)\n"
+                  "  --max-triangles <n>       triangles per meshlet (default and at most 124)");
+    }
+
+    // printed so repeated cooks can be compared for reproducibility at a glance
+    uint64_t fnv1a(const std::vector<std::byte> &data) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (std::byte b : data) {
+            hash ^= static_cast<uint64_t>(b);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+}// namespace
+
+int main(int argc, char **argv) {
+    std::string input, output;
+    float overdrawThreshold = 1.05f;
+    bool overdraw = true;
+    uint32_t maxVertices = mesh::MAX_MESHLET_VERTICES;
+    uint32_t maxTriangles = mesh::MAX_MESHLET_TRIANGLES;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "missing value for %s\n", argv[i]);
+                std::exit(EXIT_FAILURE);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            usage();
+            return EXIT_SUCCESS;
+        } else if (arg == "-o" || arg == "--output") {
+            output = value();
+        } else if (arg == "--overdraw-threshold") {
+            overdrawThreshold = std::stof(value());
+        } else if (arg == "--no-overdraw") {
+            overdraw = false;
+        } else if (arg == "--max-vertices") {
+            maxVertices = static_cast<uint32_t>(std::stoul(value()));
+        } else if (arg == "--max-triangles") {
+            maxTriangles = static_cast<uint32_t>(std::stoul(value()));
+        } else {
+            input = arg;
+        }
+    }
+
+    if (input.empty() || output.empty()) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    // the runtime sizes its meshlet outputs by these, bigger meshlets can't be drawn
+    if (maxVertices < 3 || maxVertices > mesh::MAX_MESHLET_VERTICES || maxTriangles < 1 || maxTriangles > mesh::MAX_MESHLET_TRIANGLES) {
+        std::fprintf(stderr, "--max-vertices must be in [3, %u] and --max-triangles in [1, %u]\n", mesh::MAX_MESHLET_VERTICES, mesh::MAX_MESHLET_TRIANGLES);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        meshcook::Mesh mesh = meshcook::loadObj(input);
+        float acmrBefore = meshcook::averageCacheMissRatio(mesh.indices, mesh.vertices.size());
+
+        meshcook::optimizeVertexCache(mesh.indices, mesh.vertices.size());
+        if (overdraw) {
+            meshcook::optimizeOverdraw(mesh, overdrawThreshold);
+        }
+        meshcook::optimizeVertexFetch(mesh);
+        float acmrAfter = meshcook::averageCacheMissRatio(mesh.indices, mesh.vertices.size());
+
+        meshcook::Meshlets meshlets = meshcook::buildMeshlets(mesh, maxVertices, maxTriangles);
+        std::vector<std::byte> cooked = meshcook::writeMesh(mesh, meshlets);
+
+        std::ofstream file(output, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(cooked.data()), static_cast<std::streamsize>(cooked.size()));
+        if (!file) {
+            std::fprintf(stderr, "failed to write %s\n", output.c_str());
+            return EXIT_FAILURE;
+        }
+
+        std::printf("%zu vertices, %zu triangles, %zu meshlets\n", mesh.vertices.size(), mesh.indices.size() / 3, meshlets.meshlets.size());
+        std::printf("acmr %.3f -> %.3f\n", acmrBefore, acmrAfter);
+        std::printf("%zu bytes, fnv1a %016llx\n", cooked.size(), static_cast<unsigned long long>(fnv1a(cooked)));
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
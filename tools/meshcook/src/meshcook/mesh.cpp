@@ -0,0 +1,123 @@
+#include "mesh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace kat::meshcook {
+
+    namespace {
+        // obj indices are 1 based, negative ones count back from the end
+        int64_t resolveIndex(int64_t index, size_t count) {
+            if (index > 0) return index - 1;
+            if (index < 0) return static_cast<int64_t>(count) + index;
+            return -1; // missing
+        }
+
+        void generateNormals(Mesh &mesh) {
+            for (auto &v : mesh.vertices) v.normal[0] = v.normal[1] = v.normal[2] = 0.0f;
+
+            // area weighted; vertices that only differ in uv still get the same normal since we accumulate by position
+            std::map<std::array<float, 3>, std::array<float, 3>> byPosition;
+            for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+                const float *a = mesh.vertices[mesh.indices[i]].position;
+                const float *b = mesh.vertices[mesh.indices[i + 1]].position;
+                const float *c = mesh.vertices[mesh.indices[i + 2]].position;
+
+                float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+                float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+                float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+
+                for (int k = 0; k < 3; k++) {
+                    const float *p = mesh.vertices[mesh.indices[i + k]].position;
+                    auto &acc = byPosition[{p[0], p[1], p[2]}];
+                    for (int c = 0; c < 3; c++) acc[c] += n[c];
+                }
+            }
+
+            for (auto &v : mesh.vertices) {
+                const auto &n = byPosition[{v.position[0], v.position[1], v.position[2]}];
+                float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                for (int c = 0; c < 3; c++) v.normal[c] = len > 0.0f ? n[c] / len : (c == 2 ? 1.0f : 0.0f);
+            }
+        }
+    }// namespace
+
+    Mesh loadObj(const std::filesystem::path &path) {
+        std::ifstream file(path);
+        if (!file) {
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+
+        std::vector<std::array<float, 3>> positions, normals;
+        std::vector<std::array<float, 2>> uvs;
+        std::map<std::array<int64_t, 3>, uint32_t> unique;
+        Mesh mesh;
+
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream in(line);
+            std::string tag;
+            in >> tag;
+
+            if (tag == "v") {
+                auto &p = positions.emplace_back();
+                in >> p[0] >> p[1] >> p[2];
+            } else if (tag == "vn") {
+                auto &n = normals.emplace_back();
+                in >> n[0] >> n[1] >> n[2];
+            } else if (tag == "vt") {
+                auto &t = uvs.emplace_back();
+                in >> t[0] >> t[1];
+            } else if (tag == "f") {
+                std::vector<uint32_t> polygon;
+                std::string corner;
+                while (in >> corner) {
+                    std::array<int64_t, 3> key{0, 0, 0}; // 0 is never a valid obj index, so it marks a missing element
+                    std::istringstream parts(corner);
+                    std::string part;
+                    for (int k = 0; k < 3 && std::getline(parts, part, '/'); k++) {
+                        if (!part.empty()) key[k] = std::stoll(part);
+                    }
+
+                    key[0] = resolveIndex(key[0], positions.size());
+                    key[1] = resolveIndex(key[1], uvs.size());
+                    key[2] = resolveIndex(key[2], normals.size());
+                    if (key[0] < 0 || key[0] >= static_cast<int64_t>(positions.size()) || key[1] >= static_cast<int64_t>(uvs.size()) ||
+                        key[2] >= static_cast<int64_t>(normals.size())) {
+                        throw std::runtime_error("Face index out of range in " + path.string());
+                    }
+
+                    auto [it, inserted] = unique.try_emplace(key, static_cast<uint32_t>(mesh.vertices.size()));
+                    if (inserted) {
+                        Vertex v{};
+                        std::copy_n(positions[key[0]].begin(), 3, v.position);
+                        if (key[1] >= 0) std::copy_n(uvs[key[1]].begin(), 2, v.uv);
+                        if (key[2] >= 0) std::copy_n(normals[key[2]].begin(), 3, v.normal);
+                        mesh.vertices.push_back(v);
+                    }
+                    polygon.push_back(it->second);
+                }
+
+                for (size_t k = 2; k < polygon.size(); k++) {
+                    mesh.indices.insert(mesh.indices.end(), {polygon[0], polygon[k - 1], polygon[k]});
+                }
+            }
+        }
+
+        if (mesh.indices.empty()) {
+            throw std::runtime_error("No triangles in " + path.string());
+        }
+
+        if (normals.empty()) {
+            generateNormals(mesh);
+        }
+
+        return mesh;
+    }
+}// namespace kat::meshcook
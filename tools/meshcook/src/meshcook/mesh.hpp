@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace kat::meshcook {
+
+    struct Vertex {
+        float position[3];
+        float normal[3];
+        float uv[2];
+    };
+
+    // indexed triangle list
+    struct Mesh {
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    // triangles (polygons are fanned), v / vt / vn. vertices are de-duplicated on their v/vt/vn triple in
+    // first-use order and smooth normals are generated when the file has none.
+    [[nodiscard]] Mesh loadObj(const std::filesystem::path &path);
+}// namespace kat::meshcook
@@ -0,0 +1,142 @@
+#include "meshlets.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace kat::meshcook {
+
+    namespace {
+        struct Vec3 {
+            float x, y, z;
+
+            Vec3 operator+(const Vec3 &o) const { return {x + o.x, y + o.y, z + o.z}; }
+            Vec3 operator-(const Vec3 &o) const { return {x - o.x, y - o.y, z - o.z}; }
+            Vec3 operator*(float s) const { return {x * s, y * s, z * s}; }
+        };
+
+        float dot(const Vec3 &a, const Vec3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+        Vec3 cross(const Vec3 &a, const Vec3 &b) { return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+        float length(const Vec3 &a) { return std::sqrt(dot(a, a)); }
+        Vec3 position(const Mesh &mesh, uint32_t v) { return {mesh.vertices[v].position[0], mesh.vertices[v].position[1], mesh.vertices[v].position[2]}; }
+
+        void computeBounds(const Mesh &mesh, const Meshlets &out, mesh::Meshlet &meshlet) {
+            const uint32_t *verts = &out.vertices[meshlet.vertexOffset];
+            const uint8_t *tris = &out.triangles[meshlet.triangleOffset];
+
+            // sphere around the aabb centre, good enough for culling and cheap
+            Vec3 lo{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+            Vec3 hi = lo * -1.0f;
+            for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+                Vec3 p = position(mesh, verts[i]);
+                lo = {std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z)};
+                hi = {std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z)};
+            }
+            Vec3 center = (lo + hi) * 0.5f;
+            float radius = 0.0f;
+            for (uint32_t i = 0; i < meshlet.vertexCount; i++) radius = std::max(radius, length(position(mesh, verts[i]) - center));
+
+            meshlet.center[0] = center.x;
+            meshlet.center[1] = center.y;
+            meshlet.center[2] = center.z;
+            meshlet.radius = radius;
+
+            // cone axis is the average face normal, the cutoff comes from the normal that strays furthest from it
+            std::vector<Vec3> normals;
+            std::vector<Vec3> corners;
+            Vec3 axis{0, 0, 0};
+            for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+                Vec3 a = position(mesh, verts[tris[t * 3]]);
+                Vec3 b = position(mesh, verts[tris[t * 3 + 1]]);
+                Vec3 c = position(mesh, verts[tris[t * 3 + 2]]);
+                Vec3 n = cross(b - a, c - a);
+                float len = length(n);
+                if (len <= 0.0f) continue; // degenerate triangles can't be backfacing
+
+                normals.push_back(n * (1.0f / len));
+                corners.push_back(a);
+                axis = axis + normals.back();
+            }
+
+            meshlet.coneAxis[0] = meshlet.coneAxis[1] = meshlet.coneAxis[2] = 0.0f;
+            meshlet.coneApex[0] = center.x;
+            meshlet.coneApex[1] = center.y;
+            meshlet.coneApex[2] = center.z;
+            meshlet.coneCutoff = 1.0f; // axis 0 and cutoff 1 never culls
+            meshlet.padding = 0.0f;
+
+            float axisLength = length(axis);
+            if (normals.empty() || axisLength <= 0.0f) return;
+            axis = axis * (1.0f / axisLength);
+
+            float minDot = 1.0f;
+            for (const auto &n : normals) minDot = std::min(minDot, dot(axis, n));
+            if (minDot <= 0.1f) return; // spread over more than ~84 degrees, a cone wouldn't cull anything useful
+
+            // apex: pull the centre back along the axis until every triangle plane is in front of it
+            float maxT = 0.0f;
+            for (size_t i = 0; i < normals.size(); i++) {
+                float dc = dot(center - corners[i], normals[i]);
+                float dn = dot(axis, normals[i]);
+                maxT = std::max(maxT, dc / dn);
+            }
+            Vec3 apex = center - axis * maxT;
+
+            meshlet.coneAxis[0] = axis.x;
+            meshlet.coneAxis[1] = axis.y;
+            meshlet.coneAxis[2] = axis.z;
+            meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+            meshlet.coneApex[0] = apex.x;
+            meshlet.coneApex[1] = apex.y;
+            meshlet.coneApex[2] = apex.z;
+        }
+    }// namespace
+
+    Meshlets buildMeshlets(const Mesh &mesh, uint32_t maxVertices, uint32_t maxTriangles) {
+        Meshlets out;
+
+        constexpr uint8_t ABSENT = 0xFF;
+        std::vector<uint8_t> local(mesh.vertices.size(), ABSENT);
+
+        mesh::Meshlet current{};
+        auto flush = [&] {
+            if (current.triangleCount == 0) return;
+
+            for (uint32_t i = 0; i < current.vertexCount; i++) local[out.vertices[current.vertexOffset + i]] = ABSENT;
+            while (out.triangles.size() % 4 != 0) out.triangles.push_back(0);
+
+            computeBounds(mesh, out, current);
+            out.meshlets.push_back(current);
+
+            current = mesh::Meshlet{};
+            current.vertexOffset = static_cast<uint32_t>(out.vertices.size());
+            current.triangleOffset = static_cast<uint32_t>(out.triangles.size());
+        };
+
+        for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+            const uint32_t *tri = &mesh.indices[i];
+
+            uint32_t newVertices = 0;
+            for (int k = 0; k < 3; k++) {
+                bool repeated = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+                if (local[tri[k]] == ABSENT && !repeated) newVertices++;
+            }
+
+            if (current.vertexCount + newVertices > maxVertices || current.triangleCount + 1 > maxTriangles) {
+                flush();
+            }
+
+            for (int k = 0; k < 3; k++) {
+                if (local[tri[k]] == ABSENT) {
+                    local[tri[k]] = static_cast<uint8_t>(current.vertexCount++);
+                    out.vertices.push_back(tri[k]);
+                }
+                out.triangles.push_back(local[tri[k]]);
+            }
+            current.triangleCount++;
+        }
+        flush();
+
+        return out;
+    }
+}// namespace kat::meshcook
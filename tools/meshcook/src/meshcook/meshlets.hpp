@@ -0,0 +1,19 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <kat/mesh_container.hpp>
+
+namespace kat::meshcook {
+
+    struct Meshlets {
+        std::vector<mesh::Meshlet> meshlets;
+        std::vector<uint32_t> vertices; // mesh vertex indices
+        std::vector<uint8_t> triangles; // local vertex indices, every meshlet's run padded to 4 bytes
+    };
+
+    // greedy partition of the (already cache optimised) index order into clusters with bounding spheres and
+    // backface cones
+    [[nodiscard]] Meshlets buildMeshlets(const Mesh &mesh, uint32_t maxVertices = mesh::MAX_MESHLET_VERTICES,
+                                         uint32_t maxTriangles = mesh::MAX_MESHLET_TRIANGLES);
+}// namespace kat::meshcook
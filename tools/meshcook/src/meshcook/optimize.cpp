@@ -0,0 +1,224 @@
+#include "optimize.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+
+namespace kat::meshcook {
+
+    namespace {
+        constexpr int CACHE_SIZE = 32;
+
+        float vertexScore(int cachePosition, uint32_t remaining) {
+            if (remaining == 0) return -1.0f;
+
+            float score = 0.0f;
+            if (cachePosition >= 0) {
+                // the last triangle's vertices get a fixed score so we don't just repeat them
+                score = cachePosition < 3 ? 0.75f : std::pow(1.0f - static_cast<float>(cachePosition - 3) / (CACHE_SIZE - 3), 1.5f);
+            }
+
+            // favour vertices with few triangles left so they get finished off
+            return score + 2.0f / std::sqrt(static_cast<float>(remaining));
+        }
+
+        // dot of the (area weighted) triangle normal with the direction from center to the triangle
+        float outwardness(const Mesh &mesh, const uint32_t *tri, const float center[3]) {
+            const float *a = mesh.vertices[tri[0]].position;
+            const float *b = mesh.vertices[tri[1]].position;
+            const float *c = mesh.vertices[tri[2]].position;
+
+            float centroid[3];
+            for (int k = 0; k < 3; k++) centroid[k] = (a[k] + b[k] + c[k]) / 3.0f;
+
+            float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+            float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+            float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            return (centroid[0] - center[0]) * n[0] + (centroid[1] - center[1]) * n[1] + (centroid[2] - center[2]) * n[2];
+        }
+    }// namespace
+
+    void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount) {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0) return;
+
+        // vertex -> triangles adjacency, the live triangles of v are adjacency[offsets[v] .. offsets[v] + remaining[v])
+        std::vector<uint32_t> remaining(vertexCount, 0);
+        for (uint32_t index : indices) remaining[index]++;
+
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        std::inclusive_scan(remaining.begin(), remaining.end(), offsets.begin() + 1);
+
+        std::vector<uint32_t> adjacency(indices.size());
+        {
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScores(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) vertexScores[v] = vertexScore(-1, remaining[v]);
+
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+
+        std::array<uint32_t, CACHE_SIZE + 3> cache{};
+        int cacheCount = 0;
+        size_t scan = 0;
+        int64_t best = 0;
+
+        for (size_t n = 0; n < triangleCount; n++) {
+            if (best < 0) {
+                // dead end, nothing in the cache has triangles left. take the next unused one in input order.
+                while (emitted[scan]) scan++;
+                best = static_cast<int64_t>(scan);
+            }
+
+            const uint32_t *tri = &indices[static_cast<size_t>(best) * 3];
+            output.insert(output.end(), tri, tri + 3);
+            emitted[best] = true;
+
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = tri[k];
+                uint32_t *live = &adjacency[offsets[v]];
+                uint32_t *it = std::find(live, live + remaining[v], static_cast<uint32_t>(best));
+                std::swap(*it, live[remaining[v] - 1]);
+                remaining[v]--;
+            }
+
+            // move the triangle's vertices to the front of the LRU
+            std::array<uint32_t, CACHE_SIZE + 3> next{};
+            int nextCount = 0;
+            for (int k = 0; k < 3; k++) {
+                if (std::find(next.begin(), next.begin() + nextCount, tri[k]) == next.begin() + nextCount) next[nextCount++] = tri[k];
+            }
+            for (int i = 0; i < cacheCount; i++) {
+                if (std::find(next.begin(), next.begin() + nextCount, cache[i]) == next.begin() + nextCount) next[nextCount++] = cache[i];
+            }
+
+            for (int i = 0; i < nextCount; i++) {
+                uint32_t v = next[i];
+                cachePosition[v] = i < CACHE_SIZE ? i : -1;
+                vertexScores[v] = vertexScore(cachePosition[v], remaining[v]);
+            }
+
+            // rescore triangles touching anything that moved and pick the best of them for the next round
+            best = -1;
+            float bestScore = -1.0f;
+            for (int i = 0; i < nextCount; i++) {
+                uint32_t v = next[i];
+                for (uint32_t a = offsets[v]; a < offsets[v] + remaining[v]; a++) {
+                    uint32_t t = adjacency[a];
+                    float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+                    if (score > bestScore || (score == bestScore && t < best)) {
+                        bestScore = score;
+                        best = t;
+                    }
+                }
+            }
+
+            cacheCount = std::min(nextCount, CACHE_SIZE);
+            std::copy_n(next.begin(), cacheCount, cache.begin());
+        }
+
+        indices = std::move(output);
+    }
+
+    void optimizeOverdraw(Mesh &mesh, float threshold) {
+        std::vector<uint32_t> &indices = mesh.indices;
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2) return;
+
+        float before = averageCacheMissRatio(indices, mesh.vertices.size());
+
+        // cluster boundaries where the cache model had a full miss, the cache is cold there anyway so reordering
+        // whole clusters costs little
+        std::vector<size_t> clusters{0};
+        {
+            std::vector<uint32_t> fifo;
+            for (size_t t = 0; t < triangleCount; t++) {
+                int misses = 0;
+                for (int k = 0; k < 3; k++) {
+                    uint32_t v = indices[t * 3 + k];
+                    if (std::find(fifo.begin(), fifo.end(), v) == fifo.end()) {
+                        misses++;
+                        fifo.insert(fifo.begin(), v);
+                        if (fifo.size() > 16) fifo.pop_back();
+                    }
+                }
+                if (misses == 3 && t != clusters.back()) clusters.push_back(t);
+            }
+        }
+        clusters.push_back(triangleCount);
+        if (clusters.size() <= 2) return;
+
+        float center[3] = {};
+        for (const auto &v : mesh.vertices) {
+            for (int k = 0; k < 3; k++) center[k] += v.position[k] / static_cast<float>(mesh.vertices.size());
+        }
+
+        // sort key is how much a cluster faces away from the centre of the mesh, the most outward facing clusters
+        // are the most likely to occlude others so they go first
+        struct Cluster {
+            size_t begin, end;
+            float key;
+        };
+        std::vector<Cluster> sorted;
+        for (size_t c = 0; c + 1 < clusters.size(); c++) {
+            float key = 0.0f;
+            for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+                key += outwardness(mesh, &indices[t * 3], center);
+            }
+            sorted.push_back({clusters[c], clusters[c + 1], key / static_cast<float>(clusters[c + 1] - clusters[c])});
+        }
+        std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster &a, const Cluster &b) { return a.key > b.key; });
+
+        std::vector<uint32_t> reordered;
+        reordered.reserve(indices.size());
+        for (const auto &cluster : sorted) {
+            reordered.insert(reordered.end(), indices.begin() + static_cast<ptrdiff_t>(cluster.begin * 3), indices.begin() + static_cast<ptrdiff_t>(cluster.end * 3));
+        }
+
+        if (averageCacheMissRatio(reordered, mesh.vertices.size()) <= before * threshold) {
+            indices = std::move(reordered);
+        }
+    }
+
+    void optimizeVertexFetch(Mesh &mesh) {
+        constexpr uint32_t UNUSED = ~0u;
+        std::vector<uint32_t> remap(mesh.vertices.size(), UNUSED);
+        std::vector<Vertex> vertices;
+        vertices.reserve(mesh.vertices.size());
+
+        for (uint32_t &index : mesh.indices) {
+            if (remap[index] == UNUSED) {
+                remap[index] = static_cast<uint32_t>(vertices.size());
+                vertices.push_back(mesh.vertices[index]);
+            }
+            index = remap[index];
+        }
+
+        // vertices no triangle references are dropped
+        mesh.vertices = std::move(vertices);
+    }
+
+    float averageCacheMissRatio(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize) {
+        if (indices.empty()) return 0.0f;
+
+        // FIFO model: timestamps instead of a queue
+        std::vector<uint32_t> insertedAt(vertexCount, 0);
+        uint32_t time = cacheSize + 1;
+        size_t misses = 0;
+
+        for (uint32_t index : indices) {
+            if (time - insertedAt[index] > cacheSize) {
+                insertedAt[index] = time++;
+                misses++;
+            }
+        }
+
+        return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    }
+}// namespace kat::meshcook
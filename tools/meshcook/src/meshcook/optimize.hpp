@@ -0,0 +1,19 @@
+#pragma once
+
+#include "mesh.hpp"
+
+namespace kat::meshcook {
+
+    // reorders triangles for post-transform cache reuse (Forsyth's linear-speed heuristic, 32 entry LRU model)
+    void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+
+    // splits the cache-optimised order into clusters and draws outward facing clusters first so the depth test
+    // rejects more of the rest. gives up (keeps the input order) if the cache miss ratio grows by more than threshold.
+    void optimizeOverdraw(Mesh &mesh, float threshold = 1.05f);
+
+    // renumbers vertices in order of first use so vertex fetch walks memory forwards
+    void optimizeVertexFetch(Mesh &mesh);
+
+    // average post-transform cache misses per triangle on a FIFO cache of cacheSize entries
+    [[nodiscard]] float averageCacheMissRatio(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize = 16);
+}// namespace kat::meshcook
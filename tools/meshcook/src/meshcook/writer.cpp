@@ -0,0 +1,141 @@
+#include "writer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace kat::meshcook {
+
+    namespace {
+        uint16_t toHalf(float value) {
+            uint32_t bits = std::bit_cast<uint32_t>(value);
+            uint32_t sign = (bits >> 16) & 0x8000;
+            int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+            uint32_t mantissa = bits & 0x7FFFFF;
+
+            if (((bits >> 23) & 0xFF) == 0xFF) return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0)); // inf / nan
+            if (exponent >= 31) return static_cast<uint16_t>(sign | 0x7C00);                                        // overflow
+            if (exponent <= 0) {
+                if (exponent < -10) return static_cast<uint16_t>(sign); // too small even for a denormal
+                mantissa |= 0x800000;
+                uint32_t shift = static_cast<uint32_t>(14 - exponent);
+                uint32_t half = mantissa >> shift;
+                if ((mantissa >> (shift - 1)) & 1) half++; // round half up
+                return static_cast<uint16_t>(sign | half);
+            }
+
+            uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+            if (mantissa & 0x1000) half++; // round half up, carrying into the exponent is correct
+            return static_cast<uint16_t>(half);
+        }
+
+        int16_t toSnorm16(float v) {
+            return static_cast<int16_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+        }
+
+        // octahedral encoding of a unit vector into [-1, 1]^2
+        void encodeOctahedral(const float n[3], int16_t out[2]) {
+            float l1 = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+            if (l1 <= 0.0f) {
+                out[0] = out[1] = 0;
+                return;
+            }
+
+            float x = n[0] / l1, y = n[1] / l1;
+            if (n[2] < 0.0f) {
+                float ox = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+                float oy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+                x = ox;
+                y = oy;
+            }
+            out[0] = toSnorm16(x);
+            out[1] = toSnorm16(y);
+        }
+
+        template<typename T>
+        void put(std::vector<std::byte> &out, uint64_t offset, const std::vector<T> &data) {
+            if (!data.empty()) std::memcpy(out.data() + offset, data.data(), data.size() * sizeof(T));
+        }
+    }// namespace
+
+    std::vector<std::byte> writeMesh(const Mesh &mesh, const Meshlets &meshlets) {
+        mesh::Header header{};
+        header.magic = mesh::MAGIC;
+        header.version = mesh::VERSION;
+        header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        header.indexSize = mesh.vertices.size() <= std::numeric_limits<uint16_t>::max() ? 2 : 4;
+        header.meshletCount = static_cast<uint32_t>(meshlets.meshlets.size());
+        header.meshletVertexCount = static_cast<uint32_t>(meshlets.vertices.size());
+        header.meshletTriangleBytes = static_cast<uint32_t>(meshlets.triangles.size());
+
+        float lo[3], hi[3];
+        for (int k = 0; k < 3; k++) {
+            lo[k] = std::numeric_limits<float>::max();
+            hi[k] = std::numeric_limits<float>::lowest();
+        }
+        for (const auto &v : mesh.vertices) {
+            for (int k = 0; k < 3; k++) {
+                lo[k] = std::min(lo[k], v.position[k]);
+                hi[k] = std::max(hi[k], v.position[k]);
+            }
+        }
+
+        float radius = 0.0f;
+        for (int k = 0; k < 3; k++) {
+            header.positionOffset[k] = lo[k];
+            header.positionScale[k] = (hi[k] - lo[k]) / 65535.0f;
+            header.boundsCenter[k] = (lo[k] + hi[k]) * 0.5f;
+        }
+        for (const auto &v : mesh.vertices) {
+            float d = 0.0f;
+            for (int k = 0; k < 3; k++) d += (v.position[k] - header.boundsCenter[k]) * (v.position[k] - header.boundsCenter[k]);
+            radius = std::max(radius, d);
+        }
+        header.boundsRadius = std::sqrt(radius);
+
+        std::vector<mesh::Vertex> vertices(mesh.vertices.size());
+        for (size_t i = 0; i < mesh.vertices.size(); i++) {
+            const Vertex &src = mesh.vertices[i];
+            mesh::Vertex &dst = vertices[i];
+
+            for (int k = 0; k < 3; k++) {
+                float extent = hi[k] - lo[k];
+                float t = extent > 0.0f ? (src.position[k] - lo[k]) / extent : 0.0f;
+                dst.position[k] = static_cast<uint16_t>(std::lround(std::clamp(t, 0.0f, 1.0f) * 65535.0f));
+            }
+            dst.position[3] = 0;
+
+            encodeOctahedral(src.normal, dst.normal);
+            dst.uv[0] = toHalf(src.uv[0]);
+            dst.uv[1] = toHalf(src.uv[1]);
+        }
+
+        auto align = [](uint64_t v) { return (v + mesh::BLOCK_ALIGNMENT - 1) / mesh::BLOCK_ALIGNMENT * mesh::BLOCK_ALIGNMENT; };
+        header.vertexOffset = align(sizeof(mesh::Header));
+        header.indexOffset = align(header.vertexOffset + vertices.size() * sizeof(mesh::Vertex));
+        header.meshletOffset = align(header.indexOffset + uint64_t{header.indexCount} * header.indexSize);
+        header.meshletVertexOffset = align(header.meshletOffset + meshlets.meshlets.size() * sizeof(mesh::Meshlet));
+        header.meshletTriangleOffset = align(header.meshletVertexOffset + meshlets.vertices.size() * sizeof(uint32_t));
+        header.fileSize = align(header.meshletTriangleOffset + meshlets.triangles.size());
+
+        // zero filled so padding is deterministic
+        std::vector<std::byte> out(header.fileSize);
+        std::memcpy(out.data(), &header, sizeof(header));
+        put(out, header.vertexOffset, vertices);
+
+        if (header.indexSize == 2) {
+            std::vector<uint16_t> narrow(mesh.indices.begin(), mesh.indices.end());
+            put(out, header.indexOffset, narrow);
+        } else {
+            put(out, header.indexOffset, mesh.indices);
+        }
+
+        put(out, header.meshletOffset, meshlets.meshlets);
+        put(out, header.meshletVertexOffset, meshlets.vertices);
+        put(out, header.meshletTriangleOffset, meshlets.triangles);
+        return out;
+    }
+}// namespace kat::meshcook
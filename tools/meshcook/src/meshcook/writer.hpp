@@ -0,0 +1,13 @@
+#pragma once
+
+#include "mesh.hpp"
+#include "meshlets.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace kat::meshcook {
+
+    // quantizes the vertices and lays everything out as a .kmsh file
+    [[nodiscard]] std::vector<std::byte> writeMesh(const Mesh &mesh, const Meshlets &meshlets);
+}// namespace kat::meshcook
@@ -0,0 +1,332 @@
+#include "bc.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace kat::texcook {
+
+    namespace {
+        struct Pixels {
+            float v[16][4];
+        };
+
+        Pixels toFloat(const uint8_t *rgba) {
+            Pixels p{};
+            for (int i = 0; i < 16; i++) {
+                for (int c = 0; c < 4; c++) p.v[i][c] = rgba[i * 4 + c];
+            }
+            return p;
+        }
+
+        // dominant direction of the block's colours in the first `channels` channels
+        void principalAxis(const Pixels &p, int channels, float mean[4], float axis[4]) {
+            for (int c = 0; c < 4; c++) mean[c] = axis[c] = 0.0f;
+            for (const auto &px : p.v) {
+                for (int c = 0; c < channels; c++) mean[c] += px[c];
+            }
+            for (int c = 0; c < channels; c++) mean[c] /= 16.0f;
+
+            float cov[4][4] = {};
+            for (const auto &px : p.v) {
+                for (int a = 0; a < channels; a++) {
+                    for (int b = 0; b < channels; b++) cov[a][b] += (px[a] - mean[a]) * (px[b] - mean[b]);
+                }
+            }
+
+            float v[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+            for (int iter = 0; iter < 8; iter++) {
+                float next[4] = {};
+                for (int a = 0; a < channels; a++) {
+                    for (int b = 0; b < channels; b++) next[a] += cov[a][b] * v[b];
+                }
+
+                float len = 0.0f;
+                for (int a = 0; a < channels; a++) len = std::max(len, std::abs(next[a]));
+                if (len < 1e-6f) break;
+                for (int a = 0; a < channels; a++) v[a] = next[a] / len;
+            }
+
+            float len = 0.0f;
+            for (int a = 0; a < channels; a++) len += v[a] * v[a];
+            len = std::sqrt(len);
+            for (int a = 0; a < channels; a++) axis[a] = len > 0.0f ? v[a] / len : 0.0f;
+        }
+
+        // endpoints at the extremes of the projection onto the principal axis
+        void rangeFit(const Pixels &p, int channels, float e0[4], float e1[4]) {
+            float mean[4], axis[4];
+            principalAxis(p, channels, mean, axis);
+
+            float tMin = std::numeric_limits<float>::max();
+            float tMax = std::numeric_limits<float>::lowest();
+            for (const auto &px : p.v) {
+                float t = 0.0f;
+                for (int c = 0; c < channels; c++) t += (px[c] - mean[c]) * axis[c];
+                tMin = std::min(tMin, t);
+                tMax = std::max(tMax, t);
+            }
+
+            for (int c = 0; c < 4; c++) {
+                e0[c] = std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+                e1[c] = std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+            }
+        }
+
+        // ---- BC1 ----
+
+        uint16_t to565(const float c[4]) {
+            auto r = static_cast<uint16_t>(std::lround(c[0] * 31.0f / 255.0f));
+            auto g = static_cast<uint16_t>(std::lround(c[1] * 63.0f / 255.0f));
+            auto b = static_cast<uint16_t>(std::lround(c[2] * 31.0f / 255.0f));
+            return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+        }
+
+        void from565(uint16_t v, float c[3]) {
+            uint32_t r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+            c[0] = static_cast<float>((r << 3) | (r >> 2));
+            c[1] = static_cast<float>((g << 2) | (g >> 4));
+            c[2] = static_cast<float>((b << 3) | (b >> 2));
+        }
+
+        // picks indices for c0 > c1 (4 colour mode), returns total squared error
+        float bc1Indices(const Pixels &p, uint16_t c0, uint16_t c1, uint32_t &indices) {
+            float palette[4][3];
+            from565(c0, palette[0]);
+            from565(c1, palette[1]);
+            for (int c = 0; c < 3; c++) {
+                palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+                palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+            }
+
+            indices = 0;
+            float total = 0.0f;
+            for (int i = 0; i < 16; i++) {
+                float best = std::numeric_limits<float>::max();
+                uint32_t bestIndex = 0;
+                for (uint32_t k = 0; k < 4; k++) {
+                    float d = 0.0f;
+                    for (int c = 0; c < 3; c++) d += (p.v[i][c] - palette[k][c]) * (p.v[i][c] - palette[k][c]);
+                    if (d < best) {
+                        best = d;
+                        bestIndex = k;
+                    }
+                }
+                indices |= bestIndex << (i * 2);
+                total += best;
+            }
+            return total;
+        }
+
+        // orders the endpoints for 4 colour mode. false if they collapsed to the same colour.
+        bool orderBC1(uint16_t &c0, uint16_t &c1) {
+            if (c0 == c1) return false;
+            if (c0 < c1) std::swap(c0, c1);
+            return true;
+        }
+
+        void writeBC1(uint16_t c0, uint16_t c1, uint32_t indices, uint8_t *out) {
+            out[0] = static_cast<uint8_t>(c0 & 0xFF);
+            out[1] = static_cast<uint8_t>(c0 >> 8);
+            out[2] = static_cast<uint8_t>(c1 & 0xFF);
+            out[3] = static_cast<uint8_t>(c1 >> 8);
+            for (int i = 0; i < 4; i++) out[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+        }
+
+        void encodeColorBlock(const Pixels &p, uint8_t *out) {
+            float e0[4], e1[4];
+            rangeFit(p, 3, e0, e1);
+
+            uint16_t c0 = to565(e0), c1 = to565(e1);
+            if (!orderBC1(c0, c1)) {
+                writeBC1(c0, c1, 0, out);
+                return;
+            }
+
+            uint32_t indices;
+            float error = bc1Indices(p, c0, c1, indices);
+
+            // one least squares pass over the chosen indices usually gets noticeably closer than the range fit
+            static constexpr float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+            float aa = 0, bb = 0, ab = 0, ax[3] = {}, bx[3] = {};
+            for (int i = 0; i < 16; i++) {
+                float a = weights[(indices >> (i * 2)) & 3];
+                float b = 1.0f - a;
+                aa += a * a;
+                bb += b * b;
+                ab += a * b;
+                for (int c = 0; c < 3; c++) {
+                    ax[c] += a * p.v[i][c];
+                    bx[c] += b * p.v[i][c];
+                }
+            }
+
+            float det = aa * bb - ab * ab;
+            if (std::abs(det) > 1e-6f) {
+                float r0[4] = {}, r1[4] = {};
+                for (int c = 0; c < 3; c++) {
+                    r0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / det, 0.0f, 255.0f);
+                    r1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / det, 0.0f, 255.0f);
+                }
+
+                uint16_t n0 = to565(r0), n1 = to565(r1);
+                uint32_t refinedIndices;
+                if (orderBC1(n0, n1) && bc1Indices(p, n0, n1, refinedIndices) < error) {
+                    c0 = n0;
+                    c1 = n1;
+                    indices = refinedIndices;
+                }
+            }
+
+            writeBC1(c0, c1, indices, out);
+        }
+
+        // ---- BC4 ----
+
+        void encodeChannelBlock(const uint8_t *rgba, int channel, uint8_t *out) {
+            uint8_t lo = 255, hi = 0;
+            for (int i = 0; i < 16; i++) {
+                lo = std::min(lo, rgba[i * 4 + channel]);
+                hi = std::max(hi, rgba[i * 4 + channel]);
+            }
+
+            out[0] = hi;
+            out[1] = lo;
+            std::memset(out + 2, 0, 6);
+            if (hi == lo) return; // every palette entry decodes to the same value, index 0 is fine
+
+            // 8 value mode (a0 > a1): 0 = a0, 1 = a1, 2..7 = interpolants from a0 towards a1
+            int palette[8] = {hi, lo};
+            for (int k = 1; k < 7; k++) palette[k + 1] = ((7 - k) * hi + k * lo) / 7;
+
+            uint64_t bits = 0;
+            for (int i = 0; i < 16; i++) {
+                int v = rgba[i * 4 + channel];
+                int best = std::numeric_limits<int>::max();
+                uint64_t bestIndex = 0;
+                for (uint64_t k = 0; k < 8; k++) {
+                    int d = std::abs(v - palette[k]);
+                    if (d < best) {
+                        best = d;
+                        bestIndex = k;
+                    }
+                }
+                bits |= bestIndex << (i * 3);
+            }
+
+            for (int i = 0; i < 6; i++) out[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+        }
+
+        // ---- BC7 ----
+
+        struct BitWriter {
+            uint8_t *out;
+            uint32_t position = 0;
+
+            void put(uint32_t value, uint32_t count) {
+                for (uint32_t i = 0; i < count; i++, position++) {
+                    if ((value >> i) & 1) out[position / 8] |= static_cast<uint8_t>(1u << (position % 8));
+                }
+            }
+        };
+
+        constexpr int BC7_WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+        // 7 bit endpoint + p-bit, picking the p-bit with the smaller error across all four channels
+        void quantizeBC7Endpoint(const float e[4], uint32_t q[4], uint32_t &pbit) {
+            float bestError = std::numeric_limits<float>::max();
+            for (uint32_t p = 0; p < 2; p++) {
+                uint32_t candidate[4];
+                float error = 0.0f;
+                for (int c = 0; c < 4; c++) {
+                    long v = std::lround((e[c] - static_cast<float>(p)) / 2.0f);
+                    candidate[c] = static_cast<uint32_t>(std::clamp(v, 0l, 127l));
+                    float recon = static_cast<float>((candidate[c] << 1) | p);
+                    error += (recon - e[c]) * (recon - e[c]);
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    pbit = p;
+                    std::copy_n(candidate, 4, q);
+                }
+            }
+        }
+    }// namespace
+
+    void encodeBC1(const uint8_t *rgba, uint8_t *out) {
+        encodeColorBlock(toFloat(rgba), out);
+    }
+
+    void encodeBC3(const uint8_t *rgba, uint8_t *out) {
+        encodeChannelBlock(rgba, 3, out);
+        encodeColorBlock(toFloat(rgba), out + 8);
+    }
+
+    void encodeBC4(const uint8_t *rgba, uint8_t *out) {
+        encodeChannelBlock(rgba, 0, out);
+    }
+
+    void encodeBC5(const uint8_t *rgba, uint8_t *out) {
+        encodeChannelBlock(rgba, 0, out);
+        encodeChannelBlock(rgba, 1, out + 8);
+    }
+
+    void encodeBC7(const uint8_t *rgba, uint8_t *out) {
+        Pixels p = toFloat(rgba);
+
+        float e0[4], e1[4];
+        rangeFit(p, 4, e0, e1);
+
+        uint32_t q0[4], q1[4], p0 = 0, p1 = 0;
+        quantizeBC7Endpoint(e0, q0, p0);
+        quantizeBC7Endpoint(e1, q1, p1);
+
+        int r0[4], r1[4];
+        for (int c = 0; c < 4; c++) {
+            r0[c] = static_cast<int>((q0[c] << 1) | p0);
+            r1[c] = static_cast<int>((q1[c] << 1) | p1);
+        }
+
+        int palette[16][4];
+        for (int k = 0; k < 16; k++) {
+            for (int c = 0; c < 4; c++) palette[k][c] = ((64 - BC7_WEIGHTS4[k]) * r0[c] + BC7_WEIGHTS4[k] * r1[c] + 32) >> 6;
+        }
+
+        uint32_t indices[16];
+        for (int i = 0; i < 16; i++) {
+            int best = std::numeric_limits<int>::max();
+            for (uint32_t k = 0; k < 16; k++) {
+                int d = 0;
+                for (int c = 0; c < 4; c++) {
+                    int diff = rgba[i * 4 + c] - palette[k][c];
+                    d += diff * diff;
+                }
+                if (d < best) {
+                    best = d;
+                    indices[i] = k;
+                }
+            }
+        }
+
+        // the anchor (first) index is stored with its top bit implied zero
+        if (indices[0] & 8) {
+            std::swap(q0, q1);
+            std::swap(p0, p1);
+            for (auto &index : indices) index = 15 - index;
+        }
+
+        std::memset(out, 0, 16);
+        BitWriter bits{out};
+        bits.put(1u << 6, 7); // mode 6
+        for (int c = 0; c < 4; c++) {
+            bits.put(q0[c], 7);
+            bits.put(q1[c], 7);
+        }
+        bits.put(p0, 1);
+        bits.put(p1, 1);
+
+        bits.put(indices[0], 3);
+        for (int i = 1; i < 16; i++) bits.put(indices[i], 4);
+    }
+}// namespace kat::texcook
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+// Block compressors. Every function takes one 4x4 block of RGBA8 pixels (64 bytes, row major) and writes one
+// compressed block.
+namespace kat::texcook {
+
+    // 8 bytes, opaque 4 colour mode
+    void encodeBC1(const uint8_t *rgba, uint8_t *out);
+
+    // 16 bytes, BC4 style alpha + BC1 colour
+    void encodeBC3(const uint8_t *rgba, uint8_t *out);
+
+    // 8 bytes, red channel
+    void encodeBC4(const uint8_t *rgba, uint8_t *out);
+
+    // 16 bytes, red and green channels
+    void encodeBC5(const uint8_t *rgba, uint8_t *out);
+
+    // 16 bytes, mode 6 only (single subset, RGBA 7.7.7.7 + p-bit endpoints, 4 bit indices)
+    void encodeBC7(const uint8_t *rgba, uint8_t *out);
+}// namespace kat::texcook
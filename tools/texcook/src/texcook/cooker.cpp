@@ -0,0 +1,171 @@
+#include "cooker.hpp"
+#include "bc.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace kat::texcook {
+
+    namespace {
+        using FNENCODE = void(const uint8_t *rgba, uint8_t *out);
+
+        FNENCODE *encoderFor(texture::Format format) {
+            switch (format) {
+                case texture::Format::BC1_UNORM:
+                case texture::Format::BC1_SRGB: return encodeBC1;
+                case texture::Format::BC3_UNORM:
+                case texture::Format::BC3_SRGB: return encodeBC3;
+                case texture::Format::BC4_UNORM: return encodeBC4;
+                case texture::Format::BC5_UNORM: return encodeBC5;
+                case texture::Format::BC7_UNORM:
+                case texture::Format::BC7_SRGB: return encodeBC7;
+                default: return nullptr;
+            }
+        }
+
+        // a row of blocks of one layer of one mip level, the unit of work handed to threads
+        struct RowJob {
+            const Image *image;
+            uint32_t row;
+            std::byte *dst;
+        };
+
+        void encodeRow(const RowJob &job, texture::Format format) {
+            const Image &image = *job.image;
+            texture::FormatInfo info = texture::formatInfo(format);
+            auto *dst = reinterpret_cast<uint8_t *>(job.dst);
+
+            FNENCODE *encode = encoderFor(format);
+            if (!encode) {
+                std::memcpy(dst, image.pixel(0, job.row), size_t{image.width} * 4);
+                return;
+            }
+
+            uint32_t blocksX = (image.width + 3) / 4;
+            uint8_t block[64];
+            for (uint32_t bx = 0; bx < blocksX; bx++) {
+                // edge blocks repeat the last row/column
+                for (uint32_t y = 0; y < 4; y++) {
+                    uint32_t sy = std::min(job.row * 4 + y, image.height - 1);
+                    for (uint32_t x = 0; x < 4; x++) {
+                        uint32_t sx = std::min(bx * 4 + x, image.width - 1);
+                        std::memcpy(block + (y * 4 + x) * 4, image.pixel(sx, sy), 4);
+                    }
+                }
+                encode(block, dst + size_t{bx} * info.blockBytes);
+            }
+        }
+    }// namespace
+
+    MipChains buildMips(const std::vector<Image> &layers, const CookSettings &settings) {
+        if (layers.empty()) {
+            throw std::runtime_error("No input images");
+        }
+        for (const auto &layer : layers) {
+            if (layer.width != layers[0].width || layer.height != layers[0].height) {
+                throw std::runtime_error("All array layers must be the same size");
+            }
+        }
+
+        bool srgb = texture::formatInfo(settings.format).srgb;
+        uint32_t levels = settings.generateMips ? mipCount(layers[0].width, layers[0].height) : 1;
+
+        MipChains mips(layers.size());
+        for (size_t l = 0; l < layers.size(); l++) {
+            mips[l].reserve(levels);
+            mips[l].push_back(layers[l]);
+            for (uint32_t m = 1; m < levels; m++) {
+                mips[l].push_back(downsample(mips[l].back(), srgb));
+            }
+        }
+        return mips;
+    }
+
+    std::vector<std::byte> cook(const MipChains &mips, const CookSettings &settings) {
+        texture::FormatInfo info = texture::formatInfo(settings.format);
+        auto layerCount = static_cast<uint32_t>(mips.size());
+        auto levelCount = static_cast<uint32_t>(mips[0].size());
+
+        uint64_t regionOffset = sizeof(texture::Header);
+        uint64_t dataOffset = texture::alignUp(regionOffset + uint64_t{levelCount} * sizeof(texture::Region), texture::DATA_ALIGNMENT);
+
+        // one region per mip level covering every layer; layers of a level are packed back to back, which is
+        // exactly how vkCmdCopyBufferToImage walks a layered copy with bufferImageHeight = 0
+        std::vector<texture::Region> regions(levelCount);
+        uint64_t dataSize = 0;
+        for (uint32_t m = 0; m < levelCount; m++) {
+            const Image &level = mips[0][m];
+            uint64_t layerSize = texture::imageSize(settings.format, level.width, level.height);
+
+            dataSize = texture::alignUp(dataSize, texture::DATA_ALIGNMENT);
+            regions[m] = texture::Region{
+                    .bufferOffset = dataSize,
+                    .byteSize = layerSize * layerCount,
+                    .bufferRowLength = 0,
+                    .bufferImageHeight = 0,
+                    .mipLevel = m,
+                    .baseArrayLayer = 0,
+                    .layerCount = layerCount,
+                    .width = level.width,
+                    .height = level.height,
+                    .depth = 1,
+            };
+            dataSize += regions[m].byteSize;
+        }
+
+        std::vector<std::byte> out(dataOffset + dataSize);
+
+        texture::Header header{
+                .magic = texture::MAGIC,
+                .version = texture::VERSION,
+                .format = settings.format,
+                .vkFormat = info.vkFormat,
+                .width = mips[0][0].width,
+                .height = mips[0][0].height,
+                .depth = 1,
+                .mipCount = levelCount,
+                .layerCount = layerCount,
+                .regionCount = levelCount,
+                .regionOffset = regionOffset,
+                .dataOffset = dataOffset,
+                .dataSize = dataSize,
+        };
+        std::memcpy(out.data(), &header, sizeof(header));
+        std::memcpy(out.data() + regionOffset, regions.data(), regions.size() * sizeof(texture::Region));
+
+        std::vector<RowJob> jobs;
+        std::byte *data = out.data() + dataOffset;
+        for (uint32_t m = 0; m < levelCount; m++) {
+            const Image &level = mips[0][m];
+            uint32_t rows = (level.height + info.blockHeight - 1) / info.blockHeight;
+            uint64_t rowBytes = uint64_t{(level.width + info.blockWidth - 1) / info.blockWidth} * info.blockBytes;
+            uint64_t layerSize = rowBytes * rows;
+
+            for (uint32_t l = 0; l < layerCount; l++) {
+                for (uint32_t r = 0; r < rows; r++) {
+                    jobs.push_back(RowJob{&mips[l][m], r, data + regions[m].bufferOffset + l * layerSize + r * rowBytes});
+                }
+            }
+        }
+
+        uint32_t threads = settings.threads ? settings.threads : std::max(1u, std::thread::hardware_concurrency());
+        threads = static_cast<uint32_t>(std::min<size_t>(threads, jobs.size()));
+
+        std::atomic<size_t> next = 0;
+        auto work = [&] {
+            for (size_t i = next.fetch_add(1); i < jobs.size(); i = next.fetch_add(1)) {
+                encodeRow(jobs[i], settings.format);
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (uint32_t t = 1; t < threads; t++) pool.emplace_back(work);
+        work();
+        for (auto &t : pool) t.join();
+
+        return out;
+    }
+}// namespace kat::texcook
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "image.hpp"
+
+#include <kat/texture_container.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace kat::texcook {
+
+    struct CookSettings {
+        texture::Format format = texture::Format::BC7_UNORM;
+        bool generateMips = true;
+        uint32_t threads = 0; // 0 = one per hardware thread
+    };
+
+    // one mip chain per array layer, every layer the same size. mips[layer][level].
+    using MipChains = std::vector<std::vector<Image>>;
+
+    [[nodiscard]] MipChains buildMips(const std::vector<Image> &layers, const CookSettings &settings);
+
+    // lays out the container and compresses every block into it. the output is byte-identical for the same
+    // input regardless of the thread count.
+    [[nodiscard]] std::vector<std::byte> cook(const MipChains &mips, const CookSettings &settings);
+}// namespace kat::texcook
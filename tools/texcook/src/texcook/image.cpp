@@ -0,0 +1,181 @@
+#include "image.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+namespace kat::texcook {
+
+    namespace {
+        struct TgaHeader {
+            uint8_t idLength;
+            uint8_t colorMapType;
+            uint8_t imageType;
+            uint16_t colorMapLength;
+            uint8_t colorMapDepth;
+            uint16_t width;
+            uint16_t height;
+            uint8_t bitsPerPixel;
+            uint8_t descriptor;
+        };
+
+        uint16_t readU16(const uint8_t *p) {
+            return static_cast<uint16_t>(p[0] | (p[1] << 8));
+        }
+
+        const std::array<float, 256> &srgbToLinearTable() {
+            static const std::array<float, 256> table = [] {
+                std::array<float, 256> t{};
+                for (int i = 0; i < 256; i++) {
+                    float c = static_cast<float>(i) / 255.0f;
+                    t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                }
+                return t;
+            }();
+            return table;
+        }
+
+        uint8_t linearToSrgb(float c) {
+            c = std::clamp(c, 0.0f, 1.0f);
+            float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+            return static_cast<uint8_t>(std::lround(s * 255.0f));
+        }
+    }// namespace
+
+    Image loadTga(const std::filesystem::path &path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (bytes.size() < 18) {
+            throw std::runtime_error("Truncated TGA: " + path.string());
+        }
+
+        TgaHeader h{};
+        h.idLength = bytes[0];
+        h.colorMapType = bytes[1];
+        h.imageType = bytes[2];
+        h.colorMapLength = readU16(&bytes[5]);
+        h.colorMapDepth = bytes[7];
+        h.width = readU16(&bytes[12]);
+        h.height = readU16(&bytes[14]);
+        h.bitsPerPixel = bytes[16];
+        h.descriptor = bytes[17];
+
+        bool rle = h.imageType == 10 || h.imageType == 11;
+        bool grey = h.imageType == 3 || h.imageType == 11;
+        if (h.colorMapType != 0 || !(h.imageType == 2 || h.imageType == 3 || rle)) {
+            throw std::runtime_error("Unsupported TGA type (only truecolor/greyscale): " + path.string());
+        }
+
+        uint32_t bpp = h.bitsPerPixel / 8;
+        if ((grey && bpp != 1) || (!grey && bpp != 3 && bpp != 4) || h.width == 0 || h.height == 0) {
+            throw std::runtime_error("Unsupported TGA pixel format: " + path.string());
+        }
+
+        size_t pos = 18 + h.idLength + size_t{h.colorMapLength} * ((h.colorMapDepth + 7) / 8);
+        size_t pixelCount = size_t{h.width} * h.height;
+        std::vector<uint8_t> raw(pixelCount * bpp);
+
+        auto need = [&](size_t n) {
+            if (pos + n > bytes.size()) throw std::runtime_error("Truncated TGA: " + path.string());
+        };
+
+        if (!rle) {
+            need(raw.size());
+            std::copy_n(bytes.begin() + static_cast<ptrdiff_t>(pos), raw.size(), raw.begin());
+        } else {
+            size_t out = 0;
+            while (out < raw.size()) {
+                need(1);
+                uint8_t packet = bytes[pos++];
+                size_t count = (packet & 0x7F) + 1u;
+                if (out + count * bpp > raw.size()) throw std::runtime_error("Corrupt TGA RLE data: " + path.string());
+
+                if (packet & 0x80) {
+                    need(bpp);
+                    for (size_t i = 0; i < count; i++) {
+                        std::copy_n(bytes.begin() + static_cast<ptrdiff_t>(pos), bpp, raw.begin() + static_cast<ptrdiff_t>(out));
+                        out += bpp;
+                    }
+                    pos += bpp;
+                } else {
+                    need(count * bpp);
+                    std::copy_n(bytes.begin() + static_cast<ptrdiff_t>(pos), count * bpp, raw.begin() + static_cast<ptrdiff_t>(out));
+                    pos += count * bpp;
+                    out += count * bpp;
+                }
+            }
+        }
+
+        Image image;
+        image.width = h.width;
+        image.height = h.height;
+        image.rgba.resize(pixelCount * 4);
+
+        bool bottomUp = (h.descriptor & 0x20) == 0;
+        bool rightToLeft = (h.descriptor & 0x10) != 0;
+        for (uint32_t y = 0; y < image.height; y++) {
+            uint32_t srcY = bottomUp ? image.height - 1 - y : y;
+            for (uint32_t x = 0; x < image.width; x++) {
+                uint32_t srcX = rightToLeft ? image.width - 1 - x : x;
+                const uint8_t *src = raw.data() + (size_t{srcY} * image.width + srcX) * bpp;
+                uint8_t *dst = image.rgba.data() + (size_t{y} * image.width + x) * 4;
+
+                if (grey) {
+                    dst[0] = dst[1] = dst[2] = src[0];
+                    dst[3] = 255;
+                } else {
+                    // stored as BGR(A)
+                    dst[0] = src[2];
+                    dst[1] = src[1];
+                    dst[2] = src[0];
+                    dst[3] = bpp == 4 ? src[3] : 255;
+                }
+            }
+        }
+
+        return image;
+    }
+
+    Image downsample(const Image &image, bool srgb) {
+        Image out;
+        out.width = std::max(1u, image.width / 2);
+        out.height = std::max(1u, image.height / 2);
+        out.rgba.resize(size_t{out.width} * out.height * 4);
+
+        const auto &toLinear = srgbToLinearTable();
+
+        for (uint32_t y = 0; y < out.height; y++) {
+            uint32_t y0 = std::min(y * 2, image.height - 1);
+            uint32_t y1 = std::min(y * 2 + 1, image.height - 1);
+            for (uint32_t x = 0; x < out.width; x++) {
+                uint32_t x0 = std::min(x * 2, image.width - 1);
+                uint32_t x1 = std::min(x * 2 + 1, image.width - 1);
+
+                const uint8_t *p[4] = {image.pixel(x0, y0), image.pixel(x1, y0), image.pixel(x0, y1), image.pixel(x1, y1)};
+                uint8_t *dst = out.rgba.data() + (size_t{y} * out.width + x) * 4;
+
+                for (int c = 0; c < 4; c++) {
+                    if (srgb && c < 3) {
+                        float sum = toLinear[p[0][c]] + toLinear[p[1][c]] + toLinear[p[2][c]] + toLinear[p[3][c]];
+                        dst[c] = linearToSrgb(sum * 0.25f);
+                    } else {
+                        uint32_t sum = p[0][c] + p[1][c] + p[2][c] + p[3][c];
+                        dst[c] = static_cast<uint8_t>((sum + 2) / 4);
+                    }
+                }
+            }
+        }
+
+        return out;
+    }
+
+    uint32_t mipCount(uint32_t width, uint32_t height) noexcept {
+        return std::bit_width(std::max(width, height));
+    }
+}// namespace kat::texcook
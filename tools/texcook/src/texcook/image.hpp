@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace kat::texcook {
+
+    struct Image {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> rgba; // tightly packed RGBA8, top row first
+
+        [[nodiscard]] const uint8_t *pixel(uint32_t x, uint32_t y) const noexcept {
+            return rgba.data() + (size_t{y} * width + x) * 4;
+        }
+    };
+
+    // uncompressed or RLE truecolor / greyscale TGA. throws on anything else.
+    [[nodiscard]] Image loadTga(const std::filesystem::path &path);
+
+    // 2x2 box filter down to max(1, size / 2). srgb images are filtered in linear space.
+    [[nodiscard]] Image downsample(const Image &image, bool srgb);
+
+    [[nodiscard]] uint32_t mipCount(uint32_t width, uint32_t height) noexcept;
+}// namespace kat::texcook
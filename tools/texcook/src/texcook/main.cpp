@@ -0,0 +1,169 @@
+#include "cooker.hpp"
+#include "image.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace {
+    using namespace kat;
+
+    void usage() {
+        std::puts("usage: texcook [options] <input.tga>... -o <output.ktex>\n"
+                  "       texcook --bench [options]\n"
+                  "\n"
+                  "Multiple inputs become array layers.\n"
+                  "\n"
+                  "options:\n"
+                  "  -f, --format <fmt>   rgba8 | bc1 | bc3 | bc4 | bc5 | bc7 (default bc7)\n"
+                  "  --srgb               store colour data as sRGB (rgba8, bc1, bc3, bc7)\n"
+                  "  --no-mips            only store the top level\n"
+                  "  -j, --threads <n>    worker threads, 0 = all cores (default 0)\n"
+                  "  --bench              compress a generated image and report throughput\n"
+                  "  --size <n>           benchmark image size (default 2048)\n"
+                  "  --iterations <n>     benchmark repetitions (default 5)");
+    }
+
+    std::optional<texture::Format> parseFormat(std::string_view name, bool srgb) {
+        if (name == "rgba8") return srgb ? texture::Format::RGBA8_SRGB : texture::Format::RGBA8_UNORM;
+        if (name == "bc1") return srgb ? texture::Format::BC1_SRGB : texture::Format::BC1_UNORM;
+        if (name == "bc3") return srgb ? texture::Format::BC3_SRGB : texture::Format::BC3_UNORM;
+        if (name == "bc4" && !srgb) return texture::Format::BC4_UNORM;
+        if (name == "bc5" && !srgb) return texture::Format::BC5_UNORM;
+        if (name == "bc7") return srgb ? texture::Format::BC7_SRGB : texture::Format::BC7_UNORM;
+        return std::nullopt;
+    }
+
+    // deterministic mix of smooth gradients and noise so every encoder path gets exercised
+    texcook::Image benchmarkImage(uint32_t size) {
+        texcook::Image image;
+        image.width = image.height = size;
+        image.rgba.resize(size_t{size} * size * 4);
+
+        uint32_t state = 0x9E3779B9u;
+        for (uint32_t y = 0; y < size; y++) {
+            for (uint32_t x = 0; x < size; x++) {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+
+                uint8_t *p = image.rgba.data() + (size_t{y} * size + x) * 4;
+                p[0] = static_cast<uint8_t>(x * 255 / size);
+                p[1] = static_cast<uint8_t>(y * 255 / size);
+                p[2] = static_cast<uint8_t>(((x / 16 + y / 16) & 1) ? state & 0xFF : 128);
+                p[3] = static_cast<uint8_t>(255 - (state >> 24) % 64);
+            }
+        }
+        return image;
+    }
+
+    int runBenchmark(const texcook::CookSettings &settings, uint32_t size, uint32_t iterations) {
+        std::vector<texcook::Image> layers{benchmarkImage(size)};
+        texcook::MipChains mips = texcook::buildMips(layers, settings);
+
+        uint64_t pixels = 0;
+        for (const auto &level : mips[0]) pixels += uint64_t{level.width} * level.height;
+
+        double best = 1e30;
+        size_t outputSize = 0;
+        for (uint32_t i = 0; i < iterations; i++) {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::byte> out = texcook::cook(mips, settings);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            best = std::min(best, elapsed.count());
+            outputSize = out.size();
+        }
+
+        std::printf("%ux%u with %u mips: %.2f ms, %.1f Mpixel/s, %.1f MB/s output (best of %u)\n",
+                    size, size, static_cast<unsigned>(mips[0].size()), best * 1000.0,
+                    static_cast<double>(pixels) / best / 1e6, static_cast<double>(outputSize) / best / 1e6, iterations);
+        return 0;
+    }
+}// namespace
+
+int main(int argc, char **argv) {
+    texcook::CookSettings settings{};
+    std::string formatName = "bc7";
+    bool srgb = false;
+    bool bench = false;
+    uint32_t benchSize = 2048;
+    uint32_t iterations = 5;
+    std::vector<std::string> inputs;
+    std::string output;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        auto value = [&]() -> std::string_view {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "missing value for %s\n", argv[i]);
+                std::exit(EXIT_FAILURE);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            usage();
+            return EXIT_SUCCESS;
+        } else if (arg == "-f" || arg == "--format") {
+            formatName = value();
+        } else if (arg == "--srgb") {
+            srgb = true;
+        } else if (arg == "--no-mips") {
+            settings.generateMips = false;
+        } else if (arg == "-j" || arg == "--threads") {
+            settings.threads = static_cast<uint32_t>(std::stoul(std::string(value())));
+        } else if (arg == "-o" || arg == "--output") {
+            output = value();
+        } else if (arg == "--bench") {
+            bench = true;
+        } else if (arg == "--size") {
+            benchSize = static_cast<uint32_t>(std::stoul(std::string(value())));
+        } else if (arg == "--iterations") {
+            iterations = std::max(1u, static_cast<uint32_t>(std::stoul(std::string(value()))));
+        } else {
+            inputs.emplace_back(arg);
+        }
+    }
+
+    auto format = parseFormat(formatName, srgb);
+    if (!format) {
+        std::fprintf(stderr, "unsupported format '%s'%s\n", formatName.c_str(), srgb ? " (with --srgb)" : "");
+        return EXIT_FAILURE;
+    }
+    settings.format = *format;
+
+    try {
+        if (bench) {
+            return runBenchmark(settings, benchSize, iterations);
+        }
+
+        if (inputs.empty() || output.empty()) {
+            usage();
+            return EXIT_FAILURE;
+        }
+
+        std::vector<texcook::Image> layers;
+        for (const auto &input : inputs) {
+            layers.push_back(texcook::loadTga(input));
+        }
+
+        std::vector<std::byte> cooked = texcook::cook(texcook::buildMips(layers, settings), settings);
+
+        std::ofstream file(output, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(cooked.data()), static_cast<std::streamsize>(cooked.size()));
+        if (!file) {
+            std::fprintf(stderr, "failed to write %s\n", output.c_str());
+            return EXIT_FAILURE;
+        }
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}